@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench.h"
+#include "encoder.h"
+
+uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int bench_compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double bench_percentile(const double *sorted, int count, double pct)
+{
+    // nearest-rank percentile
+    int rank = (int)(pct / 100.0 * count + 0.999999);
+    if(rank < 1)
+        rank = 1;
+    if(rank > count)
+        rank = count;
+    return sorted[rank - 1];
+}
+
+void bench_summarize(double *samples, int count, BenchSummary *out)
+{
+    out->samples = count;
+    out->min_ns = out->median_ns = out->p99_ns = out->mean_ns = 0.0;
+    if(count <= 0)
+        return;
+
+    qsort(samples, count, sizeof(double), bench_compare_double);
+
+    double sum = 0.0;
+    for(int i = 0; i < count; ++i)
+    {
+        sum += samples[i];
+    }
+
+    out->min_ns = samples[0];
+    out->median_ns = (count % 2) ? samples[count / 2]
+                                 : 0.5 * (samples[count / 2 - 1] + samples[count / 2]);
+    out->p99_ns = bench_percentile(samples, count, 99.0);
+    out->mean_ns = sum / count;
+}
+
+// ================================================================= //
+//                           GUEST IMAGES                            //
+// ================================================================= //
+
+int bench_guest_load(BenchGuest *g, char *filename, size_t memory_size, int rvc)
+{
+    memset(g, 0, sizeof(*g));
+
+    g->program = (AssemblyProgram *)calloc(1, sizeof(AssemblyProgram));
+    if(!g->program)
+    {
+        printf("[ERROR] bench: program allocation failed\n");
+        return -1;
+    }
+
+    if(read_asm_file(filename, g->program) < 0)
+        return -1;
+    if(rvc && compress_program(g->program) < 0)
+        return -1;
+
+    if(g->program->instruction_count == 0)
+    {
+        printf("[ERROR] bench: '%s' has no instructions\n", filename);
+        return -1;
+    }
+
+    g->code = (uint32_t *)malloc(sizeof(uint32_t) * g->program->instruction_count);
+    if(!g->code)
+    {
+        printf("[ERROR] bench: code allocation failed\n");
+        return -1;
+    }
+
+    for(int i = 0; i < g->program->instruction_count; ++i)
+    {
+        Instruction *instr = &g->program->instructions[i];
+        g->code[i] = encode_instruction_traced(g->program, instr, 0);
+        if(g->code[i] == 0)
+        {
+            printf("[ERROR] bench: encoding failed in '%s' (line %d)\n", filename, instr->line_number);
+            return -1;
+        }
+    }
+
+    g->memory = memory_init(memory_size);
+    if(g->memory.size == 0)
+        return -1;
+
+    if((size_t)g->program->code_size >= memory_size)
+    {
+        printf("[ERROR] bench: '%s' does not fit in %zu bytes of memory\n", filename, memory_size);
+        return -1;
+    }
+
+    return 0;
+}
+
+void bench_guest_reset(BenchGuest *g, CPU *cpu)
+{
+    uint32_t data_offset = g->program->code_size;
+
+    memory_mark_dirty(&g->memory, 0, g->memory.size);
+    memset(g->memory.data, 0, g->memory.size);
+    load_program_into_memory(&g->memory, g->code, g->program->instruction_count, 0);
+    load_data_into_memory(&g->memory, g->program, data_offset);
+
+    cpu_init_with_program(cpu, &g->memory, g->program);
+    cpu->trace = 0;
+}
+
+void bench_guest_free(BenchGuest *g)
+{
+    free(g->program);
+    free(g->code);
+    memory_free(&g->memory);
+    g->program = NULL;
+    g->code = NULL;
+}
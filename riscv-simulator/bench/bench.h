@@ -0,0 +1,48 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "assembler.h"
+#include "cpu.h"
+#include "memory.h"
+
+/**
+ * Host-side benchmarking helpers shared by the benchmark tools.
+ *
+ * Samples are wall-clock durations taken with the monotonic clock; a sample
+ * usually covers a batch of operations so that clock overhead stays far
+ * below the measured time.
+ **/
+
+typedef struct
+{
+    int samples;
+    double min_ns;
+    double median_ns;
+    double p99_ns;
+    double mean_ns;
+} BenchSummary;
+
+// an assembled guest program and the memory image it runs in
+typedef struct
+{
+    AssemblyProgram *program;
+    uint32_t *code;
+    Memory memory;
+} BenchGuest;
+
+uint64_t bench_now_ns(void);
+
+// sorts `samples` in place
+void bench_summarize(double *samples, int count, BenchSummary *out);
+
+// parse + encode (without tracing) and allocate `memory_size` bytes of memory;
+// `rvc` assembles every instruction that has a 16-bit form compressed
+int bench_guest_load(BenchGuest *g, char *filename, size_t memory_size, int rvc);
+// restore the initial memory image and prepare `cpu` to run it (tracing off)
+void bench_guest_reset(BenchGuest *g, CPU *cpu);
+void bench_guest_free(BenchGuest *g);
+
+#endif // BENCH_H
@@ -0,0 +1,333 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench.h"
+#include "bench_results.h"
+
+#ifndef BENCH_GIT_REVISION
+#define BENCH_GIT_REVISION "unknown"
+#endif
+
+#ifndef BENCH_BUILD_TYPE
+#define BENCH_BUILD_TYPE "unknown"
+#endif
+
+#define BENCH_JSON_LINE_MAX 4096
+
+// the measured spread is scaled by this factor before it is used as threshold
+#define BENCH_NOISE_FACTOR 3.0
+
+// ================================================================= //
+//                             RUN INFO                              //
+// ================================================================= //
+
+static void bench_copy(char *dst, size_t size, const char *src)
+{
+    snprintf(dst, size, "%s", src ? src : "");
+}
+
+static void bench_host_cpu(char *out, size_t size)
+{
+    bench_copy(out, size, "unknown");
+
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    if(!f)
+        return;
+
+    char line[512];
+    while(fgets(line, sizeof(line), f))
+    {
+        if(strncmp(line, "model name", 10) != 0)
+            continue;
+
+        char *value = strchr(line, ':');
+        if(!value)
+            continue;
+
+        value++;
+        while(*value == ' ' || *value == '\t')
+            value++;
+        value[strcspn(value, "\r\n")] = '\0';
+        bench_copy(out, size, value);
+        break;
+    }
+    fclose(f);
+}
+
+void bench_run_info_init(BenchRunInfo *info, const char *revision, const char *build_type)
+{
+    memset(info, 0, sizeof(*info));
+
+    time_t now = time(NULL);
+    struct tm utc;
+    gmtime_r(&now, &utc);
+    strftime(info->timestamp, sizeof(info->timestamp), "%Y-%m-%dT%H:%M:%SZ", &utc);
+
+    bench_copy(info->revision, sizeof(info->revision),
+               (revision && revision[0]) ? revision : BENCH_GIT_REVISION);
+    bench_copy(info->build_type, sizeof(info->build_type),
+               (build_type && build_type[0]) ? build_type : BENCH_BUILD_TYPE);
+    bench_host_cpu(info->host_cpu, sizeof(info->host_cpu));
+}
+
+// ================================================================= //
+//                             RECORDS                               //
+// ================================================================= //
+
+void bench_record_finalize(BenchRecord *rec)
+{
+    double sorted[BENCH_RESULT_MAX_SAMPLES];
+    memcpy(sorted, rec->wall_ms, sizeof(double) * rec->sample_count);
+
+    BenchSummary s;
+    bench_summarize(sorted, rec->sample_count, &s);
+
+    rec->wall_ms_median = s.median_ns;
+    rec->wall_ms_p99 = s.p99_ns;
+    rec->wall_ms_min = s.min_ns;
+    rec->mips_median = (s.median_ns > 0.0) ? (double)rec->instructions / (s.median_ns * 1000.0) : 0.0;
+}
+
+static void bench_json_write_string(FILE *out, const char *s)
+{
+    fputc('"', out);
+    for(; *s; ++s)
+    {
+        if(*s == '"' || *s == '\\')
+            fputc('\\', out);
+        if((unsigned char)*s >= 0x20)
+            fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+int bench_record_write_json(const BenchRecord *rec, FILE *out)
+{
+    fprintf(out, "{\"timestamp\": ");
+    bench_json_write_string(out, rec->run.timestamp);
+    fprintf(out, ", \"revision\": ");
+    bench_json_write_string(out, rec->run.revision);
+    fprintf(out, ", \"build_type\": ");
+    bench_json_write_string(out, rec->run.build_type);
+    fprintf(out, ", \"host_cpu\": ");
+    bench_json_write_string(out, rec->run.host_cpu);
+    fprintf(out, ", \"benchmark\": ");
+    bench_json_write_string(out, rec->benchmark);
+
+    fprintf(out, ", \"instructions\": %u, \"samples\": %d", rec->instructions, rec->sample_count);
+    fprintf(out, ", \"mips_median\": %.3f", rec->mips_median);
+    fprintf(out, ", \"wall_ms_median\": %.4f, \"wall_ms_p99\": %.4f, \"wall_ms_min\": %.4f",
+            rec->wall_ms_median, rec->wall_ms_p99, rec->wall_ms_min);
+
+    fprintf(out, ", \"wall_ms_samples\": [");
+    for(int i = 0; i < rec->sample_count; ++i)
+    {
+        fprintf(out, "%s%.4f", i ? ", " : "", rec->wall_ms[i]);
+    }
+    fprintf(out, "]}\n");
+
+    return ferror(out) ? -1 : 0;
+}
+
+// ================================================================= //
+//                           JSON READING                            //
+// ================================================================= //
+// Only the flat objects written above are understood: a key is located
+// by its quoted name and the value that follows the colon is parsed.
+
+static const char *bench_json_value(const char *line, const char *key)
+{
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\"", key);
+
+    const char *p = strstr(line, pattern);
+    if(!p)
+        return NULL;
+
+    p += strlen(pattern);
+    while(*p == ' ' || *p == '\t')
+        p++;
+    if(*p != ':')
+        return NULL;
+    p++;
+    while(*p == ' ' || *p == '\t')
+        p++;
+    return p;
+}
+
+static int bench_json_string(const char *line, const char *key, char *out, size_t size)
+{
+    const char *p = bench_json_value(line, key);
+    if(!p || *p != '"')
+        return -1;
+
+    size_t n = 0;
+    for(p++; *p && *p != '"'; ++p)
+    {
+        if(*p == '\\' && p[1])
+            p++;
+        if(n + 1 < size)
+            out[n++] = *p;
+    }
+    out[n] = '\0';
+    return (*p == '"') ? 0 : -1;
+}
+
+static int bench_json_number(const char *line, const char *key, double *out)
+{
+    const char *p = bench_json_value(line, key);
+    if(!p)
+        return -1;
+
+    char *end;
+    *out = strtod(p, &end);
+    return (end == p) ? -1 : 0;
+}
+
+static int bench_json_array(const char *line, const char *key, double *out, int max)
+{
+    const char *p = bench_json_value(line, key);
+    if(!p || *p != '[')
+        return -1;
+
+    int count = 0;
+    p++;
+    while(*p && *p != ']' && count < max)
+    {
+        char *end;
+        double v = strtod(p, &end);
+        if(end == p)
+            return -1;
+        out[count++] = v;
+
+        p = end;
+        while(*p == ' ' || *p == ',')
+            p++;
+    }
+    return count;
+}
+
+static int bench_record_parse(const char *line, BenchRecord *rec)
+{
+    memset(rec, 0, sizeof(*rec));
+
+    double instructions = 0.0;
+    if(bench_json_string(line, "benchmark", rec->benchmark, sizeof(rec->benchmark)) < 0 ||
+       bench_json_number(line, "instructions", &instructions) < 0)
+        return -1;
+    rec->instructions = (uint32_t)instructions;
+
+    // run information is informational only
+    bench_json_string(line, "timestamp", rec->run.timestamp, sizeof(rec->run.timestamp));
+    bench_json_string(line, "revision", rec->run.revision, sizeof(rec->run.revision));
+    bench_json_string(line, "build_type", rec->run.build_type, sizeof(rec->run.build_type));
+    bench_json_string(line, "host_cpu", rec->run.host_cpu, sizeof(rec->run.host_cpu));
+
+    int count = bench_json_array(line, "wall_ms_samples", rec->wall_ms, BENCH_RESULT_MAX_SAMPLES);
+    if(count <= 0)
+        return -1;
+
+    rec->sample_count = count;
+    bench_record_finalize(rec);
+    return 0;
+}
+
+int bench_records_load(const char *path, BenchRecord *records, int max_records)
+{
+    FILE *f = fopen(path, "r");
+    if(!f)
+        return -1;
+
+    char line[BENCH_JSON_LINE_MAX];
+    int count = 0;
+    int line_number = 0;
+    while(fgets(line, sizeof(line), f))
+    {
+        line_number++;
+        if(line[strspn(line, " \t\r\n")] == '\0')
+            continue;
+
+        if(count == max_records)
+        {
+            // keep the most recent records: drop the oldest one
+            memmove(&records[0], &records[1], sizeof(BenchRecord) * (max_records - 1));
+            count--;
+        }
+
+        if(bench_record_parse(line, &records[count]) < 0)
+        {
+            printf("[WARN] bench: %s:%d is not a benchmark record, skipped\n", path, line_number);
+            continue;
+        }
+        count++;
+    }
+
+    fclose(f);
+    return count;
+}
+
+const BenchRecord *bench_records_find(const BenchRecord *records, int count, const char *benchmark)
+{
+    for(int i = count - 1; i >= 0; --i)
+    {
+        if(strcmp(records[i].benchmark, benchmark) == 0)
+            return &records[i];
+    }
+    return NULL;
+}
+
+// ================================================================= //
+//                            COMPARISON                             //
+// ================================================================= //
+
+// median absolute deviation relative to the median
+static double bench_relative_spread(const BenchRecord *rec)
+{
+    if(rec->sample_count < 2 || rec->wall_ms_median <= 0.0)
+        return 0.0;
+
+    double dev[BENCH_RESULT_MAX_SAMPLES];
+    for(int i = 0; i < rec->sample_count; ++i)
+    {
+        dev[i] = fabs(rec->wall_ms[i] - rec->wall_ms_median);
+    }
+
+    BenchSummary s;
+    bench_summarize(dev, rec->sample_count, &s);
+    return s.median_ns / rec->wall_ms_median;
+}
+
+BenchComparison bench_compare(const BenchRecord *baseline, const BenchRecord *current, double min_threshold)
+{
+    BenchComparison c = { BENCH_VERDICT_NO_BASELINE, 0.0, min_threshold };
+    if(!baseline || baseline->mips_median <= 0.0)
+        return c;
+
+    double noise = BENCH_NOISE_FACTOR * fmax(bench_relative_spread(baseline),
+                                             bench_relative_spread(current));
+    c.threshold = fmax(min_threshold, noise);
+    c.change = current->mips_median / baseline->mips_median - 1.0;
+
+    if(c.change < -c.threshold)
+        c.verdict = BENCH_VERDICT_REGRESSION;
+    else if(c.change > c.threshold)
+        c.verdict = BENCH_VERDICT_IMPROVED;
+    else
+        c.verdict = BENCH_VERDICT_OK;
+    return c;
+}
+
+const char *bench_verdict_name(BenchVerdict verdict)
+{
+    switch(verdict)
+    {
+        case BENCH_VERDICT_OK:          return "ok";
+        case BENCH_VERDICT_IMPROVED:    return "improved";
+        case BENCH_VERDICT_REGRESSION:  return "REGRESSION";
+        case BENCH_VERDICT_NO_BASELINE: return "new";
+    }
+    return "?";
+}
@@ -0,0 +1,81 @@
+#ifndef BENCH_RESULTS_H
+#define BENCH_RESULTS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Machine-readable benchmark results.
+ *
+ * Results are stored as JSON lines, one object per benchmark per run:
+ *
+ *   {"timestamp": "...", "revision": "...", "build_type": "...",
+ *    "host_cpu": "...", "benchmark": "sieve.asm", "instructions": N,
+ *    "samples": R, "mips_median": ..., "wall_ms_median": ...,
+ *    "wall_ms_p99": ..., "wall_ms_min": ..., "wall_ms_samples": [...]}
+ *
+ * Keeping the raw samples lets the compare mode estimate run-to-run noise
+ * instead of relying on a fixed threshold only.
+ **/
+
+#define BENCH_RESULT_MAX_SAMPLES 64
+#define BENCH_RESULT_MAX_RECORDS 256
+
+typedef struct
+{
+    char timestamp[32];
+    char revision[64];
+    char build_type[32];
+    char host_cpu[128];
+} BenchRunInfo;
+
+typedef struct
+{
+    BenchRunInfo run;
+    char benchmark[64];
+    uint32_t instructions;
+
+    int sample_count;
+    double wall_ms[BENCH_RESULT_MAX_SAMPLES];
+
+    double mips_median;
+    double wall_ms_median;
+    double wall_ms_p99;
+    double wall_ms_min;
+} BenchRecord;
+
+typedef enum
+{
+    BENCH_VERDICT_OK = 0,
+    BENCH_VERDICT_IMPROVED,
+    BENCH_VERDICT_REGRESSION,
+    BENCH_VERDICT_NO_BASELINE
+} BenchVerdict;
+
+typedef struct
+{
+    BenchVerdict verdict;
+    double change;          // relative MIPS change vs. baseline (+0.05 = 5% faster)
+    double threshold;       // relative change needed to report a difference
+} BenchComparison;
+
+void bench_run_info_init(BenchRunInfo *info, const char *revision, const char *build_type);
+
+// fills the summary fields from the samples
+void bench_record_finalize(BenchRecord *rec);
+
+int bench_record_write_json(const BenchRecord *rec, FILE *out);
+
+// loads every record of a JSON lines file; returns the record count or -1
+int bench_records_load(const char *path, BenchRecord *records, int max_records);
+
+// the most recent record for `benchmark`, or NULL
+const BenchRecord *bench_records_find(const BenchRecord *records, int count, const char *benchmark);
+
+// noise-aware comparison: differences below max(min_threshold, noise) are
+// reported as OK, where noise is derived from the spread of both sample sets
+BenchComparison bench_compare(const BenchRecord *baseline, const BenchRecord *current, double min_threshold);
+
+const char *bench_verdict_name(BenchVerdict verdict);
+
+#endif // BENCH_RESULTS_H
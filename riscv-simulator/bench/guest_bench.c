@@ -0,0 +1,336 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "bench_results.h"
+#include "cpu.h"
+#include "memory.h"
+#include "perf_counters.h"
+
+/**
+ * Guest benchmark runner.
+ *
+ * Runs long self-checking guest programs (tests/bench/<name>.asm) with tracing
+ * off and reports instructions executed, wall time and MIPS per program.
+ * Every program writes its self-check status into the first word of its
+ * .data section: 1 means the computed result matched the expected one.
+ **/
+
+#define GUEST_BENCH_MEMORY_SIZE (64 * 1024)
+#define GUEST_BENCH_MAX_INSTRUCTIONS 200000000u
+#define GUEST_BENCH_REPEAT 3
+#define GUEST_BENCH_THRESHOLD 0.05
+
+typedef struct
+{
+    size_t memory_size;
+    uint32_t max_instructions;
+    int repeat;
+
+    const char *json_path;          // append results as JSON lines
+    const char *baseline_path;      // compare against these results
+    double threshold;               // minimum relative change reported
+    const char *revision;
+    const char *build_type;
+    int rvc;                        // assemble compressed (--rvc)
+
+    PerfCounters *perf;             // host counters around cpu_run, or NULL
+} GuestBenchOptions;
+
+static const char *guest_bench_basename(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+// returns 0 when the program ran and passed its self-check; `rec` then
+// holds one wall-time sample per repetition and `perf` the summed counters
+static int guest_bench_run(char *filename, const GuestBenchOptions *opts, BenchRecord *rec, PerfSample *perf)
+{
+    const char *name = guest_bench_basename(filename);
+    // a compressed run is its own benchmark, not a change to the 32-bit one
+    snprintf(rec->benchmark, sizeof(rec->benchmark), "%s%s", name, opts->rvc ? "+rvc" : "");
+    name = rec->benchmark;
+
+    BenchGuest guest;
+    if(bench_guest_load(&guest, filename, opts->memory_size, opts->rvc) < 0)
+    {
+        printf("%-24s %-6s\n", name, "ERROR");
+        bench_guest_free(&guest);
+        return -1;
+    }
+
+    CPU cpu;
+    int failed = 0;
+    uint32_t retired = 0;
+    int32_t status = 0;
+
+    rec->sample_count = 0;
+    perf_sample_clear(perf);
+    for(int i = 0; i < opts->repeat && !failed; ++i)
+    {
+        bench_guest_reset(&guest, &cpu);
+        cpu.max_instructions = opts->max_instructions;
+
+        if(opts->perf)
+            perf_counters_start(opts->perf);
+
+        uint64_t start = bench_now_ns();
+        int rc = cpu_run(&cpu);
+        rec->wall_ms[rec->sample_count++] = (double)(bench_now_ns() - start) / 1e6;
+
+        if(opts->perf)
+        {
+            PerfSample sample;
+            perf_counters_stop(opts->perf, &sample);
+            perf_sample_add(perf, &sample);
+        }
+
+        uint32_t data_offset = guest.program->code_size;
+        status = (int32_t)memory_read32(&guest.memory, data_offset);
+        retired = cpu.instructions_executed;
+
+        if(rc < 0 || !cpu.halted || status != 1)
+            failed = 1;
+    }
+
+    rec->instructions = retired;
+    if(failed)
+    {
+        printf("%-24s %-6s %14u   (status word = %d)\n", name, "FAIL", retired, status);
+    }
+    else
+    {
+        bench_record_finalize(rec);
+        printf("%-24s %-6s %14u %12.3f %12.3f %10.2f\n", name, "PASS", retired,
+               rec->wall_ms_median, rec->wall_ms_p99, rec->mips_median);
+    }
+
+    bench_guest_free(&guest);
+    return failed ? -1 : 0;
+}
+
+static int guest_bench_append_json(const char *path, const BenchRecord *records, int count)
+{
+    FILE *f = fopen(path, "a");
+    if(!f)
+    {
+        printf("[ERROR] guest bench: cannot open results file '%s'\n", path);
+        return -1;
+    }
+
+    int rc = 0;
+    for(int i = 0; i < count && rc == 0; ++i)
+    {
+        rc = bench_record_write_json(&records[i], f);
+    }
+
+    if(fclose(f) != 0 || rc < 0)
+    {
+        printf("[ERROR] guest bench: writing results file '%s' failed\n", path);
+        return -1;
+    }
+
+    printf("[OK] %d result(s) appended to %s\n", count, path);
+    return 0;
+}
+
+// returns the number of regressions, or -1 when the baseline is unusable
+static int guest_bench_compare(const GuestBenchOptions *opts, const BenchRecord *current, int count)
+{
+    BenchRecord *baseline = (BenchRecord *)malloc(sizeof(BenchRecord) * BENCH_RESULT_MAX_RECORDS);
+    if(!baseline)
+    {
+        printf("[ERROR] guest bench: baseline allocation failed\n");
+        return -1;
+    }
+
+    int baseline_count = bench_records_load(opts->baseline_path, baseline, BENCH_RESULT_MAX_RECORDS);
+    if(baseline_count < 0)
+    {
+        printf("[ERROR] guest bench: cannot read baseline '%s'\n", opts->baseline_path);
+        free(baseline);
+        return -1;
+    }
+
+    printf("\nComparison against %s (minimum threshold %.1f%%)\n", opts->baseline_path, opts->threshold * 100.0);
+    printf("%-24s %10s %10s %9s %9s  %s\n", "program", "base MIPS", "MIPS", "change", "noise", "verdict");
+    printf("--------------------------------------------------------------------\n");
+
+    int regressions = 0;
+    for(int i = 0; i < count; ++i)
+    {
+        const BenchRecord *base = bench_records_find(baseline, baseline_count, current[i].benchmark);
+        BenchComparison c = bench_compare(base, &current[i], opts->threshold);
+
+        if(c.verdict == BENCH_VERDICT_NO_BASELINE)
+        {
+            printf("%-24s %10s %10.2f %9s %9s  %s\n", current[i].benchmark, "-",
+                   current[i].mips_median, "-", "-", bench_verdict_name(c.verdict));
+            continue;
+        }
+
+        printf("%-24s %10.2f %10.2f %+8.1f%% %8.1f%%  %s\n", current[i].benchmark,
+               base->mips_median, current[i].mips_median, c.change * 100.0, c.threshold * 100.0,
+               bench_verdict_name(c.verdict));
+
+        if(strcmp(base->run.host_cpu, current[i].run.host_cpu) != 0 ||
+           strcmp(base->run.build_type, current[i].run.build_type) != 0)
+        {
+            printf("  [WARN] baseline was recorded on '%s' (%s build)\n",
+                   base->run.host_cpu, base->run.build_type);
+        }
+
+        if(c.verdict == BENCH_VERDICT_REGRESSION)
+            regressions++;
+    }
+
+    printf("--------------------------------------------------------------------\n");
+    printf("Regressions: %d\n", regressions);
+
+    free(baseline);
+    return regressions;
+}
+
+int main(int argc, char **argv)
+{
+    GuestBenchOptions opts = {
+        GUEST_BENCH_MEMORY_SIZE,
+        GUEST_BENCH_MAX_INSTRUCTIONS,
+        GUEST_BENCH_REPEAT,
+        NULL,
+        NULL,
+        GUEST_BENCH_THRESHOLD,
+        NULL,
+        NULL,
+        0,
+        NULL
+    };
+    int use_perf = 0;
+
+    int first_file = argc;
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--memory") == 0 && i + 1 < argc)
+            opts.memory_size = (size_t)strtoul(argv[++i], NULL, 0);
+        else if(strcmp(argv[i], "--max-instructions") == 0 && i + 1 < argc)
+            opts.max_instructions = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if(strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+            opts.repeat = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+            opts.json_path = argv[++i];
+        else if(strcmp(argv[i], "--compare") == 0 && i + 1 < argc)
+            opts.baseline_path = argv[++i];
+        else if(strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+            opts.threshold = atof(argv[++i]) / 100.0;
+        else if(strcmp(argv[i], "--revision") == 0 && i + 1 < argc)
+            opts.revision = argv[++i];
+        else if(strcmp(argv[i], "--build-type") == 0 && i + 1 < argc)
+            opts.build_type = argv[++i];
+        else if(strcmp(argv[i], "--rvc") == 0)
+            opts.rvc = 1;
+        else if(strcmp(argv[i], "--perf") == 0)
+            use_perf = 1;
+        else
+        {
+            first_file = i;
+            break;
+        }
+    }
+
+    int file_count = argc - first_file;
+    if(file_count <= 0 || opts.repeat <= 0 || opts.repeat > BENCH_RESULT_MAX_SAMPLES ||
+       opts.memory_size == 0 || opts.threshold < 0.0)
+    {
+        printf("Usage: %s [--memory bytes] [--max-instructions N] [--repeat N (max %d)]\n"
+               "          [--json results.jsonl] [--compare baseline.jsonl] [--threshold percent]\n"
+               "          [--revision rev] [--build-type type] [--perf] [--rvc] <file.asm>...\n",
+               argv[0], BENCH_RESULT_MAX_SAMPLES);
+        return 1;
+    }
+
+    BenchRecord *records = (BenchRecord *)calloc((size_t)file_count, sizeof(BenchRecord));
+    PerfSample *perf_samples = (PerfSample *)calloc((size_t)file_count, sizeof(PerfSample));
+    if(!records || !perf_samples)
+    {
+        printf("[ERROR] guest bench: result allocation failed\n");
+        free(records);
+        free(perf_samples);
+        return 1;
+    }
+
+    BenchRunInfo run;
+    bench_run_info_init(&run, opts.revision, opts.build_type);
+
+    printf("=================================================================\n");
+    printf("        RISC-V Assembly Simulator - Guest Benchmarks\n");
+    printf("=================================================================\n");
+    printf("Revision: %s, build: %s, host: %s\n", run.revision, run.build_type, run.host_cpu);
+    printf("Memory: %zu bytes, instruction limit: %u, repeat: %d (median reported)\n",
+           opts.memory_size, opts.max_instructions, opts.repeat);
+
+    PerfCounters counters;
+    if(use_perf)
+    {
+        int opened = perf_counters_open(&counters);
+        if(opened > 0)
+        {
+            opts.perf = &counters;
+            printf("Host counters: %d/%d available\n", opened, PERF_COUNTER_COUNT);
+        }
+        else
+        {
+            printf("Host counters: unavailable (perf_event_open not permitted), continuing without\n");
+        }
+    }
+    printf("\n");
+
+    printf("%-24s %-6s %14s %12s %12s %10s\n", "program", "status", "instructions", "median ms", "p99 ms", "MIPS");
+    printf("--------------------------------------------------------------------------------\n");
+
+    int pass = 0;
+    int fail = 0;
+    for(int i = first_file; i < argc; ++i)
+    {
+        BenchRecord *rec = &records[pass];
+        rec->run = run;
+        if(guest_bench_run(argv[i], &opts, rec, &perf_samples[pass]) == 0)
+            pass++;
+        else
+            fail++;
+    }
+
+    printf("--------------------------------------------------------------------------------\n");
+    printf("Summary: total=%d pass=%d fail=%d\n", pass + fail, pass, fail);
+
+    if(opts.perf)
+    {
+        printf("\n");
+        perf_print_header("program");
+        printf("-------------------------------------------------------------------------------------------------------------------\n");
+        for(int i = 0; i < pass; ++i)
+        {
+            double guest = (double)records[i].instructions * perf_samples[i].samples;
+            perf_print_row(records[i].benchmark, &perf_samples[i], guest, "guest insn");
+        }
+        perf_counters_close(opts.perf);
+    }
+
+    // only passing programs produce results worth keeping
+    int rc = fail ? 1 : 0;
+    if(opts.json_path && pass > 0 && guest_bench_append_json(opts.json_path, records, pass) < 0)
+        rc = 1;
+
+    if(opts.baseline_path)
+    {
+        int regressions = guest_bench_compare(&opts, records, pass);
+        if(regressions != 0)
+            rc = 1;
+    }
+
+    free(perf_samples);
+    free(records);
+    return rc;
+}
@@ -0,0 +1,495 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "assembler.h"
+#include "bench.h"
+#include "cpu.h"
+#include "encoder.h"
+#include "memory.h"
+#include "perf_counters.h"
+#include "snapshot.h"
+#include "undo.h"
+
+/**
+ * Micro-benchmarks for the simulator stages.
+ *
+ * Every benchmark is timed in batches: the batch size is calibrated so one
+ * sample takes at least BENCH_MIN_SAMPLE_NS, then BENCH_WARMUP_SAMPLES are
+ * discarded and BENCH_SAMPLES are kept. Results are reported per operation.
+ * With --perf the host hardware counters are collected over the kept samples
+ * and reported per guest instruction (or per operation for stages that do
+ * not execute guest code).
+ **/
+
+#define BENCH_MEMORY_SIZE 400
+#define BENCH_WARMUP_SAMPLES 20
+#define BENCH_SAMPLES 200
+#define BENCH_MIN_SAMPLE_NS 20000.0
+#define BENCH_MAX_BATCH (1 << 22)
+
+typedef struct
+{
+    char *filename;
+
+    BenchGuest guest;
+    AssemblyProgram *scratch;       // parse target for read_asm_file
+    CPU cpu;
+    CpuSnapshot snapshot;           // taken on first use, turns on dirty tracking
+    UndoLog undo;
+
+    // straight-line instruction mix for cpu_execute (no control flow)
+    EncodedInstruction exec_mix[8];
+    int exec_mix_count;
+} BenchFixture;
+
+// a benchmark body runs `ops` operations and returns the number of guest
+// instructions retired (0 when the operation does not execute guest code)
+typedef uint64_t (*BenchFn)(BenchFixture *f, int ops);
+
+typedef struct
+{
+    const char *name;
+    BenchFn fn;
+} BenchCase;
+
+// host counters of one benchmark, normalized when printed
+typedef struct
+{
+    const char *name;
+    PerfSample sample;
+    double units;
+    const char *unit_name;
+} BenchPerfRow;
+
+static volatile uint32_t bench_sink;
+
+// ================================================================= //
+//                             FIXTURE                               //
+// ================================================================= //
+
+static void bench_reset_cpu(BenchFixture *f)
+{
+    bench_guest_reset(&f->guest, &f->cpu);
+}
+
+static int bench_build_exec_mix(BenchFixture *f)
+{
+    static const char *mix[][4] = {
+        {"add",  "x10", "x10", "x12"},
+        {"addi", "x12", "x12", "1"},
+        {"mul",  "x13", "x10", "x12"},
+        {"xor",  "x14", "x13", "x10"},
+        {"lw",   "x15", "0(x0)", ""},
+        {"sw",   "x15", "4(x0)", ""},
+        {"sub",  "x11", "x14", "x15"},
+        {"lui",  "x16", "0x12", ""},
+    };
+
+    f->exec_mix_count = 0;
+    for(size_t i = 0; i < sizeof(mix) / sizeof(mix[0]); ++i)
+    {
+        Instruction instr = {0};
+        strncpy(instr.opcode, mix[i][0], MAX_OPCODE_SIZE - 1);
+        for(int j = 0; j < 3 && mix[i][j + 1][0] != '\0'; ++j)
+        {
+            strncpy(instr.operands[j], mix[i][j + 1], MAX_OPERAND_SIZE - 1);
+            instr.operand_count++;
+        }
+
+        uint32_t code = encode_instruction_traced(f->guest.program, &instr, 0);
+        if(code == 0)
+            return -1;
+
+        f->exec_mix[f->exec_mix_count++].value = code;
+    }
+    return 0;
+}
+
+static int bench_fixture_init(BenchFixture *f, char *filename)
+{
+    memset(f, 0, sizeof(*f));
+    f->filename = filename;
+
+    f->scratch = (AssemblyProgram *)calloc(1, sizeof(AssemblyProgram));
+    if(!f->scratch)
+    {
+        printf("[ERROR] bench: program allocation failed\n");
+        return -1;
+    }
+
+    if(bench_guest_load(&f->guest, filename, BENCH_MEMORY_SIZE, 0) < 0)
+        return -1;
+
+    bench_reset_cpu(f);
+
+    if(undo_init(&f->undo, UNDO_DEFAULT_CAPACITY, 0, UNDO_DEFAULT_KEYFRAMES) < 0)
+        return -1;
+
+    return bench_build_exec_mix(f);
+}
+
+static void bench_fixture_free(BenchFixture *f)
+{
+    free(f->scratch);
+    snapshot_free(&f->snapshot);
+    undo_free(&f->undo);
+    bench_guest_free(&f->guest);
+}
+
+// ================================================================= //
+//                            BENCHMARKS                             //
+// ================================================================= //
+
+static uint64_t bench_fetch(BenchFixture *f, int ops)
+{
+    int n = f->guest.program->instruction_count;
+    uint32_t acc = 0;
+    for(int i = 0, slot = 0; i < ops; ++i)
+    {
+        f->cpu.pc = (uint32_t)slot * 4;
+        acc ^= cpu_fetch(&f->cpu).value;
+        if(++slot == n)
+            slot = 0;
+    }
+    bench_sink = acc;
+    return 0;
+}
+
+static uint64_t bench_decode(BenchFixture *f, int ops)
+{
+    int n = f->guest.program->instruction_count;
+    int acc = 0;
+    for(int i = 0, slot = 0; i < ops; ++i)
+    {
+        EncodedInstruction enc = { .value = f->guest.code[slot] };
+        acc += cpu_decode(&f->cpu, enc);
+        if(++slot == n)
+            slot = 0;
+    }
+    bench_sink = (uint32_t)acc;
+    return 0;
+}
+
+static uint64_t bench_execute(BenchFixture *f, int ops)
+{
+    int acc = 0;
+    for(int i = 0, slot = 0; i < ops; ++i)
+    {
+        acc += cpu_execute(&f->cpu, f->exec_mix[slot]);
+        if(++slot == f->exec_mix_count)
+            slot = 0;
+    }
+    bench_sink = (uint32_t)acc;
+    return (uint64_t)ops;
+}
+
+static uint64_t bench_memory_read32(BenchFixture *f, int ops)
+{
+    uint32_t limit = (uint32_t)f->guest.memory.size - 4;
+    uint32_t acc = 0;
+    for(uint32_t i = 0, addr = 0; i < (uint32_t)ops; ++i)
+    {
+        acc += memory_read32(&f->guest.memory, addr);
+        addr += 4;
+        if(addr > limit)
+            addr = 0;
+    }
+    bench_sink = acc;
+    return 0;
+}
+
+static uint64_t bench_memory_write32(BenchFixture *f, int ops)
+{
+    // keep the text section intact, only write the data area
+    uint32_t base = f->guest.program->code_size;
+    uint32_t limit = (uint32_t)f->guest.memory.size - 4;
+    for(uint32_t i = 0, addr = base; i < (uint32_t)ops; ++i)
+    {
+        memory_write32(&f->guest.memory, addr, i);
+        addr += 4;
+        if(addr > limit)
+            addr = base;
+    }
+    return 0;
+}
+
+static uint64_t bench_read_asm_file(BenchFixture *f, int ops)
+{
+    int acc = 0;
+    for(int i = 0; i < ops; ++i)
+    {
+        acc += read_asm_file(f->filename, f->scratch);
+        acc += f->scratch->instruction_count;
+    }
+    bench_sink = (uint32_t)acc;
+    return 0;
+}
+
+static uint64_t bench_encode(BenchFixture *f, int ops)
+{
+    int n = f->guest.program->instruction_count;
+    uint32_t acc = 0;
+    for(int i = 0, slot = 0; i < ops; ++i)
+    {
+        acc ^= encode_instruction_traced(f->guest.program, &f->guest.program->instructions[slot], 0);
+        if(++slot == n)
+            slot = 0;
+    }
+    bench_sink = acc;
+    return 0;
+}
+
+static uint64_t bench_cpu_run(BenchFixture *f, int ops)
+{
+    uint64_t retired = 0;
+    for(int i = 0; i < ops; ++i)
+    {
+        bench_reset_cpu(f);
+        cpu_run(&f->cpu);
+        retired += f->cpu.instructions_executed;
+    }
+    return retired;
+}
+
+static uint64_t bench_end_to_end(BenchFixture *f, int ops)
+{
+    uint64_t retired = 0;
+    for(int i = 0; i < ops; ++i)
+    {
+        AssemblyProgram *program = f->scratch;
+        if(read_asm_file(f->filename, program) < 0)
+            break;
+
+        for(int j = 0; j < program->instruction_count; ++j)
+        {
+            f->guest.code[j] = encode_instruction_traced(program, &program->instructions[j], 0);
+        }
+
+        memset(f->guest.memory.data, 0, f->guest.memory.size);
+        load_program_into_memory(&f->guest.memory, f->guest.code, program->instruction_count, 0);
+        load_data_into_memory(&f->guest.memory, program, program->code_size);
+
+        cpu_init_with_program(&f->cpu, &f->guest.memory, program);
+        f->cpu.trace = 0;
+        cpu_run(&f->cpu);
+        retired += f->cpu.instructions_executed;
+    }
+    return retired;
+}
+
+// same work as cpu_run, but the guest is reset by restoring the pages
+// dirtied since a snapshot instead of reloading the whole image
+static uint64_t bench_snapshot_run(BenchFixture *f, int ops)
+{
+    if(!f->snapshot.memory)
+    {
+        bench_reset_cpu(f);
+        if(snapshot_take(&f->snapshot, &f->cpu) < 0)
+            return 0;
+    }
+
+    uint64_t retired = 0;
+    for(int i = 0; i < ops; ++i)
+    {
+        snapshot_restore(&f->snapshot, &f->cpu);
+        cpu_run(&f->cpu);
+        retired += f->cpu.instructions_executed;
+    }
+    return retired;
+}
+
+// cpu_run with the reverse-execution undo log recording every instruction
+static uint64_t bench_undo_run(BenchFixture *f, int ops)
+{
+    uint64_t retired = 0;
+    for(int i = 0; i < ops; ++i)
+    {
+        bench_reset_cpu(f);
+        undo_reset(&f->undo, &f->cpu);
+        f->cpu.undo = &f->undo;
+        cpu_run(&f->cpu);
+        retired += f->cpu.instructions_executed;
+    }
+    f->cpu.undo = NULL;
+    return retired;
+}
+
+static const BenchCase bench_cases[] = {
+    {"cpu_fetch",          bench_fetch},
+    {"cpu_decode",         bench_decode},
+    {"cpu_execute",        bench_execute},
+    {"memory_read32",      bench_memory_read32},
+    {"memory_write32",     bench_memory_write32},
+    {"read_asm_file",      bench_read_asm_file},
+    {"encode_instruction", bench_encode},
+    {"cpu_run",            bench_cpu_run},
+    {"end_to_end",         bench_end_to_end},
+    {"snapshot_run",       bench_snapshot_run},
+    {"undo_run",           bench_undo_run},
+};
+
+// ================================================================= //
+//                              DRIVER                               //
+// ================================================================= //
+
+static int bench_calibrate(BenchFixture *f, BenchFn fn)
+{
+    int ops = 1;
+    while(ops < BENCH_MAX_BATCH)
+    {
+        uint64_t start = bench_now_ns();
+        fn(f, ops);
+        double elapsed = (double)(bench_now_ns() - start);
+        if(elapsed >= BENCH_MIN_SAMPLE_NS)
+            break;
+        ops *= 2;
+    }
+    return ops;
+}
+
+static void bench_run_case(BenchFixture *f, const BenchCase *bc, int warmup, int samples,
+                           PerfCounters *perf, BenchPerfRow *perf_row)
+{
+    double *ns_per_op = (double *)malloc(sizeof(double) * samples);
+    if(!ns_per_op)
+    {
+        printf("[ERROR] bench: sample allocation failed\n");
+        return;
+    }
+
+    int ops = bench_calibrate(f, bc->fn);
+
+    for(int i = 0; i < warmup; ++i)
+    {
+        bc->fn(f, ops);
+    }
+
+    uint64_t retired = 0;
+    uint64_t total_ns = 0;
+    if(perf)
+        perf_counters_start(perf);
+
+    for(int i = 0; i < samples; ++i)
+    {
+        uint64_t start = bench_now_ns();
+        retired += bc->fn(f, ops);
+        uint64_t elapsed = bench_now_ns() - start;
+
+        total_ns += elapsed;
+        ns_per_op[i] = (double)elapsed / ops;
+    }
+
+    if(perf)
+    {
+        perf_counters_stop(perf, &perf_row->sample);
+        perf_row->name = bc->name;
+        perf_row->units = retired ? (double)retired : (double)ops * samples;
+        perf_row->unit_name = retired ? "guest insn" : "op";
+    }
+
+    BenchSummary s;
+    bench_summarize(ns_per_op, samples, &s);
+
+    printf("%-20s %10d %12.1f %12.1f %12.1f", bc->name, ops, s.median_ns, s.p99_ns, s.min_ns);
+    if(retired > 0 && total_ns > 0)
+        printf(" %10.2f", (double)retired * 1000.0 / (double)total_ns);
+    else
+        printf(" %10s", "-");
+    printf("\n");
+
+    free(ns_per_op);
+}
+
+int main(int argc, char **argv)
+{
+    char *filename = NULL;
+    int warmup = BENCH_WARMUP_SAMPLES;
+    int samples = BENCH_SAMPLES;
+    const char *only = NULL;
+    int use_perf = 0;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--samples") == 0 && i + 1 < argc)
+            samples = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+            warmup = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--only") == 0 && i + 1 < argc)
+            only = argv[++i];
+        else if(strcmp(argv[i], "--perf") == 0)
+            use_perf = 1;
+        else
+            filename = argv[i];
+    }
+
+    if(!filename || samples <= 0 || warmup < 0)
+    {
+        printf("Usage: %s [--samples N] [--warmup N] [--only <benchmark>] [--perf] <file.asm>\n", argv[0]);
+        return 1;
+    }
+
+    BenchFixture fixture;
+    if(bench_fixture_init(&fixture, filename) < 0)
+    {
+        printf("[FAILED] bench: cannot prepare '%s'\n", filename);
+        bench_fixture_free(&fixture);
+        return 1;
+    }
+
+    printf("=================================================================\n");
+    printf("        RISC-V Assembly Simulator - Micro-benchmarks\n");
+    printf("=================================================================\n");
+    printf("Program: %s (%d instructions)\n", filename, fixture.guest.program->instruction_count);
+    printf("Samples: %d (+%d warm-up), clock: CLOCK_MONOTONIC\n", samples, warmup);
+
+    PerfCounters counters;
+    PerfCounters *perf = NULL;
+    if(use_perf)
+    {
+        int opened = perf_counters_open(&counters);
+        if(opened > 0)
+        {
+            perf = &counters;
+            printf("Host counters: %d/%d available\n", opened, PERF_COUNTER_COUNT);
+        }
+        else
+        {
+            printf("Host counters: unavailable (perf_event_open not permitted), continuing without\n");
+        }
+    }
+    printf("\n");
+
+    printf("%-20s %10s %12s %12s %12s %10s\n",
+           "benchmark", "ops/sample", "median ns/op", "p99 ns/op", "min ns/op", "guest MIPS");
+    printf("------------------------------------------------------------------------------------\n");
+
+    BenchPerfRow perf_rows[sizeof(bench_cases) / sizeof(bench_cases[0])];
+    int perf_row_count = 0;
+
+    for(size_t i = 0; i < sizeof(bench_cases) / sizeof(bench_cases[0]); ++i)
+    {
+        if(only && strcmp(only, bench_cases[i].name) != 0)
+            continue;
+
+        bench_run_case(&fixture, &bench_cases[i], warmup, samples, perf, &perf_rows[perf_row_count]);
+        if(perf)
+            perf_row_count++;
+    }
+
+    if(perf)
+    {
+        printf("\n");
+        perf_print_header("benchmark");
+        printf("-------------------------------------------------------------------------------------------------------------------\n");
+        for(int i = 0; i < perf_row_count; ++i)
+        {
+            perf_print_row(perf_rows[i].name, &perf_rows[i].sample, perf_rows[i].units, perf_rows[i].unit_name);
+        }
+        perf_counters_close(perf);
+    }
+
+    bench_fixture_free(&fixture);
+    return 0;
+}
@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "perf_counters.h"
+
+static const char *perf_counter_names[PERF_COUNTER_COUNT] = {
+    "cycles",
+    "host-insns",
+    "branch-misses",
+    "L1d-misses",
+    "LLC-misses",
+    "iTLB-misses",
+};
+
+const char *perf_counter_name(PerfCounterId id)
+{
+    return (id >= 0 && id < PERF_COUNTER_COUNT) ? perf_counter_names[id] : "?";
+}
+
+void perf_sample_clear(PerfSample *s)
+{
+    memset(s, 0, sizeof(*s));
+}
+
+void perf_sample_add(PerfSample *out, const PerfSample *in)
+{
+    for(int i = 0; i < PERF_COUNTER_COUNT; ++i)
+    {
+        out->value[i] += in->value[i];
+        out->valid[i] = (out->samples == 0 || out->valid[i]) && in->valid[i];
+    }
+    out->samples++;
+}
+
+void perf_print_header(const char *label)
+{
+    printf("%-20s %-10s %8s", label, "per", "IPC");
+    for(int i = PERF_INSTRUCTIONS; i < PERF_COUNTER_COUNT; ++i)
+    {
+        printf(" %14s", perf_counter_names[i]);
+    }
+    printf("\n");
+}
+
+void perf_print_row(const char *name, const PerfSample *s, double units, const char *unit_name)
+{
+    printf("%-20s %-10s", name, unit_name);
+
+    if(s->valid[PERF_CYCLES] && s->valid[PERF_INSTRUCTIONS] && s->value[PERF_CYCLES] > 0)
+        printf(" %8.2f", (double)s->value[PERF_INSTRUCTIONS] / (double)s->value[PERF_CYCLES]);
+    else
+        printf(" %8s", "n/a");
+
+    for(int i = PERF_INSTRUCTIONS; i < PERF_COUNTER_COUNT; ++i)
+    {
+        if(s->valid[i] && units > 0.0)
+            printf(" %14.4f", (double)s->value[i] / units);
+        else
+            printf(" %14s", "n/a");
+    }
+    printf("\n");
+}
+
+#ifdef __linux__
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+typedef struct
+{
+    uint32_t type;
+    uint64_t config;
+} PerfEventConfig;
+
+#define PERF_CACHE_MISS(cache) \
+    ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+static const PerfEventConfig perf_event_configs[PERF_COUNTER_COUNT] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { PERF_TYPE_HW_CACHE, PERF_CACHE_MISS(PERF_COUNT_HW_CACHE_L1D) },
+    { PERF_TYPE_HW_CACHE, PERF_CACHE_MISS(PERF_COUNT_HW_CACHE_LL) },
+    { PERF_TYPE_HW_CACHE, PERF_CACHE_MISS(PERF_COUNT_HW_CACHE_ITLB) },
+};
+
+static int perf_event_open_counter(const PerfEventConfig *cfg)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = cfg->type;
+    attr.config = cfg->config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    // this thread, any CPU
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+int perf_counters_open(PerfCounters *pc)
+{
+    pc->available = 0;
+    for(int i = 0; i < PERF_COUNTER_COUNT; ++i)
+    {
+        pc->fd[i] = perf_event_open_counter(&perf_event_configs[i]);
+        if(pc->fd[i] >= 0)
+            pc->available++;
+        else
+            pc->fd[i] = -1;
+    }
+    return pc->available;
+}
+
+void perf_counters_close(PerfCounters *pc)
+{
+    for(int i = 0; i < PERF_COUNTER_COUNT; ++i)
+    {
+        if(pc->fd[i] >= 0)
+            close(pc->fd[i]);
+        pc->fd[i] = -1;
+    }
+    pc->available = 0;
+}
+
+void perf_counters_start(PerfCounters *pc)
+{
+    for(int i = 0; i < PERF_COUNTER_COUNT; ++i)
+    {
+        if(pc->fd[i] >= 0)
+            ioctl(pc->fd[i], PERF_EVENT_IOC_RESET, 0);
+    }
+    for(int i = 0; i < PERF_COUNTER_COUNT; ++i)
+    {
+        if(pc->fd[i] >= 0)
+            ioctl(pc->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+void perf_counters_stop(PerfCounters *pc, PerfSample *out)
+{
+    for(int i = 0; i < PERF_COUNTER_COUNT; ++i)
+    {
+        if(pc->fd[i] >= 0)
+            ioctl(pc->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+    }
+
+    perf_sample_clear(out);
+    for(int i = 0; i < PERF_COUNTER_COUNT; ++i)
+    {
+        // value, time enabled, time running
+        uint64_t data[3];
+        if(pc->fd[i] < 0 || read(pc->fd[i], data, sizeof(data)) != (ssize_t)sizeof(data))
+            continue;
+
+        // a counter that never got scheduled says nothing about the region
+        if(data[2] == 0)
+            continue;
+
+        double scale = (double)data[1] / (double)data[2];
+        out->value[i] = (uint64_t)((double)data[0] * scale);
+        out->valid[i] = 1;
+    }
+}
+
+#else // !__linux__
+
+int perf_counters_open(PerfCounters *pc)
+{
+    for(int i = 0; i < PERF_COUNTER_COUNT; ++i)
+    {
+        pc->fd[i] = -1;
+    }
+    pc->available = 0;
+    return 0;
+}
+
+void perf_counters_close(PerfCounters *pc)
+{
+    pc->available = 0;
+}
+
+void perf_counters_start(PerfCounters *pc)
+{
+    (void)pc;
+}
+
+void perf_counters_stop(PerfCounters *pc, PerfSample *out)
+{
+    (void)pc;
+    perf_sample_clear(out);
+}
+
+#endif // __linux__
@@ -0,0 +1,60 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdint.h>
+
+/**
+ * Host hardware counters for the benchmark tools (Linux perf_event_open).
+ *
+ * Every counter is opened on its own for the calling thread, user space
+ * only, so a counter the host does not provide (virtual machines, containers
+ * with perf_event_paranoid or seccomp restrictions) is simply reported as
+ * unavailable while the others keep working. Values are scaled when the
+ * kernel had to multiplex counters.
+ **/
+
+typedef enum
+{
+    PERF_CYCLES = 0,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCH_MISSES,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_ITLB_MISSES,
+    PERF_COUNTER_COUNT
+} PerfCounterId;
+
+typedef struct
+{
+    int fd[PERF_COUNTER_COUNT];     // -1 when the counter is unavailable
+    int available;                  // number of counters opened
+} PerfCounters;
+
+typedef struct
+{
+    uint64_t value[PERF_COUNTER_COUNT];
+    int valid[PERF_COUNTER_COUNT];
+    int samples;                    // number of samples accumulated
+} PerfSample;
+
+// returns the number of counters that could be opened (0 = none)
+int perf_counters_open(PerfCounters *pc);
+void perf_counters_close(PerfCounters *pc);
+
+// reset and enable every available counter
+void perf_counters_start(PerfCounters *pc);
+// disable the counters and read them into `out`
+void perf_counters_stop(PerfCounters *pc, PerfSample *out);
+
+// out += in; a counter stays valid only while every added sample had it
+void perf_sample_add(PerfSample *out, const PerfSample *in);
+void perf_sample_clear(PerfSample *s);
+
+const char *perf_counter_name(PerfCounterId id);
+
+// one report row: host IPC plus every other counter divided by `units`
+// (operations or guest instructions); unavailable counters print as "n/a"
+void perf_print_header(const char *label);
+void perf_print_row(const char *name, const PerfSample *s, double units, const char *unit_name);
+
+#endif // PERF_COUNTERS_H
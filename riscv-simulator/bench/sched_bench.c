@@ -0,0 +1,348 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "cpu.h"
+#include "memory.h"
+#include "scheduler.h"
+
+/**
+ * Work-stealing scheduler benchmark.
+ *
+ * Runs --contexts independent instances of one guest program, each with its
+ * own CPU and memory, through the scheduler with 1, 2, 4, ... worker
+ * threads up to --max-workers, and for reference once as a single-threaded
+ * event loop that resumes every context for one slice in turn and once with
+ * one host thread per context. Reports wall time, aggregate MIPS and the
+ * speedup over one worker. The program follows the guest benchmark convention
+ * (tests/bench/<name>.asm): it writes 1 to the first word of its .data section
+ * when its self-check passed.
+ **/
+
+#define SCHED_BENCH_CONTEXTS 256
+#define SCHED_BENCH_MEMORY_SIZE (32 * 1024)
+#define SCHED_BENCH_MAX_INSTRUCTIONS 200000000u
+#define SCHED_BENCH_REPEAT 3
+
+typedef struct
+{
+    uint32_t contexts;
+    uint32_t max_workers;
+    uint32_t slice;
+    int repeat;
+    size_t memory_size;
+    int threads;                    // also run the thread-per-context reference
+} SchedBenchOptions;
+
+typedef struct
+{
+    CPU *cpus;
+    Memory *memories;
+    uint32_t count;
+} SchedBenchContexts;
+
+static void sched_bench_free(SchedBenchContexts *c)
+{
+    for(uint32_t i = 0; i < c->count; ++i)
+    {
+        memory_free(&c->memories[i]);
+    }
+    free(c->memories);
+    free(c->cpus);
+    memset(c, 0, sizeof(*c));
+}
+
+static int sched_bench_alloc(SchedBenchContexts *c, BenchGuest *guest, uint32_t count)
+{
+    memset(c, 0, sizeof(*c));
+    c->cpus = (CPU *)calloc(count, sizeof(CPU));
+    c->memories = (Memory *)calloc(count, sizeof(Memory));
+    if(!c->cpus || !c->memories)
+    {
+        printf("[ERROR] sched bench: cannot allocate %u contexts\n", count);
+        sched_bench_free(c);
+        return -1;
+    }
+
+    for(; c->count < count; ++c->count)
+    {
+        c->memories[c->count] = memory_init(guest->memory.size);
+        if(c->memories[c->count].size == 0)
+        {
+            printf("[ERROR] sched bench: cannot allocate the memory of context %u\n", c->count);
+            sched_bench_free(c);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// every context starts from the loaded image of `guest`
+static void sched_bench_reset(SchedBenchContexts *c, BenchGuest *guest)
+{
+    CPU reset_cpu;
+    bench_guest_reset(guest, &reset_cpu);
+
+    for(uint32_t i = 0; i < c->count; ++i)
+    {
+        memcpy(c->memories[i].data, guest->memory.data, guest->memory.size);
+        cpu_init_with_program(&c->cpus[i], &c->memories[i], guest->program);
+        c->cpus[i].trace = 0;
+        c->cpus[i].max_instructions = SCHED_BENCH_MAX_INSTRUCTIONS;
+    }
+}
+
+static int sched_bench_check(SchedBenchContexts *c, uint32_t data_offset, uint64_t *instructions)
+{
+    *instructions = 0;
+    for(uint32_t i = 0; i < c->count; ++i)
+    {
+        int32_t status = (int32_t)memory_read32(&c->memories[i], data_offset);
+        if(!c->cpus[i].halted || c->cpus[i].error || status != 1)
+        {
+            printf("[ERROR] sched bench: context %u failed its self-check (status word = %d)\n", i, status);
+            return -1;
+        }
+        *instructions += c->cpus[i].instructions_executed;
+    }
+    return 0;
+}
+
+// the cooperative baseline: one host thread, contexts resumed round-robin
+static int sched_bench_run_event_loop(SchedBenchContexts *c, uint32_t workers, uint32_t slice)
+{
+    (void)workers;
+    uint32_t live = c->count;
+    while(live > 0)
+    {
+        live = 0;
+        for(uint32_t i = 0; i < c->count; ++i)
+        {
+            CPU *cpu = &c->cpus[i];
+            if(cpu->halted || cpu->instructions_executed >= cpu->max_instructions)
+                continue;
+            if(cpu_run_for(cpu, slice) < 0)
+                return -1;
+            live++;
+        }
+    }
+    return 0;
+}
+
+static void *sched_bench_thread(void *arg)
+{
+    cpu_run((CPU *)arg);
+    return NULL;
+}
+
+// one host thread per context, the setup the scheduler replaces
+static int sched_bench_run_threads(SchedBenchContexts *c, uint32_t workers, uint32_t slice)
+{
+    (void)workers;
+    (void)slice;
+    pthread_t *threads = (pthread_t *)calloc(c->count, sizeof(pthread_t));
+    if(!threads)
+        return -1;
+
+    uint32_t started = 0;
+    for(; started < c->count; ++started)
+    {
+        if(pthread_create(&threads[started], NULL, sched_bench_thread, &c->cpus[started]) != 0)
+            break;
+    }
+    for(uint32_t i = 0; i < started; ++i)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    if(started < c->count)
+    {
+        printf("[ERROR] sched bench: started only %u of %u threads\n", started, c->count);
+        return -1;
+    }
+    return 0;
+}
+
+static int sched_bench_run_pool(SchedBenchContexts *c, uint32_t workers, uint32_t slice)
+{
+    Scheduler sched;
+    if(scheduler_init(&sched, workers, slice) < 0)
+        return -1;
+
+    int rc = 0;
+    for(uint32_t i = 0; i < c->count && rc == 0; ++i)
+    {
+        rc = scheduler_add(&sched, &c->cpus[i]);
+    }
+    if(rc == 0)
+        rc = scheduler_run(&sched);
+
+    scheduler_free(&sched);
+    return rc;
+}
+
+typedef int (*SchedBenchRun)(SchedBenchContexts *c, uint32_t workers, uint32_t slice);
+
+// median wall time of `repeat` runs in ns, 0 on failure
+static double sched_bench_measure(SchedBenchContexts *c, BenchGuest *guest, const SchedBenchOptions *opts,
+                                  SchedBenchRun run, uint32_t workers, uint64_t *instructions)
+{
+    double *samples = (double *)malloc(sizeof(double) * (size_t)opts->repeat);
+    if(!samples)
+        return 0.0;
+
+    int failed = 0;
+    uint32_t data_offset = guest->program->code_size;
+    for(int i = 0; i < opts->repeat && !failed; ++i)
+    {
+        sched_bench_reset(c, guest);
+
+        uint64_t start = bench_now_ns();
+        int rc = run(c, workers, opts->slice);
+        samples[i] = (double)(bench_now_ns() - start);
+
+        if(rc < 0 || sched_bench_check(c, data_offset, instructions) < 0)
+            failed = 1;
+    }
+
+    BenchSummary summary;
+    bench_summarize(samples, opts->repeat, &summary);
+    free(samples);
+    return failed ? 0.0 : summary.median_ns;
+}
+
+static void sched_bench_row(const char *label, uint32_t threads, uint64_t instructions, double ns, double base_mips)
+{
+    double mips = (double)instructions / ns * 1000.0;
+    printf("%-20s %8u %14llu %12.3f %10.2f %8.2fx\n", label, threads, (unsigned long long)instructions,
+           ns / 1e6, mips, base_mips > 0.0 ? mips / base_mips : 1.0);
+}
+
+int main(int argc, char **argv)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    SchedBenchOptions opts = {
+        SCHED_BENCH_CONTEXTS,
+        (cpus > 0) ? (uint32_t)cpus : 1,
+        SCHEDULER_DEFAULT_SLICE,
+        SCHED_BENCH_REPEAT,
+        SCHED_BENCH_MEMORY_SIZE,
+        1
+    };
+
+    char *filename = NULL;
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--contexts") == 0 && i + 1 < argc)
+            opts.contexts = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if(strcmp(argv[i], "--max-workers") == 0 && i + 1 < argc)
+            opts.max_workers = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if(strcmp(argv[i], "--slice") == 0 && i + 1 < argc)
+            opts.slice = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if(strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+            opts.repeat = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--memory") == 0 && i + 1 < argc)
+            opts.memory_size = (size_t)strtoul(argv[++i], NULL, 0);
+        else if(strcmp(argv[i], "--no-threads") == 0)
+            opts.threads = 0;
+        else
+            filename = argv[i];
+    }
+
+    if(opts.max_workers > SCHEDULER_MAX_WORKERS)
+        opts.max_workers = SCHEDULER_MAX_WORKERS;
+    if(!filename || opts.contexts == 0 || opts.max_workers == 0 || opts.slice == 0 || opts.repeat <= 0)
+    {
+        printf("Usage: %s [--contexts N] [--max-workers N (max %d)] [--slice instructions]\n"
+               "          [--repeat N] [--memory bytes per context] [--no-threads] <file.asm>\n",
+               argv[0], SCHEDULER_MAX_WORKERS);
+        return 1;
+    }
+
+    BenchGuest guest;
+    if(bench_guest_load(&guest, filename, opts.memory_size, 0) < 0)
+    {
+        bench_guest_free(&guest);
+        return 1;
+    }
+
+    SchedBenchContexts contexts;
+    if(sched_bench_alloc(&contexts, &guest, opts.contexts) < 0)
+    {
+        bench_guest_free(&guest);
+        return 1;
+    }
+
+    printf("=================================================================\n");
+    printf("      RISC-V Assembly Simulator - Work-Stealing Scheduler\n");
+    printf("=================================================================\n");
+    printf("Program: %s, contexts: %u, slice: %u instructions, host CPUs: %ld\n",
+           filename, opts.contexts, opts.slice, cpus);
+    printf("Memory: %zu bytes per context, repeat: %d (median reported)\n\n", opts.memory_size, opts.repeat);
+
+    printf("%-20s %8s %14s %12s %10s %9s\n", "mode", "threads", "instructions", "median ms", "MIPS", "speedup");
+    printf("------------------------------------------------------------------------------\n");
+
+    int rc = 0;
+    double base_mips = 0.0;
+    // 1, 2, 4, ... and max_workers itself
+    uint32_t workers = 1;
+    for(;;)
+    {
+        uint64_t instructions = 0;
+        double ns = sched_bench_measure(&contexts, &guest, &opts, sched_bench_run_pool, workers, &instructions);
+        if(ns <= 0.0)
+        {
+            printf("%-20s %8u %14s\n", "work-stealing", workers, "FAIL");
+            rc = 1;
+            break;
+        }
+        if(workers == 1)
+            base_mips = (double)instructions / ns * 1000.0;
+        sched_bench_row("work-stealing", workers, instructions, ns, base_mips);
+
+        if(workers == opts.max_workers)
+            break;
+        workers = (workers * 2 < opts.max_workers) ? workers * 2 : opts.max_workers;
+    }
+
+    if(rc == 0)
+    {
+        uint64_t instructions = 0;
+        double ns = sched_bench_measure(&contexts, &guest, &opts, sched_bench_run_event_loop, 1, &instructions);
+        if(ns <= 0.0)
+        {
+            printf("%-20s %8u %14s\n", "event loop", 1, "FAIL");
+            rc = 1;
+        }
+        else
+        {
+            sched_bench_row("event loop", 1, instructions, ns, base_mips);
+        }
+    }
+
+    if(opts.threads && rc == 0)
+    {
+        uint64_t instructions = 0;
+        double ns = sched_bench_measure(&contexts, &guest, &opts, sched_bench_run_threads, 0, &instructions);
+        if(ns <= 0.0)
+        {
+            printf("%-20s %8u %14s\n", "thread per context", opts.contexts, "FAIL");
+            rc = 1;
+        }
+        else
+        {
+            sched_bench_row("thread per context", opts.contexts, instructions, ns, base_mips);
+        }
+    }
+    printf("------------------------------------------------------------------------------\n");
+
+    sched_bench_free(&contexts);
+    bench_guest_free(&guest);
+    return rc;
+}
@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "cpu.h"
+#include "memory.h"
+#include "smp.h"
+
+/**
+ * Multi-hart scaling benchmark.
+ *
+ * Runs each guest program (tests/bench/smp/<name>.asm) on 1, 2, 4, ... harts up
+ * to --max-harts, free-running and synchronized every --quantum
+ * instructions, and reports wall time, aggregate MIPS and the speedup over
+ * one hart. A program gets its hart id in a0 and the hart count in a1, and
+ * writes its self-check status to data offset SMP_BENCH_STATUS + 4 * hart
+ * id: 1 means the hart's result matched the expected one. Every hart does
+ * the same amount of work, so perfect scaling keeps the time per run
+ * constant; programs that contend on shared words with atomics show what
+ * that contention costs instead.
+ **/
+
+#define SMP_BENCH_REPEAT 3
+#define SMP_BENCH_QUANTUM 10000
+#define SMP_BENCH_MAX_INSTRUCTIONS 200000000u
+#define SMP_BENCH_STATUS 256
+#define SMP_BENCH_HART_BYTES 4096   // guest memory per hart, plus one block in front
+#define SMP_BENCH_MAX_HARTS 64      // status words fit in front of the first array
+
+typedef struct
+{
+    uint32_t max_harts;
+    uint32_t quantum;
+    int repeat;
+    size_t memory_size;
+} SmpBenchOptions;
+
+// median wall time of `repeat` runs in ns, 0 on failure
+static double smp_bench_run(BenchGuest *guest, const SmpBenchOptions *opts, uint32_t harts, uint32_t quantum,
+                            uint64_t *instructions)
+{
+    double *samples = (double *)malloc(sizeof(double) * (size_t)opts->repeat);
+    if(!samples)
+        return 0.0;
+
+    int failed = 0;
+    for(int i = 0; i < opts->repeat && !failed; ++i)
+    {
+        CPU reset_cpu;
+        bench_guest_reset(guest, &reset_cpu);
+
+        SmpSystem smp;
+        if(smp_init(&smp, &guest->memory, guest->program, harts) < 0)
+        {
+            failed = 1;
+            break;
+        }
+
+        uint64_t start = bench_now_ns();
+        int rc = smp_run(&smp, SMP_BENCH_MAX_INSTRUCTIONS, quantum);
+        samples[i] = (double)(bench_now_ns() - start);
+        *instructions = smp_instructions_executed(&smp);
+
+        uint32_t data_offset = guest->program->code_size;
+        for(uint32_t h = 0; h < harts && rc == 0; ++h)
+        {
+            int32_t status = (int32_t)memory_read32(&guest->memory, data_offset + SMP_BENCH_STATUS + h * 4);
+            if(!smp.harts[h].halted || status != 1)
+            {
+                printf("[ERROR] smp bench: hart %u failed its self-check (status word = %d)\n", h, status);
+                rc = -1;
+            }
+        }
+
+        smp_free(&smp);
+        if(rc < 0)
+            failed = 1;
+    }
+
+    BenchSummary summary;
+    bench_summarize(samples, opts->repeat, &summary);
+    free(samples);
+    return failed ? 0.0 : summary.median_ns;
+}
+
+// the scaling table of one program; returns 0 if every run passed
+static int smp_bench_program(char *filename, const SmpBenchOptions *opts)
+{
+    BenchGuest guest;
+    if(bench_guest_load(&guest, filename, opts->memory_size, 0) < 0)
+    {
+        bench_guest_free(&guest);
+        return 1;
+    }
+
+    printf("Program: %s\n\n", filename);
+    printf("%-6s %-18s %14s %12s %10s %9s %11s\n", "harts", "mode", "instructions", "median ms", "MIPS",
+           "speedup", "efficiency");
+    printf("-----------------------------------------------------------------------------------\n");
+
+    int modes = opts->quantum ? 2 : 1;
+    double base_mips[2] = { 0.0, 0.0 };
+    int rc = 0;
+    // 1, 2, 4, ... and max_harts itself
+    uint32_t harts = 1;
+    for(;;)
+    {
+        for(int mode = 0; mode < modes; ++mode)
+        {
+            uint32_t quantum = mode ? opts->quantum : 0;
+            char label[32];
+            if(quantum)
+                snprintf(label, sizeof(label), "lockstep/%u", quantum);
+            else
+                snprintf(label, sizeof(label), "free-running");
+
+            uint64_t instructions = 0;
+            double ns = smp_bench_run(&guest, opts, harts, quantum, &instructions);
+            if(ns <= 0.0)
+            {
+                printf("%-6u %-18s %14s\n", harts, label, "FAIL");
+                rc = 1;
+                break;
+            }
+
+            double mips = (double)instructions / ns * 1000.0;
+            if(harts == 1)
+                base_mips[mode] = mips;
+            double speedup = mips / base_mips[mode];
+            printf("%-6u %-18s %14llu %12.3f %10.2f %8.2fx %10.0f%%\n", harts, label,
+                   (unsigned long long)instructions, ns / 1e6, mips, speedup, speedup / harts * 100.0);
+        }
+
+        if(rc != 0 || harts == opts->max_harts)
+            break;
+        harts = (harts * 2 < opts->max_harts) ? harts * 2 : opts->max_harts;
+    }
+    printf("-----------------------------------------------------------------------------------\n\n");
+
+    bench_guest_free(&guest);
+    return rc;
+}
+
+int main(int argc, char **argv)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    SmpBenchOptions opts = {
+        (cpus > 0) ? (uint32_t)cpus : 1,
+        SMP_BENCH_QUANTUM,
+        SMP_BENCH_REPEAT,
+        0
+    };
+
+    char **files = (char **)calloc((size_t)argc, sizeof(char *));
+    int file_count = 0;
+    if(!files)
+        return 1;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--max-harts") == 0 && i + 1 < argc)
+            opts.max_harts = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if(strcmp(argv[i], "--quantum") == 0 && i + 1 < argc)
+            opts.quantum = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if(strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+            opts.repeat = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--memory") == 0 && i + 1 < argc)
+            opts.memory_size = (size_t)strtoul(argv[++i], NULL, 0);
+        else
+            files[file_count++] = argv[i];
+    }
+
+    if(opts.max_harts > SMP_BENCH_MAX_HARTS)
+        opts.max_harts = SMP_BENCH_MAX_HARTS;
+    if(file_count == 0 || opts.max_harts == 0 || opts.repeat <= 0)
+    {
+        printf("Usage: %s [--max-harts N (max %d)] [--quantum instructions (0: free-running only)]\n"
+               "          [--repeat N] [--memory bytes] <file.asm>...\n", argv[0], SMP_BENCH_MAX_HARTS);
+        free(files);
+        return 1;
+    }
+    if(opts.memory_size == 0)
+        opts.memory_size = (size_t)SMP_BENCH_HART_BYTES * (opts.max_harts + 2);
+
+    printf("=================================================================\n");
+    printf("        RISC-V Assembly Simulator - Multi-Hart Scaling\n");
+    printf("=================================================================\n");
+    printf("Host CPUs: %ld, memory: %zu bytes, repeat: %d (median reported)\n\n",
+           cpus, opts.memory_size, opts.repeat);
+
+    int rc = 0;
+    for(int i = 0; i < file_count; ++i)
+    {
+        if(smp_bench_program(files[i], &opts) != 0)
+            rc = 1;
+    }
+
+    free(files);
+    return rc;
+}
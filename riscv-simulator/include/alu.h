@@ -15,9 +15,51 @@ typedef enum
     ALU_SRL, // logical right
     ALU_SRA, // arithmetic right
     ALU_MUL,
-    ALU_DIV
+    ALU_MULH,   // high word, signed x signed
+    ALU_MULHSU, // high word, signed x unsigned
+    ALU_MULHU,  // high word, unsigned x unsigned
+    ALU_DIV,
+    ALU_DIVU,
+    ALU_REM,
+    ALU_REMU,
+    // Zbb, register-register
+    ALU_ANDN,
+    ALU_ORN,
+    ALU_XNOR,
+    ALU_MIN,
+    ALU_MINU,
+    ALU_MAX,
+    ALU_MAXU,
+    ALU_ROL,
+    ALU_ROR,
+    // Zbb, unary (operand2 is ignored)
+    ALU_CLZ,
+    ALU_CTZ,
+    ALU_CPOP,
+    ALU_SEXT_B,
+    ALU_SEXT_H,
+    ALU_ZEXT_H,
+    ALU_REV8,
+    ALU_ORC_B,
+    ALU_OP_COUNT
 } ALUOp;
 
+// the M extension ops of an OP instruction with funct7 0x01, by funct3
+#define ALU_MULDIV_OP(funct3) ((ALUOp)(ALU_MUL + ((funct3) & 0x7)))
+
+// division never traps: x / 0 = -1 (all ones), x % 0 = x, and the signed
+// overflow INT32_MIN / -1 = INT32_MIN with remainder 0, as the spec defines
 int32_t alu_execute(ALUOp op, int32_t operand1, int32_t operand2);
 
+// Zbb decoding, shared by the CPU and the trace renderer; both return
+// ALU_UNKNOWN when the fields do not encode a Zbb instruction.
+// OP (0x33): ANDN/ORN/XNOR, MIN[U]/MAX[U], ROL/ROR and ZEXT.H
+ALUOp alu_zbb_op(uint8_t funct7, uint8_t funct3, uint8_t rs2);
+// OP-IMM (0x13) from the 12-bit immediate: the unary ops and RORI, whose
+// shift amount is the low 5 bits of the immediate
+ALUOp alu_zbb_imm_op(uint8_t funct3, uint32_t imm12);
+
+// upper-case mnemonic, as in the [EXEC] trace
+const char *alu_op_name(ALUOp op);
+
 #endif // ALU_H
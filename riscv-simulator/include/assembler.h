@@ -2,8 +2,8 @@
 #define ASSEMBLER_H
 
 #define MAX_LABEL_SIZE 50
-#define MAX_OPCODE_SIZE 10
-#define MAX_OPERANDS 3
+#define MAX_OPCODE_SIZE 16
+#define MAX_OPERANDS 6             // vsetvli rd, rs1, e32, m1, ta, ma
 #define MAX_OPERAND_SIZE 20
 #define MAX_INSTRUCTIONS 1024
 #define MAX_DATA 1024
@@ -21,6 +21,8 @@ typedef struct
     int operand_count;
     int line_number;
     uint32_t address;
+    uint8_t size;                   // bytes: 4, or 2 when assembled as an RVC instruction
+    uint8_t rvc;                    // may be compressed (.option rvc, or a c.* mnemonic)
 } Instruction;
 
 typedef struct
@@ -40,6 +42,7 @@ typedef struct
 {
     Instruction instructions[MAX_INSTRUCTIONS];
     int instruction_count;
+    uint32_t code_size;             // bytes of code, a multiple of 4; .data starts here
 
     DataEntry data[MAX_DATA];
     int data_count;
@@ -49,6 +52,9 @@ typedef struct
 } AssemblyProgram;
 
 int read_asm_file(char *filename, AssemblyProgram *program);
+// assembles every instruction that has a 16-bit form as RVC, as if the whole
+// file were under .option rvc; addresses and labels move accordingly
+int compress_program(AssemblyProgram *program);
 void print_program(AssemblyProgram *program);
 
 int find_symbol(AssemblyProgram *program, const char *name, uint32_t *addr_out);
@@ -0,0 +1,66 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "cpu.h"
+
+/**
+ * Persistent checkpoints.
+ *
+ * A checkpoint file holds the guest memory image at the moment checkpointing
+ * started, followed by one record per checkpoint with the CPU state and the
+ * memory pages written since the previous record:
+ *
+ *   header   CHECKPOINT_HEADER_SIZE bytes: magic, version, page size,
+ *            memory size, instruction count and hash of the program, VLEN
+ *   image    memory_size bytes at offset CHECKPOINT_HEADER_SIZE, padded to
+ *            a multiple of CHECKPOINT_HEADER_SIZE
+ *   record   magic, sequence number, pc, instructions executed, halted,
+ *            error, 32 registers, vl, vtype, page count, the 32 vector
+ *            registers (VLEN / 32 words each), then the index and the
+ *            MEMORY_PAGE_SIZE bytes of every page dirtied since the previous
+ *            record (a short last page is zero padded)
+ *
+ * All integers are little-endian 32-bit. Record 0 is written when the file
+ * is opened and has no pages. The image is page aligned so a restore can map
+ * it copy-on-write (MAP_PRIVATE) and only apply the incremental pages on top.
+ * Each record is flushed when written; a truncated last record is ignored, so
+ * a run that dies keeps its earlier checkpoints.
+ *
+ * Execution statistics and the profiler are not part of a checkpoint. A
+ * restore sets VLEN to the one the checkpoint was taken with.
+ **/
+
+#define CHECKPOINT_MAGIC "RVCKPT\0\0"
+#define CHECKPOINT_MAGIC_SIZE 8
+#define CHECKPOINT_VERSION 2
+#define CHECKPOINT_HEADER_SIZE 4096
+#define CHECKPOINT_RECORD_MAGIC 0x52504B43u     // "CKPR"
+#define CHECKPOINT_DEFAULT_INTERVAL 100000
+
+typedef struct CheckpointWriter
+{
+    FILE *file;
+    uint32_t every;                 // instructions between checkpoints
+    uint32_t next_at;               // instruction count of the next checkpoint
+    uint32_t sequence;              // records written so far
+    uint64_t bytes;
+    int failed;
+} CheckpointWriter;
+
+// writes the header, the memory image and record 0, and turns on dirty
+// page tracking in cpu->memory
+CheckpointWriter *checkpoint_open(const char *path, CPU *cpu, uint32_t every);
+// appends a record with the pages dirtied since the previous one
+int checkpoint_write(CheckpointWriter *w, CPU *cpu);
+// returns -1 if any write failed
+int checkpoint_close(CheckpointWriter *w);
+
+// restores record `index` (-1 for the last complete one) into `cpu` and its
+// memory, which must hold the same program; returns the restored sequence
+// number or -1
+int checkpoint_restore(const char *path, int index, CPU *cpu);
+
+#endif // CHECKPOINT_H
@@ -6,8 +6,24 @@
 #include "assembler.h"
 #include "instruction.h"
 #include "memory.h"
+#include "profiler.h"
 
 #define REG_NUMBER 32
+#define CPU_DEFAULT_MAX_INSTRUCTIONS 1000
+
+#define CPU_VREGS 32
+#define CPU_VLEN_DEFAULT 128        // bits per vector register
+#define CPU_VLEN_MAX 1024
+#define CPU_VTYPE_VILL 0x80000000u  // vtype of an unsupported vsetvli; vector instructions then fail
+
+#define CPU_RVC_CACHE 256           // expanded compressed instructions, by PC; power of two
+
+struct CpuStats;
+struct TraceWriter;
+struct LoopTrace;
+struct CheckpointWriter;
+struct UndoLog;
+struct SyscallHost;
 
 typedef enum
 {
@@ -22,19 +38,67 @@ typedef enum
     ROLE_SPECIAL
 } RegRole;
 
+// why cpu_run() returned before the program ended or the limit was reached
+typedef enum
+{
+    CPU_STOP_NONE = 0,
+    CPU_STOP_BREAKPOINT,
+    CPU_STOP_WATCHPOINT             // details in memory->hit
+} CpuStopReason;
+
+// one compressed instruction expanded by fetch; `raw` is 0 (an illegal
+// RVC encoding) in an empty slot
+typedef struct
+{
+    uint32_t word;
+    uint16_t raw;
+} CpuRvcEntry;
+
+// RVV state (SEW=32 only); register v is the vlen / 32 words at
+// regs[v * vlen / 32], so a register group of LMUL registers is contiguous
+typedef struct
+{
+    uint32_t vlen;                  // bits per register, a power of two in [32, CPU_VLEN_MAX]
+    uint32_t vl;                    // elements the next vector instruction works on
+    uint32_t vtype;                 // as written by vsetvli, CPU_VTYPE_VILL until then
+    uint32_t regs[CPU_VREGS * (CPU_VLEN_MAX / 32)];
+} CpuVector;
+
 typedef struct
 {
     int32_t regs[REG_NUMBER];
     uint32_t pc;
+    uint32_t ilen;                  // bytes of the executing instruction: 4, or 2 for RVC
 
     RegRole reg_roles[REG_NUMBER];
 
     Memory *memory;              
     AssemblyProgram *program;       
+    Profiler *profiler;             // optional, NULL when profiling is off
+    struct CpuStats *stats;         // optional, NULL when statistics are off
+    struct TraceWriter *tracer;     // optional binary trace sink, NULL when off
+    struct LoopTrace *loop_trace;   // optional loop-compressed text trace, NULL when off
+    struct CheckpointWriter *checkpoint; // optional periodic checkpoints, NULL when off
+    struct UndoLog *undo;           // optional reverse-execution log, NULL when off
+    struct SyscallHost *syscalls;   // ECALL handler state (syscall.h), NULL: ECALL is an error
+
+    uint8_t *breakpoints;           // one flag per halfword of code, NULL when no breakpoint or watchpoint is set
+    uint32_t breakpoint_slots;
+    CpuStopReason stop_reason;
+    uint32_t stop_pc;               // instruction that triggered a watchpoint
     
+    uint32_t hart_id;               // mhartid; 0 unless the CPU is a hart of an SmpSystem (smp.h)
+    int reserved;                   // LR.W reservation is valid
+    uint32_t reservation_addr;      // guest memory address of the reserved word
+    uint32_t reservation_value;     // word LR.W read; SC.W succeeds only if it is still there
     uint32_t instructions_executed; 
+    uint32_t max_instructions;      // cpu_run stops after this many instructions
     int halted;                     
     int error; 
+    int trace;                      // print per-instruction [STEP]/[DECODE]/[EXEC] lines
+
+    CpuRvcEntry rvc_cache[CPU_RVC_CACHE];
+    CpuVector vector;               // last: large, and off the scalar hot path
 } CPU;
 
 void cpu_init(CPU *cpu);
@@ -48,7 +112,13 @@ RegRole cpu_get_reg_role(CPU *cpu, int index);
 
 void cpu_init_default_register_roles(CPU *cpu);
 
-// fetch -> decode -> execute
+// sets VLEN in bits (a power of two from 32 to CPU_VLEN_MAX) and clears the
+// vector state; cpu_init() uses CPU_VLEN_DEFAULT. Returns -1 on a bad length
+int cpu_set_vlen(CPU *cpu, uint32_t bits);
+
+// fetch -> decode -> execute; fetch expands a compressed instruction (rvc.h)
+// into its 32-bit form and sets cpu->ilen. It reads a whole word at pc, so a
+// compressed instruction in the last halfword of memory is only run by cpu_step()
 EncodedInstruction cpu_fetch(CPU *cpu);
 int cpu_decode(CPU *cpu, EncodedInstruction enc); 
 int cpu_execute(CPU *cpu, EncodedInstruction enc);
@@ -58,6 +128,22 @@ void cpu_writeback_with_context(CPU *cpu, int rd, int32_t value, EncodedInstruct
 
 int cpu_step(CPU *cpu);
 int cpu_run(CPU *cpu);
+// runs at most `budget` instructions without the start/limit diagnostics of
+// cpu_run(); also stops before an instruction with a breakpoint
+int cpu_run_for(CPU *cpu, uint32_t budget);
+
+// breakpoints are checked after every instruction against the next PC, only
+// while a breakpoint or watchpoint is set; the first instruction of a run is
+// never stopped at, so continuing from a breakpoint steps over it
+int cpu_set_breakpoint(CPU *cpu, uint32_t pc);
+void cpu_clear_breakpoint(CPU *cpu, uint32_t pc);
+// drops all breakpoints and watchpoints
+void cpu_free_breakpoints(CPU *cpu);
+
+// watchpoints stop cpu_run() after the instruction that accessed the range;
+// `kind` is a MEMORY_WATCH_* mask
+int cpu_set_watchpoint(CPU *cpu, uint32_t addr, uint32_t len, int kind);
+void cpu_clear_watchpoint(CPU *cpu, uint32_t addr, uint32_t len, int kind);
 
 void cpu_print_registers(CPU *cpu);
 void cpu_print_state(CPU *cpu);
@@ -0,0 +1,42 @@
+#ifndef CSR_H
+#define CSR_H
+
+#include <stdint.h>
+
+#include "cpu.h"
+
+/**
+ * Zicsr control and status registers.
+ *
+ * Only the unprivileged counters and mhartid exist, all of them read-only,
+ * so a guest can time its own code:
+ *   cycle / cycleh       instructions retired; the core has no timing
+ *                        model, so every instruction is one cycle
+ *   time / timeh         host CLOCK_MONOTONIC in microseconds
+ *   instret / instreth   cpu->instructions_executed
+ *   mhartid              cpu->hart_id
+ * Counters read the value before the reading instruction retires. They are
+ * computed when read rather than kept up to date, so the execute loop pays
+ * nothing for them.
+ **/
+
+#define CSR_CYCLE       0xC00
+#define CSR_TIME        0xC01
+#define CSR_INSTRET     0xC02
+#define CSR_CYCLEH      0xC80
+#define CSR_TIMEH       0xC81
+#define CSR_INSTRETH    0xC82
+#define CSR_MHARTID     0xF14
+
+// number of the CSR called `name` ("cycle", "instret", ...), or -1
+int csr_lookup(const char *name);
+// name of CSR `csr`, or "UNKNOWN"
+const char *csr_name(uint32_t csr);
+
+// CSRRW..CSRRCI by funct3, or NULL for funct3 0 and 4
+const char *csr_op_name(uint32_t funct3);
+
+// current value of CSR `csr`; returns -1 if the CSR does not exist
+int csr_read(const CPU *cpu, uint32_t csr, uint32_t *value);
+
+#endif // CSR_H
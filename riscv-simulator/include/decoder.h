@@ -4,6 +4,8 @@
 #include "alu.h"
 
 int reg_index(const char *name);
+// v0..v31, or -1
+int vreg_index(const char *name);
 
 int32_t parse_immediate(const char *str);
 int parse_memory_operand(const char *operand, int32_t *out_offset, int *out_reg);
@@ -6,4 +6,7 @@
 
 uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr);
 
+// same as encode_instruction; [ENCODE] lines are only printed when trace != 0
+uint32_t encode_instruction_traced(AssemblyProgram *program, Instruction *instr, int trace);
+
 #endif // ENCODER_H
@@ -0,0 +1,33 @@
+#ifndef GDB_STUB_H
+#define GDB_STUB_H
+
+#include "cpu.h"
+
+/**
+ * GDB remote serial protocol server.
+ *
+ * Serves one debugger connection over TCP on 127.0.0.1 or over a Unix
+ * socket. The target is described as riscv:rv32 with x0-x31 and pc; memory
+ * addresses are guest memory addresses (code at 0, data after it). Supported:
+ * register and memory read/write, single-step and continue (interruptible
+ * with Ctrl-C), software breakpoints (Z0/Z1, stored as CPU breakpoint flags so
+ * continue runs at full speed), watchpoints (Z2-Z4, on the memory's watched
+ * pages), and reverse step/continue when an undo log is attached to the CPU
+ * (undo.h).
+ *
+ *   (gdb) set architecture riscv:rv32
+ *   (gdb) target remote :1234
+ **/
+
+#define GDB_PACKET_SIZE 4096
+#define GDB_RUN_SLICE (1u << 16)    // instructions between checks for Ctrl-C
+
+// `spec` is a TCP port on 127.0.0.1 or "unix:<path>"; returns the listening
+// socket or -1
+int gdb_stub_listen(const char *spec);
+
+// waits for a debugger on `listen_fd` and serves it until it detaches, kills
+// the target or disconnects; returns -1 on socket errors
+int gdb_stub_serve(int listen_fd, CPU *cpu);
+
+#endif // GDB_STUB_H
@@ -283,6 +283,50 @@ typedef struct
     uint32_t value;
 } JTypeEncoding;
 
+/**
+ * V-Type Instruction Formats (RVV, OP-V = 0x57, LOAD-FP = 0x07, STORE-FP = 0x27)
+ *
+ * Arithmetic (OP-V):
+ *
+ *  31    26 25 24   20 19   15 14  12 11    7 6      0
+ * +--------+--+-------+-------+------+-------+-------+
+ * | funct6 |vm|  vs2  |vs1/rs1|funct3|  vd   |opcode |
+ * +--------+--+-------+-------+------+-------+-------+
+ *
+ * vsetvli (OP-V, funct3 = 7, bit 31 = 0): zimm[10:0] = vtype in [30:20].
+ * Unit-stride loads/stores use the vs2 field for lumop/sumop, funct3 for the
+ * element width and funct6 for nf[31:29], mew[28] and mop[27:26]; rd is the
+ * data register vd (or vs3 for stores) and rs1 the base address.
+ **/
+
+static inline uint8_t vtype_get_funct6(uint32_t instr)
+{
+    return (instr >> 26) & 0x3F;  // [31:26]
+}
+
+static inline uint8_t vtype_get_vm(uint32_t instr)
+{
+    return (instr >> 25) & 0x01;  // [25], 1 = unmasked
+}
+
+static inline uint32_t vtype_get_zimm(uint32_t instr)
+{
+    return (instr >> 20) & 0x7FF;  // [30:20]
+}
+
+// OP-V or a vector load/store; these change vector state, not x[rd]
+static inline int vtype_is_vector(uint32_t instr)
+{
+    uint8_t opcode = instr & 0x7F;
+    return opcode == 0x57 || opcode == 0x07 || opcode == 0x27;
+}
+
+// vsetvli is the one vector instruction here that writes x[rd]
+static inline int vtype_is_vsetvli(uint32_t instr)
+{
+    return (instr & 0x8000707F) == 0x00007057;
+}
+
 typedef union 
 {
     RTypeEncoding rtype;
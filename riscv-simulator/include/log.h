@@ -0,0 +1,86 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * Asynchronous buffered logging.
+ *
+ * Every message carries a severity and the subsystem that emitted it.
+ * Messages are formatted into a per-thread buffer; a full buffer is handed
+ * to a background writer thread that writes it to stdout in one write(2),
+ * so concurrent simulators never contend on the stdio lock, only on a short
+ * queue lock once per buffer.
+ *
+ * Errors go to stderr. They are written synchronously after everything
+ * queued before them, so `2>&1` logs keep their order.
+ *
+ * Until log_init() is called (library users, benchmark tools) messages are
+ * written directly with stdio. log_init() registers log_shutdown() with
+ * atexit(), which flushes every buffer and stops the writer.
+ *
+ * The logger is the only process-wide state of the simulator: the output
+ * streams are shared, so it has to be.
+ **/
+
+typedef enum
+{
+    LOG_LEVEL_TRACE = 0,            // per-instruction diagnostics
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_COUNT
+} LogLevel;
+
+typedef enum
+{
+    LOG_CAT_MAIN = 0,
+    LOG_CAT_ASM,
+    LOG_CAT_ENCODER,
+    LOG_CAT_CPU,
+    LOG_CAT_MEMORY,
+    LOG_CAT_PROFILER,
+    LOG_CAT_STATS,
+    LOG_CAT_TRACE,
+    LOG_CAT_COUNT
+} LogCategory;
+
+#define LOG_CHUNK_SIZE (64 * 1024)      // per-thread buffer, one write per chunk
+#define LOG_MAX_QUEUED 64               // chunks waiting for the writer
+
+int log_init(void);
+// flushes every thread's buffer and stops the writer; safe to call twice
+void log_shutdown(void);
+// hands the calling thread's buffer to the writer
+void log_flush(void);
+// log_flush() and waits until everything queued has been written
+void log_sync(void);
+
+void log_set_level(LogCategory cat, LogLevel min_level);
+int log_enabled(LogCategory cat, LogLevel level);
+// parses "level" (all categories) or "category=level"; returns -1 if unknown
+int log_parse_level(const char *spec);
+
+const char *log_level_name(LogLevel level);
+const char *log_category_name(LogCategory cat);
+
+void log_message(LogCategory cat, LogLevel level, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+void log_write(LogCategory cat, LogLevel level, const char *text, size_t len);
+
+// unbuffered stdio stream whose writes become log messages, for code that
+// prints through a FILE * (loop trace); close with fclose()
+FILE *log_open_stream(LogCategory cat, LogLevel level);
+
+#define LOG_AT(cat, level, ...) \
+    do { if(log_enabled((cat), (level))) log_message((cat), (level), __VA_ARGS__); } while(0)
+
+#define LOG_TRACE(cat, ...) LOG_AT(cat, LOG_LEVEL_TRACE, __VA_ARGS__)
+#define LOG_DEBUG(cat, ...) LOG_AT(cat, LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(cat, ...)  LOG_AT(cat, LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(cat, ...)  LOG_AT(cat, LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(cat, ...) LOG_AT(cat, LOG_LEVEL_ERROR, __VA_ARGS__)
+
+#endif // LOG_H
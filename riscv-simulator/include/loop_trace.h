@@ -0,0 +1,79 @@
+#ifndef LOOP_TRACE_H
+#define LOOP_TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "trace.h"
+
+/**
+ * Loop-aware text trace.
+ *
+ * The retired instruction stream is cut into segments at every backward
+ * control transfer. A segment whose PC sequence equals the previous one is
+ * another iteration of the same loop body: instead of re-printing its
+ * [STEP]/[EXEC] lines, only the register writes that changed a value are
+ * printed, prefixed with their position in the block:
+ *
+ *   [LOOP] block PC=0x00000014..0x00000024, 5 instructions, data=0x00000034
+ *   [REGS] x10=0x00000007 x11=0x00000002 ...
+ *   [ITER 3] 0:x15=0x00000001 1:x11=0x00000003 2:x10=0x00000003
+ *   [ITER 4..30] 3:x12+=-1
+ *   [LOOP END] 31 iterations of 5 instructions
+ *
+ * Consecutive iterations that write the same registers at the same
+ * positions, each value moving by the same stride, are folded into one
+ * ranged [ITER a..b] record holding the per-iteration strides.
+ * The block itself is the last segment printed in full before [LOOP], and
+ * [REGS] holds every non-zero register at the start of the first compressed
+ * iteration, so the log can be expanded back to the full trace
+ * (riscv_trace_decode --expand).
+ **/
+
+#define LOOP_TRACE_MAX_BODY 256
+
+typedef struct
+{
+    int pos;                        // index of the instruction in the block
+    int reg;
+    int32_t value;
+} LoopTraceEntry;
+
+typedef struct LoopTrace
+{
+    FILE *out;
+    uint32_t data_offset;           // base of data-relative load/store addresses
+
+    int32_t regs[TRACE_REGS];       // register file after the last record
+    uint32_t last_pc;
+    uint32_t step;                  // index of the next retired instruction
+
+    // segment being collected and the registers at its start
+    TraceRecord seg[LOOP_TRACE_MAX_BODY];
+    int seg_count;
+    int32_t seg_regs[TRACE_REGS];
+
+    // last segment printed in full; candidates are compared against it
+    uint32_t ref_pc[LOOP_TRACE_MAX_BODY];
+    uint32_t ref_word[LOOP_TRACE_MAX_BODY];
+    int ref_count;
+
+    uint32_t repeats;               // compressed iterations of the current block
+
+    // most recent iteration not printed yet and the run of strided
+    // iterations following it
+    LoopTraceEntry held[LOOP_TRACE_MAX_BODY];
+    int held_count;
+    int32_t run_stride[LOOP_TRACE_MAX_BODY];
+    uint32_t run_first;             // iteration number of the held record
+    uint32_t run_length;            // strided iterations after it
+    int holding;
+    uint64_t lines_saved;           // [STEP]/[EXEC] lines not printed
+} LoopTrace;
+
+void loop_trace_init(LoopTrace *lt, FILE *out, const int32_t regs[TRACE_REGS], uint32_t data_offset);
+void loop_trace_record(LoopTrace *lt, const TraceRecord *rec);
+// flushes the pending segment and closes an open block
+void loop_trace_finish(LoopTrace *lt);
+
+#endif // LOOP_TRACE_H
@@ -6,20 +6,121 @@
 
 #include "assembler.h"
 
+// granularity of dirty tracking; guest images are small, so pages are too
+#define MEMORY_PAGE_SHIFT 8
+#define MEMORY_PAGE_SIZE (1u << MEMORY_PAGE_SHIFT)
+
+#define MEMORY_MAX_WATCHES 16
+
+// kinds of access a watchpoint fires on
+#define MEMORY_WATCH_WRITE  0x1
+#define MEMORY_WATCH_READ   0x2
+#define MEMORY_WATCH_ACCESS (MEMORY_WATCH_READ | MEMORY_WATCH_WRITE)
+
+typedef struct
+{
+    uint32_t addr;
+    uint32_t len;
+    int kind;
+} MemoryWatch;
+
+// first watchpoint hit since memory_clear_watch_hit()
+typedef struct
+{
+    uint32_t addr;                  // word accessed
+    int kind;                       // MEMORY_WATCH_READ or MEMORY_WATCH_WRITE
+    uint32_t old_value;
+    uint32_t new_value;             // equal to old_value for reads
+} MemoryWatchHit;
+
+// read-modify-write operations of the RV32A AMO*.W instructions
+typedef enum
+{
+    MEMORY_AMO_SWAP = 0,
+    MEMORY_AMO_ADD,
+    MEMORY_AMO_XOR,
+    MEMORY_AMO_AND,
+    MEMORY_AMO_OR,
+    MEMORY_AMO_MIN,
+    MEMORY_AMO_MAX,
+    MEMORY_AMO_MINU,
+    MEMORY_AMO_MAXU
+} MemoryAmoOp;
+
 typedef struct 
 {
     uint8_t *data;
     size_t size;
+    int mapped;                     // data is a private file mapping (memory_map_file)
+
+    // dirty page tracking, NULL until memory_track_dirty(): one flag per
+    // page plus the list of pages written since the last memory_clear_dirty()
+    uint8_t *dirty;
+    uint32_t *dirty_pages;
+    size_t dirty_count;
+    const void *dirty_owner;        // snapshot the dirty set is relative to
+
+    // watchpoints; `watched` is NULL while none are set, so memory_read32()
+    // and memory_write32() only look at the list for pages that have one
+    uint8_t *watched;               // per page: number of watchpoints on it
+    MemoryWatch watches[MEMORY_MAX_WATCHES];
+    int watch_count;
+    int watch_hit;                  // `hit` is valid
+    MemoryWatchHit hit;
 } Memory;
 
 Memory memory_init(size_t size);
 void memory_free(Memory *m);
 
+// replaces the contents with `size` bytes of `fd` at `offset`, mapped
+// copy-on-write when possible; dirty tracking is turned off
+int memory_map_file(Memory *m, int fd, uint64_t offset, size_t size);
+
+size_t memory_page_count(const Memory *m);
+int memory_track_dirty(Memory *m);
+void memory_clear_dirty(Memory *m);
+void memory_mark_dirty(Memory *m, uint32_t addr, size_t len);
+
+int memory_watch(Memory *m, uint32_t addr, uint32_t len, int kind);
+void memory_unwatch(Memory *m, uint32_t addr, uint32_t len, int kind);
+void memory_clear_watch_hit(Memory *m);
+
 uint32_t memory_read32(Memory *m, uint32_t addr);
 
+// reads a word without bounds diagnostics or watchpoint checks, for the
+// simulator's own bookkeeping (traces, undo log); addr + 4 must be in bounds
+static inline uint32_t memory_peek32(const Memory *m, uint32_t addr)
+{
+    return m->data[addr] | (m->data[addr + 1] << 8) | (m->data[addr + 2] << 16) | ((uint32_t)m->data[addr + 3] << 24);
+}
+
+// same for a halfword (a compressed instruction)
+static inline uint16_t memory_peek16(const Memory *m, uint32_t addr)
+{
+    return (uint16_t)(m->data[addr] | (m->data[addr + 1] << 8));
+}
+
 void memory_write32(Memory *m, uint32_t addr, uint32_t value);
 
-void load_program_into_memory(Memory *m, const uint32_t *program, size_t len_words, uint32_t base_addr);
+// atomic accesses for RV32A on an aligned word, done with host atomics on
+// the backing store so harts sharing the memory need no lock; both return
+// the old value / 1 on success, and log an error for a misaligned or
+// out-of-bounds address (returning 0)
+uint32_t memory_amo32(Memory *m, uint32_t addr, MemoryAmoOp op, uint32_t value);
+// stores `value` only if the word still holds `expected`
+int memory_cas32(Memory *m, uint32_t addr, uint32_t expected, uint32_t value);
+// unit-stride blocks of little-endian words for vector loads and stores,
+// with the bounds and watchpoint checks of memory_read32/write32; return -1
+// if the range is out of bounds
+int memory_read_words(Memory *m, uint32_t addr, uint32_t *dst, size_t words);
+int memory_write_words(Memory *m, uint32_t addr, const uint32_t *src, size_t words);
+// bulk write; returns -1 if the range is out of bounds
+int memory_write(Memory *m, uint32_t addr, const void *src, size_t len);
+
+// one entry per instruction; an entry whose two low bits are not 11 is a
+// 16-bit RVC instruction and takes 2 bytes. Returns the bytes of code,
+// padded to a word, or 0 if it does not fit.
+uint32_t load_program_into_memory(Memory *m, const uint32_t *program, size_t len_words, uint32_t base_addr);
 void load_data_into_memory(Memory *m, const AssemblyProgram *program, uint32_t data_offset);
 
 void memory_dump_words(Memory *m, uint32_t addr, size_t words);
@@ -0,0 +1,69 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+
+#include "assembler.h"
+
+#define PROFILER_MAX_NODES 1024
+#define PROFILER_MAX_DEPTH 256
+
+/**
+ * Calling-context profiler.
+ *
+ * Calls and returns are recognised with the RISC-V link register convention
+ * (x1/ra and the alternate link register x5/t0):
+ *   - JAL / JALR with rd = link          -> call
+ *   - JALR rd = x0, rs1 = link           -> return
+ *
+ * Every call moves the profiler to a child node of the current context, so
+ * each node of the tree is one distinct call path. The only per-instruction
+ * work is a single counter increment on the current node (profiler_retire).
+ **/
+
+typedef struct
+{
+    uint32_t func_addr;     // entry address of the called function
+    int parent;             // -1 for the root node
+    int first_child;
+    int next_sibling;
+
+    uint64_t calls;
+    uint64_t exclusive;     // instructions retired while this context was on top
+    uint64_t inclusive;     // exclusive + all descendants (filled by profiler_finalize)
+} ProfilerNode;
+
+typedef struct
+{
+    ProfilerNode nodes[PROFILER_MAX_NODES];
+    int node_count;
+
+    int current;                                // node that receives retired instructions
+
+    int stack_nodes[PROFILER_MAX_DEPTH];        // shadow call stack: caller contexts
+    uint32_t stack_ret[PROFILER_MAX_DEPTH];     // expected return address of each frame
+    int depth;
+
+    uint32_t dropped_calls;                     // calls not tracked (tree or stack full)
+    uint32_t unmatched_returns;                 // returns with no matching frame
+} Profiler;
+
+static inline int profiler_is_link_reg(int reg)
+{
+    return reg == 1 || reg == 5;
+}
+
+static inline void profiler_retire(Profiler *p)
+{
+    p->nodes[p->current].exclusive++;
+}
+
+void profiler_init(Profiler *p, uint32_t entry_pc);
+
+void profiler_on_call(Profiler *p, uint32_t target, uint32_t return_addr);
+void profiler_on_return(Profiler *p, uint32_t target);
+
+void profiler_finalize(Profiler *p);
+void profiler_print(Profiler *p, AssemblyProgram *program);
+
+#endif // PROFILER_H
@@ -0,0 +1,164 @@
+#ifndef RISCVSIM_H
+#define RISCVSIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "assembler.h"
+#include "cpu.h"
+#include "memory.h"
+#include "snapshot.h"
+#include "stats.h"
+#include "syscall.h"
+#include "undo.h"
+
+/**
+ * Embeddable simulator (libriscvsim).
+ *
+ * A RiscvSim context owns everything one simulation needs: the parsed
+ * program, the encoded instructions, guest memory, the CPU and its
+ * statistics. The core keeps no mutable global state, so independent
+ * contexts can run concurrently on different threads; the only shared
+ * service is the logger (log.h).
+ *
+ * Typical use:
+ *
+ *   RiscvSim *sim = rvsim_create();
+ *   rvsim_set_memory_size(sim, 65536);
+ *   if(rvsim_load_source(sim, "prog.asm") == 0 &&
+ *      rvsim_run(sim, 1000000) == RVSIM_HALTED)
+ *       result = rvsim_get_reg(sim, 10);
+ *   rvsim_destroy(sim);
+ *
+ * rvsim_load_source() runs the assemble/memory/encode/load stages in one go;
+ * they are also exposed separately for front ends that report progress
+ * between them.
+ *
+ * Host event loops that multiplex many contexts on one thread drive them in
+ * slices instead:
+ *
+ *   rvsim_run_async(sim, 1000000, on_done, user);
+ *   while(rvsim_poll(sim, 1000))
+ *       ... other work ...
+ *
+ * All run state lives in the context, so switching between contexts costs
+ * no allocation.
+ *
+ * Guest programs reach the host through ECALL (syscall.h); their output is
+ * buffered in the context and flushed when a run stops.
+ **/
+
+#define RVSIM_DEFAULT_MEMORY_SIZE 400
+
+typedef struct RiscvSim RiscvSim;
+
+typedef enum
+{
+    RVSIM_HALTED = 0,               // ran off the end of the program or called exit
+    RVSIM_BUDGET,                   // instruction budget used up
+    RVSIM_BREAKPOINT,               // stopped before an instruction with a breakpoint
+    RVSIM_WATCHPOINT,               // stopped after an access to a watched range
+    RVSIM_ERROR
+} RvsimStatus;
+
+// completion of an asynchronous run, called once from rvsim_poll()
+typedef void (*RvsimDone)(RiscvSim *sim, RvsimStatus status, void *user);
+
+RiscvSim *rvsim_create(void);
+void rvsim_destroy(RiscvSim *sim);
+
+// configuration; the memory size can only change before memory is set up
+int rvsim_set_memory_size(RiscvSim *sim, size_t bytes);
+// VLEN in bits for the vector extension (cpu_set_vlen); clears the vector
+// registers, and rvsim_load() keeps the setting
+int rvsim_set_vlen(RiscvSim *sim, uint32_t bits);
+// assemble every instruction that has a 16-bit form as RVC (off by default,
+// .option rvc in the source still applies); takes effect on the next assemble
+void rvsim_set_rvc(RiscvSim *sim, int rvc);
+// per-instruction listing and [STEP]/[DECODE]/[EXEC] trace (off by default)
+void rvsim_set_trace(RiscvSim *sim, int trace);
+void rvsim_enable_stats(RiscvSim *sim);
+// records an undo log of `entries` instructions (0 for the default) plus
+// keyframes, so execution can be stepped backwards (undo.h)
+int rvsim_enable_undo(RiscvSim *sim, uint32_t entries);
+
+// loading; all return 0 on success and -1 on failure
+int rvsim_load_source(RiscvSim *sim, const char *path);
+// raw instruction words at address 0, data words right after the code; a word
+// whose two low bits are not 11 is a 16-bit RVC instruction (load_program_into_memory)
+int rvsim_load_binary(RiscvSim *sim, const uint32_t *code, size_t code_words,
+                      const uint32_t *data, size_t data_words);
+
+int rvsim_assemble(RiscvSim *sim, const char *path);
+int rvsim_init_memory(RiscvSim *sim);
+int rvsim_encode(RiscvSim *sim);
+// copies code and data into memory and resets the CPU
+int rvsim_load(RiscvSim *sim);
+
+// runs until the program ends, an error occurs or `budget` more
+// instructions have executed; can be called again to continue. The CPU
+// counts retired instructions in 32 bits, so a run also returns
+// RVSIM_BUDGET once 2^32 - 1 instructions have executed in total
+RvsimStatus rvsim_run(RiscvSim *sim, uint32_t budget);
+// same as rvsim_run() without the start/limit diagnostics, for hosts that
+// interleave many contexts in short slices
+RvsimStatus rvsim_run_for(RiscvSim *sim, uint32_t budget);
+
+// asynchronous runs: rvsim_run_async() only records the run, each
+// rvsim_poll() then executes at most `slice` instructions of it and calls
+// `done` when the run ends the way rvsim_run() would have returned; poll
+// returns 1 while the run is still pending. Starting a new run replaces a
+// pending one without calling its callback, and so does rvsim_cancel().
+int rvsim_run_async(RiscvSim *sim, uint32_t budget, RvsimDone done, void *user);
+int rvsim_poll(RiscvSim *sim, uint32_t slice);
+int rvsim_pending(const RiscvSim *sim);
+void rvsim_cancel(RiscvSim *sim);
+
+// breakpoints on instruction addresses; rvsim_run() returns RVSIM_BREAKPOINT
+// before executing one, and steps over it when called again
+int rvsim_set_breakpoint(RiscvSim *sim, uint32_t pc);
+void rvsim_clear_breakpoint(RiscvSim *sim, uint32_t pc);
+// watchpoints on guest memory addresses, `kind` is a MEMORY_WATCH_* mask;
+// rvsim_run() returns RVSIM_WATCHPOINT, details in rvsim_memory(sim)->hit
+int rvsim_set_watchpoint(RiscvSim *sim, uint32_t addr, uint32_t len, int kind);
+void rvsim_clear_watchpoint(RiscvSim *sim, uint32_t addr, uint32_t len, int kind);
+
+// reverse execution, after rvsim_enable_undo(); step_back returns the number
+// of instructions undone, reverse_continue 1 when `stop` was hit and 0 when
+// the start of the history was reached
+uint32_t rvsim_step_back(RiscvSim *sim, uint32_t count);
+int rvsim_reverse_continue(RiscvSim *sim, const UndoStop *stop);
+
+// captures registers, PC, counters and memory; restoring copies back only
+// the memory pages written since (snapshot.h)
+CpuSnapshot *rvsim_snapshot(RiscvSim *sim);
+int rvsim_restore(RiscvSim *sim, const CpuSnapshot *snap);
+void rvsim_snapshot_free(CpuSnapshot *snap);
+
+int32_t rvsim_get_reg(const RiscvSim *sim, int index);
+int rvsim_set_reg(RiscvSim *sim, int index, int32_t value);
+uint32_t rvsim_get_pc(const RiscvSim *sim);
+void rvsim_set_pc(RiscvSim *sim, uint32_t pc);
+
+int rvsim_read_memory(const RiscvSim *sim, uint32_t addr, void *buf, size_t len);
+int rvsim_write_memory(RiscvSim *sim, uint32_t addr, const void *buf, size_t len);
+// start of the data section, the base of LW/SW addresses
+uint32_t rvsim_data_offset(const RiscvSim *sim);
+
+uint64_t rvsim_instructions_executed(const RiscvSim *sim);
+// status passed to the exit system call; rvsim_exited() is 0 if the
+// program did not call it, and the code is then 0
+int rvsim_exited(const RiscvSim *sim);
+int32_t rvsim_exit_code(const RiscvSim *sim);
+// NULL unless rvsim_enable_stats() was called
+const CpuStats *rvsim_stats(const RiscvSim *sim);
+
+// the underlying components, for front ends that attach a profiler or
+// trace sinks; valid until rvsim_destroy()
+CPU *rvsim_cpu(RiscvSim *sim);
+Memory *rvsim_memory(RiscvSim *sim);
+AssemblyProgram *rvsim_program(RiscvSim *sim);
+// ECALL state, shared with other harts that run the program (smp.h)
+SyscallHost *rvsim_syscalls(RiscvSim *sim);
+
+#endif // RISCVSIM_H
@@ -0,0 +1,38 @@
+#ifndef RVC_H
+#define RVC_H
+
+#include <stdint.h>
+
+/**
+ * RVC (C extension) compressed instructions.
+ *
+ * A 16-bit instruction is one whose two low bits are not 11; every one of
+ * them stands for a single 32-bit instruction. The assembler compresses
+ * the 32-bit encoding when it has a 16-bit form, and fetch expands the
+ * halfword back, so decode and execute only ever see 32-bit instructions.
+ *
+ * Only forms whose expansion this core executes are supported:
+ *   C.ADDI4SPN C.LW C.SW C.NOP C.ADDI C.JAL C.LI C.ADDI16SP C.LUI
+ *   C.SUB C.XOR C.OR C.AND C.J C.BEQZ C.BNEZ
+ *   C.LWSP C.SWSP C.JR C.MV C.JALR C.ADD
+ * C.SLLI, C.SRLI, C.SRAI and C.ANDI expand to shift/AND immediates the
+ * base ISA here does not have, so they are treated as illegal.
+ **/
+
+static inline int rvc_is_compressed(uint32_t word)
+{
+    return (word & 0x3) != 0x3;
+}
+
+// bytes `word` takes in memory: 2 for a compressed instruction, else 4
+static inline uint32_t rvc_length(uint32_t word)
+{
+    return rvc_is_compressed(word) ? 2 : 4;
+}
+
+// 16-bit form of the 32-bit instruction `word`, or 0 if it has none
+uint16_t rvc_compress(uint32_t word);
+// 32-bit instruction `half` stands for, or 0 if it is illegal or unsupported
+uint32_t rvc_expand(uint16_t half);
+
+#endif // RVC_H
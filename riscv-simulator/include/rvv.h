@@ -0,0 +1,38 @@
+#ifndef RVV_H
+#define RVV_H
+
+#include <stdint.h>
+
+/**
+ * Host SIMD kernels for the RVV subset (SEW=32).
+ *
+ * The kernels work on `n` 32-bit elements of the vector register file, so
+ * one guest vector instruction is one host loop rather than `n` emulated
+ * scalar operations. On x86 hosts the loops use AVX2 when the CPU has it
+ * (checked at run time, the build needs no -mavx2) and SSE2 otherwise;
+ * elements after the last full host vector, and every element on other
+ * hosts, are done in C.
+ **/
+
+typedef enum
+{
+    RVV_ADD = 0,
+    RVV_SUB,                        // vs2 - vs1 / vs2 - x
+    RVV_MUL,                        // low 32 bits of the product
+    RVV_AND,
+    RVV_OR,
+    RVV_XOR,
+    RVV_OP_COUNT
+} RvvOp;
+
+// vd[i] = vs2[i] op vs1[i]; vd may be the same array as vs2 or vs1
+void rvv_op_vv(RvvOp op, uint32_t *vd, const uint32_t *vs2, const uint32_t *vs1, uint32_t n);
+// vd[i] = vs2[i] op x
+void rvv_op_vx(RvvOp op, uint32_t *vd, const uint32_t *vs2, uint32_t x, uint32_t n);
+// init + vs2[0] + ... + vs2[n - 1], wrapping modulo 2^32
+uint32_t rvv_redsum(const uint32_t *vs2, uint32_t init, uint32_t n);
+
+// "avx2", "sse2" or "c": the kernels used on this host
+const char *rvv_host_isa(void);
+
+#endif // RVV_H
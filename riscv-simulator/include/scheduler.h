@@ -0,0 +1,76 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "cpu.h"
+
+/**
+ * Work-stealing scheduler for many simulation contexts.
+ *
+ * A context is a CPU ready to run, with its Memory and program attached.
+ * Contexts may share one Memory (harts of one machine, see smp_init()) or
+ * each have their own (independent guest instances). The scheduler runs
+ * them on a fixed pool of worker threads, so the number of contexts is not
+ * limited by the number of host threads.
+ *
+ * Every worker owns a deque of contexts. It takes the context at the head,
+ * runs it for one slice of at most `slice` instructions with cpu_run_for()
+ * and appends it at the tail again, so the contexts of a worker take turns.
+ * A worker whose deque is empty steals half of the contexts at the tail of
+ * another worker's deque; a worker with nothing to steal sleeps until a
+ * context is queued again. A context leaves the scheduler when it halts,
+ * reaches its own max_instructions, stops at a breakpoint or watchpoint, or
+ * fails; a failing context does not stop the others.
+ *
+ * Contexts must not have tracing, statistics, the profiler, trace sinks,
+ * checkpoints or an undo log attached while they share a Memory or a
+ * pool with other contexts.
+ **/
+
+#define SCHEDULER_DEFAULT_SLICE 10000
+#define SCHEDULER_MAX_WORKERS 256
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    CPU **ring;                     // capacity = number of contexts
+    uint32_t head;
+    uint32_t count;
+} SchedulerDeque;
+
+typedef struct Scheduler
+{
+    CPU **contexts;
+    uint32_t context_count;
+    uint32_t context_capacity;
+
+    uint32_t worker_count;
+    uint32_t slice;
+    SchedulerDeque *deques;         // one per worker, set up by scheduler_run()
+
+    // set for the duration of scheduler_run()
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_wake;
+    uint32_t idle;                  // workers sleeping on idle_wake
+    uint32_t queued;                // contexts sitting in a deque
+    uint32_t live;                  // contexts that have not left yet
+    uint32_t failed;                // contexts that reported an error
+    uint64_t slices;                // slices run
+    uint64_t steals;                // successful steal attempts
+} Scheduler;
+
+// `workers` 0 uses one worker per online host CPU; `slice` 0 uses
+// SCHEDULER_DEFAULT_SLICE
+int scheduler_init(Scheduler *s, uint32_t workers, uint32_t slice);
+void scheduler_free(Scheduler *s);
+
+// adds a context; contexts can be added until scheduler_run() is called
+int scheduler_add(Scheduler *s, CPU *cpu);
+
+// runs every context until it leaves the scheduler; returns -1 if a context
+// failed or the workers could not be started, 0 otherwise
+int scheduler_run(Scheduler *s);
+
+#endif // SCHEDULER_H
@@ -0,0 +1,72 @@
+#ifndef SMP_H
+#define SMP_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "assembler.h"
+#include "cpu.h"
+#include "memory.h"
+
+/**
+ * Multi-hart simulation.
+ *
+ * An SmpSystem runs `hart_count` CPUs over one shared Memory and program,
+ * each hart on its own host thread. A hart is an ordinary CPU with its own
+ * registers, PC and counters; its hart_id is the mhartid and is also passed
+ * in a0 at reset, with the hart count in a1, so guest code can pick its
+ * share of the work.
+ *
+ * With quantum 0 the harts run free, each to the end of the program or its
+ * instruction limit. With quantum K every hart stops after K instructions
+ * and waits at a barrier until all the others have done the same, which
+ * bounds how far the harts drift apart at the cost of one barrier per
+ * quantum.
+ *
+ * Plain loads and stores of aligned words are single-copy atomic but not
+ * ordered between harts; the RV32A instructions (LR.W/SC.W and the AMOs) are
+ * sequentially consistent and are how harts share data. Breakpoints, watchpoints, the undo log, checkpoints, traces,
+ * statistics and the profiler are single-hart features and must not be
+ * attached to the harts.
+ **/
+
+#define SMP_MAX_HARTS 4096            // beyond a few hundred, run them with smp_run_scheduled()
+#define SMP_STOP_SLICE (1u << 16)   // free-running: instructions between checks for a failed hart
+
+typedef struct SmpSystem
+{
+    CPU *harts;
+    uint32_t hart_count;
+
+    // set for the duration of smp_run()
+    uint32_t quantum;               // 0 for free-running harts
+    uint32_t max_instructions;      // per hart
+    int failed;                     // a hart reported an error, the others stop
+
+    // lockstep barrier: the last hart to finish a quantum starts the next round
+    pthread_mutex_t lock;
+    pthread_cond_t round_done;
+    uint32_t parties;               // threads taking part in the barrier
+    uint32_t waiting;
+    uint32_t round;
+    int finished;                   // no hart has anything left to run
+} SmpSystem;
+
+// harts start at PC 0 with a0 = hart id and a1 = hart count; tracing is off
+int smp_init(SmpSystem *smp, Memory *memory, AssemblyProgram *program, uint32_t hart_count);
+void smp_free(SmpSystem *smp);
+
+// runs every hart on its own thread until it halts or has executed
+// `max_instructions`; returns -1 if a hart failed (the others are stopped)
+int smp_run(SmpSystem *smp, uint32_t max_instructions, uint32_t quantum);
+
+// runs the harts as contexts of a work-stealing pool of `workers` threads
+// (0: one per host CPU) in slices of `slice` instructions, so there can be
+// many more harts than host threads (scheduler.h); the harts are not kept in
+// lockstep
+int smp_run_scheduled(SmpSystem *smp, uint32_t max_instructions, uint32_t workers, uint32_t slice);
+
+// sum over all harts
+uint64_t smp_instructions_executed(const SmpSystem *smp);
+
+#endif // SMP_H
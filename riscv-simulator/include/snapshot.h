@@ -0,0 +1,55 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cpu.h"
+#include "memory.h"
+#include "stats.h"
+
+/**
+ * Snapshot and restore of a CPU and its memory.
+ *
+ * Taking a snapshot copies the architectural state (registers, vector
+ * state, PC, instruction counter, halted/error flags, execution statistics
+ * when they are enabled, the break and exit status of the attached
+ * SyscallHost) and the whole guest memory once, then turns on
+ * dirty page tracking in the memory. Restoring copies back only the pages written since
+ * the snapshot was taken or last restored, so resetting a run costs
+ * O(dirty pages) instead of O(memory size).
+ *
+ * The dirty set belongs to one snapshot at a time: restoring a different
+ * snapshot of the same memory falls back to a full copy once.
+ *
+ * Guest output still buffered in the SyscallHost is dropped on restore.
+ * Attached components (profiler, trace sinks) are not part of the snapshot.
+ **/
+
+typedef struct
+{
+    int32_t regs[REG_NUMBER];
+    CpuVector vector;
+    uint32_t pc;
+    uint32_t instructions_executed;
+    uint32_t max_instructions;
+    int halted;
+    int error;
+
+    CpuStats stats;
+    int has_stats;
+
+    uint32_t brk;                   // SyscallHost state (syscall.h)
+    int exited;
+    int32_t exit_code;
+    int has_syscalls;
+
+    uint8_t *memory;                // image of the guest memory
+    size_t memory_size;
+} CpuSnapshot;
+
+int snapshot_take(CpuSnapshot *snap, CPU *cpu);
+int snapshot_restore(const CpuSnapshot *snap, CPU *cpu);
+void snapshot_free(CpuSnapshot *snap);
+
+#endif // SNAPSHOT_H
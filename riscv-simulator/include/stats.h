@@ -0,0 +1,132 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "cpu.h"
+
+/**
+ * Execution statistics.
+ *
+ * The CPU owns an optional CpuStats pointer; when it is set, the execute
+ * stage records every retired instruction with plain array increments:
+ *   - by operation (ADD, LW, BNE, ...)
+ *   - by instruction format (R/I/S/B/U/J)
+ *   - taken / not-taken branches
+ *   - memory reads / writes and bytes touched
+ *   - reads / writes per architectural register
+ *   - instruction fetch bytes and compressed (RVC) instructions retired
+ *
+ * Grouping, percentages and formatting only happen in the report functions.
+ **/
+
+typedef enum
+{
+    STAT_OP_ADD = 0,
+    STAT_OP_SUB,
+    STAT_OP_XOR,
+    STAT_OP_OR,
+    STAT_OP_AND,
+    STAT_OP_SLL,
+    STAT_OP_SRL,
+    STAT_OP_SRA,
+    STAT_OP_MUL,
+    STAT_OP_MULH,
+    STAT_OP_MULHSU,
+    STAT_OP_MULHU,
+    STAT_OP_DIV,
+    STAT_OP_DIVU,
+    STAT_OP_REM,
+    STAT_OP_REMU,
+    STAT_OP_ANDN,
+    STAT_OP_ORN,
+    STAT_OP_XNOR,
+    STAT_OP_MIN,
+    STAT_OP_MINU,
+    STAT_OP_MAX,
+    STAT_OP_MAXU,
+    STAT_OP_ROL,
+    STAT_OP_ROR,
+    STAT_OP_CLZ,
+    STAT_OP_CTZ,
+    STAT_OP_CPOP,
+    STAT_OP_SEXT_B,
+    STAT_OP_SEXT_H,
+    STAT_OP_ZEXT_H,
+    STAT_OP_REV8,
+    STAT_OP_ORC_B,
+    STAT_OP_ADDI,
+    STAT_OP_LW,
+    STAT_OP_SW,
+    STAT_OP_LUI,
+    STAT_OP_AUIPC,
+    STAT_OP_BEQ,
+    STAT_OP_BNE,
+    STAT_OP_BLT,
+    STAT_OP_BGE,
+    STAT_OP_JAL,
+    STAT_OP_JALR,
+    STAT_OP_LR,
+    STAT_OP_SC,
+    STAT_OP_AMO,
+    STAT_OP_VSETVLI,
+    STAT_OP_VLE32,
+    STAT_OP_VSE32,
+    STAT_OP_VADD,                   // VADD..VXOR in RvvOp order (rvv.h)
+    STAT_OP_VSUB,
+    STAT_OP_VMUL,
+    STAT_OP_VAND,
+    STAT_OP_VOR,
+    STAT_OP_VXOR,
+    STAT_OP_VREDSUM,
+    STAT_OP_CSR,                    // CSRRW..CSRRCI
+    STAT_OP_ECALL,
+    STAT_OP_COUNT
+} StatOp;
+
+typedef enum
+{
+    STAT_FMT_R = 0,
+    STAT_FMT_I,
+    STAT_FMT_S,
+    STAT_FMT_B,
+    STAT_FMT_U,
+    STAT_FMT_J,
+    STAT_FMT_V,
+    STAT_FMT_COUNT
+} StatFormat;
+
+struct CpuStats
+{
+    uint64_t op_count[STAT_OP_COUNT];
+    uint64_t format_count[STAT_FMT_COUNT];
+
+    uint64_t branches_taken;
+    uint64_t branches_not_taken;
+
+    uint64_t mem_reads;
+    uint64_t mem_writes;
+    uint64_t mem_bytes_read;
+    uint64_t mem_bytes_written;
+
+    uint64_t reg_reads[REG_NUMBER];
+    uint64_t reg_writes[REG_NUMBER];
+
+    uint64_t fetch_bytes;
+    uint64_t compressed;
+};
+
+typedef struct CpuStats CpuStats;
+
+void stats_init(CpuStats *stats);
+
+const char *stats_op_name(StatOp op);
+const char *stats_format_name(StatFormat fmt);
+const char *stats_role_name(RegRole role);
+
+void stats_print(const CpuStats *stats, const CPU *cpu);
+int stats_write_json(const CpuStats *stats, const CPU *cpu, FILE *out);
+int stats_write_csv(const CpuStats *stats, const CPU *cpu, FILE *out);
+
+#endif // STATS_H
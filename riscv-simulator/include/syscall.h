@@ -0,0 +1,82 @@
+#ifndef SYSCALL_H
+#define SYSCALL_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "assembler.h"
+#include "cpu.h"
+
+/**
+ * ECALL system calls with a small Linux-like ABI.
+ *
+ * The call number is in a7 and the arguments in a0-a2; the result, or
+ * -errno, is returned in a0. Buffer pointers are data-relative, like LW/SW
+ * addresses.
+ *
+ *   63   read(fd, buf, len)          fd 0 only
+ *   64   write(fd, buf, len)         fd 1 and 2
+ *   93   exit(status)                halts the calling hart; 94 (exit_group) too
+ *   113  clock_gettime(clock, tp)    clock 0 (realtime) or 1 (monotonic), stored
+ *                                    as two words: tv_sec, tv_nsec
+ *   214  brk(addr)                   moves the break between the end of .data
+ *                                    and the end of memory; returns the break
+ *
+ * Handlers are looked up in a table indexed by the call number; any other
+ * number returns -ENOSYS. Guest writes are collected in one buffer and reach
+ * the host in a single write(2) when it fills up, when the guest switches
+ * between stdout and stderr, reads stdin or exits, and at syscall_flush().
+ * Queued log messages are written first, so the two outputs keep their order.
+ *
+ * Reverse execution (undo.h) records what every call did and, when it
+ * replays from a keyframe, feeds that back instead of calling the handler
+ * (undo_syscall_replay). A call it has no record of still runs, with
+ * `replay` keeping it from repeating output or consuming input.
+ *
+ * One SyscallHost may be shared by the harts of an SmpSystem (smp.h); its
+ * lock serializes their calls.
+ **/
+
+#define SYSCALL_READ            63
+#define SYSCALL_WRITE           64
+#define SYSCALL_EXIT            93
+#define SYSCALL_EXIT_GROUP      94
+#define SYSCALL_CLOCK_GETTIME   113
+#define SYSCALL_BRK             214
+#define SYSCALL_COUNT           215     // size of the handler table
+
+#define SYSCALL_OUT_BUFFER (64 * 1024)  // guest output per host write
+
+typedef struct SyscallHost
+{
+    pthread_mutex_t lock;
+    uint32_t brk_start;             // data-relative end of .data, word aligned
+    uint32_t brk;
+    int exited;                     // a hart called exit
+    int32_t exit_code;              // its status, 0 until then
+    int replay;                     // reverse execution is re-running calls: unrecorded
+                                    // writes are dropped and reads see end of input
+
+    int out_fd;                     // host fd the buffered bytes go to
+    size_t out_len;
+    char out[SYSCALL_OUT_BUFFER];
+} SyscallHost;
+
+int syscall_host_init(SyscallHost *host);
+// flushes pending output and releases the lock
+void syscall_host_free(SyscallHost *host);
+// flushes pending output and resets the break and exit status for `program`
+void syscall_host_reset(SyscallHost *host, const AssemblyProgram *program);
+
+// writes the buffered guest output to the host; returns -1 if that failed
+int syscall_flush(SyscallHost *host);
+
+// name of call `number` ("write", ...), or "unknown"
+const char *syscall_name(uint32_t number);
+
+// runs the ECALL of `cpu` (number in a7) and writes its result to a0;
+// returns -1 if cpu->syscalls is NULL
+int syscall_dispatch(CPU *cpu);
+
+#endif // SYSCALL_H
@@ -0,0 +1,91 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Compact binary execution trace.
+ *
+ * One record per retired instruction: PC, raw instruction word (the halfword
+ * of a compressed RVC instruction), the destination register and its new
+ * value, and the address/value of a memory access (the word an AMO read,
+ * the word SC.W left behind, the first element of VLE32/VSE32). Vector
+ * register contents are not recorded. Records are delta- and varint-encoded
+ * against the previous ones:
+ *
+ *   flags   1 byte, TRACE_F_* bits
+ *   pc      zigzag varint, pc - (previous pc + length)  if TRACE_F_JUMP
+ *   word    varint                                      if TRACE_F_WORD
+ *   rd      1 byte + zigzag varint, value - old value   if TRACE_F_RD
+ *   addr    zigzag varint, addr - previous address      if TRACE_F_LOAD/STORE
+ *   value   zigzag varint, memory word                  if TRACE_F_LOAD/STORE
+ *
+ * The instruction word is only stored the first time a PC is seen (and when
+ * it changes), both sides keep the same table of recently seen words.
+ *
+ * The simulator thread encodes records into a single-producer/single-consumer
+ * lock-free ring buffer; a background writer thread drains it to disk.
+ **/
+
+#define TRACE_MAGIC "RVTRACE1"
+#define TRACE_MAGIC_SIZE 8
+#define TRACE_REGS 32
+#define TRACE_WORD_CACHE 4096           // entries, power of two
+#define TRACE_DEFAULT_RING_SIZE (1u << 22)
+
+#define TRACE_F_JUMP   0x01             // PC is not previous PC + its length (2 or 4)
+#define TRACE_F_WORD   0x02             // instruction word follows
+#define TRACE_F_RD     0x04             // register write follows
+#define TRACE_F_LOAD   0x08             // memory read follows
+#define TRACE_F_STORE  0x10             // memory write follows
+
+typedef struct
+{
+    uint32_t pc;
+    uint32_t word;
+    uint8_t flags;                  // TRACE_F_RD / TRACE_F_LOAD / TRACE_F_STORE
+    uint8_t rd;
+    int32_t rd_value;
+    uint32_t mem_addr;
+    int32_t mem_value;
+} TraceRecord;
+
+// delta state shared by the encoder and the decoder
+typedef struct
+{
+    uint32_t next_pc;
+    uint32_t last_addr;
+    int32_t regs[TRACE_REGS];
+    uint32_t words[TRACE_WORD_CACHE];
+    uint8_t word_valid[TRACE_WORD_CACHE];
+} TraceState;
+
+typedef struct TraceWriter TraceWriter;
+
+// writes the header (initial PC and registers) and starts the writer thread
+TraceWriter *trace_writer_open(const char *path, uint32_t pc, const int32_t regs[TRACE_REGS], size_t ring_size);
+void trace_writer_record(TraceWriter *w, const TraceRecord *rec);
+// drains the ring, stops the thread; returns -1 if any write failed
+int trace_writer_close(TraceWriter *w);
+uint64_t trace_writer_bytes(const TraceWriter *w);
+
+typedef struct
+{
+    void *file;
+    TraceState state;
+    uint32_t start_pc;
+    int32_t start_regs[TRACE_REGS];
+} TraceReader;
+
+int trace_reader_open(TraceReader *r, const char *path);
+// returns 1 for a record, 0 at end of trace, -1 on a malformed trace
+int trace_reader_next(TraceReader *r, TraceRecord *rec);
+void trace_reader_close(TraceReader *r);
+
+// prints a record in the simulator's [STEP]/[EXEC] format; `regs` holds the
+// register values before the instruction executed
+void trace_render_record(FILE *out, uint32_t step, const int32_t regs[TRACE_REGS], const TraceRecord *rec);
+
+#endif // TRACE_H
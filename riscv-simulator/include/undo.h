@@ -0,0 +1,220 @@
+#ifndef UNDO_H
+#define UNDO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cpu.h"
+#include "instruction.h"
+#include "memory.h"
+
+/**
+ * Reverse execution.
+ *
+ * While an UndoLog is attached to a CPU, cpu_step() records for every
+ * instruction the PC it started at and the values it is about to overwrite:
+ * the old contents of rd and/or the old memory word of a store (an atomic
+ * memory operation changes both). Entries live in
+ * a ring buffer indexed by the instruction count, so recording is a handful
+ * of stores and no allocation. Stepping back pops entries and writes the old
+ * values back.
+ *
+ * The ring only reaches `capacity` instructions into the past. To go further
+ * the log also keeps keyframes, full copies of the registers and guest
+ * memory taken every `keyframe_every` instructions (the most recent
+ * `max_keyframes` are kept). Seeking before the ring restores the nearest
+ * earlier keyframe and re-executes forward to the target with tracing,
+ * statistics and the other attached sinks detached.
+ *
+ * Vector instructions (RVV) change more state than an entry holds, so they
+ * are recorded as replay points: going back past one restores the nearest
+ * earlier keyframe and re-executes, which needs keyframes to be enabled.
+ * Reverse-continue watchpoints do not see vector stores.
+ *
+ * System calls change host state as well. Every ECALL keeps an UndoSyscall
+ * with the memory it wrote (the read buffer, the clock_gettime words) before
+ * and after the call, its result and the heap break and exit status around
+ * it. Stepping back over one puts the old bytes and host state back; replaying
+ * from a keyframe feeds the recorded result and bytes to the guest instead of
+ * calling the host again, so reads return the same input and the clock the
+ * same time. Keyframes hold the host state too. Output that was written
+ * stays written. Reverse execution is single-hart, so none of this takes the
+ * SyscallHost lock.
+ *
+ * Execution statistics, the profiler and trace sinks are not rewound.
+ **/
+
+#define UNDO_DEFAULT_CAPACITY (1u << 16)
+#define UNDO_DEFAULT_KEYFRAMES 32
+
+#define UNDO_F_RD    0x01           // `old` is the previous value of x[rd]
+#define UNDO_F_STORE 0x02           // `old_word` is the previous word at `addr`
+#define UNDO_F_REPLAY 0x04          // vector instruction: undone by replaying from a keyframe
+#define UNDO_F_SYSCALL 0x08         // ECALL: the rest is in the UndoSyscall of this instruction
+
+typedef struct
+{
+    uint32_t pc;
+    uint32_t addr;
+    int32_t old;
+    int32_t old_word;
+    uint8_t rd;
+    uint8_t flags;
+} UndoEntry;
+
+// the part of SyscallHost (syscall.h) a call can change
+typedef struct
+{
+    uint32_t brk;
+    int exited;
+    int32_t exit_code;
+} UndoHostState;
+
+typedef struct
+{
+    uint32_t executed;              // instruction count of the ECALL
+    uint32_t addr;                  // memory the call may write: [addr, addr + len)
+    uint32_t len;
+    uint8_t *bytes;                 // len bytes before the call, then len bytes after
+    int32_t result;
+    int halted;                     // the call stopped the hart (exit)
+    int done;                       // result and the state after are filled in
+    UndoHostState before;
+    UndoHostState after;
+} UndoSyscall;
+
+typedef struct
+{
+    uint32_t executed;              // instruction count the keyframe was taken at
+    uint32_t pc;
+    int32_t regs[REG_NUMBER];
+    CpuVector vector;
+    UndoHostState host;
+    uint8_t *memory;
+} UndoKeyframe;
+
+typedef struct UndoLog
+{
+    UndoEntry *entries;
+    uint32_t capacity;              // power of two
+    uint32_t mask;
+    uint32_t oldest;                // instruction count of the oldest valid entry
+
+    UndoKeyframe *keyframes;        // ring of the most recent keyframes
+    uint32_t max_keyframes;
+    uint32_t keyframe_count;
+    uint32_t keyframe_head;         // slot of the oldest keyframe
+    uint32_t keyframe_every;
+    uint32_t next_keyframe;         // instruction count of the next keyframe
+    size_t memory_size;
+
+    UndoSyscall *syscalls;          // [syscall_head, syscall_count), oldest first
+    uint32_t syscall_head;
+    uint32_t syscall_count;
+    uint32_t syscall_capacity;
+} UndoLog;
+
+// where reverse_continue stops: before an instruction at `pc` or with a
+// breakpoint flag executes, or before a store that overlaps
+// [watch_addr, watch_addr + watch_len)
+typedef struct
+{
+    int has_pc;
+    uint32_t pc;
+    const uint8_t *breakpoints;     // per halfword of code, as CPU.breakpoints; may be NULL
+    uint32_t breakpoint_slots;
+    uint32_t watch_addr;
+    uint32_t watch_len;             // 0 for no watchpoint
+} UndoStop;
+
+// capacity is rounded up to a power of two; keyframe_every 0 means capacity
+int undo_init(UndoLog *log, uint32_t capacity, uint32_t keyframe_every, uint32_t max_keyframes);
+void undo_free(UndoLog *log);
+
+// forgets the history and starts recording from the current state of `cpu`
+int undo_reset(UndoLog *log, CPU *cpu);
+
+// `pc` is the address of the instruction about to execute (cpu->pc has
+// already moved past it inside cpu_step)
+void undo_keyframe(UndoLog *log, CPU *cpu, uint32_t pc);
+
+// called by undo_record() for an ECALL, before it runs
+void undo_syscall_begin(UndoLog *log, CPU *cpu);
+// called by syscall_dispatch() after the handler returned `result`
+void undo_syscall_end(UndoLog *log, CPU *cpu, int32_t result);
+// while replaying: repeats the recorded effects of the ECALL about to run and
+// stores its result; returns 0 if the call was not recorded
+int undo_syscall_replay(UndoLog *log, CPU *cpu, int32_t *result);
+
+// earliest instruction count the CPU can be taken back to
+uint32_t undo_earliest(const UndoLog *log);
+
+// steps back up to `count` instructions; returns how many were undone
+uint32_t undo_step_back(UndoLog *log, CPU *cpu, uint32_t count);
+// moves back to the state before instruction `executed` ran
+int undo_seek(UndoLog *log, CPU *cpu, uint32_t executed);
+// runs backwards to the latest earlier point matching `stop`; returns 1 if
+// one was found, 0 if the start of the history was reached
+int undo_reverse_continue(UndoLog *log, CPU *cpu, const UndoStop *stop);
+
+// address the instruction `word` may store to (SW, SC.W and the AMOs);
+// returns 0 if it does not store or the address is out of bounds
+static inline int undo_store_addr(const CPU *cpu, uint32_t word, uint32_t *addr)
+{
+    uint8_t opcode = word & 0x7F;
+    uint32_t data_offset = cpu->program->code_size;
+
+    if(opcode == 0x23)
+        *addr = data_offset + cpu->regs[stype_get_rs1(word)] + stype_get_immediate(word);
+    else if(opcode == 0x2F && (rtype_get_funct7(word) >> 2) != 0x02)
+        *addr = data_offset + cpu->regs[rtype_get_rs1(word)];
+    else
+        return 0;
+    return (size_t)*addr + 4 <= cpu->memory->size;
+}
+
+// called by cpu_step() after decode, before the instruction executes
+static inline void undo_record(UndoLog *log, CPU *cpu, uint32_t pc, EncodedInstruction enc)
+{
+    uint32_t n = cpu->instructions_executed;
+    if(n >= log->next_keyframe)
+        undo_keyframe(log, cpu, pc);
+
+    UndoEntry *e = &log->entries[n & log->mask];
+    e->pc = pc;
+    e->flags = 0;
+
+    uint8_t opcode = enc.value & 0x7F;
+    uint32_t addr;
+    if(vtype_is_vector(enc.value))
+    {
+        e->flags = UNDO_F_REPLAY;
+    }
+    else
+    {
+        if(undo_store_addr(cpu, enc.value, &addr))
+        {
+            e->flags = UNDO_F_STORE;
+            e->addr = addr;
+            e->old_word = (int32_t)memory_peek32(cpu->memory, addr);
+        }
+
+        if(opcode != 0x23 && opcode != 0x63)
+        {
+            e->flags |= UNDO_F_RD;
+            e->rd = (enc.value == 0x00000073) ? 10 : rtype_get_rd(enc.value);    // ECALL returns in a0
+            e->old = cpu->regs[e->rd];
+        }
+
+        if(enc.value == 0x00000073)
+        {
+            e->flags |= UNDO_F_SYSCALL;
+            undo_syscall_begin(log, cpu);
+        }
+    }
+
+    if(n - log->oldest >= log->capacity)
+        log->oldest = n + 1 - log->capacity;
+}
+
+#endif // UNDO_H
@@ -1,151 +1,687 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
-#include "assembler.h"
-#include "cpu.h"
-#include "encoder.h"
-#include "memory.h"
+#include "checkpoint.h"
+#include "gdb_stub.h"
+#include "log.h"
+#include "loop_trace.h"
+#include "profiler.h"
+#include "riscvsim.h"
+#include "scheduler.h"
+#include "smp.h"
+#include "trace.h"
+
+#define MAIN_MAX_STOPS 16
+
+static void write_stats_file(const char *path, const CpuStats *stats, const CPU *cpu,
+                             int (*writer)(const CpuStats *, const CPU *, FILE *))
+{
+    FILE *f = fopen(path, "w");
+    if(!f)
+    {
+        LOG_ERROR(LOG_CAT_MAIN, "[ERROR] cannot open statistics file '%s'.\n", path);
+        return;
+    }
+
+    if(writer(stats, cpu, f) < 0 || fclose(f) != 0)
+    {
+        LOG_ERROR(LOG_CAT_MAIN, "[ERROR] writing statistics file '%s' failed.\n", path);
+        return;
+    }
+
+    LOG_INFO(LOG_CAT_MAIN, "[OK] Statistics written to %s\n", path);
+}
+
+// a code label or a numeric address
+static int parse_code_address(AssemblyProgram *program, const char *text, uint32_t *out)
+{
+    if(find_symbol(program, text, out) == 0)
+        return 0;
+
+    char *end = NULL;
+    unsigned long value = strtoul(text, &end, 0);
+    if(end == text || *end != '\0')
+        return -1;
+    *out = (uint32_t)value;
+    return 0;
+}
+
+// a .data label or a numeric memory address
+static int parse_data_address(AssemblyProgram *program, uint32_t data_offset, const char *text, uint32_t *out)
+{
+    for(int i = 0; i < program->data_count; ++i)
+    {
+        if(strcmp(program->data[i].label, text) == 0)
+        {
+            *out = data_offset + program->data[i].address;
+            return 0;
+        }
+    }
+
+    char *end = NULL;
+    unsigned long value = strtoul(text, &end, 0);
+    if(end == text || *end != '\0')
+        return -1;
+    *out = (uint32_t)value;
+    return 0;
+}
+
+// --harts: runs the loaded program on `hart_count` harts sharing its memory
+// and prints per-hart results in place of the single CPU state; with
+// --workers the harts share a pool of `workers` threads (0: one per host
+// CPU) and `quantum` is their time slice
+static int run_harts(RiscvSim *sim, uint32_t hart_count, uint32_t quantum, int pooled, uint32_t workers,
+                     uint32_t max_instructions, uint32_t vlen)
+{
+    SmpSystem smp;
+    if(smp_init(&smp, rvsim_memory(sim), rvsim_program(sim), hart_count) < 0)
+        return -1;
+    for(uint32_t h = 0; h < smp.hart_count; ++h)
+    {
+        cpu_set_vlen(&smp.harts[h], vlen);
+        smp.harts[h].syscalls = rvsim_syscalls(sim);
+    }
+
+    if(pooled)
+        LOG_INFO(LOG_CAT_MAIN, "[OK] %u harts on %s%u worker threads, slices of %u instructions\n", hart_count,
+                 workers ? "" : "one per host CPU, ", workers ? workers : (uint32_t)sysconf(_SC_NPROCESSORS_ONLN),
+                 quantum ? quantum : SCHEDULER_DEFAULT_SLICE);
+    else if(quantum)
+        LOG_INFO(LOG_CAT_MAIN, "[OK] %u harts, synchronized every %u instructions\n", hart_count, quantum);
+    else
+        LOG_INFO(LOG_CAT_MAIN, "[OK] %u harts, free-running\n", hart_count);
+
+    LOG_INFO(LOG_CAT_MAIN, "\n[STEP 6] Executing program...\n");
+    LOG_INFO(LOG_CAT_MAIN, "-----------------------------------------------------------------\n");
+    int rc = pooled ? smp_run_scheduled(&smp, max_instructions, workers, quantum)
+                    : smp_run(&smp, max_instructions, quantum);
+    syscall_flush(rvsim_syscalls(sim));
+    LOG_INFO(LOG_CAT_MAIN, "-----------------------------------------------------------------\n");
+
+    LOG_DEBUG(LOG_CAT_MAIN, "\n[DEBUG] Memory dump (data region) after execution:\n");
+    memory_dump_words(rvsim_memory(sim), rvsim_data_offset(sim), 8);
+
+    LOG_INFO(LOG_CAT_MAIN, "\n[STEP 7] Final hart states:\n");
+    LOG_INFO(LOG_CAT_MAIN, "-----------------------------------------------------------------\n");
+    for(uint32_t h = 0; h < smp.hart_count; ++h)
+    {
+        const CPU *cpu = &smp.harts[h];
+        LOG_INFO(LOG_CAT_MAIN, "  hart %3u: PC=0x%08X a0=%-11d instructions=%-10u %s\n", h, cpu->pc, cpu->regs[10],
+                 cpu->instructions_executed, cpu->error ? "ERROR" : (cpu->halted ? "halted" : "limit reached"));
+    }
+    LOG_INFO(LOG_CAT_MAIN, "-----------------------------------------------------------------\n");
+
+    LOG_INFO(LOG_CAT_MAIN, "\n[SUMMARY]\n");
+    LOG_INFO(LOG_CAT_MAIN, "  Program instructions: %d\n", rvsim_program(sim)->instruction_count);
+    LOG_INFO(LOG_CAT_MAIN, "  Harts: %u\n", smp.hart_count);
+    LOG_INFO(LOG_CAT_MAIN, "  Instructions executed (all harts): %llu\n",
+             (unsigned long long)smp_instructions_executed(&smp));
+    LOG_INFO(LOG_CAT_MAIN, "  Error: %s\n", (rc < 0) ? "YES" : "NO");
+    if(rvsim_exited(sim))
+        LOG_INFO(LOG_CAT_MAIN, "  Exit code: %d\n", rvsim_exit_code(sim));
+    LOG_INFO(LOG_CAT_MAIN, "\n");
+
+    smp_free(&smp);
+    return rc;
+}
 
 int main(int argc, char **argv) 
 {
-    printf("=================================================================\n");
-    printf("        RISC-V Assembly Simulator - Executor Test\n");
-    printf("=================================================================\n\n");
+    // messages are buffered from here on; log_shutdown() runs at exit
+    if(log_init() < 0)
+        fprintf(stderr, "[WARN] main: cannot start the log writer, logging unbuffered.\n");
+
+    LOG_INFO(LOG_CAT_MAIN, "=================================================================\n");
+    LOG_INFO(LOG_CAT_MAIN, "        RISC-V Assembly Simulator - Executor Test\n");
+    LOG_INFO(LOG_CAT_MAIN, "=================================================================\n\n");
 
     // ===== STEP 1: PARSE ASM FILE =====
-    printf("[STEP 1] Parsing assembly file...\n");
-    if(argc != 2)
+    LOG_INFO(LOG_CAT_MAIN, "[STEP 1] Parsing assembly file...\n");
+    char *filename = NULL;
+    int profile = 0;
+    int stats_table = 0;
+    const char *stats_json_path = NULL;
+    const char *stats_csv_path = NULL;
+    const char *trace_bin_path = NULL;
+    int trace_loops = 0;
+    const char *checkpoint_path = NULL;
+    uint32_t checkpoint_every = CHECKPOINT_DEFAULT_INTERVAL;
+    char *resume_path = NULL;
+    int undo = 0;
+    uint32_t undo_entries = 0;
+    uint32_t step_back = 0;
+    const char *reverse_to = NULL;
+    const char *reverse_watch = NULL;
+    const char *gdb_spec = NULL;
+    const char *break_specs[MAIN_MAX_STOPS];
+    int break_count = 0;
+    const char *watch_specs[MAIN_MAX_STOPS];
+    int watch_count = 0;
+    uint32_t harts = 1;
+    uint32_t quantum = 0;
+    int pooled = 0;
+    uint32_t workers = 0;
+    size_t memory_size = RVSIM_DEFAULT_MEMORY_SIZE;
+    uint32_t vlen = CPU_VLEN_DEFAULT;
+    int rvc = 0;
+    uint32_t max_instructions = CPU_DEFAULT_MAX_INSTRUCTIONS;
+    int quiet = 0;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--profile") == 0)
+        {
+            profile = 1;
+        }
+        else if(strcmp(argv[i], "--stats") == 0)
+        {
+            stats_table = 1;
+        }
+        else if(strcmp(argv[i], "--stats-json") == 0 && i + 1 < argc)
+        {
+            stats_json_path = argv[++i];
+        }
+        else if(strcmp(argv[i], "--stats-csv") == 0 && i + 1 < argc)
+        {
+            stats_csv_path = argv[++i];
+        }
+        else if(strcmp(argv[i], "--trace-bin") == 0 && i + 1 < argc)
+        {
+            trace_bin_path = argv[++i];
+        }
+        else if(strcmp(argv[i], "--trace-loops") == 0)
+        {
+            trace_loops = 1;
+        }
+        else if(strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc)
+        {
+            checkpoint_path = argv[++i];
+        }
+        else if(strcmp(argv[i], "--checkpoint-every") == 0 && i + 1 < argc)
+        {
+            checkpoint_every = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if(strcmp(argv[i], "--resume") == 0 && i + 1 < argc)
+        {
+            resume_path = argv[++i];
+        }
+        else if(strcmp(argv[i], "--undo") == 0 && i + 1 < argc)
+        {
+            undo = 1;
+            undo_entries = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if(strcmp(argv[i], "--step-back") == 0 && i + 1 < argc)
+        {
+            undo = 1;
+            step_back = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if(strcmp(argv[i], "--reverse-to") == 0 && i + 1 < argc)
+        {
+            undo = 1;
+            reverse_to = argv[++i];
+        }
+        else if(strcmp(argv[i], "--reverse-watch") == 0 && i + 1 < argc)
+        {
+            undo = 1;
+            reverse_watch = argv[++i];
+        }
+        else if(strcmp(argv[i], "--break") == 0 && i + 1 < argc && break_count < MAIN_MAX_STOPS)
+        {
+            break_specs[break_count++] = argv[++i];
+        }
+        else if(strcmp(argv[i], "--watch") == 0 && i + 1 < argc && watch_count < MAIN_MAX_STOPS)
+        {
+            watch_specs[watch_count++] = argv[++i];
+        }
+        else if(strcmp(argv[i], "--gdb") == 0 && i + 1 < argc)
+        {
+            gdb_spec = argv[++i];
+        }
+        else if(strcmp(argv[i], "--harts") == 0 && i + 1 < argc)
+        {
+            harts = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if(strcmp(argv[i], "--quantum") == 0 && i + 1 < argc)
+        {
+            quantum = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if(strcmp(argv[i], "--workers") == 0 && i + 1 < argc)
+        {
+            pooled = 1;
+            workers = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if(strcmp(argv[i], "--memory") == 0 && i + 1 < argc)
+        {
+            memory_size = (size_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if(strcmp(argv[i], "--vlen") == 0 && i + 1 < argc)
+        {
+            vlen = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if(strcmp(argv[i], "--rvc") == 0)
+        {
+            rvc = 1;
+        }
+        else if(strcmp(argv[i], "--max-instructions") == 0 && i + 1 < argc)
+        {
+            max_instructions = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if(strcmp(argv[i], "--quiet") == 0)
+        {
+            quiet = 1;
+        }
+        else if(strcmp(argv[i], "--log-level") == 0 && i + 1 < argc)
+        {
+            if(log_parse_level(argv[++i]) < 0)
+            {
+                LOG_ERROR(LOG_CAT_MAIN, "[ERROR] main: invalid log level '%s'.\n", argv[i]);
+                return 1;
+            }
+        }
+        else if(argv[i][0] == '-')
+        {
+            LOG_ERROR(LOG_CAT_MAIN, "[ERROR] main: unknown option '%s'.\n", argv[i]);
+            return 1;
+        }
+        else
+        {
+            filename = argv[i];
+        }
+    }
+
+    if(!filename)
+    {
+        LOG_ERROR(LOG_CAT_MAIN, "[ERROR] main: not enough arguments.\n");
+        LOG_INFO(LOG_CAT_MAIN, "Usage: %s [--profile] [--stats] [--stats-json <file>] [--stats-csv <file>]\n"
+               "          [--trace-bin <file>] [--trace-loops] [--memory <bytes>] [--max-instructions <n>] [--quiet]\n"
+               "          [--checkpoint <file>] [--checkpoint-every <n>] [--resume <file>[:<n>]]\n"
+               "          [--undo <entries>] [--step-back <n>] [--reverse-to <label|addr>] [--reverse-watch <label|addr>]\n"
+               "          [--break <label|addr>] [--watch <label|addr>] [--gdb <port>|unix:<path>]\n"
+               "          [--harts <n>] [--quantum <instructions>] [--workers <n>] [--vlen <bits>] [--rvc]\n"
+               "          [--log-level [category=]level] <file.asm>\n", argv[0]);
+        return 1;
+    }
+
+    // the harts of a multi-hart run have no profiler, sinks or debug state
+    if((harts != 1 || pooled) && (profile || stats_table || stats_json_path || stats_csv_path || trace_bin_path || trace_loops ||
+                      checkpoint_path || resume_path || undo || break_count || watch_count || gdb_spec))
     {
-        printf("[ERROR] main: not enough arguments.\n");
+        LOG_ERROR(LOG_CAT_MAIN, "[ERROR] main: --harts only runs the program; profiling, statistics, traces, "
+                  "checkpoints and debugging need a single hart.\n");
         return 1;
     }
 
-    char *filename = argv[1];
-    AssemblyProgram program = {0};
+    RiscvSim *sim = rvsim_create();
+    if(!sim)
+        return 1;
+    rvsim_set_trace(sim, !quiet);
+    rvsim_set_rvc(sim, rvc);
+    if(rvsim_set_vlen(sim, vlen) < 0)
+    {
+        rvsim_destroy(sim);
+        return 1;
+    }
 
-    if(read_asm_file(filename, &program) < 0)
+    if(rvsim_assemble(sim, filename) < 0)
     {
-        printf("[FAILED] read_asm_file function failed.\n");
+        LOG_ERROR(LOG_CAT_MAIN, "[FAILED] read_asm_file function failed.\n");
+        rvsim_destroy(sim);
         return 1;
     }
-    printf("[OK] Loaded %d instructions\n", program.instruction_count);
-    print_program(&program);
+    AssemblyProgram *program = rvsim_program(sim);
+    LOG_INFO(LOG_CAT_MAIN, "[OK] Loaded %d instructions\n", program->instruction_count);
+    if(!quiet)
+        print_program(program);
 
     // ===== STEP 2: INITIALIZE MEMORY =====
-    printf("\n[STEP 2] Initializing memory...\n");
-    Memory m = memory_init(400);
-    printf("[OK] Memory initialized (size: %zu bytes)\n", m.size);
+    LOG_INFO(LOG_CAT_MAIN, "\n[STEP 2] Initializing memory...\n");
+    if(rvsim_set_memory_size(sim, memory_size) < 0 || rvsim_init_memory(sim) < 0)
+    {
+        LOG_ERROR(LOG_CAT_MAIN, "[FAILED] memory_init failed.\n");
+        rvsim_destroy(sim);
+        return 1;
+    }
+    Memory *m = rvsim_memory(sim);
+    LOG_INFO(LOG_CAT_MAIN, "[OK] Memory initialized (size: %zu bytes)\n", m->size);
 
     // ===== STEP 3: ENCODE INSTRUCTIONS =====
-    printf("\n[STEP 3] Encoding instructions...\n");
-    uint32_t *enc = (uint32_t *)malloc(sizeof(uint32_t) * program.instruction_count);
-    if(!enc)
+    LOG_INFO(LOG_CAT_MAIN, "\n[STEP 3] Encoding instructions...\n");
+    if(rvsim_encode(sim) < 0)
     {
-        printf("[ERROR] memory allocation for encoded array failed.\n");
+        rvsim_destroy(sim);
         return 1;
     }
+    LOG_INFO(LOG_CAT_MAIN, "[OK] Encoded %d/%d instructions\n", program->instruction_count, program->instruction_count);
+
+    // ===== STEP 4: LOAD PROGRAM AND DATA INTO MEMORY =====
+    LOG_INFO(LOG_CAT_MAIN, "\n[STEP 4] Loading program into memory...\n");
+    if(rvsim_load(sim) < 0)
+    {
+        LOG_ERROR(LOG_CAT_MAIN, "[FAILED] loading the program into memory failed.\n");
+        rvsim_destroy(sim);
+        return 1;
+    }
+    LOG_INFO(LOG_CAT_MAIN, "[OK] Program loaded at address 0x00000000\n");
+
+    // data is placed right after the instructions
+    uint32_t data_offset = rvsim_data_offset(sim);
+    if(program->data_count > 0)
+    {
+        LOG_INFO(LOG_CAT_MAIN, "\n[STEP 4B] Loading data section into memory...\n");
+        LOG_INFO(LOG_CAT_MAIN, "[OK] Data loaded starting at address 0x%08X\n", data_offset);
+    }
+
+    LOG_INFO(LOG_CAT_MAIN, "[OK] Data loaded at address 0x%08X\n", data_offset);
 
-    int encoded_count = 0;
-    for(int i = 0; i < program.instruction_count; ++i)
+    if(!quiet)
     {
-        Instruction *instr = &program.instructions[i];
+        LOG_DEBUG(LOG_CAT_MAIN, "\n[DEBUG] Memory dump after loading:\n");
+        memory_dump_words(m, 0, data_offset + 16);
+    }
 
-        printf("[%02d] (PC=0x%08X) ", i, instr->address);
-        if(instr->label[0] != '\0')
-            printf("%s: ", instr->label);
-        printf("%s ", instr->opcode);
+    // ===== STEP 5: INITIALIZE CPU =====
+    LOG_INFO(LOG_CAT_MAIN, "\n[STEP 5] Initializing CPU...\n");
+    CPU *cpu = rvsim_cpu(sim);
+    LOG_INFO(LOG_CAT_MAIN, "[OK] CPU initialized\n");
 
-        for (int j = 0; j < instr->operand_count; ++j)
+    if(harts != 1 || pooled)
+    {
+        int rc = run_harts(sim, harts, quantum, pooled, workers, max_instructions, vlen);
+        int exit_code = rvsim_exit_code(sim);
+        rvsim_destroy(sim);
+        if(rc < 0)
         {
-            printf("%s", instr->operands[j]);
-            if(j + 1 < instr->operand_count) printf(", ");
+            LOG_ERROR(LOG_CAT_MAIN, "[FAILED] multi-hart execution failed!\n");
+            return 1;
         }
+        LOG_INFO(LOG_CAT_MAIN, "=================================================================\n");
+        LOG_INFO(LOG_CAT_MAIN, "                    Execution Completed\n");
+        LOG_INFO(LOG_CAT_MAIN, "=================================================================\n");
+        return exit_code;
+    }
 
-        uint32_t code = encode_instruction(&program, instr);
-        enc[i] = code;
-        printf(" -> encoded: 0x%08X\n", enc[i]);
-        if(code == 0)
+    // --resume <file>[:<n>] continues from checkpoint n (default: the last one)
+    if(resume_path)
+    {
+        int index = -1;
+        char *colon = strrchr(resume_path, ':');
+        if(colon && colon[1] != '\0' && strspn(colon + 1, "0123456789") == strlen(colon + 1))
+        {
+            *colon = '\0';
+            index = atoi(colon + 1);
+        }
+
+        int restored = checkpoint_restore(resume_path, index, cpu);
+        if(restored < 0)
         {
-            printf("[ERROR] Encoding failed at instruction %d (line %d). Aborting.\n",
-                i, instr->line_number);
-            free(enc);
-            memory_free(&m);
+            LOG_ERROR(LOG_CAT_MAIN, "[FAILED] cannot resume from '%s'.\n", resume_path);
+            rvsim_destroy(sim);
             return 1;
         }
-        encoded_count++;
+        LOG_INFO(LOG_CAT_MAIN, "[OK] Resumed from checkpoint %d of %s (PC=0x%08X, %u instructions executed)\n",
+                 restored, resume_path, cpu->pc, cpu->instructions_executed);
     }
-    printf("[OK] Encoded %d/%d instructions\n", encoded_count, program.instruction_count);
 
-    // ===== STEP 4: LOAD PROGRAM INTO MEMORY =====
-    printf("\n[STEP 4] Loading program into memory...\n");
-    load_program_into_memory(&m, enc, program.instruction_count, 0);
-    printf("[OK] Program loaded at address 0x00000000\n");
+    if(checkpoint_path)
+    {
+        cpu->checkpoint = checkpoint_open(checkpoint_path, cpu, checkpoint_every);
+        if(!cpu->checkpoint)
+        {
+            LOG_ERROR(LOG_CAT_MAIN, "[FAILED] cannot create checkpoint file '%s'.\n", checkpoint_path);
+            rvsim_destroy(sim);
+            return 1;
+        }
+        LOG_INFO(LOG_CAT_MAIN, "[OK] Checkpoints every %u instructions (%s)\n", checkpoint_every, checkpoint_path);
+    }
 
-    // ===== STEP 4B: LOAD DATA INTO MEMORY (AFTER INSTRUCTIONS) =====
-    uint32_t data_offset = program.instruction_count * 4;  
-    if(program.data_count > 0)
+    UndoStop reverse_stop = {0};
+    if(reverse_to && parse_code_address(program, reverse_to, &reverse_stop.pc) == 0)
+        reverse_stop.has_pc = 1;
+    else if(reverse_to)
     {
-        printf("\n[STEP 4B] Loading data section into memory...\n");
-        load_data_into_memory(&m, &program, data_offset);
-        printf("[OK] Data loaded starting at address 0x%08X\n", data_offset);
+        LOG_ERROR(LOG_CAT_MAIN, "[FAILED] unknown label or address '%s'.\n", reverse_to);
+        rvsim_destroy(sim);
+        return 1;
+    }
+    if(reverse_watch && parse_data_address(program, data_offset, reverse_watch, &reverse_stop.watch_addr) == 0)
+        reverse_stop.watch_len = 4;
+    else if(reverse_watch)
+    {
+        LOG_ERROR(LOG_CAT_MAIN, "[FAILED] unknown label or address '%s'.\n", reverse_watch);
+        rvsim_destroy(sim);
+        return 1;
     }
 
-    printf("[OK] Data loaded at address 0x%08X\n", data_offset);
+    if(undo)
+    {
+        if(rvsim_enable_undo(sim, undo_entries) < 0)
+        {
+            LOG_ERROR(LOG_CAT_MAIN, "[FAILED] cannot allocate the undo log.\n");
+            rvsim_destroy(sim);
+            return 1;
+        }
+        LOG_INFO(LOG_CAT_MAIN, "[OK] Reverse execution enabled (%u-instruction undo log)\n", cpu->undo->capacity);
+    }
 
-    printf("\n[DEBUG] Memory dump after loading:\n");
-    memory_dump_words(&m, 0, data_offset + 16);
+    for(int b = 0; b < break_count; ++b)
+    {
+        uint32_t addr;
+        if(parse_code_address(program, break_specs[b], &addr) < 0 || rvsim_set_breakpoint(sim, addr) < 0)
+        {
+            LOG_ERROR(LOG_CAT_MAIN, "[FAILED] cannot set a breakpoint at '%s'.\n", break_specs[b]);
+            rvsim_destroy(sim);
+            return 1;
+        }
+        LOG_INFO(LOG_CAT_MAIN, "[OK] Breakpoint at PC=0x%08X (%s)\n", addr, break_specs[b]);
+    }
 
-    // ===== STEP 5: INITIALIZE CPU =====
-    printf("\n[STEP 5] Initializing CPU...\n");
-    CPU cpu;
-    cpu_init_with_program(&cpu, &m, &program);
-    printf("[OK] CPU initialized\n");
+    for(int w = 0; w < watch_count; ++w)
+    {
+        uint32_t addr;
+        if(parse_data_address(program, data_offset, watch_specs[w], &addr) < 0 ||
+           rvsim_set_watchpoint(sim, addr, 4, MEMORY_WATCH_WRITE) < 0)
+        {
+            LOG_ERROR(LOG_CAT_MAIN, "[FAILED] cannot set a watchpoint at '%s'.\n", watch_specs[w]);
+            rvsim_destroy(sim);
+            return 1;
+        }
+        LOG_INFO(LOG_CAT_MAIN, "[OK] Watchpoint on writes to 0x%08X (%s)\n", addr, watch_specs[w]);
+    }
 
-    printf("\n[DEBUG] Initial CPU state:\n");
-    cpu_print_state(&cpu);
+    Profiler profiler;
+    if(profile)
+    {
+        profiler_init(&profiler, cpu->pc);
+        cpu->profiler = &profiler;
+        LOG_INFO(LOG_CAT_MAIN, "[OK] Calling-context profiler enabled\n");
+    }
+
+    if(stats_table || stats_json_path || stats_csv_path)
+    {
+        rvsim_enable_stats(sim);
+        LOG_INFO(LOG_CAT_MAIN, "[OK] Execution statistics enabled\n");
+    }
+
+    if(trace_bin_path)
+    {
+        cpu->tracer = trace_writer_open(trace_bin_path, cpu->pc, cpu->regs, TRACE_DEFAULT_RING_SIZE);
+        if(!cpu->tracer)
+        {
+            LOG_ERROR(LOG_CAT_MAIN, "[FAILED] cannot create binary trace '%s'.\n", trace_bin_path);
+            rvsim_destroy(sim);
+            return 1;
+        }
+        LOG_INFO(LOG_CAT_MAIN, "[OK] Binary trace enabled (%s)\n", trace_bin_path);
+    }
+
+    // the loop-aware trace replaces the per-instruction output
+    LoopTrace loop_trace;
+    FILE *loop_out = NULL;
+    if(trace_loops && cpu->trace)
+    {
+        loop_out = log_open_stream(LOG_CAT_TRACE, LOG_LEVEL_TRACE);
+        loop_trace_init(&loop_trace, loop_out ? loop_out : stdout, cpu->regs, data_offset);
+        cpu->loop_trace = &loop_trace;
+        cpu->trace = 0;
+        LOG_INFO(LOG_CAT_MAIN, "[OK] Loop-compressed trace enabled\n");
+    }
+
+    LOG_DEBUG(LOG_CAT_MAIN, "\n[DEBUG] Initial CPU state:\n");
+    cpu_print_state(cpu);
 
     // ===== STEP 6: EXECUTE PROGRAM =====
-    printf("\n[STEP 6] Executing program...\n");
-    printf("-----------------------------------------------------------------\n");
+    LOG_INFO(LOG_CAT_MAIN, "\n[STEP 6] Executing program...\n");
+    LOG_INFO(LOG_CAT_MAIN, "-----------------------------------------------------------------\n");
     
-    int exec_result = cpu_run(&cpu);
+    RvsimStatus status;
+    if(gdb_spec)
+    {
+        // the debugger decides how far to run; --max-instructions does not apply
+        int listen_fd = gdb_stub_listen(gdb_spec);
+        if(listen_fd < 0 || gdb_stub_serve(listen_fd, cpu) < 0)
+            cpu->error = 1;
+        if(listen_fd >= 0)
+            close(listen_fd);
+        syscall_flush(rvsim_syscalls(sim));
+        status = cpu->error ? RVSIM_ERROR : (cpu->halted ? RVSIM_HALTED : RVSIM_BUDGET);
+    }
+    else
+    {
+        // the limit counts from the start of the program, also when resuming
+        uint32_t budget = (cpu->instructions_executed < max_instructions) ? max_instructions - cpu->instructions_executed : 0;
+        status = rvsim_run(sim, budget);
+    }
+
+    if(cpu->loop_trace)
+    {
+        loop_trace_finish(cpu->loop_trace);
+        if(loop_out)
+            fclose(loop_out);
+        LOG_INFO(LOG_CAT_MAIN, "\n[INFO] Loop-compressed trace: %llu trace lines folded into [ITER] records\n",
+               (unsigned long long)cpu->loop_trace->lines_saved);
+    }
     
-    printf("-----------------------------------------------------------------\n");
+    LOG_INFO(LOG_CAT_MAIN, "-----------------------------------------------------------------\n");
+
+    if(cpu->tracer)
+    {
+        uint64_t trace_bytes = trace_writer_bytes(cpu->tracer);
+        if(trace_writer_close(cpu->tracer) < 0)
+            LOG_ERROR(LOG_CAT_MAIN, "[ERROR] writing binary trace '%s' failed.\n", trace_bin_path);
+        else
+            LOG_INFO(LOG_CAT_MAIN, "[OK] Binary trace written to %s (%u instructions, %llu bytes)\n",
+                   trace_bin_path, cpu->instructions_executed, (unsigned long long)trace_bytes);
+        cpu->tracer = NULL;
+    }
+
+    if(cpu->checkpoint)
+    {
+        uint32_t written = cpu->checkpoint->sequence;
+        if(checkpoint_close(cpu->checkpoint) < 0)
+            LOG_ERROR(LOG_CAT_MAIN, "[ERROR] writing checkpoint file '%s' failed.\n", checkpoint_path);
+        else
+            LOG_INFO(LOG_CAT_MAIN, "[OK] %u checkpoint(s) written to %s\n", written, checkpoint_path);
+        cpu->checkpoint = NULL;
+    }
 
-    if(exec_result < 0)
+    if(status == RVSIM_BREAKPOINT)
+    {
+        LOG_INFO(LOG_CAT_MAIN, "[BREAK] Breakpoint at PC=0x%08X after %u instructions\n",
+                 cpu->pc, cpu->instructions_executed);
+    }
+    else if(status == RVSIM_WATCHPOINT)
     {
-        printf("[FAILED] CPU execution failed!\n");
-        free(enc);
-        memory_free(&m);
+        const MemoryWatchHit *hit = &m->hit;
+        LOG_INFO(LOG_CAT_MAIN, "[WATCH] Write to 0x%08X by PC=0x%08X: 0x%08X -> 0x%08X (%u instructions executed)\n",
+                 hit->addr, cpu->stop_pc, hit->old_value, hit->new_value, cpu->instructions_executed);
+    }
+
+    // ===== STEP 6B: REVERSE EXECUTION =====
+    int reversed = 0;
+    if(step_back || reverse_stop.has_pc || reverse_stop.watch_len)
+    {
+        LOG_INFO(LOG_CAT_MAIN, "\n[STEP 6B] Reverse execution...\n");
+        reversed = 1;
+
+        if(step_back)
+        {
+            uint64_t undone = rvsim_step_back(sim, step_back);
+            LOG_INFO(LOG_CAT_MAIN, "[OK] Stepped back %llu instruction(s) to PC=0x%08X (%u instructions executed)\n",
+                     (unsigned long long)undone, cpu->pc, cpu->instructions_executed);
+        }
+
+        if(reverse_stop.has_pc || reverse_stop.watch_len)
+        {
+            int hit = rvsim_reverse_continue(sim, &reverse_stop);
+            if(hit > 0)
+                LOG_INFO(LOG_CAT_MAIN, "[OK] Reverse-continued to PC=0x%08X (%u instructions executed)\n",
+                         cpu->pc, cpu->instructions_executed);
+            else if(hit == 0)
+                LOG_INFO(LOG_CAT_MAIN, "[INFO] Reached the start of the history at PC=0x%08X (%u instructions executed)\n",
+                         cpu->pc, cpu->instructions_executed);
+            else
+                LOG_ERROR(LOG_CAT_MAIN, "[ERROR] reverse execution failed.\n");
+        }
+    }
+
+    if(status == RVSIM_ERROR && !reversed)
+    {
+        LOG_ERROR(LOG_CAT_MAIN, "[FAILED] CPU execution failed!\n");
+        rvsim_destroy(sim);
         return 1;
     }
 
-    printf("\n[DEBUG] Memory dump (data region) after execution:\n");
-    memory_dump_words(&m, data_offset, 8);
+    LOG_DEBUG(LOG_CAT_MAIN, "\n[DEBUG] Memory dump (data region) after execution:\n");
+    memory_dump_words(m, data_offset, 8);
     // ===== STEP 7: PRINT FINAL STATE =====
-    printf("\n[STEP 7] Final CPU state:\n");
-    printf("-----------------------------------------------------------------\n");
-    cpu_print_state(&cpu);
-    printf("-----------------------------------------------------------------\n");
+    LOG_INFO(LOG_CAT_MAIN, "\n[STEP 7] Final CPU state:\n");
+    LOG_INFO(LOG_CAT_MAIN, "-----------------------------------------------------------------\n");
+    cpu_print_state(cpu);
+    LOG_INFO(LOG_CAT_MAIN, "-----------------------------------------------------------------\n");
+
+    if(cpu->profiler)
+    {
+        profiler_print(cpu->profiler, program);
+        LOG_INFO(LOG_CAT_MAIN, "-----------------------------------------------------------------\n");
+    }
+
+    const CpuStats *stats = rvsim_stats(sim);
+    if(stats)
+    {
+        if(stats_table)
+        {
+            stats_print(stats, cpu);
+            LOG_INFO(LOG_CAT_MAIN, "-----------------------------------------------------------------\n");
+        }
+        if(stats_json_path)
+            write_stats_file(stats_json_path, stats, cpu, stats_write_json);
+        if(stats_csv_path)
+            write_stats_file(stats_csv_path, stats, cpu, stats_write_csv);
+    }
 
     // ===== STEP 8: SUMMARY =====
-    printf("\n[SUMMARY]\n");
-    printf("  Program instructions: %d\n", program.instruction_count);
-    printf("  Instructions executed: %u\n", cpu.instructions_executed);
-    printf("  Final PC: 0x%08X\n", cpu.pc);
-    printf("  CPU halted: %s\n", cpu.halted ? "YES" : "NO");
-    printf("  CPU error: %s\n", cpu.error ? "YES" : "NO");
-    printf("\n");
+    LOG_INFO(LOG_CAT_MAIN, "\n[SUMMARY]\n");
+    LOG_INFO(LOG_CAT_MAIN, "  Program instructions: %d\n", program->instruction_count);
+    LOG_INFO(LOG_CAT_MAIN, "  Instructions executed: %u\n", cpu->instructions_executed);
+    LOG_INFO(LOG_CAT_MAIN, "  Final PC: 0x%08X\n", cpu->pc);
+    LOG_INFO(LOG_CAT_MAIN, "  CPU halted: %s\n", cpu->halted ? "YES" : "NO");
+    LOG_INFO(LOG_CAT_MAIN, "  CPU error: %s\n", cpu->error ? "YES" : "NO");
+    if(rvsim_exited(sim))
+        LOG_INFO(LOG_CAT_MAIN, "  Exit code: %d\n", rvsim_exit_code(sim));
+    LOG_INFO(LOG_CAT_MAIN, "\n");
 
     // ===== CLEANUP =====
-    printf("[CLEANUP] Freeing memory...\n");
-    free(enc);
-    memory_free(&m);
-    printf("[OK] Cleanup complete\n");
-
-    printf("\n=================================================================\n");
-    printf("                    Execution Completed\n");
-    printf("=================================================================\n");
-    return 0;
+    // the guest's exit status becomes the simulator's
+    int exit_code = rvsim_exit_code(sim);
+    LOG_INFO(LOG_CAT_MAIN, "[CLEANUP] Freeing memory...\n");
+    rvsim_destroy(sim);
+    LOG_INFO(LOG_CAT_MAIN, "[OK] Cleanup complete\n");
+
+    LOG_INFO(LOG_CAT_MAIN, "\n=================================================================\n");
+    LOG_INFO(LOG_CAT_MAIN, "                    Execution Completed\n");
+    LOG_INFO(LOG_CAT_MAIN, "=================================================================\n");
+    return exit_code;
 }
@@ -4,6 +4,9 @@
 #include <stdlib.h>
 
 #include "assembler.h"
+#include "encoder.h"
+#include "log.h"
+#include "rvc.h"
 
 static void eliminate_block_comments(char *buffer)
 {
@@ -71,13 +74,14 @@ static void eliminate_whitespaces(char *line)
 static int parse_operands(char *line, char dest_operands[MAX_OPERANDS][MAX_OPERAND_SIZE])
 {
     int count = 0;
-    char *token = strtok(line, ",");
+    char *save = NULL;
+    char *token = strtok_r(line, ",", &save);
     while(token && count < MAX_OPERANDS)
     {
         eliminate_whitespaces(token);
         strncpy(dest_operands[count++], token, MAX_OPERAND_SIZE - 1);
         dest_operands[count - 1][MAX_OPERAND_SIZE - 1] = '\0';
-        token = strtok(NULL, ",");
+        token = strtok_r(NULL, ",", &save);
     }
     return count;
 }
@@ -106,7 +110,7 @@ static void build_symbol_table(AssemblyProgram *program)
         {
             if(program->symbol_count >= MAX_SYMBOLS)
             {
-                printf("[WARN] symbol capacity exceeded\n");
+                LOG_WARN(LOG_CAT_ASM, "[WARN] symbol capacity exceeded\n");
                 break;
             }
             Symbol s = {0};
@@ -117,12 +121,97 @@ static void build_symbol_table(AssemblyProgram *program)
     }
 }
 
+// ================================================================= //
+//                              LAYOUT                               //
+// ================================================================= //
+
+static int is_rvc_mnemonic(const char *opcode)
+{
+    return opcode[0] == 'c' && opcode[1] == '.';
+}
+
+// places the instructions back to back and moves the labels with them
+static void assign_addresses(AssemblyProgram *program)
+{
+    uint32_t addr = 0;
+    for(int i = 0; i < program->instruction_count; ++i)
+    {
+        program->instructions[i].address = addr;
+        addr += program->instructions[i].size;
+    }
+
+    // .data starts on a word boundary; the loader pads the code with a C.NOP
+    program->code_size = (addr + 3) & ~3u;
+    build_symbol_table(program);
+}
+
+// RVC relaxation: every instruction starts out 4 bytes long and a candidate
+// is compressed once its 32-bit encoding has a 16-bit form. Compressing an
+// instruction only shortens the distances between the others, so a branch
+// that fitted keeps fitting and the passes end once one compresses nothing.
+static int layout_program(AssemblyProgram *program)
+{
+    int changed = 0;
+    for(int i = 0; i < program->instruction_count; ++i)
+    {
+        program->instructions[i].size = 4;
+        changed |= program->instructions[i].rvc;
+    }
+    assign_addresses(program);
+
+    while(changed)
+    {
+        changed = 0;
+        for(int i = 0; i < program->instruction_count; ++i)
+        {
+            Instruction *instr = &program->instructions[i];
+            if(!instr->rvc || instr->size == 2)
+                continue;
+
+            uint32_t word = encode_instruction_traced(program, instr, 0);
+            if(word != 0 && rvc_compress(word) != 0)
+            {
+                instr->size = 2;
+                changed = 1;
+            }
+        }
+
+        if(changed)
+            assign_addresses(program);
+    }
+
+    for(int i = 0; i < program->instruction_count; ++i)
+    {
+        Instruction *instr = &program->instructions[i];
+        if(is_rvc_mnemonic(instr->opcode) && instr->size != 2)
+        {
+            LOG_ERROR(LOG_CAT_ASM, "[ERROR] '%s' (line %d): operands have no 16-bit encoding\n",
+                      instr->opcode, instr->line_number);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int compress_program(AssemblyProgram *program)
+{
+    for(int i = 0; i < program->instruction_count; ++i)
+    {
+        program->instructions[i].rvc = 1;
+    }
+    return layout_program(program);
+}
+
+// ================================================================= //
+//                              PARSING                              //
+// ================================================================= //
+
 int read_asm_file(char *filename, AssemblyProgram *program)
 {
     FILE *f = NULL;
     if((f = fopen(filename, "r")) == NULL)
     {
-        printf("[ERROR] opening assembly test file.\n");
+        LOG_ERROR(LOG_CAT_ASM, "[ERROR] opening assembly test file.\n");
         return -1;
     }
 
@@ -133,7 +222,7 @@ int read_asm_file(char *filename, AssemblyProgram *program)
     char *buffer = (char *)malloc(fileSize + 1);
     if(!buffer)
     {
-        printf("[ERROR] memory allocation failed for file buffer.\n");
+        LOG_ERROR(LOG_CAT_ASM, "[ERROR] memory allocation failed for file buffer.\n");
         fclose(f);
         return -1;
     }
@@ -143,7 +232,7 @@ int read_asm_file(char *filename, AssemblyProgram *program)
 
     if(fclose(f) != 0)
     {
-        printf("[ERROR] closing assembly test file.\n");
+        LOG_ERROR(LOG_CAT_ASM, "[ERROR] closing assembly test file.\n");
         return -1;
     }
 
@@ -161,6 +250,7 @@ int read_asm_file(char *filename, AssemblyProgram *program)
 
     int in_data = 0;
     int in_text = 0;
+    int option_rvc = 0;
 
     while(line_ptr && *line_ptr != '\0')
     {
@@ -198,6 +288,12 @@ int read_asm_file(char *filename, AssemblyProgram *program)
             line_ptr = newline ? newline + 1 : NULL;
             continue;
         }
+        else if(strcmp(line, ".option rvc") == 0 || strcmp(line, ".option norvc") == 0)
+        {
+            option_rvc = (strcmp(line, ".option rvc") == 0);
+            line_ptr = newline ? newline + 1 : NULL;
+            continue;
+        }
 
         // optional/alternative: if we don't have .data + .text sections, treat everything as instructions
         if(!in_data && !in_text) 
@@ -225,7 +321,8 @@ int read_asm_file(char *filename, AssemblyProgram *program)
                 data_ptr += 5;
                 eliminate_whitespaces(data_ptr);
 
-                char *token = strtok(data_ptr, ",");
+                char *save = NULL;
+                char *token = strtok_r(data_ptr, ",", &save);
                 int first = 1;
                 while(token)
                 {
@@ -239,7 +336,7 @@ int read_asm_file(char *filename, AssemblyProgram *program)
                         first = 0;
                     }
                     program->data[program->data_count++] = entry;
-                    token = strtok(NULL, ",");
+                    token = strtok_r(NULL, ",", &save);
                 }
             }
 
@@ -286,7 +383,8 @@ int read_asm_file(char *filename, AssemblyProgram *program)
             }
 
             // step 3.2: [opcode]
-            char *token = strtok(line, " \t");
+            char *save = NULL;
+            char *token = strtok_r(line, " \t", &save);
             if(!token)
             {
                 line_ptr = newline ? newline + 1 : NULL;
@@ -296,9 +394,10 @@ int read_asm_file(char *filename, AssemblyProgram *program)
             strncpy(instr.opcode, token, MAX_OPCODE_SIZE - 1);
             for(int i = 0; instr.opcode[i]; i++)
                 instr.opcode[i] = tolower(instr.opcode[i]);
+            instr.rvc = option_rvc || is_rvc_mnemonic(instr.opcode);
 
             // step 3.3: [... [operands]]
-            char *rest = strtok(NULL, "");
+            char *rest = strtok_r(NULL, "", &save);
             if(rest)
             {
                 eliminate_whitespaces(rest);
@@ -314,14 +413,8 @@ int read_asm_file(char *filename, AssemblyProgram *program)
         line_ptr = newline ? newline + 1 : NULL;
     }
 
-    for(int i = 0; i < program->instruction_count; ++i)
-    {
-        program->instructions[i].address = (uint32_t)(i * 4);
-    }
-    build_symbol_table(program);
-
     free(buffer);
-    return 0;
+    return layout_program(program);
 }
 
 void print_program(AssemblyProgram *program)
@@ -329,22 +422,22 @@ void print_program(AssemblyProgram *program)
     for(int i = 0; i < program->instruction_count; i++)
     {
         Instruction *current = &program->instructions[i];
-        printf("[%02d] ", i);
+        LOG_INFO(LOG_CAT_ASM, "[%02d] ", i);
         if(strlen(current->label))
-            printf("%s : ", current->label);
-        printf("%s ", current->opcode);
+            LOG_INFO(LOG_CAT_ASM, "%s : ", current->label);
+        LOG_INFO(LOG_CAT_ASM, "%s ", current->opcode);
         for(int i = 0; i < current->operand_count; i++)
         {
-            printf("%s", current->operands[i]);
+            LOG_INFO(LOG_CAT_ASM, "%s", current->operands[i]);
             if(i != current->operand_count - 1)
-                printf(", ");
+                LOG_INFO(LOG_CAT_ASM, ", ");
         }
-        printf("\n");
+        LOG_INFO(LOG_CAT_ASM, "\n");
     }
 
     for(int i = 0; i < program->data_count; i++)
     {
         DataEntry *d = &program->data[i];
-        printf("DATA[%02d] %s = %d @ address %d\n", i, d->label, d->value, d->address);
+        LOG_INFO(LOG_CAT_ASM, "DATA[%02d] %s = %d @ address %d\n", i, d->label, d->value, d->address);
     }
 }
\ No newline at end of file
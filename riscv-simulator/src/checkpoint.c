@@ -0,0 +1,392 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+#include "log.h"
+#include "memory.h"
+
+#define CHECKPOINT_RECORD_WORDS (9 + REG_NUMBER)   // header words before the vector registers
+#define CHECKPOINT_RECORD_HEADER (CHECKPOINT_RECORD_WORDS * 4)
+#define CHECKPOINT_PAGE_ENTRY (4 + MEMORY_PAGE_SIZE)    // index + data, a short last page is zero padded
+
+static void checkpoint_put_le32(uint8_t *p, uint32_t v)
+{
+    for(int i = 0; i < 4; ++i)
+    {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static uint32_t checkpoint_get_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// FNV-1a over the code region, so a checkpoint is only resumed with the
+// program it was taken from
+static uint32_t checkpoint_code_hash(const CPU *cpu)
+{
+    uint32_t hash = 2166136261u;
+    size_t len = (size_t)cpu->program->code_size;
+    if(len > cpu->memory->size)
+        len = cpu->memory->size;
+
+    for(size_t i = 0; i < len; ++i)
+    {
+        hash ^= cpu->memory->data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static size_t checkpoint_page_bytes(const Memory *m, uint32_t page)
+{
+    size_t offset = (size_t)page << MEMORY_PAGE_SHIFT;
+    size_t len = m->size - offset;
+    return (len > MEMORY_PAGE_SIZE) ? MEMORY_PAGE_SIZE : len;
+}
+
+// bytes of the vector registers in every record
+static size_t checkpoint_vector_bytes(uint32_t vlen)
+{
+    return (size_t)CPU_VREGS * vlen / 8;
+}
+
+static size_t checkpoint_image_size(size_t memory_size)
+{
+    return (memory_size + CHECKPOINT_HEADER_SIZE - 1) / CHECKPOINT_HEADER_SIZE * CHECKPOINT_HEADER_SIZE;
+}
+
+// ================================================================= //
+//                              WRITER                               //
+// ================================================================= //
+
+static void checkpoint_emit(CheckpointWriter *w, const void *data, size_t len)
+{
+    if(!w->failed && fwrite(data, 1, len, w->file) != len)
+        w->failed = 1;
+    w->bytes += len;
+}
+
+static void checkpoint_emit_record(CheckpointWriter *w, CPU *cpu, int all_pages)
+{
+    Memory *m = cpu->memory;
+    size_t page_count = all_pages ? memory_page_count(m) : m->dirty_count;
+
+    uint8_t header[CHECKPOINT_RECORD_HEADER];
+    checkpoint_put_le32(header + 0, CHECKPOINT_RECORD_MAGIC);
+    checkpoint_put_le32(header + 4, w->sequence);
+    checkpoint_put_le32(header + 8, cpu->pc);
+    checkpoint_put_le32(header + 12, cpu->instructions_executed);
+    checkpoint_put_le32(header + 16, (uint32_t)cpu->halted);
+    checkpoint_put_le32(header + 20, (uint32_t)cpu->error);
+    for(int r = 0; r < REG_NUMBER; ++r)
+    {
+        checkpoint_put_le32(header + 24 + r * 4, (uint32_t)cpu->regs[r]);
+    }
+    checkpoint_put_le32(header + 24 + REG_NUMBER * 4, cpu->vector.vl);
+    checkpoint_put_le32(header + 28 + REG_NUMBER * 4, cpu->vector.vtype);
+    checkpoint_put_le32(header + 32 + REG_NUMBER * 4, (uint32_t)page_count);
+    checkpoint_emit(w, header, sizeof(header));
+
+    uint8_t vreg[CPU_VLEN_MAX / 8];
+    size_t vwords = checkpoint_vector_bytes(cpu->vector.vlen) / 4;
+    for(size_t i = 0; i < vwords; i += sizeof(vreg) / 4)
+    {
+        size_t n = (vwords - i < sizeof(vreg) / 4) ? vwords - i : sizeof(vreg) / 4;
+        for(size_t j = 0; j < n; ++j)
+        {
+            checkpoint_put_le32(vreg + j * 4, cpu->vector.regs[i + j]);
+        }
+        checkpoint_emit(w, vreg, n * 4);
+    }
+
+    for(size_t i = 0; i < page_count; ++i)
+    {
+        uint32_t page = all_pages ? (uint32_t)i : m->dirty_pages[i];
+        uint8_t entry[CHECKPOINT_PAGE_ENTRY] = {0};
+        checkpoint_put_le32(entry, page);
+        memcpy(entry + 4, m->data + ((size_t)page << MEMORY_PAGE_SHIFT), checkpoint_page_bytes(m, page));
+        checkpoint_emit(w, entry, sizeof(entry));
+    }
+
+    if(!w->failed && fflush(w->file) != 0)
+        w->failed = 1;
+
+    memory_clear_dirty(m);
+    m->dirty_owner = w;
+    w->sequence++;
+    w->next_at = cpu->instructions_executed + w->every;
+}
+
+CheckpointWriter *checkpoint_open(const char *path, CPU *cpu, uint32_t every)
+{
+    if(!cpu || !cpu->memory || !cpu->program || every == 0)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] checkpoint_open: invalid argument\n");
+        return NULL;
+    }
+
+    Memory *m = cpu->memory;
+    if(memory_track_dirty(m) < 0)
+        return NULL;
+
+    CheckpointWriter *w = (CheckpointWriter *)calloc(1, sizeof(CheckpointWriter));
+    if(!w)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] checkpoint_open: allocation failed\n");
+        return NULL;
+    }
+
+    w->file = fopen(path, "wb");
+    if(!w->file)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] checkpoint_open: cannot open '%s'\n", path);
+        free(w);
+        return NULL;
+    }
+    w->every = every;
+
+    uint8_t header[CHECKPOINT_HEADER_SIZE] = {0};
+    memcpy(header, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_SIZE);
+    checkpoint_put_le32(header + 8, CHECKPOINT_VERSION);
+    checkpoint_put_le32(header + 12, MEMORY_PAGE_SIZE);
+    checkpoint_put_le32(header + 16, (uint32_t)m->size);
+    checkpoint_put_le32(header + 20, (uint32_t)cpu->program->instruction_count);
+    checkpoint_put_le32(header + 24, checkpoint_code_hash(cpu));
+    checkpoint_put_le32(header + 28, cpu->vector.vlen);
+    checkpoint_emit(w, header, sizeof(header));
+
+    checkpoint_emit(w, m->data, m->size);
+    static const uint8_t zeros[CHECKPOINT_HEADER_SIZE] = {0};
+    checkpoint_emit(w, zeros, checkpoint_image_size(m->size) - m->size);
+
+    // record 0 is the image itself
+    memory_clear_dirty(m);
+    m->dirty_owner = w;
+    checkpoint_emit_record(w, cpu, 0);
+
+    if(w->failed)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] checkpoint_open: writing '%s' failed\n", path);
+        fclose(w->file);
+        free(w);
+        return NULL;
+    }
+    return w;
+}
+
+int checkpoint_write(CheckpointWriter *w, CPU *cpu)
+{
+    // someone else (a snapshot) reset the dirty set: store every page
+    int all_pages = (cpu->memory->dirty_owner != w);
+    checkpoint_emit_record(w, cpu, all_pages);
+    return w->failed ? -1 : 0;
+}
+
+int checkpoint_close(CheckpointWriter *w)
+{
+    if(!w)
+        return 0;
+
+    int failed = w->failed;
+    if(fclose(w->file) != 0)
+        failed = 1;
+    free(w);
+    return failed ? -1 : 0;
+}
+
+// ================================================================= //
+//                              RESTORE                              //
+// ================================================================= //
+
+typedef struct
+{
+    uint32_t pc;
+    uint32_t instructions_executed;
+    uint32_t halted;
+    uint32_t error;
+    int32_t regs[REG_NUMBER];
+    uint32_t vl;
+    uint32_t vtype;
+    uint32_t page_count;
+} CheckpointRecord;
+
+static int checkpoint_read_record(int fd, uint64_t offset, uint32_t sequence, CheckpointRecord *rec)
+{
+    uint8_t header[CHECKPOINT_RECORD_HEADER];
+    if(pread(fd, header, sizeof(header), (off_t)offset) != (ssize_t)sizeof(header))
+        return -1;
+    if(checkpoint_get_le32(header) != CHECKPOINT_RECORD_MAGIC || checkpoint_get_le32(header + 4) != sequence)
+        return -1;
+
+    rec->pc = checkpoint_get_le32(header + 8);
+    rec->instructions_executed = checkpoint_get_le32(header + 12);
+    rec->halted = checkpoint_get_le32(header + 16);
+    rec->error = checkpoint_get_le32(header + 20);
+    for(int r = 0; r < REG_NUMBER; ++r)
+    {
+        rec->regs[r] = (int32_t)checkpoint_get_le32(header + 24 + r * 4);
+    }
+    rec->vl = checkpoint_get_le32(header + 24 + REG_NUMBER * 4);
+    rec->vtype = checkpoint_get_le32(header + 28 + REG_NUMBER * 4);
+    rec->page_count = checkpoint_get_le32(header + 32 + REG_NUMBER * 4);
+    return 0;
+}
+
+static uint64_t checkpoint_record_size(const CheckpointRecord *rec, uint32_t vlen)
+{
+    return CHECKPOINT_RECORD_HEADER + checkpoint_vector_bytes(vlen) +
+           (uint64_t)rec->page_count * CHECKPOINT_PAGE_ENTRY;
+}
+
+static int checkpoint_read_vector(int fd, uint64_t offset, const CheckpointRecord *rec, CPU *cpu)
+{
+    uint8_t vreg[CPU_VLEN_MAX / 8];
+    size_t vwords = checkpoint_vector_bytes(cpu->vector.vlen) / 4;
+    offset += CHECKPOINT_RECORD_HEADER;
+    for(size_t i = 0; i < vwords; i += sizeof(vreg) / 4)
+    {
+        size_t n = (vwords - i < sizeof(vreg) / 4) ? vwords - i : sizeof(vreg) / 4;
+        if(pread(fd, vreg, n * 4, (off_t)offset) != (ssize_t)(n * 4))
+            return -1;
+        for(size_t j = 0; j < n; ++j)
+        {
+            cpu->vector.regs[i + j] = checkpoint_get_le32(vreg + j * 4);
+        }
+        offset += n * 4;
+    }
+    cpu->vector.vl = rec->vl;
+    cpu->vector.vtype = rec->vtype;
+    return 0;
+}
+
+static int checkpoint_apply_pages(int fd, uint64_t offset, uint32_t vlen, const CheckpointRecord *rec, Memory *m)
+{
+    uint8_t entry[CHECKPOINT_PAGE_ENTRY];
+    offset += CHECKPOINT_RECORD_HEADER + checkpoint_vector_bytes(vlen);
+    for(uint32_t i = 0; i < rec->page_count; ++i)
+    {
+        if(pread(fd, entry, sizeof(entry), (off_t)offset) != (ssize_t)sizeof(entry))
+            return -1;
+
+        uint32_t page = checkpoint_get_le32(entry);
+        if(page >= memory_page_count(m))
+            return -1;
+
+        // writing to the mapping copies only the host pages touched
+        memcpy(m->data + ((size_t)page << MEMORY_PAGE_SHIFT), entry + 4, checkpoint_page_bytes(m, page));
+        offset += CHECKPOINT_PAGE_ENTRY;
+    }
+    return 0;
+}
+
+int checkpoint_restore(const char *path, int index, CPU *cpu)
+{
+    if(!cpu || !cpu->memory || !cpu->program)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] checkpoint_restore: invalid argument\n");
+        return -1;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] checkpoint_restore: cannot open '%s'\n", path);
+        return -1;
+    }
+
+    uint8_t header[32];
+    off_t file_end = lseek(fd, 0, SEEK_END);
+    if(pread(fd, header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+       memcmp(header, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_SIZE) != 0)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] checkpoint_restore: '%s' is not a checkpoint file\n", path);
+        close(fd);
+        return -1;
+    }
+
+    uint32_t version = checkpoint_get_le32(header + 8);
+    uint32_t page_size = checkpoint_get_le32(header + 12);
+    size_t memory_size = checkpoint_get_le32(header + 16);
+    uint32_t instruction_count = checkpoint_get_le32(header + 20);
+    uint32_t code_hash = checkpoint_get_le32(header + 24);
+    uint32_t vlen = checkpoint_get_le32(header + 28);
+    if(version != CHECKPOINT_VERSION || page_size != MEMORY_PAGE_SIZE)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] checkpoint_restore: unsupported checkpoint version %u (page size %u)\n",
+                  version, page_size);
+        close(fd);
+        return -1;
+    }
+    if(instruction_count != (uint32_t)cpu->program->instruction_count || code_hash != checkpoint_code_hash(cpu))
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] checkpoint_restore: '%s' was taken from a different program\n", path);
+        close(fd);
+        return -1;
+    }
+
+    // the vector registers are restored at the VLEN they were saved with
+    if(vlen != cpu->vector.vlen && cpu_set_vlen(cpu, vlen) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    // count the complete records up to the requested one
+    uint64_t records = CHECKPOINT_HEADER_SIZE + checkpoint_image_size(memory_size);
+    uint64_t offset = records;
+    uint32_t count = 0;
+    CheckpointRecord rec;
+    while(index < 0 || count <= (uint32_t)index)
+    {
+        if(checkpoint_read_record(fd, offset, count, &rec) < 0 ||
+           offset + checkpoint_record_size(&rec, vlen) > (uint64_t)file_end)
+            break;
+        offset += checkpoint_record_size(&rec, vlen);
+        count++;
+    }
+
+    if(count == 0 || (index >= 0 && count <= (uint32_t)index))
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] checkpoint_restore: '%s' has no checkpoint %d (%u found)\n",
+                  path, index, count);
+        close(fd);
+        return -1;
+    }
+
+    // map the image, then apply the pages of records 0..target on top
+    Memory *m = cpu->memory;
+    if(memory_map_file(m, fd, CHECKPOINT_HEADER_SIZE, memory_size) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    uint32_t target = count - 1;
+    offset = records;
+    for(uint32_t seq = 0; seq <= target; ++seq)
+    {
+        if(checkpoint_read_record(fd, offset, seq, &rec) < 0 ||
+           checkpoint_apply_pages(fd, offset, vlen, &rec, m) < 0 ||
+           (seq == target && checkpoint_read_vector(fd, offset, &rec, cpu) < 0))
+        {
+            LOG_ERROR(LOG_CAT_CPU, "[ERROR] checkpoint_restore: reading checkpoint %u failed\n", seq);
+            close(fd);
+            return -1;
+        }
+        offset += checkpoint_record_size(&rec, vlen);
+    }
+    close(fd);
+
+    memcpy(cpu->regs, rec.regs, sizeof(cpu->regs));
+    cpu->regs[0] = 0;
+    cpu->pc = rec.pc;
+    cpu->instructions_executed = rec.instructions_executed;
+    cpu->halted = (int)rec.halted;
+    cpu->error = (int)rec.error;
+    return (int)target;
+}
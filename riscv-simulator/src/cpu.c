@@ -1,8 +1,24 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "cpu.h"
 #include "instruction.h"
+#include "log.h"
 #include "alu.h"
+#include "checkpoint.h"
+#include "csr.h"
+#include "loop_trace.h"
+#include "rvc.h"
+#include "rvv.h"
+#include "stats.h"
+#include "syscall.h"
+#include "trace.h"
+#include "undo.h"
+
+// per-instruction diagnostics ([STEP], [DECODE], [EXEC], ...) are only
+// printed when tracing is on; errors are always reported
+#define CPU_TRACE(cpu, ...) do { if((cpu)->trace) LOG_TRACE(LOG_CAT_CPU, __VA_ARGS__); } while(0)
 
 // ================================================================= //
 //                              INIT                                 //
@@ -10,27 +26,64 @@
 
 void cpu_init(CPU *cpu)
 {
+    cpu->regs[0] = 0;
     for(int i = 1; i < REG_NUMBER; i++)
     {
         cpu_set_reg(cpu, i, 0);
     }
     cpu->pc = 0;
+    cpu->ilen = 4;
 
     cpu->memory = NULL;
     cpu->program = NULL;
+    cpu->profiler = NULL;
+    cpu->stats = NULL;
+    cpu->tracer = NULL;
+    cpu->checkpoint = NULL;
+    cpu->undo = NULL;
+    cpu->syscalls = NULL;
+    cpu->breakpoints = NULL;
+    cpu->breakpoint_slots = 0;
+    cpu->stop_reason = CPU_STOP_NONE;
+    cpu->stop_pc = 0;
+    cpu->loop_trace = NULL;
     
+    cpu->hart_id = 0;
+    cpu->reserved = 0;
+    cpu->reservation_addr = 0;
+    cpu->reservation_value = 0;
     cpu->instructions_executed = 0;
+    cpu->max_instructions = CPU_DEFAULT_MAX_INSTRUCTIONS;
     cpu->halted = 0;
     cpu->error = 0;
+    cpu->trace = 1;
 
+    memset(cpu->rvc_cache, 0, sizeof(cpu->rvc_cache));
+    cpu_set_vlen(cpu, CPU_VLEN_DEFAULT);
     cpu_init_default_register_roles(cpu);
 }
 
+int cpu_set_vlen(CPU *cpu, uint32_t bits)
+{
+    if(bits < 32 || bits > CPU_VLEN_MAX || (bits & (bits - 1)) != 0)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_set_vlen: VLEN %u is not a power of two from 32 to %u\n",
+                  bits, CPU_VLEN_MAX);
+        return -1;
+    }
+
+    cpu->vector.vlen = bits;
+    cpu->vector.vl = 0;
+    cpu->vector.vtype = CPU_VTYPE_VILL;
+    memset(cpu->vector.regs, 0, (size_t)CPU_VREGS * bits / 8);
+    return 0;
+}
+
 void cpu_init_with_program(CPU *cpu, Memory *memory, AssemblyProgram *program)
 {
     if(!cpu || !memory || !program)
     {
-        printf("[ERROR] null argument for cpu, memory or program.\n");
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] null argument for cpu, memory or program.\n");
         return;
     }
 
@@ -83,7 +136,7 @@ void cpu_set_reg(CPU *cpu, int index, int32_t value)
 {
     if(index == 0)
     {
-        printf("[ERROR] tried modifying zero register.\n");
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] tried modifying zero register.\n");
         return; 
     }
 
@@ -94,13 +147,13 @@ int32_t cpu_get_reg(CPU *cpu, int index)
 {
     if(!cpu)
     {
-        printf("[ERROR] cpu is null, cannot get any register value.\n");
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu is null, cannot get any register value.\n");
         return 0;
     }
 
     if(index < 0 || index >= REG_NUMBER)
     {
-        printf("[ERROR] invalid register index.\n");
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] invalid register index.\n");
         return 0;
     }
 
@@ -133,20 +186,20 @@ void cpu_print_registers(CPU *cpu)
 {
     if(!cpu)
     {
-        printf("[ERROR] cpu_print_registers: CPU is NULL\n");
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_print_registers: CPU is NULL\n");
         return;
     }
 
-    printf("=== REGISTERS ===\n");
-    printf("PC: 0x%08X\n", cpu->pc);
+    LOG_INFO(LOG_CAT_CPU, "=== REGISTERS ===\n");
+    LOG_INFO(LOG_CAT_CPU, "PC: 0x%08X\n", cpu->pc);
     for(int i = 0; i < REG_NUMBER; i++)
     {
-        printf("x%02d: 0x%08X (%11d)", i, cpu->regs[i], cpu->regs[i]);
+        LOG_INFO(LOG_CAT_CPU, "x%02d: 0x%08X (%11d)", i, cpu->regs[i], cpu->regs[i]);
 
         if((i + 1) % 2 == 0)
-            printf("\n");
+            LOG_INFO(LOG_CAT_CPU, "\n");
         else
-            printf(" | ");
+            LOG_INFO(LOG_CAT_CPU, " | ");
     }
 }
 
@@ -154,35 +207,58 @@ void cpu_print_state(CPU *cpu)
 {
     if(!cpu)
     {
-        printf("[ERROR] cpu_print_state: CPU is NULL\n");
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_print_state: CPU is NULL\n");
         return;
     }
 
-    printf("\n=== CPU STATE ===\n");
-    printf("PC: 0x%08X\n", cpu->pc);
-    printf("Instructions executed: %u\n", cpu->instructions_executed);
-    printf("Halted: %s\n", cpu->halted ? "YES" : "NO");
-    printf("Error: %s\n", cpu->error ? "YES" : "NO");
-    printf("\n");
+    LOG_INFO(LOG_CAT_CPU, "\n=== CPU STATE ===\n");
+    LOG_INFO(LOG_CAT_CPU, "PC: 0x%08X\n", cpu->pc);
+    LOG_INFO(LOG_CAT_CPU, "Instructions executed: %u\n", cpu->instructions_executed);
+    LOG_INFO(LOG_CAT_CPU, "Halted: %s\n", cpu->halted ? "YES" : "NO");
+    LOG_INFO(LOG_CAT_CPU, "Error: %s\n", cpu->error ? "YES" : "NO");
+    LOG_INFO(LOG_CAT_CPU, "\n");
 
     cpu_print_registers(cpu);
-    printf("\n");
+    LOG_INFO(LOG_CAT_CPU, "\n");
 }
 
 // ================================================================= //
 //                              FETCH                                //
 // ================================================================= //
 
+// the expansion of a compressed instruction depends only on its 16 bits, so
+// a slot is reused whenever the halfword at its PC still matches; code
+// written at run time needs no invalidation. Out of line, so the 32-bit
+// path of cpu_fetch() keeps the register use of a plain load.
+__attribute__((noinline))
+static EncodedInstruction cpu_fetch_compressed(CPU *cpu, uint16_t raw)
+{
+    EncodedInstruction enc;
+    CpuRvcEntry *e = &cpu->rvc_cache[(cpu->pc >> 1) & (CPU_RVC_CACHE - 1)];
+    if(e->raw != raw)
+    {
+        e->word = rvc_expand(raw);
+        e->raw = raw;
+    }
+    cpu->ilen = 2;
+    enc.value = e->word;
+    return enc;
+}
+
 EncodedInstruction cpu_fetch(CPU *cpu)
 {
     EncodedInstruction enc = {0};
     if(!cpu || !cpu->memory)
     {
-        printf("[ERROR] cpu or cpu memory is null.\n");
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu or cpu memory is null.\n");
         return enc;
     }
 
     enc.value = memory_read32(cpu->memory, cpu->pc);
+    if(rvc_is_compressed(enc.value))
+        return cpu_fetch_compressed(cpu, (uint16_t)enc.value);
+
+    cpu->ilen = 4;
     return enc;
 }
 
@@ -194,7 +270,7 @@ static int cpu_decode_rtype(CPU *cpu, EncodedInstruction enc)
 {
     if(!cpu)
     {
-        printf("[ERROR] cpu_decode_rtype: CPU is NULL\n");
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_decode_rtype: CPU is NULL\n");
         return -1;
     }
 
@@ -204,7 +280,7 @@ static int cpu_decode_rtype(CPU *cpu, EncodedInstruction enc)
     uint8_t funct3 = rtype_get_funct3(enc.value);
     uint8_t rd = rtype_get_rd(enc.value);
 
-    printf("[DECODE] R-Type: funct7=0x%02X, rs2=%d, rs1=%d, funct3=0x%X, rd=%d\n",
+    CPU_TRACE(cpu, "[DECODE] R-Type: funct7=0x%02X, rs2=%d, rs1=%d, funct3=0x%X, rd=%d\n",
            funct7, rs2, rs1, funct3, rd);
 
     return 0;
@@ -214,7 +290,7 @@ static int cpu_decode_itype(CPU *cpu, EncodedInstruction enc)
 {
     if(!cpu)
     {
-        printf("[ERROR] cpu_decode_itype: CPU is NULL\n");
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_decode_itype: CPU is NULL\n");
         return -1;
     }
 
@@ -223,7 +299,7 @@ static int cpu_decode_itype(CPU *cpu, EncodedInstruction enc)
     uint8_t rd = itype_get_rd(enc.value);
     int32_t imm = itype_get_immediate(enc.value);
 
-    printf("[DECODE] I-Type: funct3=0x%X, rs1=%d, rd=%d, imm=%d\n",
+    CPU_TRACE(cpu, "[DECODE] I-Type: funct3=0x%X, rs1=%d, rd=%d, imm=%d\n",
            funct3, rs1, rd, imm);
 
     return 0;
@@ -233,11 +309,11 @@ static int cpu_decode_stype(CPU *cpu, EncodedInstruction enc)
 {
     if(!cpu)
     {
-        printf("[ERROR] cpu_decode_stype: CPU is NULL\n");
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_decode_stype: CPU is NULL\n");
         return -1;
     }
 
-    printf("[DECODE] S-Type (placeholder)\n");
+    CPU_TRACE(cpu, "[DECODE] S-Type (placeholder)\n");
 
     return 0;
 }
@@ -246,7 +322,7 @@ static int cpu_decode_utype(CPU *cpu, EncodedInstruction enc)
 {
     if(!cpu)
     {
-        printf("[ERROR] cpu_decode_utype: CPU is NULL\n");
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_decode_utype: CPU is NULL\n");
         return -1;
     }
 
@@ -255,7 +331,7 @@ static int cpu_decode_utype(CPU *cpu, EncodedInstruction enc)
     uint8_t opcode = utype_get_opcode(enc.value);
     const char *name = (opcode == 0x37) ? "LUI" : ((opcode == 0x17) ? "AUIPC" : "U-TYPE");
 
-    printf("[DECODE] %s: rd=%d, imm20=0x%05X\n", name, rd, imm20);
+    CPU_TRACE(cpu, "[DECODE] %s: rd=%d, imm20=0x%05X\n", name, rd, imm20);
     return 0;
 }
 
@@ -265,7 +341,7 @@ static int cpu_decode_btype(CPU *cpu, EncodedInstruction enc)
     uint32_t rs1 = btype_get_rs1(enc.value);
     uint32_t rs2 = btype_get_rs2(enc.value);
     int32_t imm = btype_get_imm(enc.value);
-    printf("[DECODE] B-Type: funct3=0x%X, rs1=%u, rs2=%u, imm=%d\n",
+    CPU_TRACE(cpu, "[DECODE] B-Type: funct3=0x%X, rs1=%u, rs2=%u, imm=%d\n",
            funct3, rs1, rs2, imm);
     return 0;
 }
@@ -274,14 +350,34 @@ static int cpu_decode_jtype(CPU *cpu, EncodedInstruction enc)
 {
     if(!cpu)
     {
-        printf("[ERROR] cpu_decode_jtype: CPU is NULL\n");
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_decode_jtype: CPU is NULL\n");
         return -1;
     }
 
     uint8_t rd = rtype_get_rd(enc.value);
     int32_t imm = jtype_get_immediate(enc.value);
 
-    printf("[DECODE] J-Type: rd=%u, imm=%d\n", rd, imm);
+    CPU_TRACE(cpu, "[DECODE] J-Type: rd=%u, imm=%d\n", rd, imm);
+    return 0;
+}
+
+static int cpu_decode_vtype(CPU *cpu, EncodedInstruction enc)
+{
+    if(!cpu)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_decode_vtype: CPU is NULL\n");
+        return -1;
+    }
+
+    uint8_t funct6 = vtype_get_funct6(enc.value);
+    uint8_t vm = vtype_get_vm(enc.value);
+    uint8_t vs2 = rtype_get_rs2(enc.value);
+    uint8_t rs1 = rtype_get_rs1(enc.value);
+    uint8_t funct3 = rtype_get_funct3(enc.value);
+    uint8_t vd = rtype_get_rd(enc.value);
+
+    CPU_TRACE(cpu, "[DECODE] V-Type: funct6=0x%02X, vm=%d, vs2=%d, rs1=%d, funct3=0x%X, vd=%d\n",
+           funct6, vm, vs2, rs1, funct3, vd);
     return 0;
 }
 
@@ -289,15 +385,16 @@ int cpu_decode(CPU *cpu, EncodedInstruction enc)
 {
     if(!cpu)
     {
-        printf("[ERROR] cpu is null.\n");
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu is null.\n");
         return -1;
     }
 
     uint8_t opcode = enc.value & 0x7F;
-    printf("[DECODE DISPATCH] Opcode=0x%02X\n", opcode);
+    CPU_TRACE(cpu, "[DECODE DISPATCH] Opcode=0x%02X\n", opcode);
     switch(opcode)
     {
         case 0x33:
+        case 0x2F:
             return cpu_decode_rtype(cpu, enc);
 
         case 0x03:
@@ -318,9 +415,17 @@ int cpu_decode(CPU *cpu, EncodedInstruction enc)
         case 0x6F:
             return cpu_decode_jtype(cpu, enc);
 
+        case 0x73:
+            return cpu_decode_itype(cpu, enc);
+
+        case 0x07:
+        case 0x27:
+        case 0x57:
+            return cpu_decode_vtype(cpu, enc);
+
         default:
             {
-                printf("[ERROR] cpu_decode: unknown opcode 0x%02X at PC 0x%08X\n",
+                LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_decode: unknown opcode 0x%02X at PC 0x%08X\n",
                    opcode, cpu->pc);
                 cpu->error = 1;
                 return -1;
@@ -332,11 +437,34 @@ int cpu_decode(CPU *cpu, EncodedInstruction enc)
 //                              EXECUTE                              //
 // ================================================================= //
 
+static inline int32_t cpu_read_operand(CPU *cpu, int index)
+{
+    if(cpu->stats && index >= 0 && index < REG_NUMBER)
+        cpu->stats->reg_reads[index]++;
+
+    return cpu_get_reg(cpu, index);
+}
+
+static inline void cpu_stats_retire(CPU *cpu, StatOp op, StatFormat fmt)
+{
+    if(cpu->stats)
+    {
+        cpu->stats->op_count[op]++;
+        cpu->stats->format_count[fmt]++;
+    }
+}
+
+// Zbb ALU ops and their stats ops are declared in the same order
+static inline StatOp cpu_zbb_stat_op(ALUOp op)
+{
+    return (StatOp)(STAT_OP_ANDN + (op - ALU_ANDN));
+}
+
 static int cpu_execute_rtype(CPU *cpu, EncodedInstruction enc)
 {
     if(!cpu)
     {
-        printf("[ERROR] cpu_execute_rtype: CPU is null.\n");
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_execute_rtype: CPU is null.\n");
         return -1;
     }
 
@@ -346,32 +474,42 @@ static int cpu_execute_rtype(CPU *cpu, EncodedInstruction enc)
     uint8_t funct3 = rtype_get_funct3(enc.value);
     uint8_t rd = rtype_get_rd(enc.value);
 
-    int32_t val_rs1 = cpu_get_reg(cpu, rs1);
-    int32_t val_rs2 = cpu_get_reg(cpu, rs2);
+    int32_t val_rs1 = cpu_read_operand(cpu, rs1);
+    int32_t val_rs2 = cpu_read_operand(cpu, rs2);
 
     ALUOp operation = ALU_UNKNOWN;
+    StatOp stat_op = STAT_OP_ADD;
     const char *op_name = "UNKNOWN";
 
-    if(funct3 == 0x00)
+    if(funct7 == 0x01)
+    {
+        // RV32M, the ALU and stats ops follow funct3 order
+        operation = ALU_MULDIV_OP(funct3);
+        op_name = alu_op_name(operation);
+        stat_op = (StatOp)(STAT_OP_MUL + funct3);
+    }
+    else if((operation = alu_zbb_op(funct7, funct3, rs2)) != ALU_UNKNOWN)
+    {
+        op_name = alu_op_name(operation);
+        stat_op = cpu_zbb_stat_op(operation);
+    }
+    else if(funct3 == 0x00)
     {
         if(funct7 == 0x00)
         {
             operation = ALU_ADD;
             op_name = "ADD";       // operation ADD
-        }
-        else if(funct7 == 0x01)
-        {
-            operation = ALU_MUL;
-            op_name = "MUL";       // operation MUL
+            stat_op = STAT_OP_ADD;
         }
         else if(funct7 == 0x20)
         {
             operation = ALU_SUB;
             op_name = "SUB";       // operation SUB
+            stat_op = STAT_OP_SUB;
         }
         else
         {
-            printf("[ERROR] unsupported funct7=0x%02X for funct3=0x00 at PC 0x%08X\n",
+            LOG_ERROR(LOG_CAT_CPU, "[ERROR] unsupported funct7=0x%02X for funct3=0x00 at PC 0x%08X\n",
                     funct7, cpu->pc);
             cpu->error = 1;
             return -1;
@@ -383,10 +521,11 @@ static int cpu_execute_rtype(CPU *cpu, EncodedInstruction enc)
         {
             operation = ALU_SLL;
             op_name = "SLL";       // operation SLL
+            stat_op = STAT_OP_SLL;
         }
         else
         {
-            printf("[ERROR] unsupported funct7=0x%02X for funct3=0x01 at PC 0x%08X\n",
+            LOG_ERROR(LOG_CAT_CPU, "[ERROR] unsupported funct7=0x%02X for funct3=0x01 at PC 0x%08X\n",
                     funct7, cpu->pc);
             cpu->error = 1;
             return -1;
@@ -398,15 +537,11 @@ static int cpu_execute_rtype(CPU *cpu, EncodedInstruction enc)
         {
             operation = ALU_XOR;
             op_name = "XOR";       // operation XOR
-        }
-        else if(funct7 == 0x01)
-        {
-            operation = ALU_DIV;
-            op_name = "DIV";       // operation DIV
+            stat_op = STAT_OP_XOR;
         }
         else
         {
-            printf("[ERROR] unsupported funct7=0x%02X for funct3=0x04 at PC 0x%08X\n",
+            LOG_ERROR(LOG_CAT_CPU, "[ERROR] unsupported funct7=0x%02X for funct3=0x04 at PC 0x%08X\n",
                        funct7, cpu->pc);
             cpu->error = 1;
             return -1;
@@ -418,15 +553,17 @@ static int cpu_execute_rtype(CPU *cpu, EncodedInstruction enc)
         {
             operation = ALU_SRL;
             op_name = "SRL";       // operation SRL
+            stat_op = STAT_OP_SRL;
         }
         else if(funct7 == 0x20)
         {
             operation = ALU_SRA;
             op_name = "SRA";       // operation SRA
+            stat_op = STAT_OP_SRA;
         }
         else
         {
-            printf("[ERROR] unsupported rtype function funct7 0x%X at PC 0x%08X\n",
+            LOG_ERROR(LOG_CAT_CPU, "[ERROR] unsupported rtype function funct7 0x%X at PC 0x%08X\n",
                funct7, cpu->pc);
             cpu->error = 1;
             return -1;
@@ -438,10 +575,11 @@ static int cpu_execute_rtype(CPU *cpu, EncodedInstruction enc)
         {
             operation = ALU_OR;
             op_name = "OR";       // operation OR
+            stat_op = STAT_OP_OR;
         }
         else
         {
-            printf("[ERROR] unsupported funct7=0x%02X for funct3=0x06 at PC 0x%08X\n",
+            LOG_ERROR(LOG_CAT_CPU, "[ERROR] unsupported funct7=0x%02X for funct3=0x06 at PC 0x%08X\n",
                     funct7, cpu->pc);
             cpu->error = 1;
             return -1;
@@ -453,10 +591,11 @@ static int cpu_execute_rtype(CPU *cpu, EncodedInstruction enc)
         {
             operation = ALU_AND;
             op_name = "AND";       // operation AND
+            stat_op = STAT_OP_AND;
         }
         else
         {
-            printf("[ERROR] unsupported funct7=0x%02X for funct3=0x07 at PC 0x%08X\n",
+            LOG_ERROR(LOG_CAT_CPU, "[ERROR] unsupported funct7=0x%02X for funct3=0x07 at PC 0x%08X\n",
                        funct7, cpu->pc);
             cpu->error = 1;
             return -1;
@@ -464,7 +603,7 @@ static int cpu_execute_rtype(CPU *cpu, EncodedInstruction enc)
     }
     else
     {
-        printf("[ERROR] cpu_execute_rtype: unsupported funct3 0x%X at PC 0x%08X\n",
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_execute_rtype: unsupported funct3 0x%X at PC 0x%08X\n",
                funct3, cpu->pc);
         cpu->error = 1;
         return -1;
@@ -472,8 +611,9 @@ static int cpu_execute_rtype(CPU *cpu, EncodedInstruction enc)
 
     int32_t result = alu_execute(operation, val_rs1, val_rs2);
     cpu_writeback(cpu, rd, result);
+    cpu_stats_retire(cpu, stat_op, STAT_FMT_R);
 
-    printf("[EXEC] %s x%d, x%d, x%d -> x%d = 0x%08X (rs1=0x%08X, rs2=0x%08X)\n",
+    CPU_TRACE(cpu, "[EXEC] %s x%d, x%d, x%d -> x%d = 0x%08X (rs1=0x%08X, rs2=0x%08X)\n",
            op_name, rd, rs1, rs2, rd, result, val_rs1, val_rs2);
 
     return 0;
@@ -483,7 +623,7 @@ static int cpu_execute_itype(CPU *cpu, EncodedInstruction enc)
 {
     if(!cpu)
     {
-        printf("[ERROR] cpu_execute_itype: CPU is null.\n");
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_execute_itype: CPU is null.\n");
         return -1;
     }
 
@@ -500,20 +640,26 @@ static int cpu_execute_itype(CPU *cpu, EncodedInstruction enc)
     {
         if(funct3 == 0x2)  
         {
-            int32_t addr_base = cpu_get_reg(cpu, rs1);
-            uint32_t data_offset = cpu->program->instruction_count * 4;
+            int32_t addr_base = cpu_read_operand(cpu, rs1);
+            uint32_t data_offset = cpu->program->code_size;
             uint32_t addr = data_offset + addr_base + imm;
 
             op_name = "LW";       // operation LW
             value = memory_read32(cpu->memory, addr);
             cpu_writeback(cpu, rd, value);
-            printf("[EXEC] %s x%d, %d(x%d) -> Load from 0x%08X = 0x%08X\n",
+            cpu_stats_retire(cpu, STAT_OP_LW, STAT_FMT_I);
+            if(cpu->stats)
+            {
+                cpu->stats->mem_reads++;
+                cpu->stats->mem_bytes_read += 4;
+            }
+            CPU_TRACE(cpu, "[EXEC] %s x%d, %d(x%d) -> Load from 0x%08X = 0x%08X\n",
                 op_name, rd, imm, rs1, addr, value);
             return 0;
         }
         else
         {
-            printf("[ERROR] cpu_execute_itype: unsupported funct3 0x%X at PC 0x%08X\n",
+            LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_execute_itype: unsupported funct3 0x%X at PC 0x%08X\n",
                 funct3, cpu->pc);
             cpu->error = 1;
             return -1;
@@ -523,21 +669,40 @@ static int cpu_execute_itype(CPU *cpu, EncodedInstruction enc)
     {
         if(funct3 == 0x00)  
         {
-            int32_t val_rs1 = cpu_get_reg(cpu, rs1);
+            int32_t val_rs1 = cpu_read_operand(cpu, rs1);
             int32_t result  = val_rs1 + imm;
             cpu_writeback(cpu, rd, result);
+            cpu_stats_retire(cpu, STAT_OP_ADDI, STAT_FMT_I);
 
             if(rs1 == 0)
-                printf("[EXEC] LI x%d, %d -> x%d = 0x%08X\n",                     // operation LI
+                CPU_TRACE(cpu, "[EXEC] LI x%d, %d -> x%d = 0x%08X\n",                     // operation LI
                    rd, imm, rd, result);
             else
-                printf("[EXEC] ADDI x%d, x%d, %d -> x%d = 0x%08X (rs1=0x%08X)\n", // operation ADDI
+                CPU_TRACE(cpu, "[EXEC] ADDI x%d, x%d, %d -> x%d = 0x%08X (rs1=0x%08X)\n", // operation ADDI
                    rd, rs1, imm, rd, result, val_rs1);
             return 0;
         }
+
+        ALUOp operation = alu_zbb_imm_op(funct3, (uint32_t)imm);
+        if(operation != ALU_UNKNOWN)
+        {
+            // unary Zbb ops ignore operand2, RORI takes the shift amount
+            int32_t val_rs1 = cpu_read_operand(cpu, rs1);
+            int32_t result = alu_execute(operation, val_rs1, imm & 0x1F);
+            cpu_writeback(cpu, rd, result);
+            cpu_stats_retire(cpu, cpu_zbb_stat_op(operation), STAT_FMT_I);
+
+            if(operation == ALU_ROR)
+                CPU_TRACE(cpu, "[EXEC] RORI x%d, x%d, %d -> x%d = 0x%08X (rs1=0x%08X)\n",
+                   rd, rs1, imm & 0x1F, rd, result, val_rs1);
+            else
+                CPU_TRACE(cpu, "[EXEC] %s x%d, x%d -> x%d = 0x%08X (rs1=0x%08X)\n",
+                   alu_op_name(operation), rd, rs1, rd, result, val_rs1);
+            return 0;
+        }
         else
         {
-            printf("[ERROR] cpu_execute_itype: unsupported OP-IMM funct3 0x%X at PC 0x%08X\n",
+            LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_execute_itype: unsupported OP-IMM funct3 0x%X at PC 0x%08X\n",
                 funct3, cpu->pc);
             cpu->error = 1;
             return -1;
@@ -547,28 +712,37 @@ static int cpu_execute_itype(CPU *cpu, EncodedInstruction enc)
     {
         if(funct3 == 0x0)
         {
-            uint32_t pc_before_inc = cpu->pc - 4;
-            int32_t base = cpu_get_reg(cpu, rs1);
+            uint32_t pc_before_inc = cpu->pc - cpu->ilen;
+            int32_t base = cpu_read_operand(cpu, rs1);
             uint32_t target = (uint32_t)((base + imm) & ~1U);
 
-            cpu_writeback_with_context(cpu, rd, (int32_t)(pc_before_inc + 4), enc, 0);
+            cpu_writeback_with_context(cpu, rd, (int32_t)(pc_before_inc + cpu->ilen), enc, 0);
             cpu->pc = target;
+            cpu_stats_retire(cpu, STAT_OP_JALR, STAT_FMT_I);
+
+            if(cpu->profiler)
+            {
+                if(profiler_is_link_reg(rd))
+                    profiler_on_call(cpu->profiler, target, pc_before_inc + cpu->ilen);
+                else if(rd == 0 && profiler_is_link_reg(rs1))
+                    profiler_on_return(cpu->profiler, target);
+            }
 
-            printf("[EXEC] JALR x%d, x%d, imm=%d -> new PC=0x%08X (rs1=0x%08X)\n",   //  operation JALR
+            CPU_TRACE(cpu, "[EXEC] JALR x%d, x%d, imm=%d -> new PC=0x%08X (rs1=0x%08X)\n",   //  operation JALR
                 rd, rs1, imm, cpu->pc, (uint32_t)base);
 
             return 0;
         }
         else
         {
-            printf("[ERROR] cpu_execute_itype: unsupported I-type funct3=0x%X for opcode 0x67 at PC 0x%08X\n",
-                   funct3, cpu->pc - 4);
+            LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_execute_itype: unsupported I-type funct3=0x%X for opcode 0x67 at PC 0x%08X\n",
+                   funct3, cpu->pc - cpu->ilen);
             cpu->error = 1;
             return -1;
         }
     }
 
-    printf("[ERROR] cpu_execute_itype: unsupported I-type opcode 0x%02X at PC 0x%08X\n",
+    LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_execute_itype: unsupported I-type opcode 0x%02X at PC 0x%08X\n",
            opcode, cpu->pc);
     cpu->error = 1;
     return -1;
@@ -578,7 +752,7 @@ static int cpu_execute_stype(CPU *cpu, EncodedInstruction enc)
 {
     if(!cpu)
     {
-        printf("[ERROR] cpu_execute_stype: CPU is null.\n");
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_execute_stype: CPU is null.\n");
         return -1;
     }
 
@@ -587,10 +761,10 @@ static int cpu_execute_stype(CPU *cpu, EncodedInstruction enc)
     uint8_t rs2 = stype_get_rs2(enc.value);
     int32_t imm = stype_get_immediate(enc.value);
 
-    int32_t addr_base = cpu_get_reg(cpu, rs1);
-    int32_t value = cpu_get_reg(cpu, rs2);
+    int32_t addr_base = cpu_read_operand(cpu, rs1);
+    int32_t value = cpu_read_operand(cpu, rs2);
 
-    uint32_t data_offset = cpu->program->instruction_count * 4;
+    uint32_t data_offset = cpu->program->code_size;
     uint32_t addr = data_offset + addr_base + imm;
 
     const char *op_name = "UNKNOWN";
@@ -598,13 +772,19 @@ static int cpu_execute_stype(CPU *cpu, EncodedInstruction enc)
     if(funct3 == 0x2)  
     {
         op_name = "SW";       // operation SW
-        printf("[EXEC] %s x%d, %d(x%d) -> Store 0x%08X to 0x%08X\n",
+        CPU_TRACE(cpu, "[EXEC] %s x%d, %d(x%d) -> Store 0x%08X to 0x%08X\n",
                op_name, rs2, imm, rs1, value, addr);
         memory_write32(cpu->memory, addr, value);
+        cpu_stats_retire(cpu, STAT_OP_SW, STAT_FMT_S);
+        if(cpu->stats)
+        {
+            cpu->stats->mem_writes++;
+            cpu->stats->mem_bytes_written += 4;
+        }
         return 0;
     }
 
-    printf("[ERROR] cpu_execute_stype: unsupported funct3 0x%X at PC 0x%08X\n",
+    LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_execute_stype: unsupported funct3 0x%X at PC 0x%08X\n",
         funct3, cpu->pc);
     cpu->error = 1;
     return -1;
@@ -614,7 +794,7 @@ static int cpu_execute_utype(CPU *cpu, EncodedInstruction enc)
 {
     if(!cpu)
     {
-        printf("[ERROR] cpu_execute_utype: CPU is null.\n");
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_execute_utype: CPU is null.\n");
         return -1;
     }
 
@@ -625,22 +805,24 @@ static int cpu_execute_utype(CPU *cpu, EncodedInstruction enc)
     if (opcode == 0x37)
     {
         cpu_writeback(cpu, rd, imm_aligned);
-        printf("[EXEC] LUI x%d, 0x%05X -> x%d = 0x%08X\n",          // operation LUI
+        cpu_stats_retire(cpu, STAT_OP_LUI, STAT_FMT_U);
+        CPU_TRACE(cpu, "[EXEC] LUI x%d, 0x%05X -> x%d = 0x%08X\n",          // operation LUI
                rd, (unsigned)utype_get_imm20(enc.value), rd, (uint32_t)imm_aligned);
         return 0;
     }
     else if (opcode == 0x17)
     {
-        uint32_t pc_before = cpu->pc - 4; 
+        uint32_t pc_before = cpu->pc - cpu->ilen;
         uint32_t result = pc_before + (uint32_t)imm_aligned;
         
         cpu_writeback(cpu, rd, (int32_t)result);
-        printf("[EXEC] AUIPC x%d, 0x%05X -> x%d = PC(0x%08X) + 0x%08X = 0x%08X\n",          // operation AUIPC
+        cpu_stats_retire(cpu, STAT_OP_AUIPC, STAT_FMT_U);
+        CPU_TRACE(cpu, "[EXEC] AUIPC x%d, 0x%05X -> x%d = PC(0x%08X) + 0x%08X = 0x%08X\n",          // operation AUIPC
                rd, (unsigned)utype_get_imm20(enc.value), rd, pc_before, (uint32_t)imm_aligned, result);
         return 0;
     }
 
-    printf("[ERROR] cpu_execute_utype: unsupported U-type opcode 0x%02X at PC 0x%08X\n",
+    LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_execute_utype: unsupported U-type opcode 0x%02X at PC 0x%08X\n",
            opcode, cpu->pc);
     cpu->error = 1;
     return -1;
@@ -653,43 +835,57 @@ static int cpu_execute_btype(CPU *cpu, EncodedInstruction enc)
     uint32_t rs2 = btype_get_rs2(enc.value);
     int32_t imm = btype_get_imm(enc.value);
 
-    int32_t v1 = cpu_get_reg(cpu, rs1);
-    int32_t v2 = cpu_get_reg(cpu, rs2);
+    int32_t v1 = cpu_read_operand(cpu, rs1);
+    int32_t v2 = cpu_read_operand(cpu, rs2);
     int take = 0;
     const char *name = NULL;
+    StatOp stat_op = STAT_OP_BEQ;
 
     switch(funct3)
     {
         case 0x0:
             name = "BEQ";          // operation BEQ
+            stat_op = STAT_OP_BEQ;
             take = (v1 == v2);
             break;
         case 0x1:
             name = "BNE";          // operation BNE
+            stat_op = STAT_OP_BNE;
             take = (v1 != v2);
             break;
         case 0x4:
             name = "BLT";          // operation BLT
+            stat_op = STAT_OP_BLT;
             take = (v1 < v2);
             break;
         case 0x5:
             name = "BGE";          // operation BGE
+            stat_op = STAT_OP_BGE;
             take = (v1 >= v2);
             break;
         default:
-            printf("[ERROR] cpu_execute_btype: unsupported funct3=0x%X at PC=0x%08X\n",
-                   funct3, cpu->pc - 4);
+            LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_execute_btype: unsupported funct3=0x%X at PC=0x%08X\n",
+                   funct3, cpu->pc - cpu->ilen);
             cpu->error = 1;
             return -1;
     }
 
-    printf("[EXEC] %s x%d, x%d, imm=%d -> %s (rs1=0x%08X, rs2=0x%08X)\n",
+    CPU_TRACE(cpu, "[EXEC] %s x%d, x%d, imm=%d -> %s (rs1=0x%08X, rs2=0x%08X)\n",
            name, rs1, rs2, imm, take ? "TAKEN" : "NOT TAKEN",
            (uint32_t)v1, (uint32_t)v2);
 
+    cpu_stats_retire(cpu, stat_op, STAT_FMT_B);
+    if(cpu->stats)
+    {
+        if(take)
+            cpu->stats->branches_taken++;
+        else
+            cpu->stats->branches_not_taken++;
+    }
+
     if(take)
     {
-        uint32_t pc_before_inc = cpu->pc - 4;
+        uint32_t pc_before_inc = cpu->pc - cpu->ilen;
         cpu->pc = pc_before_inc + imm;
     }
     return 0;
@@ -699,22 +895,446 @@ static int cpu_execute_jtype(CPU *cpu, EncodedInstruction enc)
 {
     if(!cpu)
     {
-        printf("[ERROR] cpu_execute_jtype: CPU is null.\n");
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_execute_jtype: CPU is null.\n");
         return -1;
     }
 
     uint8_t rd = rtype_get_rd(enc.value);
     int32_t imm = jtype_get_immediate(enc.value);
 
-    uint32_t pc_before_inc = cpu->pc - 4;
+    uint32_t pc_before_inc = cpu->pc - cpu->ilen;
+    uint32_t link = cpu->pc;
 
-    cpu_writeback_with_context(cpu, rd, (int32_t)(pc_before_inc + 4), enc, 0);
+    cpu_writeback_with_context(cpu, rd, (int32_t)link, enc, 0);
 
     cpu->pc = pc_before_inc + imm;
+    cpu_stats_retire(cpu, STAT_OP_JAL, STAT_FMT_J);
+
+    if(cpu->profiler && profiler_is_link_reg(rd))
+        profiler_on_call(cpu->profiler, cpu->pc, link);
+
+    CPU_TRACE(cpu, "[EXEC] JAL x%d, imm=%d -> new PC=0x%08X (return=0x%08X)\n",          // operation JAL
+           rd, imm, cpu->pc, link);
+
+    return 0;
+}
+
+// RV32A, funct5 in the upper bits of funct7; aq/rl are accepted and ignored
+// since every atomic access is sequentially consistent on the host
+#define CPU_AMO_LR   0x02
+#define CPU_AMO_SC   0x03
+
+static const struct
+{
+    uint8_t funct5;
+    MemoryAmoOp op;
+    const char *name;
+} cpu_amo_ops[] = {
+    { 0x01, MEMORY_AMO_SWAP, "AMOSWAP.W" },
+    { 0x00, MEMORY_AMO_ADD,  "AMOADD.W"  },
+    { 0x04, MEMORY_AMO_XOR,  "AMOXOR.W"  },
+    { 0x0C, MEMORY_AMO_AND,  "AMOAND.W"  },
+    { 0x08, MEMORY_AMO_OR,   "AMOOR.W"   },
+    { 0x10, MEMORY_AMO_MIN,  "AMOMIN.W"  },
+    { 0x14, MEMORY_AMO_MAX,  "AMOMAX.W"  },
+    { 0x18, MEMORY_AMO_MINU, "AMOMINU.W" },
+    { 0x1C, MEMORY_AMO_MAXU, "AMOMAXU.W" },
+};
+
+static inline void cpu_stats_mem(CPU *cpu, int reads, int writes)
+{
+    if(cpu->stats)
+    {
+        cpu->stats->mem_reads += reads;
+        cpu->stats->mem_bytes_read += 4 * reads;
+        cpu->stats->mem_writes += writes;
+        cpu->stats->mem_bytes_written += 4 * writes;
+    }
+}
+
+static int cpu_execute_amo(CPU *cpu, EncodedInstruction enc)
+{
+    uint8_t funct5 = rtype_get_funct7(enc.value) >> 2;
+    uint8_t rs2 = rtype_get_rs2(enc.value);
+    uint8_t rs1 = rtype_get_rs1(enc.value);
+    uint8_t funct3 = rtype_get_funct3(enc.value);
+    uint8_t rd = rtype_get_rd(enc.value);
+
+    if(funct3 != 0x2)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_execute_amo: unsupported width funct3 0x%X at PC 0x%08X\n",
+               funct3, cpu->pc);
+        cpu->error = 1;
+        return -1;
+    }
+
+    // same data-relative addressing as LW/SW
+    uint32_t data_offset = cpu->program->code_size;
+    uint32_t addr = data_offset + (uint32_t)cpu_read_operand(cpu, rs1);
+    if((addr & 3) != 0 || (size_t)addr + 4 > cpu->memory->size)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_execute_amo: misaligned or out-of-bounds address 0x%08X at PC 0x%08X\n",
+               addr, cpu->pc);
+        cpu->error = 1;
+        return -1;
+    }
+
+    if(funct5 == CPU_AMO_LR)
+    {
+        int32_t value = (int32_t)memory_read32(cpu->memory, addr);
+        cpu->reserved = 1;
+        cpu->reservation_addr = addr;
+        cpu->reservation_value = (uint32_t)value;
+        CPU_TRACE(cpu, "[EXEC] LR.W x%d, (x%d) -> Load 0x%08X from 0x%08X, reserved\n",
+               rd, rs1, (uint32_t)value, addr);
+        cpu_writeback_with_context(cpu, rd, value, enc, 0);
+        cpu_stats_retire(cpu, STAT_OP_LR, STAT_FMT_R);
+        cpu_stats_mem(cpu, 1, 0);
+        return 0;
+    }
+
+    if(funct5 == CPU_AMO_SC)
+    {
+        // the reservation holds while the word still has the value LR.W read;
+        // a compare-and-swap makes the check and the store one atomic step
+        int32_t value = cpu_read_operand(cpu, rs2);
+        int stored = cpu->reserved && cpu->reservation_addr == addr &&
+                     memory_cas32(cpu->memory, addr, cpu->reservation_value, (uint32_t)value);
+        cpu->reserved = 0;
+        CPU_TRACE(cpu, "[EXEC] SC.W x%d, x%d, (x%d) -> %s 0x%08X to 0x%08X\n",
+               rd, rs2, rs1, stored ? "Store" : "Failed store of", (uint32_t)value, addr);
+        cpu_writeback_with_context(cpu, rd, stored ? 0 : 1, enc, 0);
+        cpu_stats_retire(cpu, STAT_OP_SC, STAT_FMT_R);
+        cpu_stats_mem(cpu, 0, stored);
+        return 0;
+    }
+
+    for(size_t i = 0; i < sizeof(cpu_amo_ops) / sizeof(cpu_amo_ops[0]); ++i)
+    {
+        if(cpu_amo_ops[i].funct5 != funct5)
+            continue;
+
+        int32_t value = cpu_read_operand(cpu, rs2);
+        int32_t old = (int32_t)memory_amo32(cpu->memory, addr, cpu_amo_ops[i].op, (uint32_t)value);
+        CPU_TRACE(cpu, "[EXEC] %s x%d, x%d, (x%d) -> Old 0x%08X at 0x%08X, operand 0x%08X\n",
+               cpu_amo_ops[i].name, rd, rs2, rs1, (uint32_t)old, addr, (uint32_t)value);
+        cpu_writeback_with_context(cpu, rd, old, enc, 0);
+        cpu_stats_retire(cpu, STAT_OP_AMO, STAT_FMT_R);
+        cpu_stats_mem(cpu, 1, 1);
+        return 0;
+    }
+
+    LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_execute_amo: unsupported funct5 0x%02X at PC 0x%08X\n",
+           funct5, cpu->pc);
+    cpu->error = 1;
+    return -1;
+}
+
+// ================================================================= //
+//                              VECTOR                               //
+// ================================================================= //
+
+// RVV subset: SEW=32 with LMUL 1, 2, 4 or 8, unmasked; the element loops
+// run as host SIMD kernels (rvv.h)
+#define CPU_VSEW_32          0x2
+#define CPU_VWIDTH_32        0x6    // vle32/vse32 width field
+#define CPU_VFUNCT3_OPIVV    0x0
+#define CPU_VFUNCT3_OPMVV    0x2
+#define CPU_VFUNCT3_OPIVI    0x3
+#define CPU_VFUNCT3_OPIVX    0x4
+#define CPU_VFUNCT3_OPMVX    0x6
+#define CPU_VFUNCT3_OPCFG    0x7
+#define CPU_VFUNCT6_REDSUM   0x00   // vredsum.vs, OPMVV
+#define CPU_VTRACE_ELEMS     8
+
+static const struct
+{
+    uint8_t funct6;
+    int opm;                        // OPMVV/OPMVX rather than OPIVV/OPIVX/OPIVI
+    int has_vi;
+    RvvOp op;
+    const char *name;
+} cpu_vector_ops[] = {
+    { 0x00, 0, 1, RVV_ADD, "VADD" },
+    { 0x02, 0, 0, RVV_SUB, "VSUB" },
+    { 0x25, 1, 0, RVV_MUL, "VMUL" },
+    { 0x09, 0, 1, RVV_AND, "VAND" },
+    { 0x0A, 0, 1, RVV_OR,  "VOR"  },
+    { 0x0B, 0, 1, RVV_XOR, "VXOR" },
+};
+
+static inline uint32_t cpu_vlmul(const CPU *cpu)
+{
+    return 1u << (cpu->vector.vtype & 0x3);
+}
+
+static inline uint32_t *cpu_vreg(CPU *cpu, uint8_t v)
+{
+    return &cpu->vector.regs[(uint32_t)v * (cpu->vector.vlen / 32)];
+}
+
+// "{1, 2, ...}" with the first CPU_VTRACE_ELEMS active elements of group v
+static const char *cpu_vector_format(CPU *cpu, uint8_t v, char *buf, size_t size)
+{
+    const uint32_t *elems = cpu_vreg(cpu, v);
+    uint32_t shown = (cpu->vector.vl < CPU_VTRACE_ELEMS) ? cpu->vector.vl : CPU_VTRACE_ELEMS;
+    size_t len = (size_t)snprintf(buf, size, "{");
+    for(uint32_t i = 0; i < shown && len < size; ++i)
+    {
+        len += (size_t)snprintf(buf + len, size - len, "%s%d", i ? ", " : "", (int32_t)elems[i]);
+    }
+    if(len < size)
+        snprintf(buf + len, size - len, "%s}", (shown < cpu->vector.vl) ? ", ..." : "");
+    return buf;
+}
 
-    printf("[EXEC] JAL x%d, imm=%d -> new PC=0x%08X (return=0x%08X)\n",          // operation JAL
-           rd, imm, cpu->pc, (uint32_t)(pc_before_inc + 4));
+static int cpu_vector_fail(CPU *cpu, const char *name, const char *why)
+{
+    LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_execute_vector: %s %s at PC 0x%08X\n", name, why, cpu->pc);
+    cpu->error = 1;
+    return -1;
+}
 
+// vill, masking and register groups are checked before any element is touched
+static int cpu_vector_check(CPU *cpu, EncodedInstruction enc, const char *name, uint8_t group_mask)
+{
+    if(cpu->vector.vtype & CPU_VTYPE_VILL)
+        return cpu_vector_fail(cpu, name, "without a supported vtype (vsetvli e32, m1-m8 first)");
+    if(!vtype_get_vm(enc.value))
+        return cpu_vector_fail(cpu, name, "is masked (v0.t), which is not supported");
+    if(group_mask & (cpu_vlmul(cpu) - 1))
+        return cpu_vector_fail(cpu, name, "uses a register group not aligned to LMUL");
+    return 0;
+}
+
+static int cpu_execute_vsetvli(CPU *cpu, EncodedInstruction enc)
+{
+    uint8_t rd = rtype_get_rd(enc.value);
+    uint8_t rs1 = rtype_get_rs1(enc.value);
+    uint32_t zimm = vtype_get_zimm(enc.value);
+
+    if(enc.value & 0x80000000u)
+        return cpu_vector_fail(cpu, "VSETVL/VSETIVLI", "is not supported, only VSETVLI");
+
+    // SEW=32 and integer LMUL only; anything else sets vill and vl = 0, and
+    // the next vector instruction fails
+    uint32_t vsew = (zimm >> 3) & 0x7;
+    uint32_t vlmul = zimm & 0x7;
+    if(vsew != CPU_VSEW_32 || vlmul > 3 || (zimm >> 8) != 0)
+    {
+        cpu->vector.vtype = CPU_VTYPE_VILL;
+        cpu->vector.vl = 0;
+        CPU_TRACE(cpu, "[EXEC] VSETVLI x%d, x%d, vtype 0x%03X -> unsupported, vill set\n", rd, rs1, zimm);
+    }
+    else
+    {
+        cpu->vector.vtype = zimm;
+        uint32_t vlmax = cpu->vector.vlen / 32 * cpu_vlmul(cpu);
+        uint32_t avl = cpu->vector.vl;
+        if(rs1 != 0)
+            avl = (uint32_t)cpu_read_operand(cpu, rs1);
+        else if(rd != 0)
+            avl = vlmax;
+        cpu->vector.vl = (avl < vlmax) ? avl : vlmax;
+        CPU_TRACE(cpu, "[EXEC] VSETVLI x%d, x%d, e32, m%u -> vl = %u (VLMAX %u)\n",
+               rd, rs1, cpu_vlmul(cpu), cpu->vector.vl, vlmax);
+    }
+
+    if(rd != 0)
+        cpu_writeback_with_context(cpu, rd, (int32_t)cpu->vector.vl, enc, 0);
+    cpu_stats_retire(cpu, STAT_OP_VSETVLI, STAT_FMT_V);
+    return 0;
+}
+
+// vle32.v / vse32.v, unit-stride with the data-relative addressing of LW/SW
+static int cpu_execute_vmem(CPU *cpu, EncodedInstruction enc, int store)
+{
+    uint8_t vd = rtype_get_rd(enc.value);
+    uint8_t rs1 = rtype_get_rs1(enc.value);
+    uint8_t funct6 = vtype_get_funct6(enc.value);
+    const char *name = store ? "VSE32.V" : "VLE32.V";
+
+    // funct6 holds nf, mew and mop; unit-stride is all zero, as is lumop/sumop
+    if(rtype_get_funct3(enc.value) != CPU_VWIDTH_32 || funct6 != 0 || rtype_get_rs2(enc.value) != 0)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_execute_vector: unsupported load/store 0x%08X at PC 0x%08X\n",
+               enc.value, cpu->pc);
+        cpu->error = 1;
+        return -1;
+    }
+    if(cpu_vector_check(cpu, enc, name, vd) < 0)
+        return -1;
+
+    uint32_t vl = cpu->vector.vl;
+    uint32_t data_offset = cpu->program->code_size;
+    uint32_t addr = data_offset + (uint32_t)cpu_read_operand(cpu, rs1);
+    if(vl > 0)
+    {
+        int rc = store ? memory_write_words(cpu->memory, addr, cpu_vreg(cpu, vd), vl)
+                       : memory_read_words(cpu->memory, addr, cpu_vreg(cpu, vd), vl);
+        if(rc < 0)
+            return cpu_vector_fail(cpu, name, "accessed memory out of bounds");
+    }
+
+    if(cpu->trace)
+    {
+        char elems[128];
+        CPU_TRACE(cpu, "[EXEC] %s v%d, (x%d) -> %s vl=%u %s 0x%08X: %s\n", name, vd, rs1,
+               store ? "Store" : "Load", vl, store ? "to" : "from", addr,
+               cpu_vector_format(cpu, vd, elems, sizeof(elems)));
+    }
+    cpu_stats_retire(cpu, store ? STAT_OP_VSE32 : STAT_OP_VLE32, STAT_FMT_V);
+    cpu_stats_mem(cpu, store ? 0 : (int)vl, store ? (int)vl : 0);
+    return 0;
+}
+
+static int cpu_execute_vector(CPU *cpu, EncodedInstruction enc)
+{
+    uint8_t funct3 = rtype_get_funct3(enc.value);
+    if(funct3 == CPU_VFUNCT3_OPCFG)
+        return cpu_execute_vsetvli(cpu, enc);
+
+    uint8_t funct6 = vtype_get_funct6(enc.value);
+    uint8_t vd = rtype_get_rd(enc.value);
+    uint8_t vs1 = rtype_get_rs1(enc.value);
+    uint8_t vs2 = rtype_get_rs2(enc.value);
+    uint32_t vl = cpu->vector.vl;
+    char elems[128];
+
+    if(funct3 == CPU_VFUNCT3_OPMVV && funct6 == CPU_VFUNCT6_REDSUM)
+    {
+        // vd[0] = vs1[0] + sum(vs2); vd and vs1 are single registers
+        if(cpu_vector_check(cpu, enc, "VREDSUM.VS", vs2) < 0)
+            return -1;
+        if(vl > 0)
+            cpu_vreg(cpu, vd)[0] = rvv_redsum(cpu_vreg(cpu, vs2), cpu_vreg(cpu, vs1)[0], vl);
+        CPU_TRACE(cpu, "[EXEC] VREDSUM.VS v%d, v%d, v%d -> v%d[0] = %d (vl = %u)\n",
+               vd, vs2, vs1, vd, (int32_t)cpu_vreg(cpu, vd)[0], vl);
+        cpu_stats_retire(cpu, STAT_OP_VREDSUM, STAT_FMT_V);
+        return 0;
+    }
+
+    int opm = (funct3 == CPU_VFUNCT3_OPMVV || funct3 == CPU_VFUNCT3_OPMVX);
+    int vv = (funct3 == CPU_VFUNCT3_OPIVV || funct3 == CPU_VFUNCT3_OPMVV);
+    for(size_t i = 0; i < sizeof(cpu_vector_ops) / sizeof(cpu_vector_ops[0]); ++i)
+    {
+        if(cpu_vector_ops[i].funct6 != funct6 || cpu_vector_ops[i].opm != opm ||
+           (funct3 == CPU_VFUNCT3_OPIVI && !cpu_vector_ops[i].has_vi))
+            continue;
+
+        RvvOp op = cpu_vector_ops[i].op;
+        const char *name = cpu_vector_ops[i].name;
+        if(cpu_vector_check(cpu, enc, name, (uint8_t)(vd | vs2 | (vv ? vs1 : 0))) < 0)
+            return -1;
+
+        if(vv)
+        {
+            rvv_op_vv(op, cpu_vreg(cpu, vd), cpu_vreg(cpu, vs2), cpu_vreg(cpu, vs1), vl);
+            if(cpu->trace)
+                CPU_TRACE(cpu, "[EXEC] %s.VV v%d, v%d, v%d -> v%d = %s\n", name, vd, vs2, vs1, vd,
+                       cpu_vector_format(cpu, vd, elems, sizeof(elems)));
+        }
+        else
+        {
+            // .vi takes a sign-extended 5-bit immediate in the vs1 field
+            int32_t x = (funct3 == CPU_VFUNCT3_OPIVI) ? ((int32_t)((uint32_t)vs1 << 27) >> 27)
+                                                      : cpu_read_operand(cpu, vs1);
+            rvv_op_vx(op, cpu_vreg(cpu, vd), cpu_vreg(cpu, vs2), (uint32_t)x, vl);
+            if(cpu->trace)
+            {
+                if(funct3 == CPU_VFUNCT3_OPIVI)
+                    CPU_TRACE(cpu, "[EXEC] %s.VI v%d, v%d, %d -> v%d = %s\n", name, vd, vs2, x, vd,
+                           cpu_vector_format(cpu, vd, elems, sizeof(elems)));
+                else
+                    CPU_TRACE(cpu, "[EXEC] %s.VX v%d, v%d, x%d -> v%d = %s\n", name, vd, vs2, vs1, vd,
+                           cpu_vector_format(cpu, vd, elems, sizeof(elems)));
+            }
+        }
+        cpu_stats_retire(cpu, (StatOp)(STAT_OP_VADD + op), STAT_FMT_V);
+        return 0;
+    }
+
+    LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_execute_vector: unsupported funct6 0x%02X, funct3 0x%X at PC 0x%08X\n",
+           funct6, funct3, cpu->pc);
+    cpu->error = 1;
+    return -1;
+}
+
+// ================================================================= //
+//                               ZICSR                               //
+// ================================================================= //
+
+// every CSR here is read-only (csr.h): CSRRW/CSRRWI always write, CSRRS/CSRRC
+// and their immediate forms only when rs1/uimm is not 0
+static int cpu_execute_csr(CPU *cpu, EncodedInstruction enc)
+{
+    uint8_t funct3 = itype_get_funct3(enc.value);
+    uint8_t rd = itype_get_rd(enc.value);
+    uint8_t rs1 = itype_get_rs1(enc.value);
+    uint32_t csr = enc.value >> 20;
+    const char *name = csr_op_name(funct3);
+
+    if(!name)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_execute_csr: unsupported SYSTEM funct3 0x%X at PC 0x%08X\n",
+               funct3, cpu->pc);
+        cpu->error = 1;
+        return -1;
+    }
+
+    uint32_t value;
+    if(csr_read(cpu, csr, &value) < 0)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_execute_csr: %s of unknown CSR 0x%03X at PC 0x%08X\n",
+               name, csr, cpu->pc);
+        cpu->error = 1;
+        return -1;
+    }
+    if((funct3 & 0x3) == 0x1 || rs1 != 0)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_execute_csr: %s writes read-only CSR %s at PC 0x%08X\n",
+               name, csr_name(csr), cpu->pc);
+        cpu->error = 1;
+        return -1;
+    }
+
+    if(rd != 0)
+        cpu_writeback_with_context(cpu, rd, (int32_t)value, enc, 0);
+    cpu_stats_retire(cpu, STAT_OP_CSR, STAT_FMT_I);
+
+    if(funct3 & 0x4)
+        CPU_TRACE(cpu, "[EXEC] %s x%d, %s, %d -> x%d = 0x%08X\n",
+               name, rd, csr_name(csr), rs1, rd, (uint32_t)cpu->regs[rd]);
+    else
+        CPU_TRACE(cpu, "[EXEC] %s x%d, %s, x%d -> x%d = 0x%08X\n",
+               name, rd, csr_name(csr), rs1, rd, (uint32_t)cpu->regs[rd]);
+    return 0;
+}
+
+// ECALL (the only SYSTEM instruction with funct3 0 here) or a CSR access
+static int cpu_execute_system(CPU *cpu, EncodedInstruction enc)
+{
+    if(itype_get_funct3(enc.value) != 0)
+        return cpu_execute_csr(cpu, enc);
+
+    if(enc.value != 0x00000073 || !cpu->syscalls)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_execute_system: unsupported SYSTEM instruction 0x%08X at PC 0x%08X%s\n",
+               enc.value, cpu->pc, (enc.value == 0x00000073) ? " (no system call handler)" : "");
+        cpu->error = 1;
+        return -1;
+    }
+
+    uint32_t number = (uint32_t)cpu->regs[17];
+    if(syscall_dispatch(cpu) < 0)
+    {
+        cpu->error = 1;
+        return -1;
+    }
+    cpu_stats_retire(cpu, STAT_OP_ECALL, STAT_FMT_I);
+
+    CPU_TRACE(cpu, "[EXEC] ECALL %s (a7=%u) -> a0 = 0x%08X\n",
+           syscall_name(number), number, (uint32_t)cpu->regs[10]);
     return 0;
 }
 
@@ -722,7 +1342,7 @@ int cpu_execute(CPU *cpu, EncodedInstruction enc)
 {
     if(!cpu)
     {
-        printf("[ERROR] cpu is null.\n");
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu is null.\n");
         return -1;
     }
 
@@ -740,6 +1360,16 @@ int cpu_execute(CPU *cpu, EncodedInstruction enc)
         case 0x33:
             return cpu_execute_rtype(cpu, enc);
 
+        case 0x2F:
+            return cpu_execute_amo(cpu, enc);
+
+        case 0x57:
+            return cpu_execute_vector(cpu, enc);
+
+        case 0x07:
+        case 0x27:
+            return cpu_execute_vmem(cpu, enc, opcode == 0x27);
+
         case 0x17:
         case 0x37:
             return cpu_execute_utype(cpu, enc);
@@ -750,9 +1380,12 @@ int cpu_execute(CPU *cpu, EncodedInstruction enc)
         case 0x6F:
             return cpu_execute_jtype(cpu, enc);
 
+        case 0x73:
+            return cpu_execute_system(cpu, enc);
+
         default:
         {
-            printf("[ERROR] cpu_execute: unknown opcode 0x%02X at PC 0x%08X\n",
+            LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_execute: unknown opcode 0x%02X at PC 0x%08X\n",
                    opcode, cpu->pc);
             cpu->error = 1;
             return -1;
@@ -804,16 +1437,19 @@ static void cpu_write_reg_checked_with_context(CPU *cpu, int rd, int32_t value,
     {
         if(rd == 0)
         {
-            printf("[WARN] writeback ignored: attempt to write x0 with 0x%08X\n", (uint32_t)value);
+            CPU_TRACE(cpu, "[WARN] writeback ignored: attempt to write x0 with 0x%08X\n", (uint32_t)value);
             return;
         }
-        printf("[ERROR] writeback denied: cannot write x%d (instr opcode=0x%02X, operand_index=%d)\n",
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] writeback denied: cannot write x%d (instr opcode=0x%02X, operand_index=%d)\n",
                rd, enc ? (enc->value & 0x7F) : 0, operand_index);
         cpu->error = 1;
         return;
     }
 
     cpu->regs[rd] = value;
+
+    if(cpu->stats)
+        cpu->stats->reg_writes[rd]++;
 }
 
 void cpu_writeback(CPU *cpu, int rd, int32_t value)
@@ -826,98 +1462,375 @@ void cpu_writeback_with_context(CPU *cpu, int rd, int32_t value, EncodedInstruct
     cpu_write_reg_checked_with_context(cpu, rd, value, &enc, operand_index);
 }
 
+// ================================================================= //
+//                          TRACE RECORDS                            //
+// ================================================================= //
+
+// effective address of a load/store, taken before execute can change rs1
+static uint32_t cpu_trace_mem_addr(CPU *cpu, EncodedInstruction enc)
+{
+    uint8_t opcode = enc.value & 0x7F;
+    uint32_t data_offset = cpu->program->code_size;
+
+    if(opcode == 0x03)
+        return data_offset + cpu->regs[itype_get_rs1(enc.value)] + itype_get_immediate(enc.value);
+    if(opcode == 0x23)
+        return data_offset + cpu->regs[stype_get_rs1(enc.value)] + stype_get_immediate(enc.value);
+    if(opcode == 0x2F || opcode == 0x07 || opcode == 0x27)
+        return data_offset + cpu->regs[rtype_get_rs1(enc.value)];
+    return 0;
+}
+
+// word an AMO is about to read; with rd = x0 the record has no other way to
+// know it once execute has replaced it
+static int32_t cpu_trace_amo_old(CPU *cpu, EncodedInstruction enc, uint32_t mem_addr)
+{
+    uint8_t funct5 = rtype_get_funct7(enc.value) >> 2;
+    if((enc.value & 0x7F) != 0x2F || funct5 == CPU_AMO_LR || funct5 == CPU_AMO_SC)
+        return 0;
+    if((size_t)mem_addr + 4 > cpu->memory->size)
+        return 0;
+    return (int32_t)memory_peek32(cpu->memory, mem_addr);
+}
+
+static void cpu_trace_retire(CPU *cpu, uint32_t pc, EncodedInstruction enc, uint32_t mem_addr, int32_t amo_old)
+{
+    // a compressed instruction is recorded as its halfword, so readers can
+    // tell its length
+    TraceRecord rec;
+    rec.pc = pc;
+    rec.word = (cpu->ilen == 2) ? memory_peek16(cpu->memory, pc) : enc.value;
+    rec.flags = 0;
+    rec.rd = 0;
+    rec.rd_value = 0;
+    rec.mem_addr = 0;
+    rec.mem_value = 0;
+
+    uint8_t opcode = enc.value & 0x7F;
+    if(opcode != 0x23 && opcode != 0x63 && (!vtype_is_vector(enc.value) || vtype_is_vsetvli(enc.value)))
+    {
+        rec.rd = (enc.value == 0x00000073) ? 10 : rtype_get_rd(enc.value);    // ECALL returns in a0
+        if(rec.rd != 0)
+        {
+            rec.flags |= TRACE_F_RD;
+            rec.rd_value = cpu->regs[rec.rd];
+        }
+    }
+
+    if(opcode == 0x03 || opcode == 0x23 || opcode == 0x2F || opcode == 0x07 || opcode == 0x27)
+    {
+        // LR.W only reads and SC.W is recorded with the word it left behind;
+        // the AMOs are recorded as loads of the old word, which the trace
+        // prints and rd = x0 would otherwise lose; VLE32/VSE32 with their
+        // first element
+        uint8_t funct5 = rtype_get_funct7(enc.value) >> 2;
+        int amo = (opcode == 0x2F && funct5 != CPU_AMO_LR && funct5 != CPU_AMO_SC);
+        int load = (opcode == 0x03 || opcode == 0x07) || amo || (opcode == 0x2F && funct5 == CPU_AMO_LR);
+        rec.flags |= load ? TRACE_F_LOAD : TRACE_F_STORE;
+        rec.mem_addr = mem_addr;
+        if(amo)
+            rec.mem_value = amo_old;
+        else if((size_t)mem_addr + 4 <= cpu->memory->size)
+            rec.mem_value = (int32_t)memory_peek32(cpu->memory, mem_addr);
+    }
+
+    if(cpu->tracer)
+        trace_writer_record(cpu->tracer, &rec);
+    if(cpu->loop_trace)
+        loop_trace_record(cpu->loop_trace, &rec);
+}
+
+// ================================================================= //
+//                               RUN                                 //
+// ================================================================= //
+
 int cpu_step(CPU *cpu)
 {
     if(!cpu)
     {
-        printf("[ERROR] cpu_step: cpu is null.\n");
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_step: cpu is null.\n");
         return -1;
     }
 
     if(cpu->halted)
     {
-        printf("[INFO] cpu_step: cpu is halted.\n");
+        CPU_TRACE(cpu, "[INFO] cpu_step: cpu is halted.\n");
         return 0;
     }
 
-    uint32_t program_end = cpu->program->instruction_count * 4;
+    uint32_t program_end = cpu->program->code_size;
 
     if(cpu->pc >= program_end)
     {
-        printf("[INFO] cpu_step: PC (0x%08X) reached end of program (program size: %d bytes)\n",
+        CPU_TRACE(cpu, "[INFO] cpu_step: PC (0x%08X) reached end of program (program size: %d bytes)\n",
                cpu->pc, program_end);
         cpu->halted = 1;
         return 0;
     }
 
-    if(cpu->pc >= cpu->memory->size)
+    // 1. fetch; only a compressed instruction fits in the last halfword of
+    //    memory, which cpu_fetch() does not read
+    uint32_t pc = cpu->pc;
+    EncodedInstruction enc;
+    if((size_t)pc + 4 > cpu->memory->size)
     {
-        printf("[INFO] cpu_step: PC (0x%08X) reached end of program\n", cpu->pc);
-        cpu->halted = 1;
-        return 0;
+        if((size_t)pc + 2 > cpu->memory->size || !rvc_is_compressed(memory_peek16(cpu->memory, pc)))
+        {
+            CPU_TRACE(cpu, "[INFO] cpu_step: PC (0x%08X) reached end of program\n", cpu->pc);
+            cpu->halted = 1;
+            return 0;
+        }
+        enc = cpu_fetch_compressed(cpu, memory_peek16(cpu->memory, pc));
+    }
+    else
+    {
+        enc = cpu_fetch(cpu);
     }
 
-    // 1. fetch
-    EncodedInstruction enc = cpu_fetch(cpu);
+    if(cpu->trace && cpu->ilen == 2)
+        LOG_TRACE(LOG_CAT_CPU, "\n[STEP %u] PC=0x%08X, Instruction=0x%04X (compressed, expands to 0x%08X)\n",
+               cpu->instructions_executed, cpu->pc, memory_peek16(cpu->memory, cpu->pc), enc.value);
+    else
+        CPU_TRACE(cpu, "\n[STEP %u] PC=0x%08X, Instruction=0x%08X\n",
+               cpu->instructions_executed, cpu->pc, enc.value);
 
-    printf("\n[STEP %u] PC=0x%08X, Instruction=0x%08X\n",
-           cpu->instructions_executed, cpu->pc, enc.value);
+    if(cpu->stats)
+    {
+        cpu->stats->fetch_bytes += cpu->ilen;
+        cpu->stats->compressed += (cpu->ilen == 2);
+    }
 
     // 1.1 increment
-    cpu->pc += 4; 
+    cpu->pc += cpu->ilen;
 
     // 2. decode
     if(cpu_decode(cpu, enc) < 0)
     {
-        printf("[ERROR] cpu_step: decode failed\n");
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_step: decode failed\n");
         return -1;
     }
 
+    // 2.1 charge the instruction to the calling context it started in,
+    //     before a call/return inside execute moves the profiler
+    if(cpu->profiler)
+        profiler_retire(cpu->profiler);
+
+    // 2.2 the access address (and the word an AMO replaces) has to be
+    //     read before execute updates rd and memory
+    uint32_t trace_addr = 0;
+    int32_t trace_amo_old = 0;
+    int traced = cpu->tracer || cpu->loop_trace;
+    if(traced)
+    {
+        trace_addr = cpu_trace_mem_addr(cpu, enc);
+        trace_amo_old = cpu_trace_amo_old(cpu, enc, trace_addr);
+    }
+
+    // 2.3 old value of rd / the stored word, for stepping back
+    if(cpu->undo)
+        undo_record(cpu->undo, cpu, pc, enc);
+
     // 3. execute
     if(cpu_execute(cpu, enc) < 0)
     {
-        printf("[ERROR] cpu_step: execution failed\n");
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_step: execution failed\n");
         return -1;
     }
 
+    if(traced)
+        cpu_trace_retire(cpu, pc, enc, trace_addr, trace_amo_old);
+
     cpu->instructions_executed++;
 
     return 0;
 }
 
+// after the instruction at `pc`: did it hit a watchpoint, or does the next
+// one have a breakpoint?
+static inline int cpu_debug_stop(CPU *cpu, uint32_t pc)
+{
+    if(cpu->memory->watch_hit)
+    {
+        cpu->stop_reason = CPU_STOP_WATCHPOINT;
+        cpu->stop_pc = pc;
+        return 1;
+    }
+
+    if((cpu->pc >> 1) < cpu->breakpoint_slots && cpu->breakpoints[cpu->pc >> 1])
+    {
+        cpu->stop_reason = CPU_STOP_BREAKPOINT;
+        return 1;
+    }
+    return 0;
+}
+
+// runs until the program ends, an error occurs, a breakpoint or watchpoint
+// is hit or `limit` instructions have executed in total
+static int cpu_run_loop(CPU *cpu, uint32_t limit)
+{
+    cpu->stop_reason = CPU_STOP_NONE;
+    memory_clear_watch_hit(cpu->memory);
+
+    while(!cpu->halted && cpu->instructions_executed < limit)
+    {
+        uint32_t pc = cpu->pc;
+        if(cpu_step(cpu) < 0)
+            return -1;
+
+        if(cpu->checkpoint && cpu->instructions_executed >= cpu->checkpoint->next_at && !cpu->halted)
+            checkpoint_write(cpu->checkpoint, cpu);
+
+        // one test for breakpoints and watchpoints while neither is set
+        if(cpu->breakpoints && cpu_debug_stop(cpu, pc))
+            break;
+    }
+    return 0;
+}
+
 int cpu_run(CPU *cpu)
 {
     if(!cpu)
     {
-        printf("[ERROR] cpu_run: CPU is NULL\n");
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_run: CPU is NULL\n");
         return -1;
     }
 
-    printf("\n=== Starting CPU Execution ===\n");
+    CPU_TRACE(cpu, "\n=== Starting CPU Execution ===\n");
 
-    while(!cpu->halted && cpu->instructions_executed < 1000)
+    if(cpu_run_loop(cpu, cpu->max_instructions) < 0)
     {
-        if(cpu_step(cpu) < 0)
-        {
-            printf("[ERROR] cpu_run: execution failed at step %u\n",
-                   cpu->instructions_executed);
-            return -1;
-        }
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_run: execution failed at step %u\n",
+               cpu->instructions_executed);
+        return -1;
     }
 
-    if(cpu->instructions_executed >= 1000)
+    if(cpu->stop_reason == CPU_STOP_BREAKPOINT)
+    {
+        CPU_TRACE(cpu, "[INFO] cpu_run: breakpoint at PC 0x%08X\n", cpu->pc);
+    }
+    else if(cpu->stop_reason == CPU_STOP_WATCHPOINT)
+    {
+        CPU_TRACE(cpu, "[INFO] cpu_run: watchpoint at 0x%08X hit by PC 0x%08X\n", cpu->memory->hit.addr, cpu->stop_pc);
+    }
+    else if(!cpu->halted && cpu->instructions_executed >= cpu->max_instructions)
     {
-        printf("[WARN] cpu_run: execution limit (1000 instructions) reached\n");
+        LOG_WARN(LOG_CAT_CPU, "[WARN] cpu_run: execution limit (%u instructions) reached\n", cpu->max_instructions);
     } 
 
-    printf("\n=== CPU Execution Finished ===\n");
-    printf("Total instructions executed: %u\n", cpu->instructions_executed);
+    CPU_TRACE(cpu, "\n=== CPU Execution Finished ===\n");
+    CPU_TRACE(cpu, "Total instructions executed: %u\n", cpu->instructions_executed);
 
     if(cpu->error)
     {
-        printf("[ERROR] cpu_run: CPU reported an error during execution\n");
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_run: CPU reported an error during execution\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+int cpu_run_for(CPU *cpu, uint32_t budget)
+{
+    if(!cpu)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_run_for: CPU is NULL\n");
+        return -1;
+    }
+
+    uint32_t limit = cpu->instructions_executed + budget;
+    if(limit < cpu->instructions_executed)
+        limit = UINT32_MAX;
+
+    if(cpu_run_loop(cpu, limit) < 0)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_run_for: execution failed at step %u\n",
+               cpu->instructions_executed);
+        return -1;
+    }
+
+    return cpu->error ? -1 : 0;
+}
+
+// ================================================================= //
+//                            BREAKPOINTS                            //
+// ================================================================= //
+
+// the breakpoint flags double as the "debugging is on" test of cpu_run, so
+// watchpoints allocate them too
+static int cpu_alloc_breakpoints(CPU *cpu)
+{
+    if(cpu->breakpoints)
+        return 0;
+
+    // one flag per halfword, where a compressed instruction may start
+    uint32_t slots = cpu->program->code_size / 2;
+    cpu->breakpoints = (uint8_t *)calloc(slots ? slots : 1, sizeof(uint8_t));
+    if(!cpu->breakpoints)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_alloc_breakpoints: allocation failed\n");
+        return -1;
+    }
+    cpu->breakpoint_slots = slots;
+    return 0;
+}
+
+int cpu_set_breakpoint(CPU *cpu, uint32_t pc)
+{
+    if(!cpu || !cpu->program)
+        return -1;
+
+    if((pc & 1) != 0 || pc >= cpu->program->code_size)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] cpu_set_breakpoint: 0x%08X is not an instruction of the program\n", pc);
         return -1;
     }
 
+    if(cpu_alloc_breakpoints(cpu) < 0)
+        return -1;
+
+    cpu->breakpoints[pc >> 1] = 1;
     return 0;
 }
+
+void cpu_clear_breakpoint(CPU *cpu, uint32_t pc)
+{
+    if(!cpu || !cpu->breakpoints || (pc >> 1) >= cpu->breakpoint_slots)
+        return;
+
+    cpu->breakpoints[pc >> 1] = 0;
+}
+
+void cpu_free_breakpoints(CPU *cpu)
+{
+    if(!cpu)
+        return;
+
+    free(cpu->breakpoints);
+    cpu->breakpoints = NULL;
+    cpu->breakpoint_slots = 0;
+
+    // without the flags cpu_run would no longer look at watchpoints
+    while(cpu->memory && cpu->memory->watch_count > 0)
+    {
+        const MemoryWatch *w = &cpu->memory->watches[0];
+        memory_unwatch(cpu->memory, w->addr, w->len, w->kind);
+    }
+}
+
+int cpu_set_watchpoint(CPU *cpu, uint32_t addr, uint32_t len, int kind)
+{
+    if(!cpu || !cpu->program || !cpu->memory)
+        return -1;
+
+    if(cpu_alloc_breakpoints(cpu) < 0)
+        return -1;
+    return memory_watch(cpu->memory, addr, len, kind);
+}
+
+void cpu_clear_watchpoint(CPU *cpu, uint32_t addr, uint32_t len, int kind)
+{
+    if(!cpu || !cpu->memory)
+        return;
+
+    memory_unwatch(cpu->memory, addr, len, kind);
+}
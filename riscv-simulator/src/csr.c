@@ -0,0 +1,82 @@
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <time.h>
+
+#include "csr.h"
+
+static const struct
+{
+    const char *name;
+    uint32_t csr;
+} csr_names[] = {
+    { "cycle",    CSR_CYCLE },
+    { "time",     CSR_TIME },
+    { "instret",  CSR_INSTRET },
+    { "cycleh",   CSR_CYCLEH },
+    { "timeh",    CSR_TIMEH },
+    { "instreth", CSR_INSTRETH },
+    { "mhartid",  CSR_MHARTID },
+};
+
+int csr_lookup(const char *name)
+{
+    for(size_t i = 0; i < sizeof(csr_names) / sizeof(csr_names[0]); ++i)
+    {
+        if(strcmp(name, csr_names[i].name) == 0)
+            return (int)csr_names[i].csr;
+    }
+    return -1;
+}
+
+const char *csr_name(uint32_t csr)
+{
+    for(size_t i = 0; i < sizeof(csr_names) / sizeof(csr_names[0]); ++i)
+    {
+        if(csr_names[i].csr == csr)
+            return csr_names[i].name;
+    }
+    return "UNKNOWN";
+}
+
+const char *csr_op_name(uint32_t funct3)
+{
+    static const char *const names[8] = {
+        NULL, "CSRRW", "CSRRS", "CSRRC", NULL, "CSRRWI", "CSRRSI", "CSRRCI"
+    };
+    return names[funct3 & 0x7];
+}
+
+static uint64_t csr_time_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+int csr_read(const CPU *cpu, uint32_t csr, uint32_t *value)
+{
+    switch(csr)
+    {
+        // instructions_executed is 32 bits wide, so the high halves stay 0
+        case CSR_CYCLE:
+        case CSR_INSTRET:
+            *value = cpu->instructions_executed;
+            return 0;
+        case CSR_CYCLEH:
+        case CSR_INSTRETH:
+            *value = 0;
+            return 0;
+        case CSR_TIME:
+            *value = (uint32_t)csr_time_us();
+            return 0;
+        case CSR_TIMEH:
+            *value = (uint32_t)(csr_time_us() >> 32);
+            return 0;
+        case CSR_MHARTID:
+            *value = cpu->hart_id;
+            return 0;
+        default:
+            return -1;
+    }
+}
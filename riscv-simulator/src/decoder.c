@@ -5,6 +5,7 @@
 
 #include "alu.h"
 #include "decoder.h"
+#include "log.h"
 
 typedef struct 
 {
@@ -84,6 +85,25 @@ int reg_index(const char *name)
     return -1;
 }
 
+int vreg_index(const char *name)
+{
+    if(!name)
+        return -1;
+
+    char tmp[64];
+    strncpy(tmp, name, sizeof(tmp) - 1);
+    tmp[sizeof(tmp) - 1] = '\0';
+    trim_inplace(tmp);
+    if((tmp[0] != 'v' && tmp[0] != 'V') || tmp[1] == '\0')
+        return -1;
+
+    char *endp = NULL;
+    long v = strtol(tmp + 1, &endp, 10);
+    if(*endp != '\0' || v < 0 || v > 31)
+        return -1;
+    return (int)v;
+}
+
 int32_t parse_immediate(const char *str)
 {
     if(!str || strlen(str) == 0)
@@ -105,7 +125,7 @@ int parse_memory_operand(const char *operand, int32_t *out_offset, int *out_reg)
     char *paren = strchr(operand, '(');
     if(!paren)
     {
-        printf("[ERROR] Invalid memory operand format (expected 'offset(register)'): %s\n", operand);
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] Invalid memory operand format (expected 'offset(register)'): %s\n", operand);
         return -1;
     }
 
@@ -117,7 +137,7 @@ int parse_memory_operand(const char *operand, int32_t *out_offset, int *out_reg)
     char *close_paren = strchr(paren, ')');
     if(!close_paren)
     {
-        printf("[ERROR] Missing closing parenthesis in memory operand: %s\n", operand);
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] Missing closing parenthesis in memory operand: %s\n", operand);
         return -1;
     }
 
@@ -128,7 +148,7 @@ int parse_memory_operand(const char *operand, int32_t *out_offset, int *out_reg)
     *out_reg = reg_index(reg_str);
     if(*out_reg < 0)
     {
-        printf("[ERROR] Invalid register in memory operand: %s\n", reg_str);
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] Invalid register in memory operand: %s\n", reg_str);
         return -1;
     }
 
@@ -4,9 +4,14 @@
 #include <stdlib.h>
 
 #include "assembler.h"
+#include "csr.h"
 #include "decoder.h"
 #include "encoder.h"
 #include "instruction.h"
+#include "log.h"
+#include "rvc.h"
+
+#define ENCODE_TRACE(trace, ...) do { if(trace) LOG_TRACE(LOG_CAT_ENCODER, __VA_ARGS__); } while(0)
 
 static uint32_t build_rtype(uint32_t funct7, uint32_t rs2, uint32_t rs1, uint32_t funct3, uint32_t rd, uint32_t opcode)
 {
@@ -123,7 +128,7 @@ static int32_t parse_branch_imm_or_label(AssemblyProgram *program, Instruction *
         uint32_t target;
         if(find_symbol(program, token, &target) < 0)
         {
-            printf("[ERROR] encode_branch: unknown label '%s' (line %d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_branch: unknown label '%s' (line %d)\n",
                    token, instr->line_number);
             return 0;
         }
@@ -140,106 +145,680 @@ static int32_t parse_branch_imm_or_label(AssemblyProgram *program, Instruction *
         return (int32_t)val;
     }
 
-    printf("[ERROR] encode_branch: invalid immediate/label '%s' (line %d)\n",
+    LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_branch: invalid immediate/label '%s' (line %d)\n",
            token, instr->line_number);
     return 0;
 }
 
-uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
+// RV32M: funct3 of each mnemonic, all with funct7 0x01
+static const struct
 {
-    if(!program)
+    const char *name;
+    const char *trace_name;
+    uint32_t funct3;
+} muldiv_opcodes[] = {
+    { "mul",    "MUL",    0x0 },
+    { "mulh",   "MULH",   0x1 },
+    { "mulhsu", "MULHSU", 0x2 },
+    { "mulhu",  "MULHU",  0x3 },
+    { "div",    "DIV",    0x4 },
+    { "divu",   "DIVU",   0x5 },
+    { "rem",    "REM",    0x6 },
+    { "remu",   "REMU",   0x7 },
+};
+
+// returns the index into muldiv_opcodes, or -1
+static int find_muldiv_opcode(const char *opcode)
+{
+    for(size_t i = 0; i < sizeof(muldiv_opcodes) / sizeof(muldiv_opcodes[0]); ++i)
+    {
+        if(strcmp(opcode, muldiv_opcodes[i].name) == 0)
+            return (int)i;
+    }
+    return -1;
+}
+
+// <op> rd, rs1, rs2
+static uint32_t encode_muldiv(Instruction *instr, int index, int trace)
+{
+    if(instr->operand_count < 3)
     {
-        printf("[ERROR] encode_instruction: program is NULL\n");
+        LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: not enough operands for '%s' (line %d)\n",
+               instr->opcode, instr->line_number);
         return 0;
     }
-    if(!instr)
+
+    int rd = reg_index(instr->operands[0]);
+    int rs1 = reg_index(instr->operands[1]);
+    int rs2 = reg_index(instr->operands[2]);
+
+    if(rd < 0 || rs1 < 0 || rs2 < 0)
     {
-        printf("[ERROR] encode_instruction: instr is NULL\n");
+        LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: invalid registers for '%s' (line %d)\n",
+               instr->opcode, instr->line_number);
         return 0;
     }
-    
-    EncodedInstruction enc = {0};
 
-    if(strcmp(instr->opcode, "add") == 0 || strcmp(instr->opcode, "sub") == 0)
+    uint32_t encoded = build_rtype(0x01, rs2, rs1, muldiv_opcodes[index].funct3, rd, 0x33);
+    ENCODE_TRACE(trace, "[ENCODE] %s x%d, x%d, x%d -> 0x%08X\n",
+           muldiv_opcodes[index].trace_name, rd, rs1, rs2, encoded);
+    return encoded;
+}
+
+// Zbb: the register forms use OP (0x33); the unary forms and RORI use OP-IMM
+// (0x13) with the function code in the immediate, encoded here as its
+// funct7 and rs2 fields
+typedef enum
+{
+    ZBB_FORM_REG,           // rd, rs1, rs2
+    ZBB_FORM_UNARY,         // rd, rs1
+    ZBB_FORM_SHAMT          // rd, rs1, shamt
+} ZbbForm;
+
+static const struct
+{
+    const char *name;
+    const char *trace_name;
+    ZbbForm form;
+    uint32_t opcode;
+    uint32_t funct7;
+    uint32_t funct3;
+    uint32_t rs2;
+} zbb_opcodes[] = {
+    { "andn",   "ANDN",   ZBB_FORM_REG,   0x33, 0x20, 0x7, 0x00 },
+    { "orn",    "ORN",    ZBB_FORM_REG,   0x33, 0x20, 0x6, 0x00 },
+    { "xnor",   "XNOR",   ZBB_FORM_REG,   0x33, 0x20, 0x4, 0x00 },
+    { "min",    "MIN",    ZBB_FORM_REG,   0x33, 0x05, 0x4, 0x00 },
+    { "minu",   "MINU",   ZBB_FORM_REG,   0x33, 0x05, 0x5, 0x00 },
+    { "max",    "MAX",    ZBB_FORM_REG,   0x33, 0x05, 0x6, 0x00 },
+    { "maxu",   "MAXU",   ZBB_FORM_REG,   0x33, 0x05, 0x7, 0x00 },
+    { "rol",    "ROL",    ZBB_FORM_REG,   0x33, 0x30, 0x1, 0x00 },
+    { "ror",    "ROR",    ZBB_FORM_REG,   0x33, 0x30, 0x5, 0x00 },
+    { "zext.h", "ZEXT.H", ZBB_FORM_UNARY, 0x33, 0x04, 0x4, 0x00 },
+    { "clz",    "CLZ",    ZBB_FORM_UNARY, 0x13, 0x30, 0x1, 0x00 },
+    { "ctz",    "CTZ",    ZBB_FORM_UNARY, 0x13, 0x30, 0x1, 0x01 },
+    { "cpop",   "CPOP",   ZBB_FORM_UNARY, 0x13, 0x30, 0x1, 0x02 },
+    { "sext.b", "SEXT.B", ZBB_FORM_UNARY, 0x13, 0x30, 0x1, 0x04 },
+    { "sext.h", "SEXT.H", ZBB_FORM_UNARY, 0x13, 0x30, 0x1, 0x05 },
+    { "rev8",   "REV8",   ZBB_FORM_UNARY, 0x13, 0x34, 0x5, 0x18 },
+    { "orc.b",  "ORC.B",  ZBB_FORM_UNARY, 0x13, 0x14, 0x5, 0x07 },
+    { "rori",   "RORI",   ZBB_FORM_SHAMT, 0x13, 0x30, 0x5, 0x00 },
+};
+
+// returns the index into zbb_opcodes, or -1
+static int find_zbb_opcode(const char *opcode)
+{
+    for(size_t i = 0; i < sizeof(zbb_opcodes) / sizeof(zbb_opcodes[0]); ++i)
     {
-        if(instr->operand_count < 3)
+        if(strcmp(opcode, zbb_opcodes[i].name) == 0)
+            return (int)i;
+    }
+    return -1;
+}
+
+static uint32_t encode_zbb(Instruction *instr, int index, int trace)
+{
+    ZbbForm form = zbb_opcodes[index].form;
+    int needed = (form == ZBB_FORM_UNARY) ? 2 : 3;
+    if(instr->operand_count < needed)
+    {
+        LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: not enough operands for '%s' (line %d)\n",
+               instr->opcode, instr->line_number);
+        return 0;
+    }
+
+    int rd = reg_index(instr->operands[0]);
+    int rs1 = reg_index(instr->operands[1]);
+    if(rd < 0 || rs1 < 0)
+    {
+        LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: invalid registers for '%s' (line %d)\n",
+               instr->opcode, instr->line_number);
+        return 0;
+    }
+
+    uint32_t rs2 = zbb_opcodes[index].rs2;
+    if(form == ZBB_FORM_REG)
+    {
+        int reg = reg_index(instr->operands[2]);
+        if(reg < 0)
         {
-            printf("[ERROR] encode_instruction: not enough operands for '%s' (line %d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: invalid registers for '%s' (line %d)\n",
                    instr->opcode, instr->line_number);
             return 0;
         }
+        rs2 = (uint32_t)reg;
+    }
+    else if(form == ZBB_FORM_SHAMT)
+    {
+        int32_t shamt = parse_immediate(instr->operands[2]);
+        if(shamt < 0 || shamt > 31)
+        {
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: shift amount out of range for '%s' (line %d, shamt=%d)\n",
+                   instr->opcode, instr->line_number, shamt);
+            return 0;
+        }
+        rs2 = (uint32_t)shamt;
+    }
 
-        int rd = reg_index(instr->operands[0]);
-        int rs1 = reg_index(instr->operands[1]);
-        int rs2 = reg_index(instr->operands[2]);
+    uint32_t encoded = build_rtype(zbb_opcodes[index].funct7, rs2, (uint32_t)rs1, zbb_opcodes[index].funct3,
+                                   (uint32_t)rd, zbb_opcodes[index].opcode);
+    const char *name = zbb_opcodes[index].trace_name;
+    if(form == ZBB_FORM_REG)
+        ENCODE_TRACE(trace, "[ENCODE] %s x%d, x%d, x%u -> 0x%08X\n", name, rd, rs1, rs2, encoded);
+    else if(form == ZBB_FORM_SHAMT)
+        ENCODE_TRACE(trace, "[ENCODE] %s x%d, x%d, %u -> 0x%08X\n", name, rd, rs1, rs2, encoded);
+    else
+        ENCODE_TRACE(trace, "[ENCODE] %s x%d, x%d -> 0x%08X\n", name, rd, rs1, encoded);
+    return encoded;
+}
 
-        if(rd < 0 || rs1 < 0 || rs2 < 0)
-        {
-            printf("[ERROR] encode_instruction: invalid registers for '%s' (line %d)\n",
+// RV32A: funct5 of each mnemonic; the aq/rl bits come from an optional
+// .aq, .rl or .aqrl suffix
+static const struct
+{
+    const char *name;
+    uint32_t funct5;
+} amo_opcodes[] = {
+    { "lr.w",      0x02 },
+    { "sc.w",      0x03 },
+    { "amoswap.w", 0x01 },
+    { "amoadd.w",  0x00 },
+    { "amoxor.w",  0x04 },
+    { "amoand.w",  0x0C },
+    { "amoor.w",   0x08 },
+    { "amomin.w",  0x10 },
+    { "amomax.w",  0x14 },
+    { "amominu.w", 0x18 },
+    { "amomaxu.w", 0x1C },
+};
+
+// returns the index into amo_opcodes, or -1; *ordering gets the aq/rl bits
+static int find_amo_opcode(const char *opcode, uint32_t *ordering)
+{
+    for(size_t i = 0; i < sizeof(amo_opcodes) / sizeof(amo_opcodes[0]); ++i)
+    {
+        size_t len = strlen(amo_opcodes[i].name);
+        if(strncmp(opcode, amo_opcodes[i].name, len) != 0)
+            continue;
+
+        const char *suffix = opcode + len;
+        if(suffix[0] == '\0')               *ordering = 0x0;
+        else if(strcmp(suffix, ".aq") == 0)   *ordering = 0x2;
+        else if(strcmp(suffix, ".rl") == 0)   *ordering = 0x1;
+        else if(strcmp(suffix, ".aqrl") == 0) *ordering = 0x3;
+        else continue;
+        return (int)i;
+    }
+    return -1;
+}
+
+// lr.w rd, (rs1) / sc.w rd, rs2, (rs1) / amo<op>.w rd, rs2, (rs1)
+static uint32_t encode_amo(Instruction *instr, int index, uint32_t ordering, int trace)
+{
+    uint32_t funct5 = amo_opcodes[index].funct5;
+    int is_lr = (funct5 == 0x02);
+    int needed = is_lr ? 2 : 3;
+    if(instr->operand_count < needed)
+    {
+        LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: not enough operands for '%s' (line %d)\n",
                instr->opcode, instr->line_number);
-            printf("  rd=%d, rs1=%d, rs2=%d\n", rd, rs1, rs2);
-            printf("  operands: '%s', '%s', '%s'\n", 
-                instr->operands[0], instr->operands[1], instr->operands[2]);
+        return 0;
+    }
+
+    int rd = reg_index(instr->operands[0]);
+    int rs2 = is_lr ? 0 : reg_index(instr->operands[1]);
+    int32_t offset;
+    int rs1;
+    if(rd < 0 || rs2 < 0 || parse_memory_operand(instr->operands[needed - 1], &offset, &rs1) < 0)
+    {
+        LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: invalid operands for '%s' (line %d)\n",
+               instr->opcode, instr->line_number);
+        return 0;
+    }
+    if(offset != 0)
+    {
+        LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: '%s' takes no offset, use (rs1) (line %d, off=%d)\n",
+               instr->opcode, instr->line_number, offset);
+        return 0;
+    }
+
+    uint32_t encoded = build_rtype((funct5 << 2) | ordering, (uint32_t)rs2, (uint32_t)rs1, 0x2, (uint32_t)rd, 0x2F);
+    ENCODE_TRACE(trace, "[ENCODE] %s x%d, x%d, (x%d) -> 0x%08X\n", instr->opcode, rd, rs2, rs1, encoded);
+    return encoded;
+}
+
+// RVV subset: OP-V (0x57) arithmetic with vm = 1 (unmasked), operands in
+// assembler order vd, vs2, vs1/rs1/imm
+typedef enum
+{
+    VEC_FORM_VV,            // vd, vs2, vs1
+    VEC_FORM_VX,            // vd, vs2, rs1
+    VEC_FORM_VI             // vd, vs2, simm5
+} VecForm;
+
+static const struct
+{
+    const char *name;
+    const char *trace_name;
+    VecForm form;
+    uint32_t funct6;
+    uint32_t funct3;
+} vector_opcodes[] = {
+    { "vadd.vv",    "VADD.VV",    VEC_FORM_VV, 0x00, 0x0 },
+    { "vadd.vx",    "VADD.VX",    VEC_FORM_VX, 0x00, 0x4 },
+    { "vadd.vi",    "VADD.VI",    VEC_FORM_VI, 0x00, 0x3 },
+    { "vsub.vv",    "VSUB.VV",    VEC_FORM_VV, 0x02, 0x0 },
+    { "vsub.vx",    "VSUB.VX",    VEC_FORM_VX, 0x02, 0x4 },
+    { "vmul.vv",    "VMUL.VV",    VEC_FORM_VV, 0x25, 0x2 },
+    { "vmul.vx",    "VMUL.VX",    VEC_FORM_VX, 0x25, 0x6 },
+    { "vand.vv",    "VAND.VV",    VEC_FORM_VV, 0x09, 0x0 },
+    { "vand.vx",    "VAND.VX",    VEC_FORM_VX, 0x09, 0x4 },
+    { "vand.vi",    "VAND.VI",    VEC_FORM_VI, 0x09, 0x3 },
+    { "vor.vv",     "VOR.VV",     VEC_FORM_VV, 0x0A, 0x0 },
+    { "vor.vx",     "VOR.VX",     VEC_FORM_VX, 0x0A, 0x4 },
+    { "vor.vi",     "VOR.VI",     VEC_FORM_VI, 0x0A, 0x3 },
+    { "vxor.vv",    "VXOR.VV",    VEC_FORM_VV, 0x0B, 0x0 },
+    { "vxor.vx",    "VXOR.VX",    VEC_FORM_VX, 0x0B, 0x4 },
+    { "vxor.vi",    "VXOR.VI",    VEC_FORM_VI, 0x0B, 0x3 },
+    { "vredsum.vs", "VREDSUM.VS", VEC_FORM_VV, 0x00, 0x2 },
+};
+
+// returns the index into vector_opcodes, or -1
+static int find_vector_opcode(const char *opcode)
+{
+    for(size_t i = 0; i < sizeof(vector_opcodes) / sizeof(vector_opcodes[0]); ++i)
+    {
+        if(strcmp(opcode, vector_opcodes[i].name) == 0)
+            return (int)i;
+    }
+    return -1;
+}
+
+// a trailing v0.t asks for masking, which the simulator does not implement
+static int vector_operand_count_ok(Instruction *instr, int needed)
+{
+    if(instr->operand_count > needed)
+    {
+        LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: '%s' takes %d operands%s (line %d)\n",
+               instr->opcode, needed,
+               strcmp(instr->operands[instr->operand_count - 1], "v0.t") == 0 ? ", masking is not supported" : "",
+               instr->line_number);
+        return 0;
+    }
+    if(instr->operand_count < needed)
+    {
+        LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: not enough operands for '%s' (line %d)\n",
+               instr->opcode, instr->line_number);
+        return 0;
+    }
+    return 1;
+}
+
+static uint32_t encode_vector(Instruction *instr, int index, int trace)
+{
+    if(!vector_operand_count_ok(instr, 3))
+        return 0;
+
+    VecForm form = vector_opcodes[index].form;
+    int vd = vreg_index(instr->operands[0]);
+    int vs2 = vreg_index(instr->operands[1]);
+    int src = 0;
+    if(form == VEC_FORM_VV)
+        src = vreg_index(instr->operands[2]);
+    else if(form == VEC_FORM_VX)
+        src = reg_index(instr->operands[2]);
+
+    if(vd < 0 || vs2 < 0 || src < 0)
+    {
+        LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: invalid registers for '%s' (line %d)\n",
+               instr->opcode, instr->line_number);
+        return 0;
+    }
+
+    if(form == VEC_FORM_VI)
+    {
+        src = parse_immediate(instr->operands[2]);
+        if(src < -16 || src > 15)
+        {
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: immediate out of 5-bit range for '%s' (line %d, imm=%d)\n",
+                   instr->opcode, instr->line_number, src);
             return 0;
         }
+    }
 
-        uint8_t funct7, funct3, opcode;
-        const char *op_name;
+    uint32_t encoded = build_rtype((vector_opcodes[index].funct6 << 1) | 0x1, (uint32_t)vs2, (uint32_t)src & 0x1F,
+                                   vector_opcodes[index].funct3, (uint32_t)vd, 0x57);
+    const char *name = vector_opcodes[index].trace_name;
+    if(form == VEC_FORM_VV)
+        ENCODE_TRACE(trace, "[ENCODE] %s v%d, v%d, v%d -> 0x%08X\n", name, vd, vs2, src, encoded);
+    else if(form == VEC_FORM_VX)
+        ENCODE_TRACE(trace, "[ENCODE] %s v%d, v%d, x%d -> 0x%08X\n", name, vd, vs2, src, encoded);
+    else
+        ENCODE_TRACE(trace, "[ENCODE] %s v%d, v%d, %d -> 0x%08X\n", name, vd, vs2, src, encoded);
+    return encoded;
+}
 
-        funct3 = 0x00; 
-        opcode = 0x33;
+// vsetvli rd, rs1, e8|e16|e32|e64[, m1|m2|m4|m8|mf2|mf4|mf8][, ta|tu][, ma|mu]
+static uint32_t encode_vsetvli(Instruction *instr, int trace)
+{
+    if(instr->operand_count < 3)
+    {
+        LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: not enough operands for 'vsetvli' (line %d)\n",
+               instr->line_number);
+        return 0;
+    }
 
-        if(strcmp(instr->opcode, "add") == 0)
+    int rd = reg_index(instr->operands[0]);
+    int rs1 = reg_index(instr->operands[1]);
+    if(rd < 0 || rs1 < 0)
+    {
+        LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: invalid registers for 'vsetvli' (line %d)\n",
+               instr->line_number);
+        return 0;
+    }
+
+    static const struct
+    {
+        const char *name;
+        uint32_t mask;
+        uint32_t bits;
+    } fields[] = {
+        { "e8",  0x38, 0x00 }, { "e16", 0x38, 0x08 }, { "e32", 0x38, 0x10 }, { "e64", 0x38, 0x18 },
+        { "m1",  0x07, 0x00 }, { "m2",  0x07, 0x01 }, { "m4",  0x07, 0x02 }, { "m8",  0x07, 0x03 },
+        { "mf8", 0x07, 0x05 }, { "mf4", 0x07, 0x06 }, { "mf2", 0x07, 0x07 },
+        { "tu",  0x40, 0x00 }, { "ta",  0x40, 0x40 }, { "mu",  0x80, 0x00 }, { "ma",  0x80, 0x80 },
+    };
+
+    uint32_t vtype = 0;
+    uint32_t seen = 0;
+    for(int i = 2; i < instr->operand_count; ++i)
+    {
+        size_t f = 0;
+        while(f < sizeof(fields) / sizeof(fields[0]) && strcmp(instr->operands[i], fields[f].name) != 0)
+            ++f;
+        if(f == sizeof(fields) / sizeof(fields[0]) || (seen & fields[f].mask))
         {
-            funct7 = 0X00;
-            op_name = "ADD";
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: invalid or repeated vtype field '%s' for 'vsetvli' (line %d)\n",
+                   instr->operands[i], instr->line_number);
+            return 0;
         }
-        else if(strcmp(instr->opcode, "sub") == 0)
+        seen |= fields[f].mask;
+        vtype |= fields[f].bits;
+    }
+    if(!(seen & 0x38))
+    {
+        LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: 'vsetvli' needs an element width (e8-e64) (line %d)\n",
+               instr->line_number);
+        return 0;
+    }
+
+    uint32_t encoded = build_itype(vtype, (uint32_t)rs1, 0x7, (uint32_t)rd, 0x57);
+    ENCODE_TRACE(trace, "[ENCODE] VSETVLI x%d, x%d, vtype=0x%03X -> 0x%08X\n", rd, rs1, vtype, encoded);
+    return encoded;
+}
+
+// vle32.v / vse32.v vd, (rs1): unit-stride, nf = mew = mop = 0, vm = 1
+static uint32_t encode_vmem(Instruction *instr, int store, int trace)
+{
+    if(!vector_operand_count_ok(instr, 2))
+        return 0;
+
+    int vd = vreg_index(instr->operands[0]);
+    int32_t offset;
+    int rs1;
+    if(vd < 0 || parse_memory_operand(instr->operands[1], &offset, &rs1) < 0)
+    {
+        LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: invalid operands for '%s' (line %d)\n",
+               instr->opcode, instr->line_number);
+        return 0;
+    }
+    if(offset != 0)
+    {
+        LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: '%s' takes no offset, use (rs1) (line %d, off=%d)\n",
+               instr->opcode, instr->line_number, offset);
+        return 0;
+    }
+
+    uint32_t encoded = build_rtype(0x01, 0, (uint32_t)rs1, 0x6, (uint32_t)vd, store ? 0x27 : 0x07);
+    ENCODE_TRACE(trace, "[ENCODE] %s v%d, (x%d) -> 0x%08X\n", store ? "VSE32.V" : "VLE32.V", vd, rs1, encoded);
+    return encoded;
+}
+
+// Zicsr: funct3 of each mnemonic; the immediate forms take a 5-bit
+// unsigned value in the rs1 field
+static const struct
+{
+    const char *name;
+    const char *trace_name;
+    uint32_t funct3;
+} csr_opcodes[] = {
+    { "csrrw",  "CSRRW",  0x1 },
+    { "csrrs",  "CSRRS",  0x2 },
+    { "csrrc",  "CSRRC",  0x3 },
+    { "csrrwi", "CSRRWI", 0x5 },
+    { "csrrsi", "CSRRSI", 0x6 },
+    { "csrrci", "CSRRCI", 0x7 },
+};
+
+// returns the index into csr_opcodes, or -1
+static int find_csr_opcode(const char *opcode)
+{
+    for(size_t i = 0; i < sizeof(csr_opcodes) / sizeof(csr_opcodes[0]); ++i)
+    {
+        if(strcmp(opcode, csr_opcodes[i].name) == 0)
+            return (int)i;
+    }
+    return -1;
+}
+
+// a CSR operand is its name (csr.h) or its 12-bit number
+static int parse_csr(const char *token)
+{
+    int csr = csr_lookup(token);
+    if(csr >= 0)
+        return csr;
+
+    char *endp = NULL;
+    long val = strtol(token, &endp, 0);
+    if(endp == token || *endp != '\0' || val < 0 || val > 0xFFF)
+        return -1;
+    return (int)val;
+}
+
+// <op> rd, csr, rs1 / <op>i rd, csr, uimm5
+static uint32_t encode_csr(Instruction *instr, int index, int trace)
+{
+    if(instr->operand_count < 3)
+    {
+        LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: not enough operands for '%s' (line %d)\n",
+               instr->opcode, instr->line_number);
+        return 0;
+    }
+
+    int rd = reg_index(instr->operands[0]);
+    int csr = parse_csr(instr->operands[1]);
+    if(rd < 0 || csr < 0)
+    {
+        LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: invalid register or CSR for '%s' (line %d)\n",
+               instr->opcode, instr->line_number);
+        return 0;
+    }
+
+    uint32_t funct3 = csr_opcodes[index].funct3;
+    int src;
+    if(funct3 & 0x4)
+    {
+        src = parse_immediate(instr->operands[2]);
+        if(src < 0 || src > 31)
         {
-            funct7 = 0x20;
-            op_name = "SUB";
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: immediate out of 5-bit unsigned range for '%s' (line %d, imm=%d)\n",
+                   instr->opcode, instr->line_number, src);
+            return 0;
         }
-
-        uint32_t encoded = build_rtype(funct7, rs2, rs1, funct3, rd, opcode);
-        printf("[ENCODE] %s x%d, x%d, x%d -> 0x%08X\n",
-               op_name, rd, rs1, rs2, encoded);
-        return encoded;
     }
-    else if(strcmp(instr->opcode, "mul") == 0)
+    else
     {
-        if(instr->operand_count < 3)
+        src = reg_index(instr->operands[2]);
+        if(src < 0)
         {
-            printf("[ERROR] encode_instruction: not enough operands for 'mul' (line %d)\n",
-                   instr->line_number);
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: invalid registers for '%s' (line %d)\n",
+                   instr->opcode, instr->line_number);
             return 0;
         }
+    }
 
-        int rd = reg_index(instr->operands[0]);
-        int rs1 = reg_index(instr->operands[1]);
-        int rs2 = reg_index(instr->operands[2]);
+    uint32_t encoded = build_itype((uint32_t)csr, (uint32_t)src, funct3, (uint32_t)rd, 0x73);
+    if(funct3 & 0x4)
+        ENCODE_TRACE(trace, "[ENCODE] %s x%d, 0x%03X, %d -> 0x%08X\n",
+               csr_opcodes[index].trace_name, rd, csr, src, encoded);
+    else
+        ENCODE_TRACE(trace, "[ENCODE] %s x%d, 0x%03X, x%d -> 0x%08X\n",
+               csr_opcodes[index].trace_name, rd, csr, src, encoded);
+    return encoded;
+}
 
-        if(rd < 0 || rs1 < 0 || rs2 < 0)
+uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
+{
+    return encode_instruction_traced(program, instr, 1);
+}
+
+// a mnemonic that stands for a base instruction; an operand "%N" is operand
+// N of the mnemonic, anything else is used as written
+typedef struct
+{
+    const char *name;
+    const char *base;
+    int operand_count;
+    const char *operands[3];
+} MnemonicAlias;
+
+static const MnemonicAlias rvc_mnemonics[] = {
+    { "c.nop",      "addi", 0, { "x0", "x0", "0" } },
+    { "c.addi",     "addi", 2, { "%0", "%0", "%1" } },
+    { "c.li",       "addi", 2, { "%0", "x0", "%1" } },
+    { "c.addi16sp", "addi", 1, { "sp", "sp", "%0" } },
+    { "c.addi4spn", "addi", 2, { "%0", "sp", "%1" } },
+    { "c.lui",      "lui",  2, { "%0", "%1" } },
+    { "c.mv",       "add",  2, { "%0", "x0", "%1" } },
+    { "c.add",      "add",  2, { "%0", "%0", "%1" } },
+    { "c.sub",      "sub",  2, { "%0", "%0", "%1" } },
+    { "c.xor",      "xor",  2, { "%0", "%0", "%1" } },
+    { "c.or",       "or",   2, { "%0", "%0", "%1" } },
+    { "c.and",      "and",  2, { "%0", "%0", "%1" } },
+    { "c.lw",       "lw",   2, { "%0", "%1" } },
+    { "c.sw",       "sw",   2, { "%0", "%1" } },
+    { "c.lwsp",     "lw",   2, { "%0", "%1" } },
+    { "c.swsp",     "sw",   2, { "%0", "%1" } },
+    { "c.j",        "jal",  1, { "x0", "%0" } },
+    { "c.jal",      "jal",  1, { "ra", "%0" } },
+    { "c.jr",       "jalr", 1, { "x0", "0(%0)" } },
+    { "c.jalr",     "jalr", 1, { "ra", "0(%0)" } },
+    { "c.beqz",     "beq",  2, { "%0", "x0", "%1" } },
+    { "c.bnez",     "bne",  2, { "%0", "x0", "%1" } },
+};
+
+// Zicsr pseudo-instructions
+static const MnemonicAlias csr_mnemonics[] = {
+    { "csrr",       "csrrs",  2, { "%0", "%1", "x0" } },
+    { "csrw",       "csrrw",  2, { "x0", "%0", "%1" } },
+    { "csrs",       "csrrs",  2, { "x0", "%0", "%1" } },
+    { "csrc",       "csrrc",  2, { "x0", "%0", "%1" } },
+    { "csrwi",      "csrrwi", 2, { "x0", "%0", "%1" } },
+    { "csrsi",      "csrrsi", 2, { "x0", "%0", "%1" } },
+    { "csrci",      "csrrci", 2, { "x0", "%0", "%1" } },
+    { "rdcycle",    "csrrs",  1, { "%0", "cycle", "x0" } },
+    { "rdcycleh",   "csrrs",  1, { "%0", "cycleh", "x0" } },
+    { "rdtime",     "csrrs",  1, { "%0", "time", "x0" } },
+    { "rdtimeh",    "csrrs",  1, { "%0", "timeh", "x0" } },
+    { "rdinstret",  "csrrs",  1, { "%0", "instret", "x0" } },
+    { "rdinstreth", "csrrs",  1, { "%0", "instreth", "x0" } },
+};
+
+// rewrites an instruction named in `aliases` into `base`; returns 0 if it
+// is not one, -1 on bad operands
+static int expand_mnemonic(const MnemonicAlias *aliases, size_t count, const Instruction *instr, Instruction *base)
+{
+    for(size_t i = 0; i < count; ++i)
+    {
+        if(strcmp(instr->opcode, aliases[i].name) != 0)
+            continue;
+
+        if(instr->operand_count != aliases[i].operand_count)
         {
-            printf("[ERROR] encode_instruction: invalid registers for 'mul' (line %d)\n",
-                   instr->line_number);
-            return 0;
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: '%s' takes %d operands (line %d)\n",
+                      instr->opcode, aliases[i].operand_count, instr->line_number);
+            return -1;
         }
 
-        uint8_t opcode = 0x33;
-        uint8_t funct3 = 0x00;
-        uint8_t funct7 = 0x01;
+        *base = *instr;
+        strncpy(base->opcode, aliases[i].base, MAX_OPCODE_SIZE - 1);
+        base->operand_count = 0;
+        for(int j = 0; j < 3 && aliases[i].operands[j]; ++j)
+        {
+            // "%N" in the template stands for operand N of the alias
+            const char *op = aliases[i].operands[j];
+            const char *arg = strchr(op, '%');
+            char *dst = base->operands[base->operand_count];
+            if(arg)
+                snprintf(dst, MAX_OPERAND_SIZE, "%.*s%s%s", (int)(arg - op), op,
+                         instr->operands[arg[1] - '0'], arg + 2);
+            else
+                snprintf(dst, MAX_OPERAND_SIZE, "%s", op);
+            base->operand_count++;
+        }
+        return 1;
+    }
+    return 0;
+}
 
-        uint32_t encoded = build_rtype(funct7, rs2, rs1, funct3, rd, opcode);
-        enc.value = encoded;
-        printf("[ENCODE] MUL x%d, x%d, x%d -> 0x%08X\n", rd, rs1, rs2, encoded);
-        return enc.value;
+static uint32_t encode_base(AssemblyProgram *program, Instruction *instr, int trace);
+
+uint32_t encode_instruction_traced(AssemblyProgram *program, Instruction *instr, int trace)
+{
+    if(!program)
+    {
+        LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: program is NULL\n");
+        return 0;
     }
-    else if(strcmp(instr->opcode, "div") == 0)
+    if(!instr)
+    {
+        LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: instr is NULL\n");
+        return 0;
+    }
+
+    Instruction base;
+    int alias = expand_mnemonic(rvc_mnemonics, sizeof(rvc_mnemonics) / sizeof(rvc_mnemonics[0]), instr, &base);
+    if(alias == 0)
+        alias = expand_mnemonic(csr_mnemonics, sizeof(csr_mnemonics) / sizeof(csr_mnemonics[0]), instr, &base);
+    if(alias < 0)
+        return 0;
+
+    uint32_t word = encode_base(program, alias ? &base : instr, trace);
+    if(word == 0 || instr->size != 2)
+        return word;
+
+    // laid out as a 16-bit instruction by the assembler
+    uint16_t half = rvc_compress(word);
+    if(half == 0)
+    {
+        LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: '%s' has no 16-bit encoding (line %d)\n",
+                  instr->opcode, instr->line_number);
+        return 0;
+    }
+    ENCODE_TRACE(trace, "[ENCODE] compressed -> 0x%04X\n", half);
+    return half;
+}
+
+static uint32_t encode_base(AssemblyProgram *program, Instruction *instr, int trace)
+{
+    EncodedInstruction enc = {0};
+
+    if(strcmp(instr->opcode, "add") == 0 || strcmp(instr->opcode, "sub") == 0)
     {
         if(instr->operand_count < 3)
         {
-            printf("[ERROR] encode_instruction: not enough operands for 'div' (line %d)\n",
-                   instr->line_number);
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: not enough operands for '%s' (line %d)\n",
+                   instr->opcode, instr->line_number);
             return 0;
         }
 
@@ -249,26 +828,42 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
 
         if(rd < 0 || rs1 < 0 || rs2 < 0)
         {
-            printf("[ERROR] encode_instruction: invalid registers for 'div' (line %d)\n",
-                   instr->line_number);
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: invalid registers for '%s' (line %d)\n",
+               instr->opcode, instr->line_number);
+            LOG_ERROR(LOG_CAT_ENCODER, "  rd=%d, rs1=%d, rs2=%d\n", rd, rs1, rs2);
+            LOG_ERROR(LOG_CAT_ENCODER, "  operands: '%s', '%s', '%s'\n", 
+                instr->operands[0], instr->operands[1], instr->operands[2]);
             return 0;
         }
 
-        uint8_t opcode = 0x33;
-        uint8_t funct3 = 0x04;
-        uint8_t funct7 = 0x01;
+        uint8_t funct7, funct3, opcode;
+        const char *op_name;
+
+        funct3 = 0x00; 
+        opcode = 0x33;
+
+        if(strcmp(instr->opcode, "add") == 0)
+        {
+            funct7 = 0X00;
+            op_name = "ADD";
+        }
+        else if(strcmp(instr->opcode, "sub") == 0)
+        {
+            funct7 = 0x20;
+            op_name = "SUB";
+        }
 
         uint32_t encoded = build_rtype(funct7, rs2, rs1, funct3, rd, opcode);
-        enc.value = encoded;
-        printf("[ENCODE] DIV x%d, x%d, x%d -> 0x%08X\n", rd, rs1, rs2, encoded);
-        return enc.value;
+        ENCODE_TRACE(trace, "[ENCODE] %s x%d, x%d, x%d -> 0x%08X\n",
+               op_name, rd, rs1, rs2, encoded);
+        return encoded;
     }
     else if(strcmp(instr->opcode, "sll") == 0 || strcmp(instr->opcode, "srl") == 0 || strcmp(instr->opcode, "sra") == 0 ||
         strcmp(instr->opcode, "and") == 0 || strcmp(instr->opcode, "or") == 0 || strcmp(instr->opcode, "xor") == 0)
     {
         if(instr->operand_count < 3)
         {
-            printf("[ERROR] encode_instruction: not enough operands for '%s' (line %d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: not enough operands for '%s' (line %d)\n",
                    instr->opcode, instr->line_number);
             return 0;
         }
@@ -279,10 +874,10 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
 
         if(rd < 0 || rs1 < 0 || rs2 < 0)
         {
-            printf("[ERROR] encode_instruction: invalid registers for '%s' (line %d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: invalid registers for '%s' (line %d)\n",
                instr->opcode, instr->line_number);
-            printf("  rd=%d, rs1=%d, rs2=%d\n", rd, rs1, rs2);
-            printf("  operands: '%s', '%s', '%s'\n", 
+            LOG_ERROR(LOG_CAT_ENCODER, "  rd=%d, rs1=%d, rs2=%d\n", rd, rs1, rs2);
+            LOG_ERROR(LOG_CAT_ENCODER, "  operands: '%s', '%s', '%s'\n", 
                 instr->operands[0], instr->operands[1], instr->operands[2]);
             return 0;
         }
@@ -321,7 +916,7 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
         }
 
         uint32_t encoded = build_rtype(funct7, rs2, rs1, funct3, rd, opcode);
-        printf("[ENCODE] %s x%d, x%d, x%d -> 0x%08X\n",
+        ENCODE_TRACE(trace, "[ENCODE] %s x%d, x%d, x%d -> 0x%08X\n",
                 instr->opcode, rd, rs1, rs2, encoded);
         return encoded;
     }
@@ -329,7 +924,7 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
     {
         if(instr->operand_count < 3)
         {
-            printf("[ERROR] encode_instruction: not enough operands for 'addi' (line %d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: not enough operands for 'addi' (line %d)\n",
                    instr->line_number);
             return 0;
         }
@@ -340,13 +935,13 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
 
         if(rd < 0 || rs1 < 0)
         {
-            printf("[ERROR] encode_instruction: invalid registers for 'addi' (line %d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: invalid registers for 'addi' (line %d)\n",
                    instr->line_number);
             return 0;
         }
         if(!fits_imm12(imm))
         {
-            printf("[ERROR] encode_instruction: immediate out of 12-bit range for 'addi' (line %d, imm=%d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: immediate out of 12-bit range for 'addi' (line %d, imm=%d)\n",
                    instr->line_number, imm);
             return 0;
         }
@@ -356,7 +951,7 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
 
         uint32_t encoded = build_itype((uint32_t)imm, (uint32_t)rs1, funct3, (uint32_t)rd, opcode);
         enc.value = encoded;
-        printf("[ENCODE] ADDI x%d, x%d, %d -> 0x%08X\n", 
+        ENCODE_TRACE(trace, "[ENCODE] ADDI x%d, x%d, %d -> 0x%08X\n", 
             rd, rs1, imm, encoded);
         return enc.value;
     }
@@ -364,7 +959,7 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
     {
         if(instr->operand_count < 2)
         {
-            printf("[ERROR] encode_instruction: not enough operands for 'li' (line %d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: not enough operands for 'li' (line %d)\n",
                    instr->line_number);
             return 0;
         }
@@ -374,13 +969,13 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
 
         if(rd < 0)
         {
-            printf("[ERROR] encode_instruction: invalid destination register for 'li' (line %d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: invalid destination register for 'li' (line %d)\n",
                    instr->line_number);
             return 0;
         }
         if(!fits_imm12(imm))
         {
-            printf("[ERROR] encode_instruction: 'li' immediate out of 12-bit range (line %d, imm=%d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: 'li' immediate out of 12-bit range (line %d, imm=%d)\n",
                    instr->line_number, imm);
             return 0;
         }
@@ -391,7 +986,7 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
 
         uint32_t encoded = build_itype((uint32_t)imm, (uint32_t)rs1, funct3, (uint32_t)rd, opcode);
         enc.value = encoded;
-        printf("[ENCODE] LI x%d, %d -> (ADDI x%d, x0, %d) -> 0x%08X\n",
+        ENCODE_TRACE(trace, "[ENCODE] LI x%d, %d -> (ADDI x%d, x0, %d) -> 0x%08X\n",
             rd, imm, rd, imm, encoded);
         return enc.value;
     }
@@ -399,7 +994,7 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
     {
         if(instr->operand_count < 2)
         {
-            printf("[ERROR] encode_instruction: not enough operands for 'lui' (line %d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: not enough operands for 'lui' (line %d)\n",
                    instr->line_number);
             return 0;
         }
@@ -409,19 +1004,19 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
 
         if(rd < 0)
         {
-            printf("[ERROR] encode_instruction: invalid destination register for 'lui' (line %d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: invalid destination register for 'lui' (line %d)\n",
                    instr->line_number);
             return 0;
         }
         if(!fits_imm20(imm))
         {
-            printf("[ERROR] encode_instruction: immediate out of 20-bit range for 'lui' (line %d, imm=%d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: immediate out of 20-bit range for 'lui' (line %d, imm=%d)\n",
                    instr->line_number, imm);
             return 0;
         }
 
         uint32_t encoded = build_utype((uint32_t)imm, (uint32_t)rd, 0x37);
-        printf("[ENCODE] LUI x%d, 0x%05X -> 0x%08X\n",
+        ENCODE_TRACE(trace, "[ENCODE] LUI x%d, 0x%05X -> 0x%08X\n",
                rd, (unsigned)((uint32_t)imm & 0xFFFFF), encoded);
         return encoded;
     }
@@ -429,7 +1024,7 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
     {
         if(instr->operand_count < 2)
         {
-            printf("[ERROR] encode_instruction: not enough operands for 'auipc' (line %d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: not enough operands for 'auipc' (line %d)\n",
                    instr->line_number);
             return 0;
         }
@@ -439,19 +1034,19 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
 
         if (rd < 0)
         {
-            printf("[ERROR] encode_instruction: invalid destination register for 'auipc' (line %d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: invalid destination register for 'auipc' (line %d)\n",
                    instr->line_number);
             return 0;
         }
         if (!fits_imm20(imm))
         {
-            printf("[ERROR] encode_instruction: immediate out of 20-bit range for 'auipc' (line %d, imm=%d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: immediate out of 20-bit range for 'auipc' (line %d, imm=%d)\n",
                    instr->line_number, imm);
             return 0;
         }
 
         uint32_t encoded = build_utype((uint32_t)imm, (uint32_t)rd, 0x17);
-        printf("[ENCODE] AUIPC x%d, 0x%05X -> 0x%08X\n",
+        ENCODE_TRACE(trace, "[ENCODE] AUIPC x%d, 0x%05X -> 0x%08X\n",
                rd, (unsigned)((uint32_t)imm & 0xFFFFF), encoded);
         return encoded;
     }
@@ -459,7 +1054,7 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
     {
         if(instr->operand_count < 2)
         {
-            printf("[ERROR] encode_instruction: not enough operands for 'lw' (line %d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: not enough operands for 'lw' (line %d)\n",
                    instr->line_number);
             return 0;
         }
@@ -467,7 +1062,7 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
         int rd = reg_index(instr->operands[0]);
         if(rd < 0)
         {
-            printf("[ERROR] Invalid destination register for lw: %s (line %d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] Invalid destination register for lw: %s (line %d)\n",
                    instr->operands[0], instr->line_number);
             return 0;
         }
@@ -476,7 +1071,7 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
         int rs1;
         if(parse_memory_operand(instr->operands[1], &offset, &rs1) < 0)
         {
-            printf("[ERROR] Failed to parse memory operand for lw (line %d)\n", instr->line_number);
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] Failed to parse memory operand for lw (line %d)\n", instr->line_number);
             return 0;
         }
 
@@ -484,7 +1079,7 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
         uint8_t opcode = 0x03; 
         
         uint32_t encoded = build_itype(offset & 0xFFF, rs1, funct3, rd, opcode);
-        printf("[ENCODE] LW x%d, %d(x%d) -> 0x%08X\n",
+        ENCODE_TRACE(trace, "[ENCODE] LW x%d, %d(x%d) -> 0x%08X\n",
                rd, offset, rs1, encoded);
         return encoded;
     }
@@ -492,7 +1087,7 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
     {
         if(instr->operand_count < 2)
         {
-            printf("[ERROR] encode_instruction: not enough operands for 'sw' (line %d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: not enough operands for 'sw' (line %d)\n",
                    instr->line_number);
             return 0;
         }
@@ -500,7 +1095,7 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
         int rs2 = reg_index(instr->operands[0]);
         if(rs2 < 0)
         {
-            printf("[ERROR] Invalid source register for sw: %s (line %d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] Invalid source register for sw: %s (line %d)\n",
                    instr->operands[0], instr->line_number);
             return 0;
         }
@@ -509,7 +1104,7 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
         int rs1;
         if(parse_memory_operand(instr->operands[1], &offset, &rs1) < 0)
         {
-            printf("[ERROR] Failed to parse memory operand for sw (line %d)\n", instr->line_number);
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] Failed to parse memory operand for sw (line %d)\n", instr->line_number);
             return 0;
         }
 
@@ -517,7 +1112,7 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
         uint8_t opcode = 0x23; 
 
         uint32_t encoded = build_stype(offset & 0xFFF, rs2, rs1, funct3, opcode);
-        printf("[ENCODE] SW x%d, %d(x%d) -> 0x%08X\n",
+        ENCODE_TRACE(trace, "[ENCODE] SW x%d, %d(x%d) -> 0x%08X\n",
                rs2, offset, rs1, encoded);
         return encoded;
     }
@@ -528,7 +1123,7 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
     {
         if(instr->operand_count < 3)
         {
-            printf("[ERROR] encode_instruction: not enough operands for '%s' (line %d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: not enough operands for '%s' (line %d)\n",
                    instr->opcode, instr->line_number);
             return 0;
         }
@@ -540,13 +1135,13 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
 
         if(rs1 < 0 || rs2 < 0 || !parse_ok)
         {
-            printf("[ERROR] encode_instruction: invalid operands for '%s' (line %d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: invalid operands for '%s' (line %d)\n",
                    instr->opcode, instr->line_number);
             return 0;
         }
         if(!fits_branch_offset(offset))
         {
-            printf("[ERROR] encode_instruction: branch offset out of range for '%s' (line %d, off=%d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: branch offset out of range for '%s' (line %d, off=%d)\n",
                    instr->opcode, instr->line_number, offset);
             return 0;
         }
@@ -570,7 +1165,7 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
         }
 
         uint32_t encoded = build_btype(offset, (uint32_t)rs1, (uint32_t)rs2, funct3);
-        printf("[ENCODE] %s x%d, x%d, %s -> off=%d (PC=0x%08X) -> 0x%08X\n",
+        ENCODE_TRACE(trace, "[ENCODE] %s x%d, x%d, %s -> off=%d (PC=0x%08X) -> 0x%08X\n",
             instr->opcode, rs1, rs2, instr->operands[2], offset, instr->address, encoded);
         return encoded;
     }
@@ -578,7 +1173,7 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
     {
         if(instr->operand_count < 1)
         {
-            printf("[ERROR] encode_instruction: not enough operands for 'jal' (line %d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: not enough operands for 'jal' (line %d)\n",
                    instr->line_number);
             return 0;
         }
@@ -598,7 +1193,7 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
 
         if(rd < 0)
         {
-            printf("[ERROR] encode_instruction: invalid destination register for 'jal' (line %d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: invalid destination register for 'jal' (line %d)\n",
                    instr->line_number);
             return 0;
         }
@@ -650,13 +1245,13 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
 
         if(!fits_imm21(offset))
         {
-            printf("[ERROR] encode_instruction: JAL immediate out of range (line %d, off=%d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: JAL immediate out of range (line %d, off=%d)\n",
                    instr->line_number, offset);
             return 0;
         }
 
         uint32_t encoded = build_jtype((uint32_t)offset, (uint32_t)rd, 0x6F);
-        printf("[ENCODE] JAL x%d, %s (off=%d) -> 0x%08X\n",
+        ENCODE_TRACE(trace, "[ENCODE] JAL x%d, %s (off=%d) -> 0x%08X\n",
                rd, target_token, offset, encoded);
         return encoded;
     }
@@ -664,7 +1259,7 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
     {
         if(instr->operand_count < 2)
         {
-            printf("[ERROR] encode_instruction: not enough operands for 'jalr' (line %d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: not enough operands for 'jalr' (line %d)\n",
                    instr->line_number);
             return 0;
         }
@@ -672,7 +1267,7 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
         int rd = reg_index(instr->operands[0]);
         if(rd < 0)
         {
-            printf("[ERROR] encode_instruction: invalid destination register for 'jalr' (line %d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: invalid destination register for 'jalr' (line %d)\n",
                    instr->line_number);
             return 0;
         }
@@ -693,25 +1288,57 @@ uint32_t encode_instruction(AssemblyProgram *program, Instruction *instr)
 
         if(rs1 < 0)
         {
-            printf("[ERROR] encode_instruction: invalid base register for 'jalr' (line %d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: invalid base register for 'jalr' (line %d)\n",
                    instr->line_number);
             return 0;
         }
 
         if(!fits_imm12(imm))
         {
-            printf("[ERROR] encode_instruction: jalr immediate out of 12-bit range (line %d, imm=%d)\n",
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] encode_instruction: jalr immediate out of 12-bit range (line %d, imm=%d)\n",
                    instr->line_number, imm);
             return 0;
         }
 
         uint8_t funct3 = 0x0;
         uint32_t encoded = build_itype((uint32_t)imm, (uint32_t)rs1, funct3, (uint32_t)rd, 0x67);
-        printf("[ENCODE] JALR x%d, %s -> rd=x%d, rs1=x%d, imm=%d -> 0x%08X\n",
+        ENCODE_TRACE(trace, "[ENCODE] JALR x%d, %s -> rd=x%d, rs1=x%d, imm=%d -> 0x%08X\n",
                rd, instr->operands[1], rd, rs1, imm, encoded);
         return encoded;
     }
 
-    printf("[WARN] unknown opcode: %s\n", instr->opcode);
+
+    int muldiv = find_muldiv_opcode(instr->opcode);
+    if(muldiv >= 0)
+        return encode_muldiv(instr, muldiv, trace);
+
+    int zbb = find_zbb_opcode(instr->opcode);
+    if(zbb >= 0)
+        return encode_zbb(instr, zbb, trace);
+
+    int vector = find_vector_opcode(instr->opcode);
+    if(vector >= 0)
+        return encode_vector(instr, vector, trace);
+    if(strcmp(instr->opcode, "vsetvli") == 0)
+        return encode_vsetvli(instr, trace);
+    if(strcmp(instr->opcode, "vle32.v") == 0 || strcmp(instr->opcode, "vse32.v") == 0)
+        return encode_vmem(instr, instr->opcode[1] == 's', trace);
+
+    uint32_t ordering = 0;
+    int amo = find_amo_opcode(instr->opcode, &ordering);
+    if(amo >= 0)
+        return encode_amo(instr, amo, ordering, trace);
+
+    int csr = find_csr_opcode(instr->opcode);
+    if(csr >= 0)
+        return encode_csr(instr, csr, trace);
+    if(strcmp(instr->opcode, "ecall") == 0)
+    {
+        uint32_t encoded = build_itype(0, 0, 0x0, 0, 0x73);
+        ENCODE_TRACE(trace, "[ENCODE] ECALL -> 0x%08X\n", encoded);
+        return encoded;
+    }
+
+    LOG_WARN(LOG_CAT_ENCODER, "[WARN] unknown opcode: %s\n", instr->opcode);
     return 0;
 }
\ No newline at end of file
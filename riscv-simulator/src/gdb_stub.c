@@ -0,0 +1,778 @@
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+#include "gdb_stub.h"
+#include "log.h"
+#include "memory.h"
+#include "undo.h"
+
+#define GDB_PC_REGNUM REG_NUMBER
+
+typedef struct
+{
+    int fd;
+    CPU *cpu;
+    int no_ack;
+    int closed;
+    int trace;                      // log every packet
+
+    uint8_t in[GDB_PACKET_SIZE];
+    size_t in_len;
+    size_t in_pos;
+
+    char last[GDB_PACKET_SIZE + 4]; // last packet sent, resent on '-'
+    size_t last_len;
+} GdbConn;
+
+static const char gdb_target_xml[] =
+    "<?xml version=\"1.0\"?>"
+    "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">"
+    "<target version=\"1.0\">"
+    "<architecture>riscv:rv32</architecture>"
+    "<feature name=\"org.gnu.gdb.riscv.cpu\">"
+    "<reg name=\"zero\" bitsize=\"32\" type=\"int\" regnum=\"0\"/>"
+    "<reg name=\"ra\" bitsize=\"32\" type=\"code_ptr\"/>"
+    "<reg name=\"sp\" bitsize=\"32\" type=\"data_ptr\"/>"
+    "<reg name=\"gp\" bitsize=\"32\" type=\"data_ptr\"/>"
+    "<reg name=\"tp\" bitsize=\"32\" type=\"data_ptr\"/>"
+    "<reg name=\"t0\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"t1\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"t2\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"fp\" bitsize=\"32\" type=\"data_ptr\"/>"
+    "<reg name=\"s1\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"a0\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"a1\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"a2\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"a3\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"a4\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"a5\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"a6\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"a7\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"s2\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"s3\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"s4\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"s5\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"s6\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"s7\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"s8\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"s9\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"s10\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"s11\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"t3\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"t4\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"t5\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"t6\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"pc\" bitsize=\"32\" type=\"code_ptr\"/>"
+    "</feature>"
+    "</target>";
+
+// ================================================================= //
+//                             ENCODING                              //
+// ================================================================= //
+
+static const char gdb_hex_digits[] = "0123456789abcdef";
+
+static int gdb_hex_value(char c)
+{
+    if(c >= '0' && c <= '9')
+        return c - '0';
+    if(c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if(c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+static char *gdb_put_hex_bytes(char *out, const uint8_t *data, size_t len)
+{
+    for(size_t i = 0; i < len; ++i)
+    {
+        *out++ = gdb_hex_digits[data[i] >> 4];
+        *out++ = gdb_hex_digits[data[i] & 0xF];
+    }
+    *out = '\0';
+    return out;
+}
+
+// registers travel as target (little-endian) byte order
+static char *gdb_put_reg(char *out, uint32_t value)
+{
+    uint8_t bytes[4] = { (uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24) };
+    return gdb_put_hex_bytes(out, bytes, 4);
+}
+
+static int gdb_get_hex_bytes(const char *in, uint8_t *data, size_t len)
+{
+    for(size_t i = 0; i < len; ++i)
+    {
+        int hi = gdb_hex_value(in[2 * i]);
+        int lo = (hi < 0) ? -1 : gdb_hex_value(in[2 * i + 1]);
+        if(lo < 0)
+            return -1;
+        data[i] = (uint8_t)((hi << 4) | lo);
+    }
+    return 0;
+}
+
+static int gdb_get_reg(const char *in, uint32_t *value)
+{
+    uint8_t bytes[4];
+    if(gdb_get_hex_bytes(in, bytes, 4) < 0)
+        return -1;
+    *value = (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+    return 0;
+}
+
+// parses a hex number and advances *p past it
+static int gdb_parse_hex(const char **p, uint32_t *value)
+{
+    const char *s = *p;
+    uint32_t v = 0;
+    int digits = 0;
+    int d;
+    while((d = gdb_hex_value(*s)) >= 0)
+    {
+        v = (v << 4) | (uint32_t)d;
+        s++;
+        digits++;
+    }
+    if(digits == 0)
+        return -1;
+    *p = s;
+    *value = v;
+    return 0;
+}
+
+// ================================================================= //
+//                            CONNECTION                             //
+// ================================================================= //
+
+static int gdb_send_raw(GdbConn *c, const char *data, size_t len)
+{
+    while(len > 0)
+    {
+        ssize_t n = send(c->fd, data, len, MSG_NOSIGNAL);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+        {
+            c->closed = 1;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int gdb_send_packet(GdbConn *c, const char *payload)
+{
+    size_t len = strlen(payload);
+    if(len > GDB_PACKET_SIZE - 1)
+        len = GDB_PACKET_SIZE - 1;
+
+    uint8_t sum = 0;
+    for(size_t i = 0; i < len; ++i)
+    {
+        sum = (uint8_t)(sum + (uint8_t)payload[i]);
+    }
+
+    c->last[0] = '$';
+    memcpy(c->last + 1, payload, len);
+    c->last[len + 1] = '#';
+    c->last[len + 2] = gdb_hex_digits[sum >> 4];
+    c->last[len + 3] = gdb_hex_digits[sum & 0xF];
+    c->last_len = len + 4;
+
+    if(c->trace)
+        LOG_TRACE(LOG_CAT_MAIN, "[GDB] -> %.*s\n", (int)len, payload);
+    return gdb_send_raw(c, c->last, c->last_len);
+}
+
+// next byte from the socket; -1 when the connection is gone
+static int gdb_read_byte(GdbConn *c)
+{
+    if(c->in_pos == c->in_len)
+    {
+        ssize_t n;
+        do
+        {
+            n = recv(c->fd, c->in, sizeof(c->in), 0);
+        } while(n < 0 && errno == EINTR);
+
+        if(n <= 0)
+        {
+            c->closed = 1;
+            return -1;
+        }
+        c->in_len = (size_t)n;
+        c->in_pos = 0;
+    }
+    return c->in[c->in_pos++];
+}
+
+// reads the next packet into `buf`; acks and interrupt bytes outside
+// packets are skipped. Returns the payload length or -1.
+static int gdb_read_packet(GdbConn *c, char *buf, size_t size)
+{
+    for(;;)
+    {
+        int ch = gdb_read_byte(c);
+        if(ch < 0)
+            return -1;
+        if(ch == '-' && c->last_len > 0)
+        {
+            gdb_send_raw(c, c->last, c->last_len);
+            continue;
+        }
+        if(ch != '$')
+            continue;
+
+        size_t len = 0;
+        uint8_t sum = 0;
+        while((ch = gdb_read_byte(c)) >= 0 && ch != '#')
+        {
+            sum = (uint8_t)(sum + (uint8_t)ch);
+            if(len + 1 < size)
+                buf[len++] = (char)ch;
+        }
+        buf[len] = '\0';
+
+        int hi = gdb_hex_value((char)gdb_read_byte(c));
+        int lo = gdb_hex_value((char)gdb_read_byte(c));
+        if(c->closed)
+            return -1;
+
+        if(hi < 0 || lo < 0 || (uint8_t)((hi << 4) | lo) != sum)
+        {
+            if(!c->no_ack)
+                gdb_send_raw(c, "-", 1);
+            continue;
+        }
+
+        if(!c->no_ack)
+            gdb_send_raw(c, "+", 1);
+        if(c->trace)
+            LOG_TRACE(LOG_CAT_MAIN, "[GDB] <- %s\n", buf);
+        return (int)len;
+    }
+}
+
+// non-blocking check for a Ctrl-C from the debugger while the target runs
+static int gdb_interrupted(GdbConn *c)
+{
+    if(c->in_pos == c->in_len)
+    {
+        struct pollfd pfd = { .fd = c->fd, .events = POLLIN, .revents = 0 };
+        if(poll(&pfd, 1, 0) <= 0)
+            return 0;
+        if(gdb_read_byte(c) < 0)
+            return 1;
+        c->in_pos--;
+    }
+
+    if(c->in[c->in_pos] == 0x03)
+    {
+        c->in_pos++;
+        return 1;
+    }
+    return 0;
+}
+
+// ================================================================= //
+//                             EXECUTION                             //
+// ================================================================= //
+
+static void gdb_stop_reply(GdbConn *c, char *reply, int breakpoint)
+{
+    CPU *cpu = c->cpu;
+    Memory *m = cpu->memory;
+    if(cpu->error)
+        strcpy(reply, "S04");
+    else if(m->watch_hit)
+        snprintf(reply, GDB_PACKET_SIZE, "T05%s:%x;",
+                 (m->hit.kind == MEMORY_WATCH_READ) ? "rwatch" : "watch", (unsigned)m->hit.addr);
+    else if(cpu->halted)
+        strcpy(reply, "W00");
+    else if(breakpoint)
+        strcpy(reply, "T05swbreak:;");
+    else
+        strcpy(reply, "S05");
+}
+
+static void gdb_step(GdbConn *c, char *reply)
+{
+    memory_clear_watch_hit(c->cpu->memory);
+    if(cpu_step(c->cpu) < 0)
+        c->cpu->error = 1;
+    // running off the end of the program only halts on the next step
+    else if(!c->cpu->halted && c->cpu->pc >= c->cpu->program->code_size)
+        cpu_step(c->cpu);
+    gdb_stop_reply(c, reply, 0);
+}
+
+static void gdb_continue(GdbConn *c, char *reply)
+{
+    CPU *cpu = c->cpu;
+    memory_clear_watch_hit(cpu->memory);
+    while(!cpu->halted)
+    {
+        if(cpu_run_for(cpu, GDB_RUN_SLICE) < 0)
+        {
+            cpu->error = 1;
+            break;
+        }
+        if(cpu->stop_reason != CPU_STOP_NONE)
+        {
+            gdb_stop_reply(c, reply, cpu->stop_reason == CPU_STOP_BREAKPOINT);
+            return;
+        }
+        if(gdb_interrupted(c))
+        {
+            strcpy(reply, c->closed ? "X09" : "S02");
+            return;
+        }
+    }
+    gdb_stop_reply(c, reply, 0);
+}
+
+static void gdb_reverse(GdbConn *c, char *reply, int step)
+{
+    CPU *cpu = c->cpu;
+    if(!cpu->undo)
+    {
+        strcpy(reply, "E01");
+        return;
+    }
+
+    int hit;
+    if(step)
+    {
+        hit = (int)undo_step_back(cpu->undo, cpu, 1);
+    }
+    else
+    {
+        UndoStop stop = {0};
+        stop.breakpoints = cpu->breakpoints;
+        stop.breakpoint_slots = cpu->breakpoint_slots;
+        hit = undo_reverse_continue(cpu->undo, cpu, &stop);
+    }
+
+    if(hit < 0)
+        strcpy(reply, "E01");
+    else if(hit == 0)
+        strcpy(reply, "T05replaylog:begin;");
+    else
+        strcpy(reply, step ? "S05" : "T05swbreak:;");
+}
+
+// ================================================================= //
+//                              PACKETS                              //
+// ================================================================= //
+
+static void gdb_read_registers(GdbConn *c, char *reply)
+{
+    char *out = reply;
+    for(int r = 0; r < REG_NUMBER; ++r)
+    {
+        out = gdb_put_reg(out, (uint32_t)c->cpu->regs[r]);
+    }
+    gdb_put_reg(out, c->cpu->pc);
+}
+
+static void gdb_write_register(CPU *cpu, uint32_t regnum, uint32_t value)
+{
+    if(regnum == GDB_PC_REGNUM)
+    {
+        cpu->pc = value;
+        cpu->halted = 0;
+    }
+    else if(regnum > 0 && regnum < REG_NUMBER)
+    {
+        cpu->regs[regnum] = (int32_t)value;
+    }
+}
+
+static void gdb_write_registers(GdbConn *c, const char *args, char *reply)
+{
+    if(strlen(args) < (REG_NUMBER + 1) * 8)
+    {
+        strcpy(reply, "E01");
+        return;
+    }
+
+    for(uint32_t r = 0; r <= GDB_PC_REGNUM; ++r)
+    {
+        uint32_t value;
+        if(gdb_get_reg(args + r * 8, &value) < 0)
+        {
+            strcpy(reply, "E01");
+            return;
+        }
+        gdb_write_register(c->cpu, r, value);
+    }
+    strcpy(reply, "OK");
+}
+
+static void gdb_read_memory(GdbConn *c, const char *args, char *reply)
+{
+    uint32_t addr, len;
+    if(gdb_parse_hex(&args, &addr) < 0 || *args++ != ',' || gdb_parse_hex(&args, &len) < 0)
+    {
+        strcpy(reply, "E01");
+        return;
+    }
+
+    Memory *m = c->cpu->memory;
+    if(len > (GDB_PACKET_SIZE - 1) / 2)
+        len = (GDB_PACKET_SIZE - 1) / 2;
+    if((size_t)addr >= m->size)
+    {
+        strcpy(reply, "E14");
+        return;
+    }
+    if((size_t)addr + len > m->size)
+        len = (uint32_t)(m->size - addr);
+
+    gdb_put_hex_bytes(reply, m->data + addr, len);
+}
+
+static void gdb_write_memory(GdbConn *c, const char *args, char *reply)
+{
+    uint32_t addr, len;
+    if(gdb_parse_hex(&args, &addr) < 0 || *args++ != ',' || gdb_parse_hex(&args, &len) < 0 ||
+       *args++ != ':' || strlen(args) < (size_t)len * 2)
+    {
+        strcpy(reply, "E01");
+        return;
+    }
+
+    uint8_t buf[GDB_PACKET_SIZE / 2];
+    if(len > sizeof(buf) || gdb_get_hex_bytes(args, buf, len) < 0 ||
+       memory_write(c->cpu->memory, addr, buf, len) < 0)
+    {
+        strcpy(reply, "E14");
+        return;
+    }
+    strcpy(reply, "OK");
+}
+
+// Z0/Z1 (software/hardware breakpoint), Z2/Z3/Z4 (write/read/access
+// watchpoint) and the matching z packets
+static void gdb_breakpoint(GdbConn *c, const char *packet, char *reply)
+{
+    static const int watch_kinds[] = { MEMORY_WATCH_WRITE, MEMORY_WATCH_READ, MEMORY_WATCH_ACCESS };
+
+    int insert = (packet[0] == 'Z');
+    const char *args = packet + 1;
+    uint32_t type, addr, len;
+    if(gdb_parse_hex(&args, &type) < 0 || *args++ != ',' || gdb_parse_hex(&args, &addr) < 0 ||
+       *args++ != ',' || gdb_parse_hex(&args, &len) < 0)
+    {
+        strcpy(reply, "E01");
+        return;
+    }
+
+    if(type > 4)
+    {
+        reply[0] = '\0';
+        return;
+    }
+
+    int rc = 0;
+    if(type <= 1 && insert)
+        rc = cpu_set_breakpoint(c->cpu, addr);
+    else if(type <= 1)
+        cpu_clear_breakpoint(c->cpu, addr);
+    else if(insert)
+        rc = cpu_set_watchpoint(c->cpu, addr, len, watch_kinds[type - 2]);
+    else
+        cpu_clear_watchpoint(c->cpu, addr, len, watch_kinds[type - 2]);
+
+    strcpy(reply, (rc < 0) ? "E01" : "OK");
+}
+
+// qXfer:features:read:target.xml:<offset>,<length>
+static void gdb_read_target_xml(const char *args, char *reply)
+{
+    uint32_t offset, len;
+    if(gdb_parse_hex(&args, &offset) < 0 || *args++ != ',' || gdb_parse_hex(&args, &len) < 0)
+    {
+        strcpy(reply, "E01");
+        return;
+    }
+
+    size_t total = sizeof(gdb_target_xml) - 1;
+    if(offset >= total)
+    {
+        strcpy(reply, "l");
+        return;
+    }
+    if(len > GDB_PACKET_SIZE - 2)
+        len = GDB_PACKET_SIZE - 2;
+
+    size_t chunk = total - offset;
+    if(chunk > len)
+        chunk = len;
+    reply[0] = (offset + chunk < total) ? 'm' : 'l';
+    memcpy(reply + 1, gdb_target_xml + offset, chunk);
+    reply[chunk + 1] = '\0';
+}
+
+static void gdb_query(GdbConn *c, const char *packet, char *reply)
+{
+    static const char xfer[] = "qXfer:features:read:target.xml:";
+
+    reply[0] = '\0';
+    if(strncmp(packet, "qSupported", 10) == 0)
+    {
+        snprintf(reply, GDB_PACKET_SIZE, "PacketSize=%x;qXfer:features:read+;swbreak+;QStartNoAckMode+%s",
+                 GDB_PACKET_SIZE, c->cpu->undo ? ";ReverseStep+;ReverseContinue+" : "");
+    }
+    else if(strncmp(packet, xfer, sizeof(xfer) - 1) == 0)
+    {
+        gdb_read_target_xml(packet + sizeof(xfer) - 1, reply);
+    }
+    else if(strcmp(packet, "qAttached") == 0)
+    {
+        strcpy(reply, "1");
+    }
+    else if(strcmp(packet, "QStartNoAckMode") == 0)
+    {
+        strcpy(reply, "OK");
+    }
+}
+
+// handles one packet; returns 0 to send `reply`, 1 to send it and end the
+// session, 2 to end it without a reply and -1 when the reply was already sent
+static int gdb_handle_packet(GdbConn *c, const char *packet, char *reply)
+{
+    CPU *cpu = c->cpu;
+    const char *args = packet + 1;
+    uint32_t value;
+
+    reply[0] = '\0';
+    switch(packet[0])
+    {
+        case '?':
+            gdb_stop_reply(c, reply, 0);
+            break;
+
+        case 'g':
+            gdb_read_registers(c, reply);
+            break;
+
+        case 'G':
+            gdb_write_registers(c, args, reply);
+            break;
+
+        case 'p':
+            if(gdb_parse_hex(&args, &value) < 0 || value > GDB_PC_REGNUM)
+                strcpy(reply, "E01");
+            else
+                gdb_put_reg(reply, (value == GDB_PC_REGNUM) ? cpu->pc : (uint32_t)cpu->regs[value]);
+            break;
+
+        case 'P':
+        {
+            uint32_t regnum;
+            if(gdb_parse_hex(&args, &regnum) < 0 || *args++ != '=' || regnum > GDB_PC_REGNUM ||
+               gdb_get_reg(args, &value) < 0)
+            {
+                strcpy(reply, "E01");
+                break;
+            }
+            gdb_write_register(cpu, regnum, value);
+            strcpy(reply, "OK");
+            break;
+        }
+
+        case 'm':
+            gdb_read_memory(c, args, reply);
+            break;
+
+        case 'M':
+            gdb_write_memory(c, args, reply);
+            break;
+
+        case 'c':
+        case 's':
+            if(gdb_parse_hex(&args, &value) == 0)
+                gdb_write_register(cpu, GDB_PC_REGNUM, value);
+            if(packet[0] == 'c')
+                gdb_continue(c, reply);
+            else
+                gdb_step(c, reply);
+            break;
+
+        case 'b':
+            if(packet[1] == 's' || packet[1] == 'c')
+                gdb_reverse(c, reply, packet[1] == 's');
+            break;
+
+        case 'Z':
+        case 'z':
+            gdb_breakpoint(c, packet, reply);
+            break;
+
+        case 'H':
+        case 'T':
+            strcpy(reply, "OK");
+            break;
+
+        case 'q':
+        case 'Q':
+            gdb_query(c, packet, reply);
+            if(strcmp(packet, "QStartNoAckMode") == 0)
+            {
+                gdb_send_packet(c, reply);
+                c->no_ack = 1;
+                reply[0] = '\0';
+                return -1;
+            }
+            break;
+
+        case 'D':
+            strcpy(reply, "OK");
+            return 1;
+
+        case 'k':
+            return 2;
+
+        default:
+            break;
+    }
+    return 0;
+}
+
+// ================================================================= //
+//                              SERVER                               //
+// ================================================================= //
+
+int gdb_stub_listen(const char *spec)
+{
+    int fd;
+    if(strncmp(spec, "unix:", 5) == 0)
+    {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if(strlen(spec + 5) >= sizeof(addr.sun_path))
+        {
+            LOG_ERROR(LOG_CAT_MAIN, "[ERROR] gdb_stub_listen: socket path '%s' is too long\n", spec + 5);
+            return -1;
+        }
+        strcpy(addr.sun_path, spec + 5);
+        unlink(addr.sun_path);
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 1) < 0)
+        {
+            LOG_ERROR(LOG_CAT_MAIN, "[ERROR] gdb_stub_listen: cannot listen on '%s': %s\n", spec + 5, strerror(errno));
+            if(fd >= 0)
+                close(fd);
+            return -1;
+        }
+        LOG_INFO(LOG_CAT_MAIN, "[OK] Waiting for GDB on %s\n", spec + 5);
+        return fd;
+    }
+
+    char *end = NULL;
+    unsigned long port = strtoul(spec, &end, 10);
+    if(end == spec || *end != '\0' || port > 65535)
+    {
+        LOG_ERROR(LOG_CAT_MAIN, "[ERROR] gdb_stub_listen: invalid port '%s'\n", spec);
+        return -1;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int one = 1;
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if(fd >= 0)
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if(fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 1) < 0)
+    {
+        LOG_ERROR(LOG_CAT_MAIN, "[ERROR] gdb_stub_listen: cannot listen on port %lu: %s\n", port, strerror(errno));
+        if(fd >= 0)
+            close(fd);
+        return -1;
+    }
+
+    socklen_t addr_len = sizeof(addr);
+    getsockname(fd, (struct sockaddr *)&addr, &addr_len);
+    LOG_INFO(LOG_CAT_MAIN, "[OK] Waiting for GDB on 127.0.0.1:%u\n", (unsigned)ntohs(addr.sin_port));
+    return fd;
+}
+
+int gdb_stub_serve(int listen_fd, CPU *cpu)
+{
+    if(!cpu || !cpu->memory || !cpu->program)
+    {
+        LOG_ERROR(LOG_CAT_MAIN, "[ERROR] gdb_stub_serve: CPU is not set up\n");
+        return -1;
+    }
+
+    GdbConn *c = (GdbConn *)calloc(1, sizeof(GdbConn));
+    char *packet = (char *)malloc(GDB_PACKET_SIZE);
+    char *reply = (char *)malloc(GDB_PACKET_SIZE);
+    if(!c || !packet || !reply)
+    {
+        LOG_ERROR(LOG_CAT_MAIN, "[ERROR] gdb_stub_serve: allocation failed\n");
+        free(c);
+        free(packet);
+        free(reply);
+        return -1;
+    }
+
+    c->fd = accept(listen_fd, NULL, NULL);
+    c->cpu = cpu;
+    if(c->fd < 0)
+    {
+        LOG_ERROR(LOG_CAT_MAIN, "[ERROR] gdb_stub_serve: accept failed: %s\n", strerror(errno));
+        free(c);
+        free(packet);
+        free(reply);
+        return -1;
+    }
+
+    int one = 1;
+    setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    LOG_INFO(LOG_CAT_MAIN, "[OK] GDB connected\n");
+
+    // with tracing on the packets are logged instead of every instruction
+    c->trace = cpu->trace;
+    cpu->trace = 0;
+
+    while(!c->closed && gdb_read_packet(c, packet, GDB_PACKET_SIZE) >= 0)
+    {
+        int done = gdb_handle_packet(c, packet, reply);
+        if(done == 0 || done == 1)
+            gdb_send_packet(c, reply);
+        if(done > 0)
+            break;
+    }
+
+    cpu->trace = c->trace;
+    LOG_INFO(LOG_CAT_MAIN, "[OK] GDB session ended (PC=0x%08X, %u instructions executed)\n",
+             cpu->pc, cpu->instructions_executed);
+
+    close(c->fd);
+    free(c);
+    free(packet);
+    free(reply);
+    return 0;
+}
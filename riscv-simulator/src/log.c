@@ -0,0 +1,494 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "log.h"
+
+typedef struct LogChunk
+{
+    struct LogChunk *next;
+    size_t len;
+    char data[LOG_CHUNK_SIZE];
+} LogChunk;
+
+static struct
+{
+    int running;
+    int stop;
+    int writing;                    // writer holds a chunk outside the queue
+    int atexit_registered;
+    pthread_t thread;
+    pthread_key_t key;              // only used for its destructor
+
+    pthread_mutex_t lock;
+    pthread_cond_t wake;            // chunks queued or stop requested
+    pthread_cond_t space;           // queue below LOG_MAX_QUEUED
+    pthread_cond_t drained;         // queue empty and nothing being written
+
+    LogChunk *head;
+    LogChunk *tail;
+    int queued;
+    LogChunk *free_list;
+} log_state = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER,
+    .space = PTHREAD_COND_INITIALIZER,
+    .drained = PTHREAD_COND_INITIALIZER,
+};
+
+static LogLevel log_min_level[LOG_CAT_COUNT];
+
+static __thread LogChunk *log_tls_chunk;
+static __thread int log_tls_registered;
+
+static const char *log_level_names[LOG_LEVEL_COUNT] = {
+    "trace", "debug", "info", "warn", "error"
+};
+
+static const char *log_category_names[LOG_CAT_COUNT] = {
+    "main", "asm", "encoder", "cpu", "memory", "profiler", "stats", "trace"
+};
+
+// ================================================================= //
+//                              LEVELS                               //
+// ================================================================= //
+
+const char *log_level_name(LogLevel level)
+{
+    return (level >= 0 && level < LOG_LEVEL_COUNT) ? log_level_names[level] : "?";
+}
+
+const char *log_category_name(LogCategory cat)
+{
+    return (cat >= 0 && cat < LOG_CAT_COUNT) ? log_category_names[cat] : "?";
+}
+
+void log_set_level(LogCategory cat, LogLevel min_level)
+{
+    if(cat >= 0 && cat < LOG_CAT_COUNT)
+        log_min_level[cat] = min_level;
+}
+
+int log_enabled(LogCategory cat, LogLevel level)
+{
+    return level >= LOG_LEVEL_ERROR || level >= log_min_level[cat];
+}
+
+static int log_lookup(const char *name, size_t len, const char **names, int count)
+{
+    for(int i = 0; i < count; ++i)
+    {
+        if(strlen(names[i]) == len && strncmp(names[i], name, len) == 0)
+            return i;
+    }
+    return -1;
+}
+
+int log_parse_level(const char *spec)
+{
+    const char *eq = strchr(spec, '=');
+    const char *level_name = eq ? eq + 1 : spec;
+
+    int level = log_lookup(level_name, strlen(level_name), log_level_names, LOG_LEVEL_COUNT);
+    if(level < 0)
+        return -1;
+
+    if(!eq)
+    {
+        for(int c = 0; c < LOG_CAT_COUNT; ++c)
+        {
+            log_min_level[c] = (LogLevel)level;
+        }
+        return 0;
+    }
+
+    int cat = log_lookup(spec, (size_t)(eq - spec), log_category_names, LOG_CAT_COUNT);
+    if(cat < 0)
+        return -1;
+
+    log_min_level[cat] = (LogLevel)level;
+    return 0;
+}
+
+// ================================================================= //
+//                          WRITER THREAD                            //
+// ================================================================= //
+
+static void log_write_fd(int fd, const char *data, size_t len)
+{
+    while(len > 0)
+    {
+        ssize_t n = write(fd, data, len);
+        if(n < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            return;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+static void *log_writer_main(void *arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&log_state.lock);
+    for(;;)
+    {
+        while(!log_state.head && !log_state.stop)
+            pthread_cond_wait(&log_state.wake, &log_state.lock);
+
+        if(!log_state.head)
+            break;
+
+        LogChunk *c = log_state.head;
+        log_state.head = c->next;
+        if(!log_state.head)
+            log_state.tail = NULL;
+        log_state.queued--;
+        log_state.writing = 1;
+        pthread_cond_signal(&log_state.space);
+        pthread_mutex_unlock(&log_state.lock);
+
+        log_write_fd(STDOUT_FILENO, c->data, c->len);
+
+        pthread_mutex_lock(&log_state.lock);
+        log_state.writing = 0;
+        c->len = 0;
+        c->next = log_state.free_list;
+        log_state.free_list = c;
+        if(!log_state.head)
+            pthread_cond_broadcast(&log_state.drained);
+    }
+    pthread_mutex_unlock(&log_state.lock);
+    return NULL;
+}
+
+// queues `c` (if not empty) and returns an empty chunk; lock held
+static LogChunk *log_swap_chunk_locked(LogChunk *c)
+{
+    if(c && c->len > 0)
+    {
+        while(log_state.queued >= LOG_MAX_QUEUED)
+            pthread_cond_wait(&log_state.space, &log_state.lock);
+
+        c->next = NULL;
+        if(log_state.tail)
+            log_state.tail->next = c;
+        else
+            log_state.head = c;
+        log_state.tail = c;
+        log_state.queued++;
+        pthread_cond_signal(&log_state.wake);
+        c = NULL;
+    }
+
+    if(!c)
+    {
+        c = log_state.free_list;
+        if(c)
+            log_state.free_list = c->next;
+        else
+            c = malloc(sizeof(LogChunk));
+        if(c)
+            c->len = 0;
+    }
+    return c;
+}
+
+static LogChunk *log_swap_chunk(LogChunk *c)
+{
+    pthread_mutex_lock(&log_state.lock);
+    c = log_swap_chunk_locked(c);
+    pthread_mutex_unlock(&log_state.lock);
+    return c;
+}
+
+// runs when a thread that logged exits
+static void log_thread_exit(void *value)
+{
+    (void)value;
+    LogChunk *c = log_tls_chunk;
+    log_tls_chunk = NULL;
+    if(!c)
+        return;
+
+    pthread_mutex_lock(&log_state.lock);
+    if(c->len > 0)
+    {
+        c = log_swap_chunk_locked(c);
+    }
+    if(c)
+    {
+        c->next = log_state.free_list;
+        log_state.free_list = c;
+    }
+    pthread_mutex_unlock(&log_state.lock);
+}
+
+static LogChunk *log_thread_chunk(void)
+{
+    if(!log_tls_chunk)
+    {
+        if(!log_tls_registered)
+        {
+            pthread_setspecific(log_state.key, &log_tls_registered);
+            log_tls_registered = 1;
+        }
+        log_tls_chunk = log_swap_chunk(NULL);
+    }
+    return log_tls_chunk;
+}
+
+// ================================================================= //
+//                             LIFECYCLE                             //
+// ================================================================= //
+
+int log_init(void)
+{
+    if(log_state.running)
+        return 0;
+
+    fflush(stdout);
+
+    if(pthread_key_create(&log_state.key, log_thread_exit) != 0)
+        return -1;
+
+    log_state.stop = 0;
+    if(pthread_create(&log_state.thread, NULL, log_writer_main, NULL) != 0)
+    {
+        pthread_key_delete(log_state.key);
+        return -1;
+    }
+    log_state.running = 1;
+
+    if(!log_state.atexit_registered)
+    {
+        atexit(log_shutdown);
+        log_state.atexit_registered = 1;
+    }
+    return 0;
+}
+
+void log_flush(void)
+{
+    if(!log_state.running || !log_tls_chunk || log_tls_chunk->len == 0)
+        return;
+
+    log_tls_chunk = log_swap_chunk(log_tls_chunk);
+}
+
+void log_sync(void)
+{
+    if(!log_state.running)
+    {
+        fflush(stdout);
+        return;
+    }
+
+    log_flush();
+
+    pthread_mutex_lock(&log_state.lock);
+    while(log_state.head || log_state.writing)
+        pthread_cond_wait(&log_state.drained, &log_state.lock);
+    pthread_mutex_unlock(&log_state.lock);
+}
+
+void log_shutdown(void)
+{
+    if(!log_state.running)
+        return;
+
+    log_flush();
+
+    pthread_mutex_lock(&log_state.lock);
+    log_state.stop = 1;
+    pthread_cond_signal(&log_state.wake);
+    pthread_mutex_unlock(&log_state.lock);
+
+    pthread_join(log_state.thread, NULL);
+    log_state.running = 0;
+
+    // the calling thread's empty chunk goes back with the others
+    if(log_tls_chunk)
+    {
+        log_tls_chunk->next = log_state.free_list;
+        log_state.free_list = log_tls_chunk;
+        log_tls_chunk = NULL;
+    }
+
+    while(log_state.free_list)
+    {
+        LogChunk *next = log_state.free_list->next;
+        free(log_state.free_list);
+        log_state.free_list = next;
+    }
+    pthread_key_delete(log_state.key);
+    log_tls_registered = 0;
+}
+
+// ================================================================= //
+//                              OUTPUT                               //
+// ================================================================= //
+
+static void log_write_direct(LogLevel level, const char *text, size_t len)
+{
+    if(level >= LOG_LEVEL_ERROR)
+    {
+        fflush(stdout);
+        fwrite(text, 1, len, stderr);
+    }
+    else
+    {
+        fwrite(text, 1, len, stdout);
+    }
+}
+
+void log_write(LogCategory cat, LogLevel level, const char *text, size_t len)
+{
+    (void)cat;
+
+    if(!log_state.running)
+    {
+        log_write_direct(level, text, len);
+        return;
+    }
+
+    // errors are written in order with everything logged before them
+    if(level >= LOG_LEVEL_ERROR)
+    {
+        log_sync();
+        log_write_fd(STDERR_FILENO, text, len);
+        return;
+    }
+
+    LogChunk *c = log_thread_chunk();
+    if(c && len > LOG_CHUNK_SIZE - c->len)
+        c = log_tls_chunk = log_swap_chunk(c);
+
+    if(!c || len > LOG_CHUNK_SIZE)
+    {
+        log_sync();
+        log_write_fd(STDOUT_FILENO, text, len);
+        return;
+    }
+
+    memcpy(c->data + c->len, text, len);
+    c->len += len;
+}
+
+static void log_vmessage_slow(LogCategory cat, LogLevel level, const char *fmt, va_list ap)
+{
+    char small[1024];
+    va_list copy;
+    va_copy(copy, ap);
+    int n = vsnprintf(small, sizeof(small), fmt, copy);
+    va_end(copy);
+    if(n < 0)
+        return;
+
+    if((size_t)n < sizeof(small))
+    {
+        log_write(cat, level, small, (size_t)n);
+        return;
+    }
+
+    char *big = malloc((size_t)n + 1);
+    if(!big)
+        return;
+    vsnprintf(big, (size_t)n + 1, fmt, ap);
+    log_write(cat, level, big, (size_t)n);
+    free(big);
+}
+
+void log_message(LogCategory cat, LogLevel level, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+
+    if(!log_state.running)
+    {
+        FILE *out = stdout;
+        if(level >= LOG_LEVEL_ERROR)
+        {
+            fflush(stdout);
+            out = stderr;
+        }
+        vfprintf(out, fmt, ap);
+        va_end(ap);
+        return;
+    }
+
+    // common case: format straight into the thread's buffer
+    LogChunk *c = (level < LOG_LEVEL_ERROR) ? log_thread_chunk() : NULL;
+    if(c)
+    {
+        size_t space = LOG_CHUNK_SIZE - c->len;
+        va_list copy;
+        va_copy(copy, ap);
+        int n = vsnprintf(c->data + c->len, space, fmt, copy);
+        va_end(copy);
+        if(n >= 0 && (size_t)n < space)
+        {
+            c->len += (size_t)n;
+            va_end(ap);
+            return;
+        }
+    }
+
+    log_vmessage_slow(cat, level, fmt, ap);
+    va_end(ap);
+}
+
+// ================================================================= //
+//                              STREAMS                              //
+// ================================================================= //
+
+typedef struct
+{
+    LogCategory cat;
+    LogLevel level;
+} LogStream;
+
+static ssize_t log_stream_write(void *cookie, const char *buf, size_t size)
+{
+    LogStream *s = cookie;
+    if(log_enabled(s->cat, s->level))
+        log_write(s->cat, s->level, buf, size);
+    return (ssize_t)size;
+}
+
+static int log_stream_close(void *cookie)
+{
+    free(cookie);
+    return 0;
+}
+
+FILE *log_open_stream(LogCategory cat, LogLevel level)
+{
+    LogStream *s = malloc(sizeof(LogStream));
+    if(!s)
+        return NULL;
+    s->cat = cat;
+    s->level = level;
+
+    cookie_io_functions_t io = { NULL, log_stream_write, NULL, log_stream_close };
+    FILE *f = fopencookie(s, "w", io);
+    if(!f)
+    {
+        free(s);
+        return NULL;
+    }
+
+    // unbuffered: every fprintf() becomes one message, keeping it in order
+    // with log_message() calls around it
+    setvbuf(f, NULL, _IONBF, 0);
+    return f;
+}
@@ -0,0 +1,216 @@
+#include <string.h>
+
+#include "instruction.h"
+#include "loop_trace.h"
+
+void loop_trace_init(LoopTrace *lt, FILE *out, const int32_t regs[TRACE_REGS], uint32_t data_offset)
+{
+    memset(lt, 0, sizeof(*lt));
+    lt->out = out;
+    lt->data_offset = data_offset;
+    memcpy(lt->regs, regs, sizeof(lt->regs));
+}
+
+static void loop_trace_apply(int32_t regs[TRACE_REGS], const TraceRecord *rec)
+{
+    if((rec->flags & TRACE_F_RD) && rec->rd != 0)
+        regs[rec->rd] = rec->rd_value;
+}
+
+static int loop_trace_matches_ref(const LoopTrace *lt)
+{
+    if(lt->seg_count != lt->ref_count)
+        return 0;
+
+    for(int i = 0; i < lt->seg_count; ++i)
+    {
+        if(lt->seg[i].pc != lt->ref_pc[i] || lt->seg[i].word != lt->ref_word[i])
+            return 0;
+    }
+    return 1;
+}
+
+static void loop_trace_flush_held(LoopTrace *lt)
+{
+    if(!lt->holding)
+        return;
+
+    fprintf(lt->out, "[ITER %u]", lt->run_first);
+    for(int i = 0; i < lt->held_count; ++i)
+    {
+        fprintf(lt->out, " %d:x%d=0x%08X", lt->held[i].pos, lt->held[i].reg,
+                (uint32_t)(lt->held[i].value - (int32_t)((uint32_t)lt->run_stride[i] * lt->run_length)));
+    }
+    fprintf(lt->out, "\n");
+
+    if(lt->run_length == 1)
+    {
+        fprintf(lt->out, "[ITER %u]", lt->run_first + 1);
+        for(int i = 0; i < lt->held_count; ++i)
+        {
+            fprintf(lt->out, " %d:x%d=0x%08X", lt->held[i].pos, lt->held[i].reg, (uint32_t)lt->held[i].value);
+        }
+        fprintf(lt->out, "\n");
+    }
+    else if(lt->run_length > 1)
+    {
+        fprintf(lt->out, "[ITER %u..%u]", lt->run_first + 1, lt->run_first + lt->run_length);
+        for(int i = 0; i < lt->held_count; ++i)
+        {
+            fprintf(lt->out, " %d:x%d+=%d", lt->held[i].pos, lt->held[i].reg, lt->run_stride[i]);
+        }
+        fprintf(lt->out, "\n");
+    }
+
+    lt->holding = 0;
+}
+
+static void loop_trace_close_block(LoopTrace *lt)
+{
+    if(lt->repeats == 0)
+        return;
+
+    loop_trace_flush_held(lt);
+    fprintf(lt->out, "[LOOP END] %u iterations of %d instructions\n", lt->repeats + 1, lt->ref_count);
+    lt->repeats = 0;
+}
+
+// the held record keeps the values of the latest iteration of its run
+static int loop_trace_extends_run(const LoopTrace *lt, const LoopTraceEntry *cur, int count)
+{
+    if(!lt->holding || count != lt->held_count)
+        return 0;
+
+    for(int i = 0; i < count; ++i)
+    {
+        if(cur[i].pos != lt->held[i].pos || cur[i].reg != lt->held[i].reg)
+            return 0;
+
+        int32_t stride = (int32_t)((uint32_t)cur[i].value - (uint32_t)lt->held[i].value);
+        if(lt->run_length > 0 && stride != lt->run_stride[i])
+            return 0;
+    }
+    return 1;
+}
+
+static void loop_trace_print_iteration(LoopTrace *lt)
+{
+    if(lt->repeats == 0)
+    {
+        fprintf(lt->out, "\n[LOOP] block PC=0x%08X..0x%08X, %d instructions, data=0x%08X\n",
+                lt->ref_pc[0], lt->ref_pc[lt->ref_count - 1], lt->ref_count, lt->data_offset);
+        fprintf(lt->out, "[REGS]");
+        for(int r = 1; r < TRACE_REGS; ++r)
+        {
+            if(lt->seg_regs[r] != 0)
+                fprintf(lt->out, " x%d=0x%08X", r, (uint32_t)lt->seg_regs[r]);
+        }
+        fprintf(lt->out, "\n");
+    }
+    lt->repeats++;
+
+    // only writes that change a register are needed to replay the block;
+    // a load (or AMO) into x0 still carries the loaded value; a vector load
+    // has no rd and is rendered without its data
+    LoopTraceEntry cur[LOOP_TRACE_MAX_BODY];
+    int count = 0;
+    int32_t regs[TRACE_REGS];
+    memcpy(regs, lt->seg_regs, sizeof(regs));
+
+    for(int i = 0; i < lt->seg_count; ++i)
+    {
+        const TraceRecord *rec = &lt->seg[i];
+        if((rec->flags & TRACE_F_LOAD) && rec->rd == 0 && !vtype_is_vector(rec->word))
+        {
+            cur[count].pos = i;
+            cur[count].reg = 0;
+            cur[count].value = rec->mem_value;
+            count++;
+        }
+        else if((rec->flags & TRACE_F_RD) && rec->rd_value != regs[rec->rd])
+        {
+            cur[count].pos = i;
+            cur[count].reg = rec->rd;
+            cur[count].value = rec->rd_value;
+            count++;
+        }
+        loop_trace_apply(regs, rec);
+    }
+
+    if(loop_trace_extends_run(lt, cur, count))
+    {
+        for(int i = 0; i < count; ++i)
+        {
+            lt->run_stride[i] = (int32_t)((uint32_t)cur[i].value - (uint32_t)lt->held[i].value);
+            lt->held[i].value = cur[i].value;
+        }
+        lt->run_length++;
+    }
+    else
+    {
+        loop_trace_flush_held(lt);
+        memcpy(lt->held, cur, sizeof(LoopTraceEntry) * count);
+        lt->held_count = count;
+        lt->run_first = lt->repeats + 1;
+        lt->run_length = 0;
+        lt->holding = 1;
+    }
+
+    // blank line, [STEP] and [EXEC] per instruction are not printed
+    lt->lines_saved += (uint64_t)lt->seg_count * 3;
+}
+
+static void loop_trace_print_segment(LoopTrace *lt)
+{
+    int32_t regs[TRACE_REGS];
+    memcpy(regs, lt->seg_regs, sizeof(regs));
+
+    for(int i = 0; i < lt->seg_count; ++i)
+    {
+        trace_render_record(lt->out, lt->step + i, regs, &lt->seg[i]);
+        loop_trace_apply(regs, &lt->seg[i]);
+
+        lt->ref_pc[i] = lt->seg[i].pc;
+        lt->ref_word[i] = lt->seg[i].word;
+    }
+    lt->ref_count = lt->seg_count;
+}
+
+static void loop_trace_end_segment(LoopTrace *lt)
+{
+    if(lt->seg_count == 0)
+        return;
+
+    if(loop_trace_matches_ref(lt))
+    {
+        loop_trace_print_iteration(lt);
+    }
+    else
+    {
+        loop_trace_close_block(lt);
+        loop_trace_print_segment(lt);
+    }
+
+    lt->step += lt->seg_count;
+    lt->seg_count = 0;
+}
+
+void loop_trace_record(LoopTrace *lt, const TraceRecord *rec)
+{
+    // a backward transfer starts the next iteration of a potential loop
+    if(lt->seg_count > 0 && (rec->pc <= lt->last_pc || lt->seg_count == LOOP_TRACE_MAX_BODY))
+        loop_trace_end_segment(lt);
+
+    if(lt->seg_count == 0)
+        memcpy(lt->seg_regs, lt->regs, sizeof(lt->seg_regs));
+
+    lt->seg[lt->seg_count++] = *rec;
+    loop_trace_apply(lt->regs, rec);
+    lt->last_pc = rec->pc;
+}
+
+void loop_trace_finish(LoopTrace *lt)
+{
+    loop_trace_end_segment(lt);
+    loop_trace_close_block(lt);
+}
@@ -2,18 +2,23 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include "assembler.h"
+#include "log.h"
 #include "memory.h"
+#include "rvc.h"
 
 Memory memory_init(size_t size)
 {
-    Memory m;
+    // every field starts cleared, so memory_free() is safe even when the
+    // allocation below fails
+    Memory m = {0};
     m.data = (uint8_t *)malloc(sizeof(uint8_t) * size);
     if(m.data == NULL)
     {
-        printf("[ERROR] memory allocation failed.\n");
-        m.size = 0;
+        LOG_ERROR(LOG_CAT_MEMORY, "[ERROR] memory allocation failed.\n");
         return m;
     }
 
@@ -27,24 +32,270 @@ void memory_free(Memory *m)
     if(!m)
         return;
 
-    free(m->data);
+    if(m->mapped)
+        munmap(m->data, m->size);
+    else
+        free(m->data);
+    free(m->dirty);
+    free(m->dirty_pages);
+    free(m->watched);
     m->data = NULL;
     m->size = 0;
+    m->mapped = 0;
+    m->dirty = NULL;
+    m->dirty_pages = NULL;
+    m->dirty_count = 0;
+    m->dirty_owner = NULL;
+    m->watched = NULL;
+    m->watch_count = 0;
+    m->watch_hit = 0;
 }
 
+int memory_map_file(Memory *m, int fd, uint64_t offset, size_t size)
+{
+    if(size == 0)
+        return -1;
+
+    uint8_t *data = NULL;
+    int mapped = 0;
+
+    long host_page = sysconf(_SC_PAGESIZE);
+    if(host_page > 0 && offset % (uint64_t)host_page == 0)
+    {
+        void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, (off_t)offset);
+        if(p != MAP_FAILED)
+        {
+            data = (uint8_t *)p;
+            mapped = 1;
+        }
+    }
+
+    // the file offset does not suit the host page size: read it instead
+    if(!data)
+    {
+        data = (uint8_t *)malloc(size);
+        if(!data || pread(fd, data, size, (off_t)offset) != (ssize_t)size)
+        {
+            LOG_ERROR(LOG_CAT_MEMORY, "[ERROR] memory_map_file: cannot read %zu bytes at offset %llu.\n",
+                      size, (unsigned long long)offset);
+            free(data);
+            return -1;
+        }
+    }
+
+    memory_free(m);
+    m->data = data;
+    m->size = size;
+    m->mapped = mapped;
+    return 0;
+}
+
+// ================================================================= //
+//                          DIRTY TRACKING                           //
+// ================================================================= //
+
+size_t memory_page_count(const Memory *m)
+{
+    return (m->size + MEMORY_PAGE_SIZE - 1) >> MEMORY_PAGE_SHIFT;
+}
+
+int memory_track_dirty(Memory *m)
+{
+    if(m->dirty)
+        return 0;
+
+    size_t pages = memory_page_count(m);
+    m->dirty = (uint8_t *)calloc(pages ? pages : 1, sizeof(uint8_t));
+    m->dirty_pages = (uint32_t *)malloc(sizeof(uint32_t) * (pages ? pages : 1));
+    if(!m->dirty || !m->dirty_pages)
+    {
+        LOG_ERROR(LOG_CAT_MEMORY, "[ERROR] memory_track_dirty: allocation failed.\n");
+        free(m->dirty);
+        free(m->dirty_pages);
+        m->dirty = NULL;
+        m->dirty_pages = NULL;
+        return -1;
+    }
+    m->dirty_count = 0;
+    return 0;
+}
+
+void memory_clear_dirty(Memory *m)
+{
+    if(!m->dirty)
+        return;
+
+    for(size_t i = 0; i < m->dirty_count; ++i)
+    {
+        m->dirty[m->dirty_pages[i]] = 0;
+    }
+    m->dirty_count = 0;
+}
+
+// harts sharing the memory can store to the same clean page at once: only
+// the one whose exchange flips the flag appends the page, into a slot of
+// its own
+static inline void memory_mark_page(Memory *m, uint32_t page)
+{
+    if(!__atomic_load_n(&m->dirty[page], __ATOMIC_RELAXED) &&
+       !__atomic_exchange_n(&m->dirty[page], 1, __ATOMIC_RELAXED))
+    {
+        size_t slot = __atomic_fetch_add(&m->dirty_count, 1, __ATOMIC_RELAXED);
+        m->dirty_pages[slot] = page;
+    }
+}
+
+void memory_mark_dirty(Memory *m, uint32_t addr, size_t len)
+{
+    if(!m->dirty || len == 0)
+        return;
+
+    uint32_t first = addr >> MEMORY_PAGE_SHIFT;
+    uint32_t last = (uint32_t)((addr + len - 1) >> MEMORY_PAGE_SHIFT);
+    for(uint32_t page = first; page <= last; ++page)
+    {
+        memory_mark_page(m, page);
+    }
+}
+
+// ================================================================= //
+//                            WATCHPOINTS                            //
+// ================================================================= //
+
+static void memory_count_watch(Memory *m, const MemoryWatch *w, int delta)
+{
+    uint32_t first = w->addr >> MEMORY_PAGE_SHIFT;
+    uint32_t last = (w->addr + w->len - 1) >> MEMORY_PAGE_SHIFT;
+    for(uint32_t page = first; page <= last; ++page)
+    {
+        m->watched[page] = (uint8_t)(m->watched[page] + delta);
+    }
+}
+
+int memory_watch(Memory *m, uint32_t addr, uint32_t len, int kind)
+{
+    if(len == 0 || (size_t)addr + len > m->size || !(kind & MEMORY_WATCH_ACCESS))
+    {
+        LOG_ERROR(LOG_CAT_MEMORY, "[ERROR] memory_watch: invalid range 0x%08X+%u.\n", addr, len);
+        return -1;
+    }
+    if(m->watch_count == MEMORY_MAX_WATCHES)
+    {
+        LOG_ERROR(LOG_CAT_MEMORY, "[ERROR] memory_watch: at most %d watchpoints.\n", MEMORY_MAX_WATCHES);
+        return -1;
+    }
+
+    if(!m->watched)
+    {
+        size_t pages = memory_page_count(m);
+        m->watched = (uint8_t *)calloc(pages ? pages : 1, sizeof(uint8_t));
+        if(!m->watched)
+        {
+            LOG_ERROR(LOG_CAT_MEMORY, "[ERROR] memory_watch: allocation failed.\n");
+            return -1;
+        }
+    }
+
+    MemoryWatch *w = &m->watches[m->watch_count++];
+    w->addr = addr;
+    w->len = len;
+    w->kind = kind & MEMORY_WATCH_ACCESS;
+    memory_count_watch(m, w, 1);
+    return 0;
+}
+
+void memory_unwatch(Memory *m, uint32_t addr, uint32_t len, int kind)
+{
+    for(int i = 0; i < m->watch_count; ++i)
+    {
+        MemoryWatch *w = &m->watches[i];
+        if(w->addr != addr || w->len != len || w->kind != (kind & MEMORY_WATCH_ACCESS))
+            continue;
+
+        memory_count_watch(m, w, -1);
+        m->watches[i] = m->watches[--m->watch_count];
+        break;
+    }
+
+    // back to the fast path
+    if(m->watch_count == 0)
+    {
+        free(m->watched);
+        m->watched = NULL;
+    }
+}
+
+void memory_clear_watch_hit(Memory *m)
+{
+    // harts sharing the memory call this on every run; only write when set
+    if(m->watch_hit)
+        m->watch_hit = 0;
+}
+
+// slow path of memory_read32/memory_write32, for words on watched pages
+static void memory_check_watch(Memory *m, uint32_t addr, int kind, uint32_t old_value, uint32_t new_value)
+{
+    if(m->watch_hit)
+        return;
+
+    for(int i = 0; i < m->watch_count; ++i)
+    {
+        const MemoryWatch *w = &m->watches[i];
+        if((w->kind & kind) && addr < w->addr + w->len && w->addr < addr + 4)
+        {
+            m->watch_hit = 1;
+            m->hit.addr = addr;
+            m->hit.kind = kind;
+            m->hit.old_value = old_value;
+            m->hit.new_value = new_value;
+            return;
+        }
+    }
+}
+
+static inline int memory_page_watched(const Memory *m, uint32_t addr)
+{
+    return m->watched[addr >> MEMORY_PAGE_SHIFT] | m->watched[(addr + 3) >> MEMORY_PAGE_SHIFT];
+}
+
+// ================================================================= //
+//                              ACCESS                               //
+// ================================================================= //
+
 static int in_bounds(Memory *m, uint32_t addr, size_t len)
 {
     return addr + len <= m->size;
 }
 
+// guest memory is little-endian; aligned words are accessed whole so that a
+// word stored by one hart is never seen half-written by another
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define MEMORY_LE32(x) __builtin_bswap32(x)
+#else
+#define MEMORY_LE32(x) (x)
+#endif
+
+static inline uint32_t *memory_word(Memory *m, uint32_t addr)
+{
+    return (uint32_t *)(m->data + addr);
+}
+
 uint32_t memory_read32(Memory *m, uint32_t addr)
 {
     if(!in_bounds(m , addr, 4))
     {
-        printf("[ERROR] trying to read from out-of-bounds memory.\n");
+        LOG_ERROR(LOG_CAT_MEMORY, "[ERROR] trying to read from out-of-bounds memory.\n");
         return 0;
     }
-    uint32_t v = m->data[addr] | (m->data[addr + 1] << 8) | (m->data[addr + 2] << 16) | (m->data[addr + 3] << 24);
+
+    uint32_t v;
+    if((addr & 3) == 0)
+        v = MEMORY_LE32(__atomic_load_n(memory_word(m, addr), __ATOMIC_RELAXED));
+    else
+        v = m->data[addr] | (m->data[addr + 1] << 8) | (m->data[addr + 2] << 16) | ((uint32_t)m->data[addr + 3] << 24);
+
+    if(m->watched && memory_page_watched(m, addr))
+        memory_check_watch(m, addr, MEMORY_WATCH_READ, v, v);
     return v;
 }
 
@@ -52,7 +303,23 @@ void memory_write32(Memory *m, uint32_t addr, uint32_t value)
 {
     if(!in_bounds(m , addr, 4))
     {
-        printf("[ERROR] trying to write to out-of-bounds memory.\n");
+        LOG_ERROR(LOG_CAT_MEMORY, "[ERROR] trying to write to out-of-bounds memory.\n");
+        return;
+    }
+
+    if(m->watched && memory_page_watched(m, addr))
+        memory_check_watch(m, addr, MEMORY_WATCH_WRITE, memory_peek32(m, addr), value);
+
+    // a word may straddle two pages
+    if(m->dirty)
+    {
+        memory_mark_page(m, addr >> MEMORY_PAGE_SHIFT);
+        memory_mark_page(m, (addr + 3) >> MEMORY_PAGE_SHIFT);
+    }
+
+    if((addr & 3) == 0)
+    {
+        __atomic_store_n(memory_word(m, addr), MEMORY_LE32(value), __ATOMIC_RELAXED);
         return;
     }
 
@@ -62,19 +329,210 @@ void memory_write32(Memory *m, uint32_t addr, uint32_t value)
     m->data[addr + 3] = (value >> 24) & 0xFF;
 }
 
-void load_program_into_memory(Memory *m, const uint32_t *program, size_t len_words, uint32_t base_addr)
+// ================================================================= //
+//                              ATOMICS                              //
+// ================================================================= //
+
+static uint32_t memory_amo_apply(MemoryAmoOp op, uint32_t old, uint32_t value)
+{
+    switch(op)
+    {
+        case MEMORY_AMO_SWAP: return value;
+        case MEMORY_AMO_ADD:  return old + value;
+        case MEMORY_AMO_XOR:  return old ^ value;
+        case MEMORY_AMO_AND:  return old & value;
+        case MEMORY_AMO_OR:   return old | value;
+        case MEMORY_AMO_MIN:  return ((int32_t)old < (int32_t)value) ? old : value;
+        case MEMORY_AMO_MAX:  return ((int32_t)old > (int32_t)value) ? old : value;
+        case MEMORY_AMO_MINU: return (old < value) ? old : value;
+        case MEMORY_AMO_MAXU: return (old > value) ? old : value;
+    }
+    return old;
+}
+
+// operations without a host fetch-op, and every operation on hosts whose
+// byte order differs from the guest's
+static uint32_t memory_amo_cas_loop(uint32_t *word, MemoryAmoOp op, uint32_t value)
+{
+    uint32_t raw = __atomic_load_n(word, __ATOMIC_RELAXED);
+    for(;;)
+    {
+        uint32_t old = MEMORY_LE32(raw);
+        uint32_t next = MEMORY_LE32(memory_amo_apply(op, old, value));
+        if(__atomic_compare_exchange_n(word, &raw, next, 1, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+            return old;
+    }
+}
+
+static int memory_atomic_ok(Memory *m, uint32_t addr)
+{
+    if(!in_bounds(m, addr, 4) || (addr & 3) != 0)
+    {
+        LOG_ERROR(LOG_CAT_MEMORY, "[ERROR] atomic access to a misaligned or out-of-bounds word at 0x%08X.\n", addr);
+        return 0;
+    }
+
+    if(m->dirty)
+        memory_mark_page(m, addr >> MEMORY_PAGE_SHIFT);
+    return 1;
+}
+
+uint32_t memory_amo32(Memory *m, uint32_t addr, MemoryAmoOp op, uint32_t value)
+{
+    if(!memory_atomic_ok(m, addr))
+        return 0;
+
+    uint32_t *word = memory_word(m, addr);
+    uint32_t old;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    old = memory_amo_cas_loop(word, op, value);
+#else
+    switch(op)
+    {
+        case MEMORY_AMO_SWAP: old = __atomic_exchange_n(word, value, __ATOMIC_SEQ_CST); break;
+        case MEMORY_AMO_ADD:  old = __atomic_fetch_add(word, value, __ATOMIC_SEQ_CST); break;
+        case MEMORY_AMO_XOR:  old = __atomic_fetch_xor(word, value, __ATOMIC_SEQ_CST); break;
+        case MEMORY_AMO_AND:  old = __atomic_fetch_and(word, value, __ATOMIC_SEQ_CST); break;
+        case MEMORY_AMO_OR:   old = __atomic_fetch_or(word, value, __ATOMIC_SEQ_CST);  break;
+        default:              old = memory_amo_cas_loop(word, op, value); break;
+    }
+#endif
+
+    if(m->watched && memory_page_watched(m, addr))
+        memory_check_watch(m, addr, MEMORY_WATCH_WRITE, old, memory_amo_apply(op, old, value));
+    return old;
+}
+
+int memory_cas32(Memory *m, uint32_t addr, uint32_t expected, uint32_t value)
+{
+    if(!memory_atomic_ok(m, addr))
+        return 0;
+
+    uint32_t raw = MEMORY_LE32(expected);
+    if(!__atomic_compare_exchange_n(memory_word(m, addr), &raw, MEMORY_LE32(value), 0,
+                                    __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+        return 0;
+
+    if(m->watched && memory_page_watched(m, addr))
+        memory_check_watch(m, addr, MEMORY_WATCH_WRITE, expected, value);
+    return 1;
+}
+
+int memory_read_words(Memory *m, uint32_t addr, uint32_t *dst, size_t words)
 {
-    size_t bytes = len_words * sizeof(uint32_t);
+    size_t len = words * 4;
+    if(!in_bounds(m, addr, len))
+    {
+        LOG_ERROR(LOG_CAT_MEMORY, "[ERROR] trying to read from out-of-bounds memory.\n");
+        return -1;
+    }
+
+    memcpy(dst, m->data + addr, len);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    for(size_t i = 0; i < words; ++i)
+    {
+        dst[i] = MEMORY_LE32(dst[i]);
+    }
+#endif
+
+    if(m->watched)
+    {
+        for(size_t i = 0; i < words; ++i)
+        {
+            uint32_t a = addr + (uint32_t)i * 4;
+            if(memory_page_watched(m, a))
+                memory_check_watch(m, a, MEMORY_WATCH_READ, dst[i], dst[i]);
+        }
+    }
+    return 0;
+}
+
+int memory_write_words(Memory *m, uint32_t addr, const uint32_t *src, size_t words)
+{
+    size_t len = words * 4;
+    if(!in_bounds(m, addr, len))
+    {
+        LOG_ERROR(LOG_CAT_MEMORY, "[ERROR] trying to write to out-of-bounds memory.\n");
+        return -1;
+    }
+
+    if(m->watched)
+    {
+        for(size_t i = 0; i < words; ++i)
+        {
+            uint32_t a = addr + (uint32_t)i * 4;
+            if(memory_page_watched(m, a))
+                memory_check_watch(m, a, MEMORY_WATCH_WRITE, memory_peek32(m, a), src[i]);
+        }
+    }
+
+    memory_mark_dirty(m, addr, len);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    for(size_t i = 0; i < words; ++i)
+    {
+        uint32_t v = MEMORY_LE32(src[i]);
+        memcpy(m->data + addr + i * 4, &v, 4);
+    }
+#else
+    memcpy(m->data + addr, src, len);
+#endif
+    return 0;
+}
+
+int memory_write(Memory *m, uint32_t addr, const void *src, size_t len)
+{
+    if(!in_bounds(m, addr, len))
+    {
+        LOG_ERROR(LOG_CAT_MEMORY, "[ERROR] trying to write to out-of-bounds memory.\n");
+        return -1;
+    }
+
+    memory_mark_dirty(m, addr, len);
+    memcpy(m->data + addr, src, len);
+    return 0;
+}
+
+uint32_t load_program_into_memory(Memory *m, const uint32_t *program, size_t len_words, uint32_t base_addr)
+{
+    size_t bytes = 0;
+    for(size_t i = 0; i < len_words; i++)
+    {
+        bytes += rvc_length(program[i]);
+    }
+    bytes = (bytes + 3) & ~(size_t)3;
+
     if(base_addr + bytes > m->size)
     {
-        printf("[ERROR] trying to load more bytes than memory can support.\n");
-        return;
+        LOG_ERROR(LOG_CAT_MEMORY, "[ERROR] trying to load more bytes than memory can support.\n");
+        return 0;
     }
 
+    uint32_t addr = base_addr;
+    uint8_t half[2];
     for(size_t i = 0; i < len_words; i++)
     {
-        memory_write32(m, base_addr + i * 4, program[i]);
+        if(rvc_is_compressed(program[i]))
+        {
+            half[0] = program[i] & 0xFF;
+            half[1] = (program[i] >> 8) & 0xFF;
+            memory_write(m, addr, half, 2);
+            addr += 2;
+        }
+        else
+        {
+            memory_write32(m, addr, program[i]);
+            addr += 4;
+        }
+    }
+
+    // pad to a word with a C.NOP, so running off the code still ends it
+    if(addr < base_addr + bytes)
+    {
+        half[0] = 0x01;
+        half[1] = 0x00;
+        memory_write(m, addr, half, 2);
     }
+    return (uint32_t)bytes;
 }
 
 void load_data_into_memory(Memory *m, const AssemblyProgram *program, uint32_t data_offset)
@@ -91,7 +549,7 @@ void load_data_into_memory(Memory *m, const AssemblyProgram *program, uint32_t d
 
         if(addr + 4 > m->size) 
         {
-            printf("[ERROR] Not enough memory to load data entry at address 0x%08X.\n", addr);
+            LOG_ERROR(LOG_CAT_MEMORY, "[ERROR] Not enough memory to load data entry at address 0x%08X.\n", addr);
             continue; 
         }
 
@@ -103,14 +561,14 @@ void memory_dump_words(Memory *m, uint32_t addr, size_t words)
 {
     if(!m)
     {
-        printf("[ERROR] memory is null: cannot read words from it.\n");
+        LOG_ERROR(LOG_CAT_MEMORY, "[ERROR] memory is null: cannot read words from it.\n");
         return;
     }
 
     size_t start = (size_t)addr;
     if(start >= m->size) 
     {
-        printf("[ERROR] memory_dump_words: start address out of bounds\n");
+        LOG_ERROR(LOG_CAT_MEMORY, "[ERROR] memory_dump_words: start address out of bounds\n");
         return;
     }
 
@@ -128,6 +586,6 @@ void memory_dump_words(Memory *m, uint32_t addr, size_t words)
                    | ((uint32_t)m->data[a + 1] << 8)
                    | ((uint32_t)m->data[a + 2] << 16)
                    | ((uint32_t)m->data[a + 3] << 24);
-        printf("%08zx: %08x\n", a, w);
+        LOG_INFO(LOG_CAT_MEMORY, "%08zx: %08x\n", a, w);
     }
 }
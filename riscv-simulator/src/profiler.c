@@ -0,0 +1,243 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "log.h"
+#include "profiler.h"
+
+// ================================================================= //
+//                              INIT                                 //
+// ================================================================= //
+
+static void profiler_reset_node(ProfilerNode *node, uint32_t func_addr, int parent)
+{
+    node->func_addr = func_addr;
+    node->parent = parent;
+    node->first_child = -1;
+    node->next_sibling = -1;
+    node->calls = 0;
+    node->exclusive = 0;
+    node->inclusive = 0;
+}
+
+void profiler_init(Profiler *p, uint32_t entry_pc)
+{
+    if(!p)
+        return;
+
+    profiler_reset_node(&p->nodes[0], entry_pc, -1);
+    p->nodes[0].calls = 1;
+    p->node_count = 1;
+
+    p->current = 0;
+    p->depth = 0;
+
+    p->dropped_calls = 0;
+    p->unmatched_returns = 0;
+}
+
+// ================================================================= //
+//                         CALL / RETURN                             //
+// ================================================================= //
+
+static int profiler_find_or_add_child(Profiler *p, int parent, uint32_t func_addr)
+{
+    for(int c = p->nodes[parent].first_child; c >= 0; c = p->nodes[c].next_sibling)
+    {
+        if(p->nodes[c].func_addr == func_addr)
+            return c;
+    }
+
+    if(p->node_count >= PROFILER_MAX_NODES)
+        return -1;
+
+    int idx = p->node_count++;
+    profiler_reset_node(&p->nodes[idx], func_addr, parent);
+    p->nodes[idx].next_sibling = p->nodes[parent].first_child;
+    p->nodes[parent].first_child = idx;
+    return idx;
+}
+
+void profiler_on_call(Profiler *p, uint32_t target, uint32_t return_addr)
+{
+    if(!p)
+        return;
+
+    if(p->depth >= PROFILER_MAX_DEPTH)
+    {
+        p->dropped_calls++;
+        return;
+    }
+
+    p->stack_nodes[p->depth] = p->current;
+    p->stack_ret[p->depth] = return_addr;
+    p->depth++;
+
+    int child = profiler_find_or_add_child(p, p->current, target);
+    if(child < 0)
+    {
+        // tree is full: keep charging the caller, but still track the frame
+        p->dropped_calls++;
+        return;
+    }
+
+    p->nodes[child].calls++;
+    p->current = child;
+}
+
+void profiler_on_return(Profiler *p, uint32_t target)
+{
+    if(!p)
+        return;
+
+    // unwind to the innermost frame expecting this return address; frames
+    // skipped on the way were left without a matching return
+    for(int d = p->depth - 1; d >= 0; --d)
+    {
+        if(p->stack_ret[d] == target)
+        {
+            p->current = p->stack_nodes[d];
+            p->depth = d;
+            return;
+        }
+    }
+
+    p->unmatched_returns++;
+}
+
+// ================================================================= //
+//                              REPORT                               //
+// ================================================================= //
+
+void profiler_finalize(Profiler *p)
+{
+    if(!p)
+        return;
+
+    for(int i = 0; i < p->node_count; ++i)
+    {
+        p->nodes[i].inclusive = p->nodes[i].exclusive;
+    }
+
+    // children are always created after their parent, so a reverse sweep
+    // folds every subtree into its parent exactly once
+    for(int i = p->node_count - 1; i > 0; --i)
+    {
+        p->nodes[p->nodes[i].parent].inclusive += p->nodes[i].inclusive;
+    }
+}
+
+static const char *profiler_func_name(AssemblyProgram *program, uint32_t addr, char *buf, size_t size)
+{
+    if(program)
+    {
+        for(int i = 0; i < program->symbol_count; ++i)
+        {
+            if(program->symbols[i].address == addr)
+                return program->symbols[i].name;
+        }
+    }
+
+    snprintf(buf, size, "0x%08X", addr);
+    return buf;
+}
+
+static double profiler_percent(uint64_t part, uint64_t total)
+{
+    return total ? (100.0 * (double)part / (double)total) : 0.0;
+}
+
+static void profiler_print_node(Profiler *p, AssemblyProgram *program, int idx, int level, uint64_t total)
+{
+    ProfilerNode *node = &p->nodes[idx];
+    char buf[16];
+    const char *name = profiler_func_name(program, node->func_addr, buf, sizeof(buf));
+
+    LOG_INFO(LOG_CAT_PROFILER, "  %*s%-*s incl=%8llu (%5.1f%%)  excl=%8llu (%5.1f%%)  calls=%llu\n",
+           level * 2, "", 24 - level * 2 > 0 ? 24 - level * 2 : 0, name,
+           (unsigned long long)node->inclusive, profiler_percent(node->inclusive, total),
+           (unsigned long long)node->exclusive, profiler_percent(node->exclusive, total),
+           (unsigned long long)node->calls);
+
+    for(int c = node->first_child; c >= 0; c = p->nodes[c].next_sibling)
+    {
+        profiler_print_node(p, program, c, level + 1, total);
+    }
+}
+
+static int profiler_has_ancestor_with(Profiler *p, int idx, uint32_t func_addr)
+{
+    for(int a = p->nodes[idx].parent; a >= 0; a = p->nodes[a].parent)
+    {
+        if(p->nodes[a].func_addr == func_addr)
+            return 1;
+    }
+    return 0;
+}
+
+void profiler_print(Profiler *p, AssemblyProgram *program)
+{
+    if(!p)
+    {
+        LOG_ERROR(LOG_CAT_PROFILER, "[ERROR] profiler_print: profiler is NULL\n");
+        return;
+    }
+
+    profiler_finalize(p);
+    uint64_t total = p->nodes[0].inclusive;
+
+    LOG_INFO(LOG_CAT_PROFILER, "\n=== CALL PROFILE ===\n");
+    LOG_INFO(LOG_CAT_PROFILER, "Calling-context tree (%d contexts, %llu instructions):\n",
+           p->node_count, (unsigned long long)total);
+    profiler_print_node(p, program, 0, 0, total);
+
+    // flat view: fold every context of the same function together; for
+    // recursive functions only the outermost activation counts as inclusive
+    struct
+    {
+        uint32_t func_addr;
+        uint64_t calls;
+        uint64_t exclusive;
+        uint64_t inclusive;
+    } funcs[PROFILER_MAX_NODES];
+    int func_count = 0;
+
+    for(int i = 0; i < p->node_count; ++i)
+    {
+        ProfilerNode *node = &p->nodes[i];
+        int f = 0;
+        while(f < func_count && funcs[f].func_addr != node->func_addr)
+            f++;
+
+        if(f == func_count)
+        {
+            funcs[f].func_addr = node->func_addr;
+            funcs[f].calls = 0;
+            funcs[f].exclusive = 0;
+            funcs[f].inclusive = 0;
+            func_count++;
+        }
+
+        funcs[f].calls += node->calls;
+        funcs[f].exclusive += node->exclusive;
+        if(!profiler_has_ancestor_with(p, i, node->func_addr))
+            funcs[f].inclusive += node->inclusive;
+    }
+
+    LOG_INFO(LOG_CAT_PROFILER, "\nPer-function summary:\n");
+    LOG_INFO(LOG_CAT_PROFILER, "  %-24s %8s %18s %18s\n", "function", "calls", "inclusive", "exclusive");
+    for(int f = 0; f < func_count; ++f)
+    {
+        char buf[16];
+        const char *name = profiler_func_name(program, funcs[f].func_addr, buf, sizeof(buf));
+        LOG_INFO(LOG_CAT_PROFILER, "  %-24s %8llu %9llu (%5.1f%%) %9llu (%5.1f%%)\n",
+               name, (unsigned long long)funcs[f].calls,
+               (unsigned long long)funcs[f].inclusive, profiler_percent(funcs[f].inclusive, total),
+               (unsigned long long)funcs[f].exclusive, profiler_percent(funcs[f].exclusive, total));
+    }
+
+    if(p->dropped_calls || p->unmatched_returns)
+    {
+        LOG_WARN(LOG_CAT_PROFILER, "[WARN] profiler: %u call(s) not tracked, %u unmatched return(s)\n",
+               p->dropped_calls, p->unmatched_returns);
+    }
+}
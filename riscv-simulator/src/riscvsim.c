@@ -0,0 +1,572 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "encoder.h"
+#include "log.h"
+#include "riscvsim.h"
+
+struct RiscvSim
+{
+    AssemblyProgram *program;
+    uint32_t *code;                 // encoded instructions
+    int code_count;
+
+    size_t memory_size;
+    Memory memory;
+    uint32_t data_offset;
+
+    CPU cpu;
+    int loaded;                     // cpu is set up for program and memory
+    int trace;
+    uint32_t vlen;
+    int rvc;                        // compress the whole program (compress_program)
+
+    CpuStats stats;
+    int stats_enabled;
+
+    UndoLog undo;
+    int undo_enabled;
+
+    SyscallHost syscalls;           // ECALL state, reset by rvsim_load()
+
+    // pending asynchronous run
+    int pending;
+    uint32_t run_end;               // instruction count the run stops at
+    RvsimDone done;
+    void *done_user;
+};
+
+// ================================================================= //
+//                             LIFECYCLE                             //
+// ================================================================= //
+
+RiscvSim *rvsim_create(void)
+{
+    RiscvSim *sim = calloc(1, sizeof(RiscvSim));
+    if(!sim)
+    {
+        LOG_ERROR(LOG_CAT_MAIN, "[ERROR] rvsim_create: allocation failed\n");
+        return NULL;
+    }
+
+    sim->program = calloc(1, sizeof(AssemblyProgram));
+    if(!sim->program)
+    {
+        LOG_ERROR(LOG_CAT_MAIN, "[ERROR] rvsim_create: allocation failed\n");
+        free(sim);
+        return NULL;
+    }
+
+    if(syscall_host_init(&sim->syscalls) < 0)
+    {
+        free(sim->program);
+        free(sim);
+        return NULL;
+    }
+
+    sim->memory_size = RVSIM_DEFAULT_MEMORY_SIZE;
+    sim->vlen = CPU_VLEN_DEFAULT;
+    cpu_init(&sim->cpu);
+    return sim;
+}
+
+void rvsim_destroy(RiscvSim *sim)
+{
+    if(!sim)
+        return;
+
+    cpu_free_breakpoints(&sim->cpu);
+    undo_free(&sim->undo);
+    syscall_host_free(&sim->syscalls);
+    memory_free(&sim->memory);
+    free(sim->code);
+    free(sim->program);
+    free(sim);
+}
+
+int rvsim_set_memory_size(RiscvSim *sim, size_t bytes)
+{
+    if(sim->memory.data || bytes == 0)
+        return -1;
+
+    sim->memory_size = bytes;
+    return 0;
+}
+
+int rvsim_set_vlen(RiscvSim *sim, uint32_t bits)
+{
+    if(cpu_set_vlen(&sim->cpu, bits) < 0)
+        return -1;
+
+    sim->vlen = bits;
+    return 0;
+}
+
+void rvsim_set_rvc(RiscvSim *sim, int rvc)
+{
+    sim->rvc = rvc;
+}
+
+void rvsim_set_trace(RiscvSim *sim, int trace)
+{
+    sim->trace = trace;
+    if(sim->loaded)
+        sim->cpu.trace = trace;
+}
+
+void rvsim_enable_stats(RiscvSim *sim)
+{
+    if(!sim->stats_enabled)
+        stats_init(&sim->stats);
+    sim->stats_enabled = 1;
+    if(sim->loaded)
+        sim->cpu.stats = &sim->stats;
+}
+
+int rvsim_enable_undo(RiscvSim *sim, uint32_t entries)
+{
+    if(!sim->undo_enabled)
+    {
+        if(undo_init(&sim->undo, entries, 0, UNDO_DEFAULT_KEYFRAMES) < 0)
+            return -1;
+        sim->undo_enabled = 1;
+    }
+
+    if(sim->loaded)
+    {
+        undo_reset(&sim->undo, &sim->cpu);
+        sim->cpu.undo = &sim->undo;
+    }
+    return 0;
+}
+
+// ================================================================= //
+//                              LOADING                              //
+// ================================================================= //
+
+int rvsim_assemble(RiscvSim *sim, const char *path)
+{
+    memset(sim->program, 0, sizeof(AssemblyProgram));
+    sim->loaded = 0;
+
+    if(read_asm_file((char *)path, sim->program) < 0)
+        return -1;
+    return (sim->rvc && compress_program(sim->program) < 0) ? -1 : 0;
+}
+
+int rvsim_init_memory(RiscvSim *sim)
+{
+    memory_free(&sim->memory);
+    sim->memory = memory_init(sim->memory_size);
+    return (sim->memory.size == 0) ? -1 : 0;
+}
+
+static int rvsim_reserve_code(RiscvSim *sim, size_t words)
+{
+    free(sim->code);
+    sim->code_count = 0;
+    sim->code = malloc(sizeof(uint32_t) * (words ? words : 1));
+    if(!sim->code)
+    {
+        LOG_ERROR(LOG_CAT_MAIN, "[ERROR] memory allocation for encoded array failed.\n");
+        return -1;
+    }
+    return 0;
+}
+
+static void rvsim_list_instruction(const Instruction *instr, int index)
+{
+    LOG_INFO(LOG_CAT_ENCODER, "[%02d] (PC=0x%08X) ", index, instr->address);
+    if(instr->label[0] != '\0')
+        LOG_INFO(LOG_CAT_ENCODER, "%s: ", instr->label);
+    LOG_INFO(LOG_CAT_ENCODER, "%s ", instr->opcode);
+
+    for(int j = 0; j < instr->operand_count; ++j)
+    {
+        LOG_INFO(LOG_CAT_ENCODER, "%s", instr->operands[j]);
+        if(j + 1 < instr->operand_count)
+            LOG_INFO(LOG_CAT_ENCODER, ", ");
+    }
+}
+
+int rvsim_encode(RiscvSim *sim)
+{
+    AssemblyProgram *program = sim->program;
+    if(rvsim_reserve_code(sim, (size_t)program->instruction_count) < 0)
+        return -1;
+
+    for(int i = 0; i < program->instruction_count; ++i)
+    {
+        Instruction *instr = &program->instructions[i];
+
+        if(sim->trace)
+            rvsim_list_instruction(instr, i);
+
+        uint32_t code = encode_instruction_traced(program, instr, sim->trace);
+        sim->code[i] = code;
+        if(sim->trace)
+            LOG_INFO(LOG_CAT_ENCODER, " -> encoded: 0x%08X\n", code);
+        if(code == 0)
+        {
+            LOG_ERROR(LOG_CAT_ENCODER, "[ERROR] Encoding failed at instruction %d (line %d). Aborting.\n",
+                      i, instr->line_number);
+            return -1;
+        }
+        sim->code_count++;
+    }
+    return 0;
+}
+
+int rvsim_load(RiscvSim *sim)
+{
+    if(!sim->memory.data || !sim->code)
+    {
+        LOG_ERROR(LOG_CAT_MAIN, "[ERROR] rvsim_load: program is not encoded or memory is not set up\n");
+        return -1;
+    }
+
+    memory_mark_dirty(&sim->memory, 0, sim->memory.size);
+    memset(sim->memory.data, 0, sim->memory.size);
+    uint32_t code_size = load_program_into_memory(&sim->memory, sim->code, (size_t)sim->code_count, 0);
+    if(code_size == 0 && sim->code_count > 0)
+        return -1;
+
+    sim->program->code_size = code_size;
+    sim->data_offset = code_size;
+    load_data_into_memory(&sim->memory, sim->program, sim->data_offset);
+
+    cpu_free_breakpoints(&sim->cpu);
+    cpu_init_with_program(&sim->cpu, &sim->memory, sim->program);
+    cpu_set_vlen(&sim->cpu, sim->vlen);
+    sim->cpu.trace = sim->trace;
+    syscall_host_reset(&sim->syscalls, sim->program);
+    sim->cpu.syscalls = &sim->syscalls;
+    if(sim->stats_enabled)
+    {
+        stats_init(&sim->stats);
+        sim->cpu.stats = &sim->stats;
+    }
+    if(sim->undo_enabled)
+    {
+        undo_reset(&sim->undo, &sim->cpu);
+        sim->cpu.undo = &sim->undo;
+    }
+    sim->pending = 0;
+    sim->loaded = 1;
+    return 0;
+}
+
+int rvsim_load_source(RiscvSim *sim, const char *path)
+{
+    if(rvsim_assemble(sim, path) < 0)
+        return -1;
+    if(!sim->memory.data && rvsim_init_memory(sim) < 0)
+        return -1;
+    if(rvsim_encode(sim) < 0)
+        return -1;
+    return rvsim_load(sim);
+}
+
+int rvsim_load_binary(RiscvSim *sim, const uint32_t *code, size_t code_words,
+                      const uint32_t *data, size_t data_words)
+{
+    if(data_words > MAX_DATA)
+    {
+        LOG_ERROR(LOG_CAT_MAIN, "[ERROR] rvsim_load_binary: more than %d data words\n", MAX_DATA);
+        return -1;
+    }
+
+    // the CPU only needs the instruction count and the data entries;
+    // rvsim_load() fills in the code size
+    memset(sim->program, 0, sizeof(AssemblyProgram));
+    sim->program->instruction_count = (int)code_words;
+    for(size_t i = 0; i < data_words; ++i)
+    {
+        sim->program->data[i].address = (uint32_t)i * 4;
+        sim->program->data[i].value = data[i];
+    }
+    sim->program->data_count = (int)data_words;
+
+    if(rvsim_reserve_code(sim, code_words) < 0)
+        return -1;
+    memcpy(sim->code, code, sizeof(uint32_t) * code_words);
+    sim->code_count = (int)code_words;
+
+    if(!sim->memory.data && rvsim_init_memory(sim) < 0)
+        return -1;
+    return rvsim_load(sim);
+}
+
+// ================================================================= //
+//                             EXECUTION                             //
+// ================================================================= //
+
+static RvsimStatus rvsim_status(const RiscvSim *sim)
+{
+    if(sim->cpu.stop_reason == CPU_STOP_BREAKPOINT)
+        return RVSIM_BREAKPOINT;
+    if(sim->cpu.stop_reason == CPU_STOP_WATCHPOINT)
+        return RVSIM_WATCHPOINT;
+    return sim->cpu.halted ? RVSIM_HALTED : RVSIM_BUDGET;
+}
+
+// the instruction counter saturates rather than wraps
+static uint32_t rvsim_limit(const RiscvSim *sim, uint32_t budget)
+{
+    uint64_t limit = (uint64_t)sim->cpu.instructions_executed + budget;
+    return (limit > UINT32_MAX) ? UINT32_MAX : (uint32_t)limit;
+}
+
+RvsimStatus rvsim_run(RiscvSim *sim, uint32_t budget)
+{
+    if(!sim->loaded)
+    {
+        LOG_ERROR(LOG_CAT_MAIN, "[ERROR] rvsim_run: no program loaded\n");
+        return RVSIM_ERROR;
+    }
+
+    sim->cpu.max_instructions = rvsim_limit(sim, budget);
+
+    int rc = cpu_run(&sim->cpu);
+    syscall_flush(&sim->syscalls);
+    return (rc < 0) ? RVSIM_ERROR : rvsim_status(sim);
+}
+
+RvsimStatus rvsim_run_for(RiscvSim *sim, uint32_t budget)
+{
+    if(!sim->loaded)
+    {
+        LOG_ERROR(LOG_CAT_MAIN, "[ERROR] rvsim_run_for: no program loaded\n");
+        return RVSIM_ERROR;
+    }
+
+    // guest output stays buffered across slices until the run stops
+    RvsimStatus status = (cpu_run_for(&sim->cpu, budget) < 0) ? RVSIM_ERROR : rvsim_status(sim);
+    if(status != RVSIM_BUDGET)
+        syscall_flush(&sim->syscalls);
+    return status;
+}
+
+int rvsim_run_async(RiscvSim *sim, uint32_t budget, RvsimDone done, void *user)
+{
+    if(!sim->loaded)
+    {
+        LOG_ERROR(LOG_CAT_MAIN, "[ERROR] rvsim_run_async: no program loaded\n");
+        return -1;
+    }
+
+    sim->pending = 1;
+    sim->run_end = rvsim_limit(sim, budget);
+    sim->done = done;
+    sim->done_user = user;
+    return 0;
+}
+
+int rvsim_poll(RiscvSim *sim, uint32_t slice)
+{
+    if(!sim->pending)
+        return 0;
+
+    uint32_t left = sim->run_end - sim->cpu.instructions_executed;
+    RvsimStatus status = rvsim_run_for(sim, (left < slice) ? left : slice);
+    if(status == RVSIM_BUDGET && sim->cpu.instructions_executed < sim->run_end)
+        return 1;
+
+    // the callback may start the next run on this context
+    syscall_flush(&sim->syscalls);
+    sim->pending = 0;
+    if(sim->done)
+        sim->done(sim, status, sim->done_user);
+    return sim->pending;
+}
+
+int rvsim_pending(const RiscvSim *sim)
+{
+    return sim->pending;
+}
+
+void rvsim_cancel(RiscvSim *sim)
+{
+    sim->pending = 0;
+}
+
+int rvsim_set_breakpoint(RiscvSim *sim, uint32_t pc)
+{
+    if(!sim->loaded)
+    {
+        LOG_ERROR(LOG_CAT_MAIN, "[ERROR] rvsim_set_breakpoint: no program loaded\n");
+        return -1;
+    }
+    return cpu_set_breakpoint(&sim->cpu, pc);
+}
+
+void rvsim_clear_breakpoint(RiscvSim *sim, uint32_t pc)
+{
+    cpu_clear_breakpoint(&sim->cpu, pc);
+}
+
+int rvsim_set_watchpoint(RiscvSim *sim, uint32_t addr, uint32_t len, int kind)
+{
+    if(!sim->loaded)
+    {
+        LOG_ERROR(LOG_CAT_MAIN, "[ERROR] rvsim_set_watchpoint: no program loaded\n");
+        return -1;
+    }
+    return cpu_set_watchpoint(&sim->cpu, addr, len, kind);
+}
+
+void rvsim_clear_watchpoint(RiscvSim *sim, uint32_t addr, uint32_t len, int kind)
+{
+    cpu_clear_watchpoint(&sim->cpu, addr, len, kind);
+}
+
+// ================================================================= //
+//                         REVERSE EXECUTION                         //
+// ================================================================= //
+
+uint32_t rvsim_step_back(RiscvSim *sim, uint32_t count)
+{
+    if(!sim->cpu.undo)
+    {
+        LOG_ERROR(LOG_CAT_MAIN, "[ERROR] rvsim_step_back: reverse execution is not enabled\n");
+        return 0;
+    }
+
+    return undo_step_back(sim->cpu.undo, &sim->cpu, count);
+}
+
+int rvsim_reverse_continue(RiscvSim *sim, const UndoStop *stop)
+{
+    if(!sim->cpu.undo)
+    {
+        LOG_ERROR(LOG_CAT_MAIN, "[ERROR] rvsim_reverse_continue: reverse execution is not enabled\n");
+        return -1;
+    }
+
+    return undo_reverse_continue(sim->cpu.undo, &sim->cpu, stop);
+}
+
+// ================================================================= //
+//                             SNAPSHOTS                             //
+// ================================================================= //
+
+CpuSnapshot *rvsim_snapshot(RiscvSim *sim)
+{
+    if(!sim->loaded)
+    {
+        LOG_ERROR(LOG_CAT_MAIN, "[ERROR] rvsim_snapshot: no program loaded\n");
+        return NULL;
+    }
+
+    CpuSnapshot *snap = malloc(sizeof(CpuSnapshot));
+    if(!snap)
+        return NULL;
+
+    if(snapshot_take(snap, &sim->cpu) < 0)
+    {
+        free(snap);
+        return NULL;
+    }
+    return snap;
+}
+
+int rvsim_restore(RiscvSim *sim, const CpuSnapshot *snap)
+{
+    return snapshot_restore(snap, &sim->cpu);
+}
+
+void rvsim_snapshot_free(CpuSnapshot *snap)
+{
+    snapshot_free(snap);
+    free(snap);
+}
+
+// ================================================================= //
+//                           STATE ACCESS                            //
+// ================================================================= //
+
+int32_t rvsim_get_reg(const RiscvSim *sim, int index)
+{
+    if(index < 0 || index >= REG_NUMBER)
+        return 0;
+    return sim->cpu.regs[index];
+}
+
+int rvsim_set_reg(RiscvSim *sim, int index, int32_t value)
+{
+    if(index <= 0 || index >= REG_NUMBER)
+        return -1;
+    sim->cpu.regs[index] = value;
+    return 0;
+}
+
+uint32_t rvsim_get_pc(const RiscvSim *sim)
+{
+    return sim->cpu.pc;
+}
+
+void rvsim_set_pc(RiscvSim *sim, uint32_t pc)
+{
+    sim->cpu.pc = pc;
+    sim->cpu.halted = 0;
+}
+
+int rvsim_read_memory(const RiscvSim *sim, uint32_t addr, void *buf, size_t len)
+{
+    if(!sim->memory.data || (size_t)addr + len > sim->memory.size)
+        return -1;
+    memcpy(buf, sim->memory.data + addr, len);
+    return 0;
+}
+
+int rvsim_write_memory(RiscvSim *sim, uint32_t addr, const void *buf, size_t len)
+{
+    if(!sim->memory.data)
+        return -1;
+    return memory_write(&sim->memory, addr, buf, len);
+}
+
+uint32_t rvsim_data_offset(const RiscvSim *sim)
+{
+    return sim->data_offset;
+}
+
+uint64_t rvsim_instructions_executed(const RiscvSim *sim)
+{
+    return sim->cpu.instructions_executed;
+}
+
+int rvsim_exited(const RiscvSim *sim)
+{
+    return sim->syscalls.exited;
+}
+
+int32_t rvsim_exit_code(const RiscvSim *sim)
+{
+    return sim->syscalls.exit_code;
+}
+
+const CpuStats *rvsim_stats(const RiscvSim *sim)
+{
+    return sim->stats_enabled ? &sim->stats : NULL;
+}
+
+CPU *rvsim_cpu(RiscvSim *sim)
+{
+    return &sim->cpu;
+}
+
+SyscallHost *rvsim_syscalls(RiscvSim *sim)
+{
+    return &sim->syscalls;
+}
+
+Memory *rvsim_memory(RiscvSim *sim)
+{
+    return &sim->memory;
+}
+
+AssemblyProgram *rvsim_program(RiscvSim *sim)
+{
+    return sim->program;
+}
@@ -0,0 +1,316 @@
+#include <stdint.h>
+
+#include "instruction.h"
+#include "rvc.h"
+
+// bits [hi:lo] of v, moved down to bit 0 / up to bit `at`
+#define RVC_GET(v, hi, lo)     (((uint32_t)(v) >> (lo)) & ((1u << ((hi) - (lo) + 1)) - 1))
+#define RVC_PUT(v, hi, lo, at) (RVC_GET(v, hi, lo) << (at))
+
+// compressed register fields only reach x8..x15
+static inline int rvc_is_creg(uint32_t r)
+{
+    return r >= 8 && r <= 15;
+}
+
+static inline int32_t rvc_sext(uint32_t v, int bits)
+{
+    return (int32_t)(v << (32 - bits)) >> (32 - bits);
+}
+
+// ================================================================= //
+//                          32-BIT FORMS                             //
+// ================================================================= //
+
+static uint32_t rvc_itype(int32_t imm, uint32_t rs1, uint32_t funct3, uint32_t rd, uint32_t opcode)
+{
+    return ((uint32_t)imm & 0xFFF) << 20 | rs1 << 15 | funct3 << 12 | rd << 7 | opcode;
+}
+
+static uint32_t rvc_rtype(uint32_t funct7, uint32_t rs2, uint32_t rs1, uint32_t funct3, uint32_t rd)
+{
+    return funct7 << 25 | rs2 << 20 | rs1 << 15 | funct3 << 12 | rd << 7 | 0x33;
+}
+
+static uint32_t rvc_sw(int32_t imm, uint32_t rs2, uint32_t rs1)
+{
+    return RVC_PUT(imm, 11, 5, 25) | rs2 << 20 | rs1 << 15 | 0x2 << 12 | RVC_PUT(imm, 4, 0, 7) | 0x23;
+}
+
+static uint32_t rvc_branch(int32_t imm, uint32_t rs1, uint32_t funct3)
+{
+    return RVC_PUT(imm, 12, 12, 31) | RVC_PUT(imm, 10, 5, 25) | rs1 << 15 | funct3 << 12 |
+           RVC_PUT(imm, 4, 1, 8) | RVC_PUT(imm, 11, 11, 7) | 0x63;
+}
+
+static uint32_t rvc_jal(int32_t imm, uint32_t rd)
+{
+    return RVC_PUT(imm, 20, 20, 31) | RVC_PUT(imm, 10, 1, 21) | RVC_PUT(imm, 11, 11, 20) |
+           RVC_PUT(imm, 19, 12, 12) | rd << 7 | 0x6F;
+}
+
+// ================================================================= //
+//                             COMPRESS                              //
+// ================================================================= //
+
+// offset field shared by C.J and C.JAL
+static uint16_t rvc_cj_offset(int32_t off)
+{
+    return (uint16_t)(RVC_PUT(off, 11, 11, 12) | RVC_PUT(off, 4, 4, 11) | RVC_PUT(off, 9, 8, 9) |
+                      RVC_PUT(off, 10, 10, 8) | RVC_PUT(off, 6, 6, 7) | RVC_PUT(off, 7, 7, 6) |
+                      RVC_PUT(off, 3, 1, 3) | RVC_PUT(off, 5, 5, 2));
+}
+
+// word offset field shared by C.LW and C.SW
+static uint16_t rvc_cl_offset(int32_t off)
+{
+    return (uint16_t)(RVC_PUT(off, 5, 3, 10) | RVC_PUT(off, 2, 2, 6) | RVC_PUT(off, 6, 6, 5));
+}
+
+static uint16_t rvc_compress_addi(uint32_t rd, uint32_t rs1, int32_t imm)
+{
+    if(rd == 0 && rs1 == 0 && imm == 0)
+        return 0x0001;                                                  // C.NOP
+
+    if(rd == 2 && rs1 == 2 && imm != 0 && (imm & 0xF) == 0 && imm >= -512 && imm <= 496)
+        return (uint16_t)(0x6101 | RVC_PUT(imm, 9, 9, 12) | RVC_PUT(imm, 4, 4, 6) | RVC_PUT(imm, 6, 6, 5) |
+                          RVC_PUT(imm, 8, 7, 3) | RVC_PUT(imm, 5, 5, 2)); // C.ADDI16SP
+
+    if(rs1 == 2 && rvc_is_creg(rd) && imm > 0 && (imm & 0x3) == 0 && imm <= 1020)
+        return (uint16_t)(RVC_PUT(imm, 5, 4, 11) | RVC_PUT(imm, 9, 6, 7) | RVC_PUT(imm, 2, 2, 6) |
+                          RVC_PUT(imm, 3, 3, 5) | (rd - 8) << 2);       // C.ADDI4SPN
+
+    if(imm < -32 || imm > 31 || rd == 0)
+        return 0;
+    uint16_t imm6 = (uint16_t)(RVC_PUT(imm, 5, 5, 12) | RVC_PUT(imm, 4, 0, 2));
+
+    if(rd == rs1 && imm != 0)
+        return (uint16_t)(0x0001 | rd << 7 | imm6);                     // C.ADDI
+    if(rs1 == 0)
+        return (uint16_t)(0x4001 | rd << 7 | imm6);                     // C.LI
+    return 0;
+}
+
+static uint16_t rvc_compress_lui(uint32_t rd, uint32_t imm20)
+{
+    int32_t imm = rvc_sext(imm20, 20);
+    if(rd == 0 || rd == 2 || imm == 0 || imm < -32 || imm > 31)
+        return 0;
+    return (uint16_t)(0x6001 | RVC_PUT(imm, 5, 5, 12) | rd << 7 | RVC_PUT(imm, 4, 0, 2));   // C.LUI
+}
+
+static uint16_t rvc_compress_op(uint32_t funct7, uint32_t funct3, uint32_t rd, uint32_t rs1, uint32_t rs2)
+{
+    if(funct7 == 0x00 && funct3 == 0x0 && rd != 0 && rs2 != 0)
+    {
+        if(rs1 == 0)
+            return (uint16_t)(0x8002 | rd << 7 | rs2 << 2);             // C.MV
+        if(rs1 == rd)
+            return (uint16_t)(0x9002 | rd << 7 | rs2 << 2);             // C.ADD
+        return 0;
+    }
+
+    if(rd != rs1 || !rvc_is_creg(rd) || !rvc_is_creg(rs2))
+        return 0;
+
+    uint16_t funct2;
+    if(funct7 == 0x20 && funct3 == 0x0)
+        funct2 = 0;                                                     // C.SUB
+    else if(funct7 == 0x00 && funct3 == 0x4)
+        funct2 = 1;                                                     // C.XOR
+    else if(funct7 == 0x00 && funct3 == 0x6)
+        funct2 = 2;                                                     // C.OR
+    else if(funct7 == 0x00 && funct3 == 0x7)
+        funct2 = 3;                                                     // C.AND
+    else
+        return 0;
+    return (uint16_t)(0x8C01 | (rd - 8) << 7 | funct2 << 5 | (rs2 - 8) << 2);
+}
+
+static uint16_t rvc_compress_lw(uint32_t rd, uint32_t rs1, int32_t off)
+{
+    if(off < 0 || (off & 0x3) != 0)
+        return 0;
+
+    if(rs1 == 2 && rd != 0 && off <= 252)
+        return (uint16_t)(0x4002 | RVC_PUT(off, 5, 5, 12) | rd << 7 | RVC_PUT(off, 4, 2, 4) |
+                          RVC_PUT(off, 7, 6, 2));                      // C.LWSP
+    if(rvc_is_creg(rd) && rvc_is_creg(rs1) && off <= 124)
+        return (uint16_t)(0x4000 | rvc_cl_offset(off) | (rs1 - 8) << 7 | (rd - 8) << 2);   // C.LW
+    return 0;
+}
+
+static uint16_t rvc_compress_sw(uint32_t rs2, uint32_t rs1, int32_t off)
+{
+    if(off < 0 || (off & 0x3) != 0)
+        return 0;
+
+    if(rs1 == 2 && off <= 252)
+        return (uint16_t)(0xC002 | RVC_PUT(off, 5, 2, 9) | RVC_PUT(off, 7, 6, 7) | rs2 << 2);  // C.SWSP
+    if(rvc_is_creg(rs2) && rvc_is_creg(rs1) && off <= 124)
+        return (uint16_t)(0xC000 | rvc_cl_offset(off) | (rs1 - 8) << 7 | (rs2 - 8) << 2);  // C.SW
+    return 0;
+}
+
+uint16_t rvc_compress(uint32_t word)
+{
+    uint32_t rd = rtype_get_rd(word);
+    uint32_t rs1 = rtype_get_rs1(word);
+    uint32_t rs2 = rtype_get_rs2(word);
+    uint32_t funct3 = rtype_get_funct3(word);
+
+    switch(word & 0x7F)
+    {
+        case 0x13:
+            return (funct3 == 0x0) ? rvc_compress_addi(rd, rs1, itype_get_immediate(word)) : 0;
+        case 0x37:
+            return rvc_compress_lui(rd, (uint32_t)utype_get_imm20(word));
+        case 0x33:
+            return rvc_compress_op(rtype_get_funct7(word), funct3, rd, rs1, rs2);
+        case 0x03:
+            return (funct3 == 0x2) ? rvc_compress_lw(rd, rs1, itype_get_immediate(word)) : 0;
+        case 0x23:
+            return (funct3 == 0x2) ? rvc_compress_sw(rs2, rs1, stype_get_immediate(word)) : 0;
+        case 0x6F:
+        {
+            int32_t off = jtype_get_immediate(word);
+            if(rd > 1 || off < -2048 || off > 2046)
+                return 0;
+            return (uint16_t)((rd ? 0x2001 : 0xA001) | rvc_cj_offset(off));   // C.JAL / C.J
+        }
+        case 0x67:
+            if(funct3 != 0x0 || itype_get_immediate(word) != 0 || rs1 == 0 || rd > 1)
+                return 0;
+            return (uint16_t)((rd ? 0x9002 : 0x8002) | rs1 << 7);      // C.JALR / C.JR
+        case 0x63:
+        {
+            int32_t off = btype_get_imm(word);
+            if((funct3 != 0x0 && funct3 != 0x1) || rs2 != 0 || !rvc_is_creg(rs1) || off < -256 || off > 254)
+                return 0;
+            return (uint16_t)((funct3 ? 0xE001 : 0xC001) | RVC_PUT(off, 8, 8, 12) | RVC_PUT(off, 4, 3, 10) |
+                              (rs1 - 8) << 7 | RVC_PUT(off, 7, 6, 5) | RVC_PUT(off, 2, 1, 3) |
+                              RVC_PUT(off, 5, 5, 2));                  // C.BEQZ / C.BNEZ
+        }
+        default:
+            return 0;
+    }
+}
+
+// ================================================================= //
+//                              EXPAND                               //
+// ================================================================= //
+
+static uint32_t rvc_expand_q0(uint32_t h, uint32_t funct3)
+{
+    uint32_t rd = RVC_GET(h, 4, 2) + 8;             // rd' / rs2'
+    uint32_t rs1 = RVC_GET(h, 9, 7) + 8;
+    int32_t off = (int32_t)(RVC_GET(h, 12, 10) << 3 | RVC_GET(h, 6, 6) << 2 | RVC_GET(h, 5, 5) << 6);
+
+    switch(funct3)
+    {
+        case 0x0:
+        {
+            int32_t imm = (int32_t)(RVC_GET(h, 12, 11) << 4 | RVC_GET(h, 10, 7) << 6 |
+                                    RVC_GET(h, 6, 6) << 2 | RVC_GET(h, 5, 5) << 3);
+            return imm ? rvc_itype(imm, 2, 0x0, rd, 0x13) : 0;                 // C.ADDI4SPN
+        }
+        case 0x2:
+            return rvc_itype(off, rs1, 0x2, rd, 0x03);                         // C.LW
+        case 0x6:
+            return rvc_sw(off, rd, rs1);                                        // C.SW
+        default:
+            return 0;
+    }
+}
+
+static uint32_t rvc_expand_q1(uint32_t h, uint32_t funct3)
+{
+    uint32_t rd = RVC_GET(h, 11, 7);
+    int32_t imm6 = rvc_sext(RVC_GET(h, 12, 12) << 5 | RVC_GET(h, 6, 2), 6);
+    int32_t cj = rvc_sext(RVC_GET(h, 12, 12) << 11 | RVC_GET(h, 11, 11) << 4 | RVC_GET(h, 10, 9) << 8 |
+                          RVC_GET(h, 8, 8) << 10 | RVC_GET(h, 7, 7) << 6 | RVC_GET(h, 6, 6) << 7 |
+                          RVC_GET(h, 5, 3) << 1 | RVC_GET(h, 2, 2) << 5, 12);
+
+    switch(funct3)
+    {
+        case 0x0:
+            return rvc_itype(imm6, rd, 0x0, rd, 0x13);                         // C.NOP / C.ADDI
+        case 0x1:
+            return rvc_jal(cj, 1);                                              // C.JAL
+        case 0x2:
+            return rvc_itype(imm6, 0, 0x0, rd, 0x13);                          // C.LI
+        case 0x3:
+            if(rd == 2)
+            {
+                int32_t imm = rvc_sext(RVC_GET(h, 12, 12) << 9 | RVC_GET(h, 6, 6) << 4 | RVC_GET(h, 5, 5) << 6 |
+                                       RVC_GET(h, 4, 3) << 7 | RVC_GET(h, 2, 2) << 5, 10);
+                return imm ? rvc_itype(imm, 2, 0x0, 2, 0x13) : 0;             // C.ADDI16SP
+            }
+            if(imm6 == 0 || rd == 0)
+                return 0;
+            return ((uint32_t)imm6 & 0xFFFFF) << 12 | rd << 7 | 0x37;          // C.LUI
+        case 0x4:
+        {
+            // C.SRLI / C.SRAI / C.ANDI have no 32-bit counterpart here
+            if(RVC_GET(h, 11, 10) != 0x3 || RVC_GET(h, 12, 12) != 0)
+                return 0;
+
+            static const uint32_t funct3s[4] = { 0x0, 0x4, 0x6, 0x7 };         // SUB XOR OR AND
+            uint32_t funct2 = RVC_GET(h, 6, 5);
+            uint32_t rdp = RVC_GET(h, 9, 7) + 8;
+            return rvc_rtype(funct2 ? 0x00 : 0x20, RVC_GET(h, 4, 2) + 8, rdp, funct3s[funct2], rdp);
+        }
+        case 0x5:
+            return rvc_jal(cj, 0);                                              // C.J
+        default:
+        {
+            int32_t off = rvc_sext(RVC_GET(h, 12, 12) << 8 | RVC_GET(h, 11, 10) << 3 | RVC_GET(h, 6, 5) << 6 |
+                                   RVC_GET(h, 4, 3) << 1 | RVC_GET(h, 2, 2) << 5, 9);
+            return rvc_branch(off, RVC_GET(h, 9, 7) + 8, funct3 & 0x1);        // C.BEQZ / C.BNEZ
+        }
+    }
+}
+
+static uint32_t rvc_expand_q2(uint32_t h, uint32_t funct3)
+{
+    uint32_t rd = RVC_GET(h, 11, 7);
+    uint32_t rs2 = RVC_GET(h, 6, 2);
+
+    switch(funct3)
+    {
+        case 0x2:
+        {
+            int32_t off = (int32_t)(RVC_GET(h, 12, 12) << 5 | RVC_GET(h, 6, 4) << 2 | RVC_GET(h, 3, 2) << 6);
+            return rd ? rvc_itype(off, 2, 0x2, rd, 0x03) : 0;                  // C.LWSP
+        }
+        case 0x4:
+            if(RVC_GET(h, 12, 12) == 0)
+            {
+                if(rs2 == 0)
+                    return rd ? rvc_itype(0, rd, 0x0, 0, 0x67) : 0;            // C.JR
+                return rvc_rtype(0x00, rs2, 0, 0x0, rd);                        // C.MV
+            }
+            if(rs2 == 0)
+                return rd ? rvc_itype(0, rd, 0x0, 1, 0x67) : 0;                // C.JALR (C.EBREAK unsupported)
+            return rvc_rtype(0x00, rs2, rd, 0x0, rd);                           // C.ADD
+        case 0x6:
+        {
+            int32_t off = (int32_t)(RVC_GET(h, 12, 9) << 2 | RVC_GET(h, 8, 7) << 6);
+            return rvc_sw(off, rs2, 2);                                         // C.SWSP
+        }
+        default:
+            return 0;
+    }
+}
+
+uint32_t rvc_expand(uint16_t half)
+{
+    uint32_t funct3 = RVC_GET(half, 15, 13);
+    switch(half & 0x3)
+    {
+        case 0x0: return rvc_expand_q0(half, funct3);
+        case 0x1: return rvc_expand_q1(half, funct3);
+        case 0x2: return rvc_expand_q2(half, funct3);
+        default:  return 0;
+    }
+}
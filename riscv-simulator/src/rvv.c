@@ -0,0 +1,189 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rvv.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RVV_X86 1
+#include <immintrin.h>
+#endif
+
+// ================================================================= //
+//                                 C                                 //
+// ================================================================= //
+
+// elements [i, n); vs1 NULL means every element uses x
+static void rvv_tail(RvvOp op, uint32_t *vd, const uint32_t *vs2, const uint32_t *vs1, uint32_t x,
+                     uint32_t i, uint32_t n)
+{
+    for(; i < n; ++i)
+    {
+        uint32_t a = vs2[i];
+        uint32_t b = vs1 ? vs1[i] : x;
+        switch(op)
+        {
+            case RVV_ADD: vd[i] = a + b; break;
+            case RVV_SUB: vd[i] = a - b; break;
+            case RVV_MUL: vd[i] = a * b; break;
+            case RVV_AND: vd[i] = a & b; break;
+            case RVV_OR:  vd[i] = a | b; break;
+            default:      vd[i] = a ^ b; break;
+        }
+    }
+}
+
+#ifdef RVV_X86
+
+// ================================================================= //
+//                               SSE2                                //
+// ================================================================= //
+
+// SSE2 has no 32-bit low multiply (pmulld is SSE4.1): multiply the even
+// and the odd lanes as 64-bit products and interleave their low halves
+static inline __m128i rvv_mullo_sse2(__m128i a, __m128i b)
+{
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// returns the number of elements done
+static uint32_t rvv_op_sse2(RvvOp op, uint32_t *vd, const uint32_t *vs2, const uint32_t *vs1, uint32_t x,
+                            uint32_t n)
+{
+    __m128i splat = _mm_set1_epi32((int)x);
+    uint32_t i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(vs2 + i));
+        __m128i b = vs1 ? _mm_loadu_si128((const __m128i *)(vs1 + i)) : splat;
+        __m128i r;
+        switch(op)
+        {
+            case RVV_ADD: r = _mm_add_epi32(a, b); break;
+            case RVV_SUB: r = _mm_sub_epi32(a, b); break;
+            case RVV_MUL: r = rvv_mullo_sse2(a, b); break;
+            case RVV_AND: r = _mm_and_si128(a, b); break;
+            case RVV_OR:  r = _mm_or_si128(a, b); break;
+            default:      r = _mm_xor_si128(a, b); break;
+        }
+        _mm_storeu_si128((__m128i *)(vd + i), r);
+    }
+    return i;
+}
+
+static inline uint32_t rvv_hsum_sse2(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return (uint32_t)_mm_cvtsi128_si32(v);
+}
+
+static uint32_t rvv_redsum_sse2(const uint32_t *vs2, uint32_t *sum, uint32_t n)
+{
+    __m128i acc = _mm_setzero_si128();
+    uint32_t i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        acc = _mm_add_epi32(acc, _mm_loadu_si128((const __m128i *)(vs2 + i)));
+    }
+    *sum += rvv_hsum_sse2(acc);
+    return i;
+}
+
+// ================================================================= //
+//                               AVX2                                //
+// ================================================================= //
+
+__attribute__((target("avx2")))
+static uint32_t rvv_op_avx2(RvvOp op, uint32_t *vd, const uint32_t *vs2, const uint32_t *vs1, uint32_t x,
+                            uint32_t n)
+{
+    __m256i splat = _mm256_set1_epi32((int)x);
+    uint32_t i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(vs2 + i));
+        __m256i b = vs1 ? _mm256_loadu_si256((const __m256i *)(vs1 + i)) : splat;
+        __m256i r;
+        switch(op)
+        {
+            case RVV_ADD: r = _mm256_add_epi32(a, b); break;
+            case RVV_SUB: r = _mm256_sub_epi32(a, b); break;
+            case RVV_MUL: r = _mm256_mullo_epi32(a, b); break;
+            case RVV_AND: r = _mm256_and_si256(a, b); break;
+            case RVV_OR:  r = _mm256_or_si256(a, b); break;
+            default:      r = _mm256_xor_si256(a, b); break;
+        }
+        _mm256_storeu_si256((__m256i *)(vd + i), r);
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static uint32_t rvv_redsum_avx2(const uint32_t *vs2, uint32_t *sum, uint32_t n)
+{
+    __m256i acc = _mm256_setzero_si256();
+    uint32_t i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        acc = _mm256_add_epi32(acc, _mm256_loadu_si256((const __m256i *)(vs2 + i)));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    *sum += rvv_hsum_sse2(half);
+    return i;
+}
+
+static int rvv_has_avx2(void)
+{
+    return __builtin_cpu_supports("avx2");
+}
+
+#endif // RVV_X86
+
+// ================================================================= //
+//                             DISPATCH                              //
+// ================================================================= //
+
+static void rvv_op(RvvOp op, uint32_t *vd, const uint32_t *vs2, const uint32_t *vs1, uint32_t x, uint32_t n)
+{
+    uint32_t done = 0;
+#ifdef RVV_X86
+    done = rvv_has_avx2() ? rvv_op_avx2(op, vd, vs2, vs1, x, n) : rvv_op_sse2(op, vd, vs2, vs1, x, n);
+#endif
+    rvv_tail(op, vd, vs2, vs1, x, done, n);
+}
+
+void rvv_op_vv(RvvOp op, uint32_t *vd, const uint32_t *vs2, const uint32_t *vs1, uint32_t n)
+{
+    rvv_op(op, vd, vs2, vs1, 0, n);
+}
+
+void rvv_op_vx(RvvOp op, uint32_t *vd, const uint32_t *vs2, uint32_t x, uint32_t n)
+{
+    rvv_op(op, vd, vs2, NULL, x, n);
+}
+
+uint32_t rvv_redsum(const uint32_t *vs2, uint32_t init, uint32_t n)
+{
+    uint32_t sum = init;
+    uint32_t i = 0;
+#ifdef RVV_X86
+    i = rvv_has_avx2() ? rvv_redsum_avx2(vs2, &sum, n) : rvv_redsum_sse2(vs2, &sum, n);
+#endif
+    for(; i < n; ++i)
+    {
+        sum += vs2[i];
+    }
+    return sum;
+}
+
+const char *rvv_host_isa(void)
+{
+#ifdef RVV_X86
+    return rvv_has_avx2() ? "avx2" : "sse2";
+#else
+    return "c";
+#endif
+}
@@ -0,0 +1,360 @@
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "scheduler.h"
+
+typedef struct
+{
+    pthread_t thread;
+    Scheduler *s;
+    uint32_t id;
+    uint32_t rng;                   // victim selection
+    uint64_t slices;
+    uint64_t steals;
+} SchedulerWorker;
+
+int scheduler_init(Scheduler *s, uint32_t workers, uint32_t slice)
+{
+    memset(s, 0, sizeof(*s));
+
+    if(workers == 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = (cpus > 0) ? (uint32_t)cpus : 1;
+    }
+    if(workers > SCHEDULER_MAX_WORKERS)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] scheduler_init: %u workers, at most %u are supported\n",
+                  workers, SCHEDULER_MAX_WORKERS);
+        return -1;
+    }
+
+    s->worker_count = workers;
+    s->slice = slice ? slice : SCHEDULER_DEFAULT_SLICE;
+    return 0;
+}
+
+void scheduler_free(Scheduler *s)
+{
+    if(!s)
+        return;
+
+    free(s->contexts);
+    memset(s, 0, sizeof(*s));
+}
+
+int scheduler_add(Scheduler *s, CPU *cpu)
+{
+    if(!cpu || !cpu->memory || !cpu->program)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] scheduler_add: the context has no memory or program\n");
+        return -1;
+    }
+
+    if(s->context_count == s->context_capacity)
+    {
+        uint32_t capacity = s->context_capacity ? s->context_capacity * 2 : 64;
+        CPU **contexts = (CPU **)realloc(s->contexts, sizeof(CPU *) * capacity);
+        if(!contexts)
+        {
+            LOG_ERROR(LOG_CAT_CPU, "[ERROR] scheduler_add: cannot grow the context list to %u\n", capacity);
+            return -1;
+        }
+        s->contexts = contexts;
+        s->context_capacity = capacity;
+    }
+
+    s->contexts[s->context_count++] = cpu;
+    return 0;
+}
+
+// ================================================================= //
+//                              DEQUES                               //
+// ================================================================= //
+// The owner takes contexts from the head and requeues them at the tail;
+// thieves take from the tail. Every context is in at most one deque, so a
+// ring of `context_count` slots never overflows.
+
+static void scheduler_push(Scheduler *s, SchedulerDeque *d, CPU *cpu)
+{
+    pthread_mutex_lock(&d->lock);
+    d->ring[(d->head + d->count) % s->context_count] = cpu;
+    d->count++;
+    pthread_mutex_unlock(&d->lock);
+}
+
+static CPU *scheduler_pop(Scheduler *s, SchedulerDeque *d)
+{
+    CPU *cpu = NULL;
+    pthread_mutex_lock(&d->lock);
+    if(d->count > 0)
+    {
+        cpu = d->ring[d->head];
+        d->head = (d->head + 1) % s->context_count;
+        d->count--;
+    }
+    pthread_mutex_unlock(&d->lock);
+
+    if(cpu)
+        __atomic_fetch_sub(&s->queued, 1, __ATOMIC_SEQ_CST);
+    return cpu;
+}
+
+static uint32_t scheduler_random(SchedulerWorker *w)
+{
+    // xorshift32
+    uint32_t x = w->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    w->rng = x;
+    return x;
+}
+
+// moves half of the contexts of the first non-empty victim, starting at a
+// random one, to the tail of the thief's deque
+static int scheduler_steal(SchedulerWorker *w)
+{
+    Scheduler *s = w->s;
+    if(s->worker_count < 2)
+        return 0;
+
+    CPU *stolen[64];
+    uint32_t start = scheduler_random(w) % s->worker_count;
+    for(uint32_t i = 0; i < s->worker_count; ++i)
+    {
+        uint32_t victim = (start + i) % s->worker_count;
+        if(victim == w->id)
+            continue;
+
+        SchedulerDeque *d = &s->deques[victim];
+        if(__atomic_load_n(&d->count, __ATOMIC_RELAXED) == 0)
+            continue;
+
+        uint32_t n = 0;
+        pthread_mutex_lock(&d->lock);
+        uint32_t take = (d->count + 1) / 2;
+        if(take > 64)
+            take = 64;
+        for(; n < take; ++n)
+        {
+            d->count--;
+            stolen[n] = d->ring[(d->head + d->count) % s->context_count];
+        }
+        pthread_mutex_unlock(&d->lock);
+
+        if(n == 0)
+            continue;
+
+        SchedulerDeque *own = &s->deques[w->id];
+        pthread_mutex_lock(&own->lock);
+        for(uint32_t k = n; k > 0; --k)
+        {
+            own->ring[(own->head + own->count) % s->context_count] = stolen[k - 1];
+            own->count++;
+        }
+        pthread_mutex_unlock(&own->lock);
+
+        w->steals++;
+        return 1;
+    }
+    return 0;
+}
+
+// ================================================================= //
+//                              WORKERS                              //
+// ================================================================= //
+
+static int scheduler_context_done(const CPU *cpu)
+{
+    return cpu->halted || cpu->error || cpu->stop_reason != CPU_STOP_NONE ||
+           cpu->instructions_executed >= cpu->max_instructions;
+}
+
+static void scheduler_wake(Scheduler *s, int all)
+{
+    pthread_mutex_lock(&s->idle_lock);
+    if(all)
+        pthread_cond_broadcast(&s->idle_wake);
+    else
+        pthread_cond_signal(&s->idle_wake);
+    pthread_mutex_unlock(&s->idle_lock);
+}
+
+// sleeps until a context is queued or every context has left; returns 1 in
+// the latter case. `idle` and `queued` are updated in opposite order by
+// sleepers and by scheduler_requeue(), so one of them always sees the other.
+static int scheduler_wait(Scheduler *s)
+{
+    pthread_mutex_lock(&s->idle_lock);
+    __atomic_fetch_add(&s->idle, 1, __ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&s->live, __ATOMIC_SEQ_CST) != 0 && __atomic_load_n(&s->queued, __ATOMIC_SEQ_CST) == 0)
+        pthread_cond_wait(&s->idle_wake, &s->idle_lock);
+    __atomic_fetch_sub(&s->idle, 1, __ATOMIC_SEQ_CST);
+    int done = (__atomic_load_n(&s->live, __ATOMIC_SEQ_CST) == 0);
+    pthread_mutex_unlock(&s->idle_lock);
+    return done;
+}
+
+static void scheduler_requeue(Scheduler *s, SchedulerDeque *own, CPU *cpu)
+{
+    __atomic_fetch_add(&s->queued, 1, __ATOMIC_SEQ_CST);
+    scheduler_push(s, own, cpu);
+    if(__atomic_load_n(&s->idle, __ATOMIC_SEQ_CST) != 0)
+        scheduler_wake(s, 0);
+}
+
+static void scheduler_leave(Scheduler *s, CPU *cpu, int rc)
+{
+    if(rc < 0 || cpu->error)
+        __atomic_fetch_add(&s->failed, 1, __ATOMIC_RELAXED);
+    if(__atomic_sub_fetch(&s->live, 1, __ATOMIC_SEQ_CST) == 0)
+        scheduler_wake(s, 1);
+}
+
+static void *scheduler_worker(void *arg)
+{
+    SchedulerWorker *w = (SchedulerWorker *)arg;
+    Scheduler *s = w->s;
+    SchedulerDeque *own = &s->deques[w->id];
+
+    for(;;)
+    {
+        CPU *cpu = scheduler_pop(s, own);
+        if(!cpu && scheduler_steal(w))
+            cpu = scheduler_pop(s, own);
+        if(!cpu)
+        {
+            if(scheduler_wait(s))
+                break;
+            continue;
+        }
+
+        // keep running the context while nothing else is waiting here
+        for(;;)
+        {
+            uint32_t left = cpu->max_instructions - cpu->instructions_executed;
+            int rc = cpu_run_for(cpu, (left < s->slice) ? left : s->slice);
+            w->slices++;
+            if(rc < 0)
+                LOG_ERROR(LOG_CAT_CPU, "[ERROR] scheduler_run: context at PC 0x%08X failed\n", cpu->pc);
+
+            if(rc < 0 || scheduler_context_done(cpu))
+            {
+                scheduler_leave(s, cpu, rc);
+                break;
+            }
+            if(__atomic_load_n(&own->count, __ATOMIC_RELAXED) != 0)
+            {
+                scheduler_requeue(s, own, cpu);
+                break;
+            }
+        }
+    }
+    return NULL;
+}
+
+// ================================================================= //
+//                                RUN                                //
+// ================================================================= //
+
+int scheduler_run(Scheduler *s)
+{
+    uint32_t workers = s->worker_count;
+    if(workers > s->context_count)
+        workers = s->context_count;
+    if(workers == 0)
+        return 0;
+
+    SchedulerWorker *threads = (SchedulerWorker *)calloc(workers, sizeof(SchedulerWorker));
+    s->deques = (SchedulerDeque *)calloc(workers, sizeof(SchedulerDeque));
+    CPU **rings = (CPU **)malloc(sizeof(CPU *) * (size_t)s->context_count * workers);
+    if(!threads || !s->deques || !rings)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] scheduler_run: cannot allocate %u workers\n", workers);
+        free(threads);
+        free(s->deques);
+        free(rings);
+        s->deques = NULL;
+        return -1;
+    }
+
+    // only the deques of started workers are used
+    uint32_t configured = s->worker_count;
+    s->worker_count = workers;
+    for(uint32_t i = 0; i < workers; ++i)
+    {
+        pthread_mutex_init(&s->deques[i].lock, NULL);
+        s->deques[i].ring = rings + (size_t)i * s->context_count;
+    }
+
+    s->idle = 0;
+    s->queued = 0;
+    s->live = 0;
+    s->failed = 0;
+    s->slices = 0;
+    s->steals = 0;
+    pthread_mutex_init(&s->idle_lock, NULL);
+    pthread_cond_init(&s->idle_wake, NULL);
+
+    // round-robin over the workers; contexts with nothing left to run are
+    // skipped
+    for(uint32_t c = 0; c < s->context_count; ++c)
+    {
+        CPU *cpu = s->contexts[c];
+        cpu->stop_reason = CPU_STOP_NONE;
+        if(scheduler_context_done(cpu))
+            continue;
+
+        SchedulerDeque *d = &s->deques[s->live % workers];
+        d->ring[d->count++] = cpu;
+        s->live++;
+        s->queued++;
+    }
+
+    uint32_t live = s->live;
+    uint32_t started = 0;
+    for(; started < workers && live > 0; ++started)
+    {
+        threads[started].s = s;
+        threads[started].id = started;
+        threads[started].rng = 2463534242u + started * 2654435761u;
+        if(pthread_create(&threads[started].thread, NULL, scheduler_worker, &threads[started]) != 0)
+            break;
+    }
+
+    int rc = 0;
+    if(started < workers && live > 0)
+    {
+        // the started workers steal the contexts of the missing ones
+        LOG_WARN(LOG_CAT_CPU, "[WARN] scheduler_run: started %u of %u workers\n", started, workers);
+        if(started == 0)
+            rc = -1;
+    }
+
+    for(uint32_t i = 0; i < started; ++i)
+    {
+        pthread_join(threads[i].thread, NULL);
+        s->slices += threads[i].slices;
+        s->steals += threads[i].steals;
+    }
+
+    pthread_cond_destroy(&s->idle_wake);
+    pthread_mutex_destroy(&s->idle_lock);
+    for(uint32_t i = 0; i < workers; ++i)
+    {
+        pthread_mutex_destroy(&s->deques[i].lock);
+    }
+    free(rings);
+    free(s->deques);
+    free(threads);
+    s->deques = NULL;
+    s->worker_count = configured;
+
+    return (rc < 0 || s->failed) ? -1 : 0;
+}
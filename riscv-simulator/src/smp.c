@@ -0,0 +1,243 @@
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "scheduler.h"
+#include "smp.h"
+
+typedef struct
+{
+    pthread_t thread;
+    SmpSystem *smp;
+    CPU *cpu;
+} SmpThread;
+
+int smp_init(SmpSystem *smp, Memory *memory, AssemblyProgram *program, uint32_t hart_count)
+{
+    memset(smp, 0, sizeof(*smp));
+
+    if(!memory || !program || hart_count == 0 || hart_count > SMP_MAX_HARTS)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] smp_init: invalid hart count %u (1-%u)\n", hart_count, SMP_MAX_HARTS);
+        return -1;
+    }
+
+    smp->harts = (CPU *)calloc(hart_count, sizeof(CPU));
+    if(!smp->harts)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] smp_init: cannot allocate %u harts\n", hart_count);
+        return -1;
+    }
+
+    smp->hart_count = hart_count;
+    for(uint32_t h = 0; h < hart_count; ++h)
+    {
+        CPU *cpu = &smp->harts[h];
+        cpu_init_with_program(cpu, memory, program);
+        cpu->trace = 0;
+        cpu->hart_id = h;
+        cpu->regs[10] = (int32_t)h;
+        cpu->regs[11] = (int32_t)hart_count;
+    }
+    return 0;
+}
+
+void smp_free(SmpSystem *smp)
+{
+    if(!smp)
+        return;
+
+    free(smp->harts);
+    memset(smp, 0, sizeof(*smp));
+}
+
+// ================================================================= //
+//                              THREADS                              //
+// ================================================================= //
+
+static int smp_hart_done(const SmpSystem *smp, const CPU *cpu)
+{
+    return cpu->halted || cpu->instructions_executed >= smp->max_instructions;
+}
+
+static uint32_t smp_slice(const SmpSystem *smp, const CPU *cpu, uint32_t slice)
+{
+    uint32_t left = smp->max_instructions - cpu->instructions_executed;
+    return (left < slice) ? left : slice;
+}
+
+static int smp_run_slice(SmpSystem *smp, CPU *cpu, uint32_t slice)
+{
+    if(cpu_run_for(cpu, smp_slice(smp, cpu, slice)) < 0)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] smp_run: hart %u failed at PC 0x%08X\n", cpu->hart_id, cpu->pc);
+        __atomic_store_n(&smp->failed, 1, __ATOMIC_RELAXED);
+        return -1;
+    }
+    return 0;
+}
+
+static void *smp_free_running(void *arg)
+{
+    SmpThread *t = (SmpThread *)arg;
+    SmpSystem *smp = t->smp;
+
+    while(!smp_hart_done(smp, t->cpu) && !__atomic_load_n(&smp->failed, __ATOMIC_RELAXED))
+    {
+        if(smp_run_slice(smp, t->cpu, SMP_STOP_SLICE) < 0)
+            break;
+    }
+    return NULL;
+}
+
+// called with the lock held by the last hart to reach the barrier
+static void smp_next_round(SmpSystem *smp)
+{
+    int finished = 1;
+    for(uint32_t h = 0; h < smp->hart_count && finished; ++h)
+    {
+        finished = smp_hart_done(smp, &smp->harts[h]);
+    }
+
+    smp->finished = finished || smp->failed;
+    smp->waiting = 0;
+    smp->round++;
+    pthread_cond_broadcast(&smp->round_done);
+}
+
+// waits until every hart has finished the current quantum; returns 1 when
+// there is nothing left to run
+static int smp_sync(SmpSystem *smp)
+{
+    pthread_mutex_lock(&smp->lock);
+    uint32_t round = smp->round;
+    if(++smp->waiting == smp->parties)
+    {
+        smp_next_round(smp);
+    }
+    else
+    {
+        while(round == smp->round)
+            pthread_cond_wait(&smp->round_done, &smp->lock);
+    }
+    int finished = smp->finished;
+    pthread_mutex_unlock(&smp->lock);
+    return finished;
+}
+
+static void *smp_lockstep(void *arg)
+{
+    SmpThread *t = (SmpThread *)arg;
+    SmpSystem *smp = t->smp;
+
+    do
+    {
+        if(!smp_hart_done(smp, t->cpu) && !__atomic_load_n(&smp->failed, __ATOMIC_RELAXED))
+            smp_run_slice(smp, t->cpu, smp->quantum);
+    } while(!smp_sync(smp));
+    return NULL;
+}
+
+// ================================================================= //
+//                                RUN                                //
+// ================================================================= //
+
+int smp_run(SmpSystem *smp, uint32_t max_instructions, uint32_t quantum)
+{
+    SmpThread *threads = (SmpThread *)calloc(smp->hart_count, sizeof(SmpThread));
+    if(!threads)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] smp_run: cannot allocate %u threads\n", smp->hart_count);
+        return -1;
+    }
+
+    smp->quantum = quantum;
+    smp->max_instructions = max_instructions;
+    smp->failed = 0;
+    smp->parties = smp->hart_count;
+    smp->waiting = 0;
+    smp->round = 0;
+    smp->finished = 0;
+    pthread_mutex_init(&smp->lock, NULL);
+    pthread_cond_init(&smp->round_done, NULL);
+
+    void *(*body)(void *) = quantum ? smp_lockstep : smp_free_running;
+    uint32_t started = 0;
+    for(; started < smp->hart_count; ++started)
+    {
+        threads[started].smp = smp;
+        threads[started].cpu = &smp->harts[started];
+        if(pthread_create(&threads[started].thread, NULL, body, &threads[started]) != 0)
+            break;
+    }
+
+    if(started < smp->hart_count)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] smp_run: cannot start the thread of hart %u\n", started);
+
+        // stop the harts already running and shrink the barrier to them
+        pthread_mutex_lock(&smp->lock);
+        __atomic_store_n(&smp->failed, 1, __ATOMIC_RELAXED);
+        smp->parties = started;
+        if(started > 0 && smp->waiting == started)
+            smp_next_round(smp);
+        pthread_mutex_unlock(&smp->lock);
+    }
+
+    for(uint32_t h = 0; h < started; ++h)
+    {
+        pthread_join(threads[h].thread, NULL);
+    }
+
+    pthread_cond_destroy(&smp->round_done);
+    pthread_mutex_destroy(&smp->lock);
+    free(threads);
+
+    for(uint32_t h = 0; h < smp->hart_count; ++h)
+    {
+        if(smp->harts[h].error)
+            smp->failed = 1;
+    }
+    return smp->failed ? -1 : 0;
+}
+
+int smp_run_scheduled(SmpSystem *smp, uint32_t max_instructions, uint32_t workers, uint32_t slice)
+{
+    Scheduler sched;
+    if(scheduler_init(&sched, workers, slice) < 0)
+        return -1;
+
+    smp->max_instructions = max_instructions;
+    smp->failed = 0;
+    for(uint32_t h = 0; h < smp->hart_count; ++h)
+    {
+        smp->harts[h].max_instructions = max_instructions;
+        if(scheduler_add(&sched, &smp->harts[h]) < 0)
+        {
+            scheduler_free(&sched);
+            return -1;
+        }
+    }
+
+    int rc = scheduler_run(&sched);
+    LOG_DEBUG(LOG_CAT_CPU, "[DEBUG] smp_run_scheduled: %u harts on %u workers, %llu slices, %llu steals\n",
+              smp->hart_count, (sched.worker_count < smp->hart_count) ? sched.worker_count : smp->hart_count,
+              (unsigned long long)sched.slices, (unsigned long long)sched.steals);
+    scheduler_free(&sched);
+
+    smp->failed = (rc < 0);
+    return rc;
+}
+
+uint64_t smp_instructions_executed(const SmpSystem *smp)
+{
+    uint64_t total = 0;
+    for(uint32_t h = 0; h < smp->hart_count; ++h)
+    {
+        total += smp->harts[h].instructions_executed;
+    }
+    return total;
+}
@@ -0,0 +1,128 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "snapshot.h"
+#include "syscall.h"
+
+int snapshot_take(CpuSnapshot *snap, CPU *cpu)
+{
+    if(!snap || !cpu || !cpu->memory)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] snapshot_take: null argument\n");
+        return -1;
+    }
+
+    Memory *m = cpu->memory;
+    if(memory_track_dirty(m) < 0)
+        return -1;
+
+    memset(snap, 0, sizeof(*snap));
+    snap->memory = (uint8_t *)malloc(m->size ? m->size : 1);
+    if(!snap->memory)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] snapshot_take: allocation failed\n");
+        return -1;
+    }
+    memcpy(snap->memory, m->data, m->size);
+    snap->memory_size = m->size;
+
+    memcpy(snap->regs, cpu->regs, sizeof(snap->regs));
+    snap->vector = cpu->vector;
+    snap->pc = cpu->pc;
+    snap->instructions_executed = cpu->instructions_executed;
+    snap->max_instructions = cpu->max_instructions;
+    snap->halted = cpu->halted;
+    snap->error = cpu->error;
+
+    if(cpu->stats)
+    {
+        snap->stats = *cpu->stats;
+        snap->has_stats = 1;
+    }
+
+    if(cpu->syscalls)
+    {
+        SyscallHost *host = cpu->syscalls;
+        pthread_mutex_lock(&host->lock);
+        snap->brk = host->brk;
+        snap->exited = host->exited;
+        snap->exit_code = host->exit_code;
+        snap->has_syscalls = 1;
+        pthread_mutex_unlock(&host->lock);
+    }
+
+    memory_clear_dirty(m);
+    m->dirty_owner = snap->memory;
+    return 0;
+}
+
+int snapshot_restore(const CpuSnapshot *snap, CPU *cpu)
+{
+    if(!snap || !snap->memory || !cpu || !cpu->memory)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] snapshot_restore: null argument\n");
+        return -1;
+    }
+
+    Memory *m = cpu->memory;
+    if(m->size != snap->memory_size || !m->dirty)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] snapshot_restore: snapshot does not match this memory\n");
+        return -1;
+    }
+
+    if(m->dirty_owner == snap->memory)
+    {
+        for(size_t i = 0; i < m->dirty_count; ++i)
+        {
+            size_t offset = (size_t)m->dirty_pages[i] << MEMORY_PAGE_SHIFT;
+            size_t len = m->size - offset;
+            if(len > MEMORY_PAGE_SIZE)
+                len = MEMORY_PAGE_SIZE;
+            memcpy(m->data + offset, snap->memory + offset, len);
+        }
+    }
+    else
+    {
+        // the dirty set is relative to another snapshot
+        memcpy(m->data, snap->memory, m->size);
+        m->dirty_owner = snap->memory;
+    }
+    memory_clear_dirty(m);
+
+    memcpy(cpu->regs, snap->regs, sizeof(cpu->regs));
+    cpu->vector = snap->vector;
+    cpu->pc = snap->pc;
+    cpu->instructions_executed = snap->instructions_executed;
+    cpu->max_instructions = snap->max_instructions;
+    cpu->halted = snap->halted;
+    cpu->error = snap->error;
+
+    if(cpu->stats && snap->has_stats)
+        *cpu->stats = snap->stats;
+
+    if(cpu->syscalls && snap->has_syscalls)
+    {
+        // output of the run being discarded does not reach the host
+        SyscallHost *host = cpu->syscalls;
+        pthread_mutex_lock(&host->lock);
+        host->brk = snap->brk;
+        host->exited = snap->exited;
+        host->exit_code = snap->exit_code;
+        host->out_len = 0;
+        pthread_mutex_unlock(&host->lock);
+    }
+
+    return 0;
+}
+
+void snapshot_free(CpuSnapshot *snap)
+{
+    if(!snap)
+        return;
+
+    free(snap->memory);
+    snap->memory = NULL;
+    snap->memory_size = 0;
+}
@@ -0,0 +1,310 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "log.h"
+#include "stats.h"
+
+#define STAT_ROLE_COUNT (ROLE_SPECIAL + 1)
+
+static const char *stat_op_names[STAT_OP_COUNT] = {
+    "ADD", "SUB", "XOR", "OR", "AND", "SLL", "SRL", "SRA",
+    "MUL", "MULH", "MULHSU", "MULHU", "DIV", "DIVU", "REM", "REMU",
+    "ANDN", "ORN", "XNOR", "MIN", "MINU", "MAX", "MAXU", "ROL", "ROR",
+    "CLZ", "CTZ", "CPOP", "SEXT.B", "SEXT.H", "ZEXT.H", "REV8", "ORC.B",
+    "ADDI", "LW", "SW", "LUI", "AUIPC",
+    "BEQ", "BNE", "BLT", "BGE", "JAL", "JALR",
+    "LR.W", "SC.W", "AMO",
+    "VSETVLI", "VLE32", "VSE32", "VADD", "VSUB", "VMUL", "VAND", "VOR", "VXOR", "VREDSUM",
+    "CSR", "ECALL"
+};
+
+static const char *stat_format_names[STAT_FMT_COUNT] = {
+    "R", "I", "S", "B", "U", "J", "V"
+};
+
+static const char *stat_role_names[STAT_ROLE_COUNT] = {
+    "zero", "ra", "sp", "gp", "tp", "temp", "saved", "arg", "special"
+};
+
+void stats_init(CpuStats *stats)
+{
+    if(!stats)
+        return;
+
+    memset(stats, 0, sizeof(*stats));
+}
+
+const char *stats_op_name(StatOp op)
+{
+    if(op < 0 || op >= STAT_OP_COUNT)
+        return "UNKNOWN";
+
+    return stat_op_names[op];
+}
+
+const char *stats_format_name(StatFormat fmt)
+{
+    if(fmt < 0 || fmt >= STAT_FMT_COUNT)
+        return "?";
+
+    return stat_format_names[fmt];
+}
+
+const char *stats_role_name(RegRole role)
+{
+    if(role < 0 || role >= STAT_ROLE_COUNT)
+        return "unknown";
+
+    return stat_role_names[role];
+}
+
+static uint64_t stats_total(const CpuStats *stats)
+{
+    uint64_t total = 0;
+    for(int i = 0; i < STAT_OP_COUNT; ++i)
+    {
+        total += stats->op_count[i];
+    }
+    return total;
+}
+
+// static side of RVC: instructions the assembler gave a 16-bit form
+static int stats_code_compressed(const CPU *cpu)
+{
+    int count = 0;
+    for(int i = 0; cpu->program && i < cpu->program->instruction_count; ++i)
+    {
+        count += (cpu->program->instructions[i].size == 2);
+    }
+    return count;
+}
+
+static void stats_group_roles(const CpuStats *stats, const CPU *cpu,
+                              uint64_t reads[STAT_ROLE_COUNT], uint64_t writes[STAT_ROLE_COUNT])
+{
+    for(int r = 0; r < STAT_ROLE_COUNT; ++r)
+    {
+        reads[r] = 0;
+        writes[r] = 0;
+    }
+
+    for(int i = 0; i < REG_NUMBER; ++i)
+    {
+        RegRole role = cpu->reg_roles[i];
+        if(role < 0 || role >= STAT_ROLE_COUNT)
+            role = ROLE_SPECIAL;
+
+        reads[role] += stats->reg_reads[i];
+        writes[role] += stats->reg_writes[i];
+    }
+}
+
+static double stats_percent(uint64_t part, uint64_t total)
+{
+    return total ? (100.0 * (double)part / (double)total) : 0.0;
+}
+
+// ================================================================= //
+//                              TABLES                               //
+// ================================================================= //
+
+void stats_print(const CpuStats *stats, const CPU *cpu)
+{
+    if(!stats || !cpu)
+    {
+        LOG_ERROR(LOG_CAT_STATS, "[ERROR] stats_print: stats or cpu is NULL\n");
+        return;
+    }
+
+    uint64_t total = stats_total(stats);
+
+    LOG_INFO(LOG_CAT_STATS, "\n=== EXECUTION STATISTICS ===\n");
+    LOG_INFO(LOG_CAT_STATS, "Instructions retired: %llu\n", (unsigned long long)total);
+
+    LOG_INFO(LOG_CAT_STATS, "\nInstruction mix by operation:\n");
+    LOG_INFO(LOG_CAT_STATS, "  %-8s %10s %8s\n", "op", "count", "share");
+    for(int i = 0; i < STAT_OP_COUNT; ++i)
+    {
+        if(stats->op_count[i] == 0)
+            continue;
+
+        LOG_INFO(LOG_CAT_STATS, "  %-8s %10llu %7.1f%%\n", stat_op_names[i],
+               (unsigned long long)stats->op_count[i], stats_percent(stats->op_count[i], total));
+    }
+
+    LOG_INFO(LOG_CAT_STATS, "\nInstruction mix by format:\n");
+    LOG_INFO(LOG_CAT_STATS, "  %-8s %10s %8s\n", "format", "count", "share");
+    for(int i = 0; i < STAT_FMT_COUNT; ++i)
+    {
+        LOG_INFO(LOG_CAT_STATS, "  %-8s %10llu %7.1f%%\n", stat_format_names[i],
+               (unsigned long long)stats->format_count[i], stats_percent(stats->format_count[i], total));
+    }
+
+    uint64_t branches = stats->branches_taken + stats->branches_not_taken;
+    LOG_INFO(LOG_CAT_STATS, "\nBranches: %llu (taken=%llu, not taken=%llu, taken rate=%.1f%%)\n",
+           (unsigned long long)branches,
+           (unsigned long long)stats->branches_taken,
+           (unsigned long long)stats->branches_not_taken,
+           stats_percent(stats->branches_taken, branches));
+
+    LOG_INFO(LOG_CAT_STATS, "Memory: reads=%llu (%llu bytes), writes=%llu (%llu bytes)\n",
+           (unsigned long long)stats->mem_reads, (unsigned long long)stats->mem_bytes_read,
+           (unsigned long long)stats->mem_writes, (unsigned long long)stats->mem_bytes_written);
+
+    if(cpu->program)
+    {
+        int count = cpu->program->instruction_count;
+        LOG_INFO(LOG_CAT_STATS, "Code: %u bytes for %d instructions (%d compressed, %.1f%% of 32-bit size)\n",
+               cpu->program->code_size, count, stats_code_compressed(cpu),
+               stats_percent(cpu->program->code_size, (uint64_t)count * 4));
+    }
+    LOG_INFO(LOG_CAT_STATS, "Fetch: %llu bytes (%.2f per instruction), compressed retired=%llu (%.1f%%)\n",
+           (unsigned long long)stats->fetch_bytes, total ? (double)stats->fetch_bytes / (double)total : 0.0,
+           (unsigned long long)stats->compressed, stats_percent(stats->compressed, total));
+
+    LOG_INFO(LOG_CAT_STATS, "\nRegister usage:\n");
+    LOG_INFO(LOG_CAT_STATS, "  %-4s %-8s %10s %10s\n", "reg", "role", "reads", "writes");
+    for(int i = 0; i < REG_NUMBER; ++i)
+    {
+        if(stats->reg_reads[i] == 0 && stats->reg_writes[i] == 0)
+            continue;
+
+        LOG_INFO(LOG_CAT_STATS, "  x%-3d %-8s %10llu %10llu\n", i, stats_role_name(cpu->reg_roles[i]),
+               (unsigned long long)stats->reg_reads[i], (unsigned long long)stats->reg_writes[i]);
+    }
+
+    uint64_t role_reads[STAT_ROLE_COUNT];
+    uint64_t role_writes[STAT_ROLE_COUNT];
+    stats_group_roles(stats, cpu, role_reads, role_writes);
+
+    LOG_INFO(LOG_CAT_STATS, "\nRegister usage by role:\n");
+    LOG_INFO(LOG_CAT_STATS, "  %-8s %10s %10s\n", "role", "reads", "writes");
+    for(int r = 0; r < STAT_ROLE_COUNT; ++r)
+    {
+        LOG_INFO(LOG_CAT_STATS, "  %-8s %10llu %10llu\n", stat_role_names[r],
+               (unsigned long long)role_reads[r], (unsigned long long)role_writes[r]);
+    }
+}
+
+// ================================================================= //
+//                            JSON / CSV                             //
+// ================================================================= //
+
+int stats_write_json(const CpuStats *stats, const CPU *cpu, FILE *out)
+{
+    if(!stats || !cpu || !out)
+    {
+        LOG_ERROR(LOG_CAT_STATS, "[ERROR] stats_write_json: null argument\n");
+        return -1;
+    }
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"instructions\": %llu,\n", (unsigned long long)stats_total(stats));
+
+    fprintf(out, "  \"ops\": {");
+    for(int i = 0; i < STAT_OP_COUNT; ++i)
+    {
+        fprintf(out, "%s\"%s\": %llu", i ? ", " : "", stat_op_names[i],
+                (unsigned long long)stats->op_count[i]);
+    }
+    fprintf(out, "},\n");
+
+    fprintf(out, "  \"formats\": {");
+    for(int i = 0; i < STAT_FMT_COUNT; ++i)
+    {
+        fprintf(out, "%s\"%s\": %llu", i ? ", " : "", stat_format_names[i],
+                (unsigned long long)stats->format_count[i]);
+    }
+    fprintf(out, "},\n");
+
+    fprintf(out, "  \"branches\": {\"taken\": %llu, \"not_taken\": %llu},\n",
+            (unsigned long long)stats->branches_taken, (unsigned long long)stats->branches_not_taken);
+
+    fprintf(out, "  \"memory\": {\"reads\": %llu, \"writes\": %llu, \"bytes_read\": %llu, \"bytes_written\": %llu},\n",
+            (unsigned long long)stats->mem_reads, (unsigned long long)stats->mem_writes,
+            (unsigned long long)stats->mem_bytes_read, (unsigned long long)stats->mem_bytes_written);
+
+    fprintf(out, "  \"code\": {\"bytes\": %u, \"instructions\": %d, \"compressed\": %d},\n",
+            cpu->program ? cpu->program->code_size : 0, cpu->program ? cpu->program->instruction_count : 0,
+            stats_code_compressed(cpu));
+    fprintf(out, "  \"fetch\": {\"bytes\": %llu, \"compressed\": %llu},\n",
+            (unsigned long long)stats->fetch_bytes, (unsigned long long)stats->compressed);
+
+    fprintf(out, "  \"registers\": [\n");
+    for(int i = 0; i < REG_NUMBER; ++i)
+    {
+        fprintf(out, "    {\"reg\": \"x%d\", \"role\": \"%s\", \"reads\": %llu, \"writes\": %llu}%s\n",
+                i, stats_role_name(cpu->reg_roles[i]),
+                (unsigned long long)stats->reg_reads[i], (unsigned long long)stats->reg_writes[i],
+                i + 1 < REG_NUMBER ? "," : "");
+    }
+    fprintf(out, "  ],\n");
+
+    uint64_t role_reads[STAT_ROLE_COUNT];
+    uint64_t role_writes[STAT_ROLE_COUNT];
+    stats_group_roles(stats, cpu, role_reads, role_writes);
+
+    fprintf(out, "  \"roles\": {");
+    for(int r = 0; r < STAT_ROLE_COUNT; ++r)
+    {
+        fprintf(out, "%s\"%s\": {\"reads\": %llu, \"writes\": %llu}", r ? ", " : "", stat_role_names[r],
+                (unsigned long long)role_reads[r], (unsigned long long)role_writes[r]);
+    }
+    fprintf(out, "}\n");
+    fprintf(out, "}\n");
+
+    return ferror(out) ? -1 : 0;
+}
+
+int stats_write_csv(const CpuStats *stats, const CPU *cpu, FILE *out)
+{
+    if(!stats || !cpu || !out)
+    {
+        LOG_ERROR(LOG_CAT_STATS, "[ERROR] stats_write_csv: null argument\n");
+        return -1;
+    }
+
+    fprintf(out, "category,name,value\n");
+    fprintf(out, "total,instructions,%llu\n", (unsigned long long)stats_total(stats));
+
+    for(int i = 0; i < STAT_OP_COUNT; ++i)
+    {
+        fprintf(out, "op,%s,%llu\n", stat_op_names[i], (unsigned long long)stats->op_count[i]);
+    }
+
+    for(int i = 0; i < STAT_FMT_COUNT; ++i)
+    {
+        fprintf(out, "format,%s,%llu\n", stat_format_names[i], (unsigned long long)stats->format_count[i]);
+    }
+
+    fprintf(out, "branch,taken,%llu\n", (unsigned long long)stats->branches_taken);
+    fprintf(out, "branch,not_taken,%llu\n", (unsigned long long)stats->branches_not_taken);
+
+    fprintf(out, "memory,reads,%llu\n", (unsigned long long)stats->mem_reads);
+    fprintf(out, "memory,writes,%llu\n", (unsigned long long)stats->mem_writes);
+    fprintf(out, "memory,bytes_read,%llu\n", (unsigned long long)stats->mem_bytes_read);
+    fprintf(out, "memory,bytes_written,%llu\n", (unsigned long long)stats->mem_bytes_written);
+
+    fprintf(out, "code,bytes,%u\n", cpu->program ? cpu->program->code_size : 0);
+    fprintf(out, "code,compressed,%d\n", stats_code_compressed(cpu));
+    fprintf(out, "fetch,bytes,%llu\n", (unsigned long long)stats->fetch_bytes);
+    fprintf(out, "fetch,compressed,%llu\n", (unsigned long long)stats->compressed);
+
+    for(int i = 0; i < REG_NUMBER; ++i)
+    {
+        fprintf(out, "reg_reads,x%d,%llu\n", i, (unsigned long long)stats->reg_reads[i]);
+        fprintf(out, "reg_writes,x%d,%llu\n", i, (unsigned long long)stats->reg_writes[i]);
+    }
+
+    uint64_t role_reads[STAT_ROLE_COUNT];
+    uint64_t role_writes[STAT_ROLE_COUNT];
+    stats_group_roles(stats, cpu, role_reads, role_writes);
+
+    for(int r = 0; r < STAT_ROLE_COUNT; ++r)
+    {
+        fprintf(out, "role_reads,%s,%llu\n", stat_role_names[r], (unsigned long long)role_reads[r]);
+        fprintf(out, "role_writes,%s,%llu\n", stat_role_names[r], (unsigned long long)role_writes[r]);
+    }
+
+    return ferror(out) ? -1 : 0;
+}
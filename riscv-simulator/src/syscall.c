@@ -0,0 +1,257 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "syscall.h"
+#include "undo.h"
+
+typedef int32_t (*SyscallHandler)(SyscallHost *host, CPU *cpu, const int32_t args[3]);
+
+// ================================================================= //
+//                              OUTPUT                               //
+// ================================================================= //
+
+static int syscall_write_all(int fd, const char *buf, size_t len)
+{
+    while(len > 0)
+    {
+        ssize_t n = write(fd, buf, len);
+        if(n < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+int syscall_flush(SyscallHost *host)
+{
+    if(host->out_len == 0)
+        return 0;
+
+    // simulator messages queued before the guest output come out first
+    log_sync();
+
+    size_t len = host->out_len;
+    host->out_len = 0;
+    if(syscall_write_all(host->out_fd, host->out, len) < 0)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] syscall_flush: writing %zu bytes of guest output to fd %d failed\n",
+                  len, host->out_fd);
+        return -1;
+    }
+    return 0;
+}
+
+// ================================================================= //
+//                             LIFECYCLE                             //
+// ================================================================= //
+
+int syscall_host_init(SyscallHost *host)
+{
+    memset(host, 0, sizeof(*host));
+    host->out_fd = STDOUT_FILENO;
+    if(pthread_mutex_init(&host->lock, NULL) != 0)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] syscall_host_init: cannot create the lock\n");
+        return -1;
+    }
+    return 0;
+}
+
+void syscall_host_free(SyscallHost *host)
+{
+    syscall_flush(host);
+    pthread_mutex_destroy(&host->lock);
+}
+
+void syscall_host_reset(SyscallHost *host, const AssemblyProgram *program)
+{
+    syscall_flush(host);
+
+    uint32_t end = 0;
+    for(int i = 0; i < program->data_count; ++i)
+    {
+        if(program->data[i].address + 4 > end)
+            end = program->data[i].address + 4;
+    }
+    host->brk_start = end;
+    host->brk = end;
+    host->exited = 0;
+    host->exit_code = 0;
+    host->replay = 0;
+}
+
+// ================================================================= //
+//                             HANDLERS                              //
+// ================================================================= //
+
+// host address of the data-relative guest range [addr, addr + len), or NULL
+// if it is not inside memory
+static uint8_t *syscall_guest_range(CPU *cpu, int32_t addr, int32_t len)
+{
+    uint64_t start = (uint64_t)cpu->program->code_size + (uint32_t)addr;
+    if(len < 0 || start + (uint32_t)len > cpu->memory->size)
+        return NULL;
+    return cpu->memory->data + start;
+}
+
+static int32_t syscall_read(SyscallHost *host, CPU *cpu, const int32_t args[3])
+{
+    if(args[0] != STDIN_FILENO)
+        return -EBADF;
+    uint8_t *buf = syscall_guest_range(cpu, args[1], args[2]);
+    if(!buf)
+        return -EFAULT;
+    if(host->replay)
+        return 0;                   // not recorded: behave as end of input
+
+    // a prompt written before the read has to be visible
+    syscall_flush(host);
+
+    ssize_t n;
+    do
+    {
+        n = read(STDIN_FILENO, buf, (size_t)args[2]);
+    } while(n < 0 && errno == EINTR);
+    if(n < 0)
+        return -errno;
+
+    memory_mark_dirty(cpu->memory, (uint32_t)(buf - cpu->memory->data), (size_t)n);
+    return (int32_t)n;
+}
+
+static int32_t syscall_write(SyscallHost *host, CPU *cpu, const int32_t args[3])
+{
+    int fd = args[0];
+    if(fd != STDOUT_FILENO && fd != STDERR_FILENO)
+        return -EBADF;
+    const uint8_t *buf = syscall_guest_range(cpu, args[1], args[2]);
+    if(!buf)
+        return -EFAULT;
+    if(host->replay)
+        return args[2];
+
+    size_t len = (size_t)args[2];
+    if(fd != host->out_fd || host->out_len + len > SYSCALL_OUT_BUFFER)
+        syscall_flush(host);
+    host->out_fd = fd;
+
+    if(len >= SYSCALL_OUT_BUFFER)
+    {
+        log_sync();
+        if(syscall_write_all(fd, (const char *)buf, len) < 0)
+            return -errno;
+        return (int32_t)len;
+    }
+
+    memcpy(host->out + host->out_len, buf, len);
+    host->out_len += len;
+    return (int32_t)len;
+}
+
+static int32_t syscall_exit(SyscallHost *host, CPU *cpu, const int32_t args[3])
+{
+    host->exited = 1;
+    host->exit_code = args[0];
+    cpu->halted = 1;
+    syscall_flush(host);
+    return args[0];
+}
+
+static int32_t syscall_clock_gettime(SyscallHost *host, CPU *cpu, const int32_t args[3])
+{
+    (void)host;
+    struct timespec ts;
+    if(args[0] != CLOCK_REALTIME && args[0] != CLOCK_MONOTONIC)
+        return -EINVAL;
+    if(!syscall_guest_range(cpu, args[1], 8))
+        return -EFAULT;
+
+    clock_gettime((clockid_t)args[0], &ts);
+    uint32_t words[2] = { (uint32_t)ts.tv_sec, (uint32_t)ts.tv_nsec };
+    memory_write_words(cpu->memory, cpu->program->code_size + (uint32_t)args[1], words, 2);
+    return 0;
+}
+
+// like Linux, a break outside the heap leaves it where it was
+static int32_t syscall_brk(SyscallHost *host, CPU *cpu, const int32_t args[3])
+{
+    uint32_t addr = (uint32_t)args[0];
+    uint64_t limit = cpu->memory->size - cpu->program->code_size;
+    if(addr >= host->brk_start && addr <= limit)
+        host->brk = addr;
+    return (int32_t)host->brk;
+}
+
+static const SyscallHandler syscall_table[SYSCALL_COUNT] = {
+    [SYSCALL_READ]          = syscall_read,
+    [SYSCALL_WRITE]         = syscall_write,
+    [SYSCALL_EXIT]          = syscall_exit,
+    [SYSCALL_EXIT_GROUP]    = syscall_exit,
+    [SYSCALL_CLOCK_GETTIME] = syscall_clock_gettime,
+    [SYSCALL_BRK]           = syscall_brk,
+};
+
+static const char *const syscall_names[SYSCALL_COUNT] = {
+    [SYSCALL_READ]          = "read",
+    [SYSCALL_WRITE]         = "write",
+    [SYSCALL_EXIT]          = "exit",
+    [SYSCALL_EXIT_GROUP]    = "exit_group",
+    [SYSCALL_CLOCK_GETTIME] = "clock_gettime",
+    [SYSCALL_BRK]           = "brk",
+};
+
+const char *syscall_name(uint32_t number)
+{
+    if(number >= SYSCALL_COUNT || !syscall_names[number])
+        return "unknown";
+    return syscall_names[number];
+}
+
+// ================================================================= //
+//                             DISPATCH                              //
+// ================================================================= //
+
+int syscall_dispatch(CPU *cpu)
+{
+    SyscallHost *host = cpu->syscalls;
+    if(!host)
+        return -1;
+
+    uint32_t number = (uint32_t)cpu->regs[17];
+    const int32_t args[3] = { cpu->regs[10], cpu->regs[11], cpu->regs[12] };
+
+    // reverse execution replays what the call did the first time
+    int32_t result = -ENOSYS;
+    if(host->replay && cpu->undo && undo_syscall_replay(cpu->undo, cpu, &result))
+    {
+        cpu_writeback(cpu, 10, result);
+        return 0;
+    }
+
+    SyscallHandler handler = (number < SYSCALL_COUNT) ? syscall_table[number] : NULL;
+    if(handler)
+    {
+        pthread_mutex_lock(&host->lock);
+        result = handler(host, cpu, args);
+        pthread_mutex_unlock(&host->lock);
+    }
+    else
+    {
+        LOG_WARN(LOG_CAT_CPU, "[WARN] syscall_dispatch: unknown system call %u at PC 0x%08X\n", number, cpu->pc);
+    }
+
+    if(cpu->undo && !host->replay)
+        undo_syscall_end(cpu->undo, cpu, result);
+    cpu_writeback(cpu, 10, result);
+    return 0;
+}
@@ -0,0 +1,389 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "log.h"
+#include "rvc.h"
+#include "trace.h"
+
+#define TRACE_MAX_RECORD_SIZE 32
+#define TRACE_IDLE_SLEEP_NS 50000
+
+struct TraceWriter
+{
+    FILE *file;
+    pthread_t thread;
+
+    uint8_t *ring;
+    size_t ring_mask;
+
+    // head is only written by the simulator thread, tail only by the
+    // writer thread; both grow monotonically and are masked on access
+    size_t head;
+    size_t tail;
+    int closing;
+    int failed;
+
+    uint64_t bytes;
+    TraceState state;               // producer-side delta state
+};
+
+// ================================================================= //
+//                             ENCODING                              //
+// ================================================================= //
+
+static inline uint32_t trace_zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t trace_unzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static inline uint8_t *trace_put_varint(uint8_t *p, uint32_t v)
+{
+    while(v >= 0x80)
+    {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static void trace_state_init(TraceState *s, uint32_t pc, const int32_t regs[TRACE_REGS])
+{
+    memset(s, 0, sizeof(*s));
+    s->next_pc = pc;
+    memcpy(s->regs, regs, sizeof(s->regs));
+}
+
+static inline uint32_t trace_word_slot(uint32_t pc)
+{
+    return (pc >> 2) & (TRACE_WORD_CACHE - 1);
+}
+
+static size_t trace_encode(TraceState *s, const TraceRecord *rec, uint8_t *out)
+{
+    uint8_t *p = out + 1;
+    uint8_t flags = rec->flags & (TRACE_F_RD | TRACE_F_LOAD | TRACE_F_STORE);
+
+    if(rec->pc != s->next_pc)
+    {
+        flags |= TRACE_F_JUMP;
+        p = trace_put_varint(p, trace_zigzag((int32_t)(rec->pc - s->next_pc)));
+    }
+
+    uint32_t slot = trace_word_slot(rec->pc);
+    if(!s->word_valid[slot] || s->words[slot] != rec->word)
+    {
+        flags |= TRACE_F_WORD;
+        p = trace_put_varint(p, rec->word);
+        s->words[slot] = rec->word;
+        s->word_valid[slot] = 1;
+    }
+
+    if(flags & TRACE_F_RD)
+    {
+        uint8_t rd = rec->rd & (TRACE_REGS - 1);
+        *p++ = rd;
+        p = trace_put_varint(p, trace_zigzag((int32_t)((uint32_t)rec->rd_value - (uint32_t)s->regs[rd])));
+        s->regs[rd] = rec->rd_value;
+    }
+
+    if(flags & (TRACE_F_LOAD | TRACE_F_STORE))
+    {
+        p = trace_put_varint(p, trace_zigzag((int32_t)(rec->mem_addr - s->last_addr)));
+        p = trace_put_varint(p, trace_zigzag(rec->mem_value));
+        s->last_addr = rec->mem_addr;
+    }
+
+    s->next_pc = rec->pc + rvc_length(rec->word);
+    out[0] = flags;
+    return (size_t)(p - out);
+}
+
+// ================================================================= //
+//                              WRITER                               //
+// ================================================================= //
+
+static void trace_idle(void)
+{
+    struct timespec ts = { 0, TRACE_IDLE_SLEEP_NS };
+    nanosleep(&ts, NULL);
+}
+
+static void *trace_writer_main(void *arg)
+{
+    TraceWriter *w = (TraceWriter *)arg;
+    size_t ring_size = w->ring_mask + 1;
+
+    for(;;)
+    {
+        // read closing before head: once closing is seen, head is final
+        int closing = __atomic_load_n(&w->closing, __ATOMIC_ACQUIRE);
+        size_t head = __atomic_load_n(&w->head, __ATOMIC_ACQUIRE);
+        size_t tail = w->tail;
+
+        if(head == tail)
+        {
+            if(closing)
+                break;
+            trace_idle();
+            continue;
+        }
+
+        // drain up to the end of the ring, the rest on the next pass
+        size_t offset = tail & w->ring_mask;
+        size_t len = head - tail;
+        if(len > ring_size - offset)
+            len = ring_size - offset;
+
+        if(!w->failed && fwrite(w->ring + offset, 1, len, w->file) != len)
+            w->failed = 1;
+
+        __atomic_store_n(&w->tail, tail + len, __ATOMIC_RELEASE);
+    }
+
+    return NULL;
+}
+
+TraceWriter *trace_writer_open(const char *path, uint32_t pc, const int32_t regs[TRACE_REGS], size_t ring_size)
+{
+    // the ring must hold at least a few records and be a power of two
+    size_t size = 1024;
+    while(size < ring_size)
+        size <<= 1;
+
+    TraceWriter *w = (TraceWriter *)calloc(1, sizeof(TraceWriter));
+    if(!w)
+    {
+        LOG_ERROR(LOG_CAT_TRACE, "[ERROR] trace: allocation failed\n");
+        return NULL;
+    }
+
+    w->ring = (uint8_t *)malloc(size);
+    w->file = fopen(path, "wb");
+    if(!w->ring || !w->file)
+    {
+        LOG_ERROR(LOG_CAT_TRACE, "[ERROR] trace: cannot open '%s'\n", path);
+        if(w->file)
+            fclose(w->file);
+        free(w->ring);
+        free(w);
+        return NULL;
+    }
+    w->ring_mask = size - 1;
+
+    uint8_t header[TRACE_MAGIC_SIZE + 4 + TRACE_REGS * 4];
+    memcpy(header, TRACE_MAGIC, TRACE_MAGIC_SIZE);
+    for(int i = 0; i < 4; ++i)
+    {
+        header[TRACE_MAGIC_SIZE + i] = (uint8_t)(pc >> (8 * i));
+    }
+    for(int r = 0; r < TRACE_REGS; ++r)
+    {
+        for(int i = 0; i < 4; ++i)
+        {
+            header[TRACE_MAGIC_SIZE + 4 + r * 4 + i] = (uint8_t)((uint32_t)regs[r] >> (8 * i));
+        }
+    }
+
+    if(fwrite(header, 1, sizeof(header), w->file) != sizeof(header))
+        w->failed = 1;
+    w->bytes = sizeof(header);
+
+    trace_state_init(&w->state, pc, regs);
+
+    if(pthread_create(&w->thread, NULL, trace_writer_main, w) != 0)
+    {
+        LOG_ERROR(LOG_CAT_TRACE, "[ERROR] trace: cannot start writer thread\n");
+        fclose(w->file);
+        free(w->ring);
+        free(w);
+        return NULL;
+    }
+
+    return w;
+}
+
+void trace_writer_record(TraceWriter *w, const TraceRecord *rec)
+{
+    uint8_t buf[TRACE_MAX_RECORD_SIZE];
+    size_t len = trace_encode(&w->state, rec, buf);
+    size_t ring_size = w->ring_mask + 1;
+    size_t head = w->head;
+
+    // wait for the writer thread when the ring is full
+    while(head + len - __atomic_load_n(&w->tail, __ATOMIC_ACQUIRE) > ring_size)
+        sched_yield();
+
+    size_t offset = head & w->ring_mask;
+    size_t first = ring_size - offset;
+    if(first >= len)
+    {
+        memcpy(w->ring + offset, buf, len);
+    }
+    else
+    {
+        memcpy(w->ring + offset, buf, first);
+        memcpy(w->ring, buf + first, len - first);
+    }
+
+    __atomic_store_n(&w->head, head + len, __ATOMIC_RELEASE);
+    w->bytes += len;
+}
+
+int trace_writer_close(TraceWriter *w)
+{
+    if(!w)
+        return -1;
+
+    __atomic_store_n(&w->closing, 1, __ATOMIC_RELEASE);
+    pthread_join(w->thread, NULL);
+
+    int failed = w->failed;
+    if(fclose(w->file) != 0)
+        failed = 1;
+
+    free(w->ring);
+    free(w);
+    return failed ? -1 : 0;
+}
+
+uint64_t trace_writer_bytes(const TraceWriter *w)
+{
+    return w ? w->bytes : 0;
+}
+
+// ================================================================= //
+//                              READER                               //
+// ================================================================= //
+
+static int trace_get_varint(FILE *f, uint32_t *out)
+{
+    uint32_t v = 0;
+    for(int shift = 0; shift < 35; shift += 7)
+    {
+        int c = fgetc(f);
+        if(c == EOF)
+            return -1;
+
+        v |= (uint32_t)(c & 0x7F) << shift;
+        if(!(c & 0x80))
+        {
+            *out = v;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static uint32_t trace_get_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+int trace_reader_open(TraceReader *r, const char *path)
+{
+    memset(r, 0, sizeof(*r));
+
+    FILE *f = fopen(path, "rb");
+    if(!f)
+    {
+        LOG_ERROR(LOG_CAT_TRACE, "[ERROR] trace: cannot open '%s'\n", path);
+        return -1;
+    }
+
+    uint8_t header[TRACE_MAGIC_SIZE + 4 + TRACE_REGS * 4];
+    if(fread(header, 1, sizeof(header), f) != sizeof(header) ||
+       memcmp(header, TRACE_MAGIC, TRACE_MAGIC_SIZE) != 0)
+    {
+        LOG_ERROR(LOG_CAT_TRACE, "[ERROR] trace: '%s' is not a binary trace\n", path);
+        fclose(f);
+        return -1;
+    }
+
+    r->file = f;
+    r->start_pc = trace_get_le32(header + TRACE_MAGIC_SIZE);
+    for(int i = 0; i < TRACE_REGS; ++i)
+    {
+        r->start_regs[i] = (int32_t)trace_get_le32(header + TRACE_MAGIC_SIZE + 4 + i * 4);
+    }
+
+    trace_state_init(&r->state, r->start_pc, r->start_regs);
+    return 0;
+}
+
+int trace_reader_next(TraceReader *r, TraceRecord *rec)
+{
+    FILE *f = (FILE *)r->file;
+    TraceState *s = &r->state;
+
+    int flags = fgetc(f);
+    if(flags == EOF)
+        return 0;
+
+    memset(rec, 0, sizeof(*rec));
+    rec->flags = (uint8_t)flags & (TRACE_F_RD | TRACE_F_LOAD | TRACE_F_STORE);
+    rec->pc = s->next_pc;
+
+    uint32_t v;
+    if(flags & TRACE_F_JUMP)
+    {
+        if(trace_get_varint(f, &v) < 0)
+            return -1;
+        rec->pc = s->next_pc + (uint32_t)trace_unzigzag(v);
+    }
+
+    uint32_t slot = trace_word_slot(rec->pc);
+    if(flags & TRACE_F_WORD)
+    {
+        if(trace_get_varint(f, &v) < 0)
+            return -1;
+        s->words[slot] = v;
+        s->word_valid[slot] = 1;
+    }
+    else if(!s->word_valid[slot])
+    {
+        return -1;
+    }
+    rec->word = s->words[slot];
+
+    if(flags & TRACE_F_RD)
+    {
+        int rd = fgetc(f);
+        if(rd == EOF || rd >= TRACE_REGS || trace_get_varint(f, &v) < 0)
+            return -1;
+        rec->rd = (uint8_t)rd;
+        rec->rd_value = (int32_t)((uint32_t)s->regs[rd] + (uint32_t)trace_unzigzag(v));
+        s->regs[rd] = rec->rd_value;
+    }
+
+    if(flags & (TRACE_F_LOAD | TRACE_F_STORE))
+    {
+        if(trace_get_varint(f, &v) < 0)
+            return -1;
+        rec->mem_addr = s->last_addr + (uint32_t)trace_unzigzag(v);
+        s->last_addr = rec->mem_addr;
+
+        if(trace_get_varint(f, &v) < 0)
+            return -1;
+        rec->mem_value = trace_unzigzag(v);
+    }
+
+    s->next_pc = rec->pc + rvc_length(rec->word);
+    return 1;
+}
+
+void trace_reader_close(TraceReader *r)
+{
+    if(r->file)
+        fclose((FILE *)r->file);
+    r->file = NULL;
+}
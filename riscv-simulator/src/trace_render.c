@@ -0,0 +1,310 @@
+#include <stdio.h>
+#include <stdint.h>
+
+#include "alu.h"
+#include "csr.h"
+#include "instruction.h"
+#include "rvc.h"
+#include "syscall.h"
+#include "trace.h"
+
+// ================================================================= //
+//                          TEXT RENDERING                           //
+// ================================================================= //
+// Mirrors the [STEP]/[EXEC] lines printed by cpu.c; the register file
+// passed in holds the values before the instruction executed.
+
+static void trace_render_rtype(FILE *out, const int32_t regs[TRACE_REGS], const TraceRecord *rec)
+{
+    uint32_t w = rec->word;
+    uint8_t funct7 = rtype_get_funct7(w);
+    uint8_t funct3 = rtype_get_funct3(w);
+    uint8_t rd = rtype_get_rd(w);
+    uint8_t rs1 = rtype_get_rs1(w);
+    uint8_t rs2 = rtype_get_rs2(w);
+
+    ALUOp op = ALU_UNKNOWN;
+    const char *name = "UNKNOWN";
+    if(funct7 == 0x01)
+    {
+        op = ALU_MULDIV_OP(funct3);
+        name = alu_op_name(op);
+    }
+    else if((op = alu_zbb_op(funct7, funct3, rs2)) != ALU_UNKNOWN)
+    {
+        name = alu_op_name(op);
+    }
+    else switch(funct3)
+    {
+        case 0x0:
+            if(funct7 == 0x00)      { op = ALU_ADD; name = "ADD"; }
+            else if(funct7 == 0x20) { op = ALU_SUB; name = "SUB"; }
+            break;
+        case 0x1: op = ALU_SLL; name = "SLL"; break;
+        case 0x4: op = ALU_XOR; name = "XOR"; break;
+        case 0x5:
+            if(funct7 == 0x20)      { op = ALU_SRA; name = "SRA"; }
+            else                    { op = ALU_SRL; name = "SRL"; }
+            break;
+        case 0x6: op = ALU_OR;  name = "OR";  break;
+        case 0x7: op = ALU_AND; name = "AND"; break;
+    }
+
+    int32_t v1 = regs[rs1];
+    int32_t v2 = regs[rs2];
+    int32_t result = (rec->flags & TRACE_F_RD) ? rec->rd_value : alu_execute(op, v1, v2);
+
+    fprintf(out, "[EXEC] %s x%d, x%d, x%d -> x%d = 0x%08X (rs1=0x%08X, rs2=0x%08X)\n",
+            name, rd, rs1, rs2, rd, result, v1, v2);
+}
+
+static void trace_render_itype(FILE *out, const int32_t regs[TRACE_REGS], const TraceRecord *rec)
+{
+    uint32_t w = rec->word;
+    uint8_t opcode = itype_get_opcode(w);
+    uint8_t rd = itype_get_rd(w);
+    uint8_t rs1 = itype_get_rs1(w);
+    int32_t imm = itype_get_immediate(w);
+    int32_t v1 = regs[rs1];
+
+    if(opcode == 0x03)
+    {
+        fprintf(out, "[EXEC] LW x%d, %d(x%d) -> Load from 0x%08X = 0x%08X\n",
+                rd, imm, rs1, rec->mem_addr, rec->mem_value);
+    }
+    else if(opcode == 0x13 && itype_get_funct3(w) != 0x0)
+    {
+        ALUOp op = alu_zbb_imm_op(itype_get_funct3(w), (uint32_t)imm);
+        int32_t result = (rec->flags & TRACE_F_RD) ? rec->rd_value : alu_execute(op, v1, imm & 0x1F);
+        if(op == ALU_ROR)
+            fprintf(out, "[EXEC] RORI x%d, x%d, %d -> x%d = 0x%08X (rs1=0x%08X)\n",
+                    rd, rs1, imm & 0x1F, rd, result, v1);
+        else
+            fprintf(out, "[EXEC] %s x%d, x%d -> x%d = 0x%08X (rs1=0x%08X)\n",
+                    alu_op_name(op), rd, rs1, rd, result, v1);
+    }
+    else if(opcode == 0x13)
+    {
+        int32_t result = v1 + imm;
+        if(rs1 == 0)
+            fprintf(out, "[EXEC] LI x%d, %d -> x%d = 0x%08X\n", rd, imm, rd, result);
+        else
+            fprintf(out, "[EXEC] ADDI x%d, x%d, %d -> x%d = 0x%08X (rs1=0x%08X)\n",
+                    rd, rs1, imm, rd, result, v1);
+    }
+    else
+    {
+        uint32_t target = (uint32_t)((v1 + imm) & ~1U);
+        fprintf(out, "[EXEC] JALR x%d, x%d, imm=%d -> new PC=0x%08X (rs1=0x%08X)\n",
+                rd, rs1, imm, target, (uint32_t)v1);
+    }
+}
+
+static void trace_render_amo(FILE *out, const int32_t regs[TRACE_REGS], const TraceRecord *rec)
+{
+    static const char *names[32] = {
+        [0x00] = "AMOADD.W", [0x01] = "AMOSWAP.W", [0x04] = "AMOXOR.W", [0x08] = "AMOOR.W",
+        [0x0C] = "AMOAND.W", [0x10] = "AMOMIN.W", [0x14] = "AMOMAX.W", [0x18] = "AMOMINU.W",
+        [0x1C] = "AMOMAXU.W"
+    };
+    uint32_t w = rec->word;
+    uint8_t funct5 = rtype_get_funct7(w) >> 2;
+    uint8_t rd = rtype_get_rd(w);
+    uint8_t rs1 = rtype_get_rs1(w);
+    uint8_t rs2 = rtype_get_rs2(w);
+    uint32_t v2 = (uint32_t)regs[rs2];
+
+    if(funct5 == 0x02)
+    {
+        fprintf(out, "[EXEC] LR.W x%d, (x%d) -> Load 0x%08X from 0x%08X, reserved\n",
+                rd, rs1, rec->mem_value, rec->mem_addr);
+    }
+    else if(funct5 == 0x03)
+    {
+        int stored = (rec->flags & TRACE_F_RD) ? rec->rd_value == 0 : (uint32_t)rec->mem_value == v2;
+        fprintf(out, "[EXEC] SC.W x%d, x%d, (x%d) -> %s 0x%08X to 0x%08X\n",
+                rd, rs2, rs1, stored ? "Store" : "Failed store of", v2, rec->mem_addr);
+    }
+    else
+    {
+        // recorded as a load of the old word, whatever rd is
+        fprintf(out, "[EXEC] %s x%d, x%d, (x%d) -> Old 0x%08X at 0x%08X, operand 0x%08X\n",
+                names[funct5] ? names[funct5] : "UNKNOWN", rd, rs2, rs1,
+                (uint32_t)rec->mem_value, rec->mem_addr, v2);
+    }
+}
+
+// element values, vl of loads/stores and VLMAX are not in the record, so
+// the line stops where cpu.c would print them
+static void trace_render_vector(FILE *out, const TraceRecord *rec)
+{
+    static const char *names[64] = {
+        [0x00] = "VADD", [0x02] = "VSUB", [0x09] = "VAND", [0x0A] = "VOR", [0x0B] = "VXOR", [0x25] = "VMUL"
+    };
+    uint32_t w = rec->word;
+    uint8_t funct3 = rtype_get_funct3(w);
+    uint8_t vd = rtype_get_rd(w);
+    uint8_t rs1 = rtype_get_rs1(w);
+    uint8_t vs2 = rtype_get_rs2(w);
+    const char *name = names[vtype_get_funct6(w)] ? names[vtype_get_funct6(w)] : "UNKNOWN";
+
+    if((w & 0x7F) != 0x57)
+    {
+        int store = (w & 0x7F) == 0x27;
+        fprintf(out, "[EXEC] %s v%d, (x%d) -> %s 0x%08X\n", store ? "VSE32.V" : "VLE32.V",
+                vd, rs1, store ? "Store to" : "Load from", rec->mem_addr);
+        return;
+    }
+
+    switch(funct3)
+    {
+        case 0x7:
+        {
+            // same check as cpu_execute_vsetvli: SEW=32 and integer LMUL only
+            uint32_t zimm = vtype_get_zimm(w);
+            if(((zimm >> 3) & 0x7) != 0x2 || (zimm & 0x7) > 3 || (zimm >> 8) != 0)
+                fprintf(out, "[EXEC] VSETVLI x%d, x%d, vtype 0x%03X -> unsupported, vill set\n", vd, rs1, zimm);
+            else if(rec->flags & TRACE_F_RD)
+                fprintf(out, "[EXEC] VSETVLI x%d, x%d, e32, m%u -> vl = %d\n",
+                        vd, rs1, 1u << (zimm & 0x7), rec->rd_value);
+            else
+                fprintf(out, "[EXEC] VSETVLI x%d, x%d, e32, m%u\n", vd, rs1, 1u << (zimm & 0x7));
+            break;
+        }
+        case 0x2:
+            if(vtype_get_funct6(w) == 0x00)
+                fprintf(out, "[EXEC] VREDSUM.VS v%d, v%d, v%d\n", vd, vs2, rs1);
+            else
+                fprintf(out, "[EXEC] %s.VV v%d, v%d, v%d\n", name, vd, vs2, rs1);
+            break;
+        case 0x0:
+            fprintf(out, "[EXEC] %s.VV v%d, v%d, v%d\n", name, vd, vs2, rs1);
+            break;
+        case 0x3:
+            fprintf(out, "[EXEC] %s.VI v%d, v%d, %d\n", name, vd, vs2, (int32_t)((uint32_t)rs1 << 27) >> 27);
+            break;
+        default:
+            fprintf(out, "[EXEC] %s.VX v%d, v%d, x%d\n", name, vd, vs2, rs1);
+            break;
+    }
+}
+
+void trace_render_record(FILE *out, uint32_t step, const int32_t regs[TRACE_REGS], const TraceRecord *rec)
+{
+    uint32_t w = rec->word;
+    uint32_t len = rvc_length(w);
+
+    // a compressed instruction renders as the 32-bit one it stands for
+    TraceRecord expanded;
+    if(len == 2)
+    {
+        expanded = *rec;
+        expanded.word = rvc_expand((uint16_t)w);
+        fprintf(out, "\n[STEP %u] PC=0x%08X, Instruction=0x%04X (compressed, expands to 0x%08X)\n",
+                step, rec->pc, w, expanded.word);
+        rec = &expanded;
+        w = expanded.word;
+    }
+    else
+    {
+        fprintf(out, "\n[STEP %u] PC=0x%08X, Instruction=0x%08X\n", step, rec->pc, w);
+    }
+
+    switch(w & 0x7F)
+    {
+        case 0x33:
+            trace_render_rtype(out, regs, rec);
+            break;
+
+        case 0x03:
+        case 0x13:
+        case 0x67:
+            trace_render_itype(out, regs, rec);
+            break;
+
+        case 0x2F:
+            trace_render_amo(out, regs, rec);
+            break;
+
+        case 0x07:
+        case 0x27:
+        case 0x57:
+            trace_render_vector(out, rec);
+            break;
+
+        case 0x23:
+            fprintf(out, "[EXEC] SW x%d, %d(x%d) -> Store 0x%08X to 0x%08X\n",
+                    stype_get_rs2(w), stype_get_immediate(w), stype_get_rs1(w),
+                    rec->mem_value, rec->mem_addr);
+            break;
+
+        case 0x37:
+            fprintf(out, "[EXEC] LUI x%d, 0x%05X -> x%d = 0x%08X\n",
+                    utype_get_rd(w), (unsigned)utype_get_imm20(w), utype_get_rd(w),
+                    (uint32_t)utype_get_immediate(w));
+            break;
+
+        case 0x17:
+        {
+            uint32_t imm = (uint32_t)utype_get_immediate(w);
+            fprintf(out, "[EXEC] AUIPC x%d, 0x%05X -> x%d = PC(0x%08X) + 0x%08X = 0x%08X\n",
+                    utype_get_rd(w), (unsigned)utype_get_imm20(w), utype_get_rd(w),
+                    rec->pc, imm, rec->pc + imm);
+            break;
+        }
+
+        case 0x63:
+        {
+            static const char *names[8] = { "BEQ", "BNE", "?", "?", "BLT", "BGE", "?", "?" };
+            uint8_t funct3 = btype_get_funct3(w);
+            int32_t v1 = regs[btype_get_rs1(w)];
+            int32_t v2 = regs[btype_get_rs2(w)];
+            int take = 0;
+            switch(funct3)
+            {
+                case 0x0: take = (v1 == v2); break;
+                case 0x1: take = (v1 != v2); break;
+                case 0x4: take = (v1 < v2);  break;
+                case 0x5: take = (v1 >= v2); break;
+            }
+            fprintf(out, "[EXEC] %s x%d, x%d, imm=%d -> %s (rs1=0x%08X, rs2=0x%08X)\n",
+                    names[funct3], btype_get_rs1(w), btype_get_rs2(w), btype_get_imm(w),
+                    take ? "TAKEN" : "NOT TAKEN", (uint32_t)v1, (uint32_t)v2);
+            break;
+        }
+
+        case 0x6F:
+        {
+            int32_t imm = jtype_get_immediate(w);
+            fprintf(out, "[EXEC] JAL x%d, imm=%d -> new PC=0x%08X (return=0x%08X)\n",
+                    rtype_get_rd(w), imm, rec->pc + imm, rec->pc + len);
+            break;
+        }
+
+        case 0x73:
+        {
+            if(w == 0x00000073)
+            {
+                uint32_t number = (uint32_t)regs[17];
+                fprintf(out, "[EXEC] ECALL %s (a7=%u) -> a0 = 0x%08X\n", syscall_name(number), number,
+                        (uint32_t)((rec->flags & TRACE_F_RD) ? rec->rd_value : regs[10]));
+                break;
+            }
+
+            // the value read is only known from the record: time differs per run
+            uint8_t funct3 = itype_get_funct3(w);
+            uint8_t rd = itype_get_rd(w);
+            uint32_t csr = w >> 20;
+            uint32_t value = (rec->flags & TRACE_F_RD) ? (uint32_t)rec->rd_value : 0;
+            fprintf(out, (funct3 & 0x4) ? "[EXEC] %s x%d, %s, %d -> x%d = 0x%08X\n"
+                                        : "[EXEC] %s x%d, %s, x%d -> x%d = 0x%08X\n",
+                    csr_op_name(funct3) ? csr_op_name(funct3) : "UNKNOWN", rd, csr_name(csr),
+                    itype_get_rs1(w), rd, value);
+            break;
+        }
+
+        default:
+            fprintf(out, "[EXEC] UNKNOWN opcode 0x%02X\n", w & 0x7F);
+            break;
+    }
+}
@@ -0,0 +1,536 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "rvc.h"
+#include "syscall.h"
+#include "undo.h"
+
+int undo_init(UndoLog *log, uint32_t capacity, uint32_t keyframe_every, uint32_t max_keyframes)
+{
+    memset(log, 0, sizeof(*log));
+
+    if(capacity == 0 || capacity > (1u << 31))
+        capacity = UNDO_DEFAULT_CAPACITY;
+    uint32_t rounded = 1;
+    while(rounded < capacity)
+        rounded <<= 1;
+
+    log->entries = (UndoEntry *)malloc(sizeof(UndoEntry) * rounded);
+    log->keyframes = (UndoKeyframe *)calloc(max_keyframes ? max_keyframes : 1, sizeof(UndoKeyframe));
+    if(!log->entries || !log->keyframes)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] undo_init: cannot allocate a log of %u entries\n", rounded);
+        undo_free(log);
+        return -1;
+    }
+
+    log->capacity = rounded;
+    log->mask = rounded - 1;
+    log->max_keyframes = max_keyframes;
+    log->keyframe_every = keyframe_every ? keyframe_every : rounded;
+    log->next_keyframe = UINT32_MAX;
+    return 0;
+}
+
+void undo_free(UndoLog *log)
+{
+    if(!log)
+        return;
+
+    if(log->keyframes)
+    {
+        for(uint32_t i = 0; i < log->max_keyframes; ++i)
+        {
+            free(log->keyframes[i].memory);
+        }
+    }
+    for(uint32_t i = log->syscall_head; i < log->syscall_count; ++i)
+    {
+        free(log->syscalls[i].bytes);
+    }
+    free(log->syscalls);
+    free(log->keyframes);
+    free(log->entries);
+    memset(log, 0, sizeof(*log));
+}
+
+int undo_reset(UndoLog *log, CPU *cpu)
+{
+    if(!log->entries || !cpu || !cpu->memory)
+        return -1;
+
+    log->oldest = cpu->instructions_executed;
+    log->keyframe_count = 0;
+    log->keyframe_head = 0;
+    log->memory_size = cpu->memory->size;
+
+    for(uint32_t i = log->syscall_head; i < log->syscall_count; ++i)
+    {
+        free(log->syscalls[i].bytes);
+    }
+    log->syscall_head = 0;
+    log->syscall_count = 0;
+
+    // the first recorded instruction takes a keyframe of the starting state
+    log->next_keyframe = log->max_keyframes ? cpu->instructions_executed : UINT32_MAX;
+    return 0;
+}
+
+// ================================================================= //
+//                            HOST STATE                             //
+// ================================================================= //
+
+static void undo_host_save(const CPU *cpu, UndoHostState *state)
+{
+    const SyscallHost *host = cpu->syscalls;
+    if(!host)
+        return;
+
+    state->brk = host->brk;
+    state->exited = host->exited;
+    state->exit_code = host->exit_code;
+}
+
+static void undo_host_load(CPU *cpu, const UndoHostState *state)
+{
+    SyscallHost *host = cpu->syscalls;
+    if(!host)
+        return;
+
+    host->brk = state->brk;
+    host->exited = state->exited;
+    host->exit_code = state->exit_code;
+}
+
+// ================================================================= //
+//                             KEYFRAMES                             //
+// ================================================================= //
+
+static UndoKeyframe *undo_keyframe_at(UndoLog *log, uint32_t index)
+{
+    return &log->keyframes[(log->keyframe_head + index) % log->max_keyframes];
+}
+
+void undo_keyframe(UndoLog *log, CPU *cpu, uint32_t pc)
+{
+    if(log->max_keyframes == 0 || cpu->memory->size != log->memory_size)
+    {
+        log->next_keyframe = UINT32_MAX;
+        return;
+    }
+
+    UndoKeyframe *kf;
+    if(log->keyframe_count == log->max_keyframes)
+    {
+        // drop the oldest
+        kf = undo_keyframe_at(log, 0);
+        log->keyframe_head = (log->keyframe_head + 1) % log->max_keyframes;
+    }
+    else
+    {
+        kf = undo_keyframe_at(log, log->keyframe_count);
+        log->keyframe_count++;
+    }
+
+    if(!kf->memory)
+    {
+        kf->memory = (uint8_t *)malloc(log->memory_size ? log->memory_size : 1);
+        if(!kf->memory)
+        {
+            LOG_ERROR(LOG_CAT_CPU, "[ERROR] undo_keyframe: allocation failed, keyframes disabled\n");
+            log->keyframe_count--;
+            log->next_keyframe = UINT32_MAX;
+            return;
+        }
+    }
+
+    kf->executed = cpu->instructions_executed;
+    kf->pc = pc;
+    memcpy(kf->regs, cpu->regs, sizeof(kf->regs));
+    kf->vector = cpu->vector;
+    undo_host_save(cpu, &kf->host);
+    memcpy(kf->memory, cpu->memory->data, log->memory_size);
+
+    log->next_keyframe = cpu->instructions_executed + log->keyframe_every;
+    if(log->next_keyframe < cpu->instructions_executed)
+        log->next_keyframe = UINT32_MAX;
+}
+
+// restores keyframe `index` and forgets the ones taken after it
+static int undo_restore_keyframe(UndoLog *log, CPU *cpu, uint32_t index)
+{
+    UndoKeyframe *kf = undo_keyframe_at(log, index);
+    if(memory_write(cpu->memory, 0, kf->memory, log->memory_size) < 0)
+        return -1;
+
+    memcpy(cpu->regs, kf->regs, sizeof(cpu->regs));
+    cpu->vector = kf->vector;
+    undo_host_load(cpu, &kf->host);
+    cpu->pc = kf->pc;
+    cpu->instructions_executed = kf->executed;
+    cpu->halted = 0;
+    cpu->error = 0;
+
+    log->keyframe_count = index + 1;
+    log->next_keyframe = kf->executed + log->keyframe_every;
+    log->oldest = kf->executed;
+    return 0;
+}
+
+// ================================================================= //
+//                           SYSTEM CALLS                            //
+// ================================================================= //
+
+// record of the ECALL at instruction count `executed`, or NULL
+static UndoSyscall *undo_syscall_find(UndoLog *log, uint32_t executed)
+{
+    uint32_t lo = log->syscall_head;
+    uint32_t hi = log->syscall_count;
+    while(lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if(log->syscalls[mid].executed < executed)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return (lo < log->syscall_count && log->syscalls[lo].executed == executed) ? &log->syscalls[lo] : NULL;
+}
+
+// forgets the calls at or after `executed` (a new future is being recorded)
+// and the ones before the history
+static void undo_syscall_trim(UndoLog *log, uint32_t executed)
+{
+    while(log->syscall_count > log->syscall_head && log->syscalls[log->syscall_count - 1].executed >= executed)
+    {
+        free(log->syscalls[--log->syscall_count].bytes);
+    }
+
+    uint32_t earliest = undo_earliest(log);
+    while(log->syscall_head < log->syscall_count && log->syscalls[log->syscall_head].executed < earliest)
+    {
+        free(log->syscalls[log->syscall_head++].bytes);
+    }
+
+    if(log->syscall_head > 0 && log->syscall_head >= log->syscall_count / 2)
+    {
+        log->syscall_count -= log->syscall_head;
+        memmove(log->syscalls, log->syscalls + log->syscall_head, sizeof(UndoSyscall) * log->syscall_count);
+        log->syscall_head = 0;
+    }
+}
+
+void undo_syscall_begin(UndoLog *log, CPU *cpu)
+{
+    SyscallHost *host = cpu->syscalls;
+    if(!host || host->replay)
+        return;
+
+    uint32_t n = cpu->instructions_executed;
+    undo_syscall_trim(log, n);
+
+    if(log->syscall_count == log->syscall_capacity)
+    {
+        uint32_t capacity = log->syscall_capacity ? log->syscall_capacity * 2 : 16;
+        UndoSyscall *grown = (UndoSyscall *)realloc(log->syscalls, sizeof(UndoSyscall) * capacity);
+        if(!grown)
+        {
+            LOG_ERROR(LOG_CAT_CPU, "[ERROR] undo_syscall_begin: allocation failed, the call at instruction %u "
+                      "cannot be undone\n", n);
+            return;
+        }
+        log->syscalls = grown;
+        log->syscall_capacity = capacity;
+    }
+
+    UndoSyscall *rec = &log->syscalls[log->syscall_count++];
+    memset(rec, 0, sizeof(*rec));
+    rec->executed = n;
+    undo_host_save(cpu, &rec->before);
+
+    // the guest memory the call can write
+    uint32_t number = (uint32_t)cpu->regs[17];
+    int32_t len = 0;
+    if(number == SYSCALL_READ && cpu->regs[10] == 0)
+        len = cpu->regs[12];
+    else if(number == SYSCALL_CLOCK_GETTIME)
+        len = 8;
+
+    uint64_t addr = (uint64_t)cpu->program->code_size + (uint32_t)cpu->regs[11];
+    if(len <= 0 || addr + (uint32_t)len > cpu->memory->size)
+        return;
+
+    rec->bytes = (uint8_t *)malloc((size_t)len * 2);
+    if(!rec->bytes)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] undo_syscall_begin: cannot save the %d bytes the call at instruction %u "
+                  "may write\n", len, n);
+        return;
+    }
+    rec->addr = (uint32_t)addr;
+    rec->len = (uint32_t)len;
+    memcpy(rec->bytes, cpu->memory->data + rec->addr, rec->len);
+}
+
+void undo_syscall_end(UndoLog *log, CPU *cpu, int32_t result)
+{
+    UndoSyscall *rec = undo_syscall_find(log, cpu->instructions_executed);
+    if(!rec)
+        return;
+
+    rec->result = result;
+    rec->halted = cpu->halted;
+    undo_host_save(cpu, &rec->after);
+    if(rec->len)
+        memcpy(rec->bytes + rec->len, cpu->memory->data + rec->addr, rec->len);
+    rec->done = 1;
+}
+
+int undo_syscall_replay(UndoLog *log, CPU *cpu, int32_t *result)
+{
+    const UndoSyscall *rec = undo_syscall_find(log, cpu->instructions_executed);
+    if(!rec || !rec->done)
+        return 0;
+
+    if(rec->len)
+        memory_write(cpu->memory, rec->addr, rec->bytes + rec->len, rec->len);
+    undo_host_load(cpu, &rec->after);
+    if(rec->halted)
+        cpu->halted = 1;
+    *result = rec->result;
+    return 1;
+}
+
+// ================================================================= //
+//                           STOP CONDITIONS                         //
+// ================================================================= //
+
+static int undo_watch_hit(const UndoStop *stop, uint32_t addr)
+{
+    return stop->watch_len && addr < stop->watch_addr + stop->watch_len && stop->watch_addr < addr + 4;
+}
+
+static int undo_pc_hit(const UndoStop *stop, uint32_t pc)
+{
+    if(stop->has_pc && pc == stop->pc)
+        return 1;
+    return stop->breakpoints && (pc >> 1) < stop->breakpoint_slots && stop->breakpoints[pc >> 1];
+}
+
+static int undo_entry_matches(const UndoEntry *e, const UndoStop *stop)
+{
+    if(undo_pc_hit(stop, e->pc))
+        return 1;
+    return (e->flags & UNDO_F_STORE) && undo_watch_hit(stop, e->addr);
+}
+
+// same test as undo_entry_matches(), for the instruction about to execute
+static int undo_next_matches(CPU *cpu, const UndoStop *stop)
+{
+    if(undo_pc_hit(stop, cpu->pc))
+        return 1;
+    if(!stop->watch_len || (size_t)cpu->pc + 4 > cpu->memory->size)
+        return 0;
+
+    uint32_t addr;
+    uint32_t word = memory_peek32(cpu->memory, cpu->pc);
+    if(rvc_is_compressed(word))
+        word = rvc_expand((uint16_t)word);
+    return undo_store_addr(cpu, word, &addr) && undo_watch_hit(stop, addr);
+}
+
+// ================================================================= //
+//                            MOVING BACK                            //
+// ================================================================= //
+
+static void undo_pop(UndoLog *log, CPU *cpu)
+{
+    const UndoEntry *e = &log->entries[(cpu->instructions_executed - 1) & log->mask];
+
+    if(e->flags & UNDO_F_STORE)
+        memory_write32(cpu->memory, e->addr, (uint32_t)e->old_word);
+    if(e->flags & UNDO_F_RD)
+        cpu->regs[e->rd] = e->old;
+    if(e->flags & UNDO_F_SYSCALL)
+    {
+        const UndoSyscall *rec = undo_syscall_find(log, cpu->instructions_executed - 1);
+        if(rec && rec->done)
+        {
+            if(rec->len)
+                memory_write(cpu->memory, rec->addr, rec->bytes, rec->len);
+            undo_host_load(cpu, &rec->before);
+        }
+    }
+
+    // an LR.W reservation does not survive going back in time
+    cpu->reserved = 0;
+    cpu->pc = e->pc;
+    cpu->instructions_executed--;
+    cpu->halted = 0;
+    cpu->error = 0;
+}
+
+// re-executes up to instruction `target` with every attached sink detached;
+// with `stop`, *last_hit is the latest instruction count matching it
+static int undo_replay(CPU *cpu, uint32_t target, const UndoStop *stop, uint32_t *last_hit, int *found)
+{
+    Profiler *profiler = cpu->profiler;
+    struct CpuStats *stats = cpu->stats;
+    struct TraceWriter *tracer = cpu->tracer;
+    struct LoopTrace *loop_trace = cpu->loop_trace;
+    struct CheckpointWriter *checkpoint = cpu->checkpoint;
+    int trace = cpu->trace;
+
+    cpu->profiler = NULL;
+    cpu->stats = NULL;
+    cpu->tracer = NULL;
+    cpu->loop_trace = NULL;
+    cpu->checkpoint = NULL;
+    cpu->trace = 0;
+    if(cpu->syscalls)
+        cpu->syscalls->replay = 1;
+
+    int rc = 0;
+    while(cpu->instructions_executed < target && !cpu->halted)
+    {
+        if(stop && undo_next_matches(cpu, stop))
+        {
+            *last_hit = cpu->instructions_executed;
+            *found = 1;
+        }
+
+        if(cpu_step(cpu) < 0)
+        {
+            rc = -1;
+            break;
+        }
+    }
+
+    cpu->profiler = profiler;
+    cpu->stats = stats;
+    cpu->tracer = tracer;
+    cpu->loop_trace = loop_trace;
+    cpu->checkpoint = checkpoint;
+    cpu->trace = trace;
+    if(cpu->syscalls)
+        cpu->syscalls->replay = 0;
+
+    if(rc == 0 && cpu->instructions_executed != target)
+        rc = -1;
+    return rc;
+}
+
+// an entry in [from, to) can only be undone by replaying
+static int undo_needs_replay(const UndoLog *log, uint32_t from, uint32_t to)
+{
+    for(uint32_t n = from; n < to; ++n)
+    {
+        if(log->entries[n & log->mask].flags & UNDO_F_REPLAY)
+            return 1;
+    }
+    return 0;
+}
+
+uint32_t undo_earliest(const UndoLog *log)
+{
+    if(log->keyframe_count > 0)
+    {
+        uint32_t first = log->keyframes[log->keyframe_head].executed;
+        if(first < log->oldest)
+            return first;
+    }
+    return log->oldest;
+}
+
+int undo_seek(UndoLog *log, CPU *cpu, uint32_t executed)
+{
+    if(executed > cpu->instructions_executed)
+    {
+        LOG_ERROR(LOG_CAT_CPU, "[ERROR] undo_seek: instruction %u has not executed yet\n", executed);
+        return -1;
+    }
+
+    if(executed >= log->oldest && !undo_needs_replay(log, executed, cpu->instructions_executed))
+    {
+        while(cpu->instructions_executed > executed)
+        {
+            undo_pop(log, cpu);
+        }
+        return 0;
+    }
+
+    // before the ring or past a vector instruction: replay from the latest
+    // keyframe at or before it
+    for(uint32_t k = log->keyframe_count; k-- > 0;)
+    {
+        if(undo_keyframe_at(log, k)->executed > executed)
+            continue;
+
+        if(undo_restore_keyframe(log, cpu, k) < 0 || undo_replay(cpu, executed, NULL, NULL, NULL) < 0)
+        {
+            LOG_ERROR(LOG_CAT_CPU, "[ERROR] undo_seek: replay to instruction %u failed\n", executed);
+            return -1;
+        }
+        return 0;
+    }
+
+    LOG_ERROR(LOG_CAT_CPU, "[ERROR] undo_seek: instruction %u is no longer in the history (earliest: %u)\n",
+              executed, undo_earliest(log));
+    return -1;
+}
+
+uint32_t undo_step_back(UndoLog *log, CPU *cpu, uint32_t count)
+{
+    uint32_t now = cpu->instructions_executed;
+    uint32_t available = now - undo_earliest(log);
+    if(count > available)
+        count = available;
+
+    if(undo_seek(log, cpu, now - count) < 0)
+        return 0;
+    return now - cpu->instructions_executed;
+}
+
+int undo_reverse_continue(UndoLog *log, CPU *cpu, const UndoStop *stop)
+{
+    while(cpu->instructions_executed > log->oldest)
+    {
+        const UndoEntry *e = &log->entries[(cpu->instructions_executed - 1) & log->mask];
+        if(e->flags & UNDO_F_REPLAY)
+            break;
+
+        int hit = undo_entry_matches(e, stop);
+        undo_pop(log, cpu);
+        if(hit)
+            return 1;
+    }
+
+    // search the keyframe intervals before the ring (or before a vector
+    // instruction the ring cannot undo), latest first
+    uint32_t segment_end = cpu->instructions_executed;
+    for(uint32_t k = log->keyframe_count; k-- > 0;)
+    {
+        uint32_t start = undo_keyframe_at(log, k)->executed;
+        if(start >= segment_end)
+            continue;
+
+        uint32_t last_hit = 0;
+        int found = 0;
+        if(undo_restore_keyframe(log, cpu, k) < 0 ||
+           undo_replay(cpu, segment_end, stop, &last_hit, &found) < 0)
+        {
+            LOG_ERROR(LOG_CAT_CPU, "[ERROR] undo_reverse_continue: replay from instruction %u failed\n", start);
+            return -1;
+        }
+
+        if(found)
+            return (undo_seek(log, cpu, last_hit) < 0) ? -1 : 1;
+
+        segment_end = start;
+    }
+
+    if(undo_seek(log, cpu, undo_earliest(log)) < 0)
+        return -1;
+    return 0;
+}
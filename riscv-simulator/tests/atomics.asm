@@ -0,0 +1,45 @@
+# This program exercises the RV32A instructions on one hart. AMOs return the
+# old word in rd; LR.W/SC.W implement a compare-and-swap retry loop, and an
+# SC.W without a matching reservation fails with rd = 1.
+
+.data
+    counter: .word 5          # Target of the AMOs.
+    flags:   .word 12         # Bit mask for amoor/amoand/amoxor.
+    lock:    .word 0          # Taken and released with LR.W/SC.W.
+    result:  .word 0          # Output placeholder for the combined check value.
+
+.text
+    main:
+        li s0, 0                # s0 = &counter
+        li s1, 4                # s1 = &flags
+        li s2, 8                # s2 = &lock
+
+        li t0, 3
+        amoadd.w a0, t0, (s0)   # a0 = 5, counter = 8
+        li t0, -2
+        amomin.w a1, t0, (s0)   # a1 = 8, counter = -2
+        li t0, 7
+        amomaxu.w a2, t0, (s0)  # a2 = -2, counter stays 0xFFFFFFFE
+        amoswap.w a3, t0, (s0)  # a3 = -2, counter = 7
+
+        li t1, 3
+        amoor.w t2, t1, (s1)    # flags = 15
+        li t1, 6
+        amoand.w t2, t1, (s1)   # flags = 6
+        amoxor.w t2, t1, (s1)   # t2 = 6, flags = 0
+
+    acquire:
+        lr.w t3, (s2)
+        bne t3, x0, acquire     # Spin while the lock is held.
+        li t4, 1
+        sc.w t5, t4, (s2)       # t5 = 0 on success.
+        bne t5, x0, acquire
+
+        sc.w a4, t4, (s2)       # No reservation left: a4 = 1.
+        amoswap.w.rl x0, x0, (s2)   # Release the lock.
+
+        lw a5, 0(s0)            # a5 = 7
+        lw a6, 4(s1)            # a6 = 0 (reads the lock word)
+        add a7, a0, a5          # a7 = 5 + 7
+        add a7, a7, a4          # a7 = 13
+        sw a7, 12(x0)
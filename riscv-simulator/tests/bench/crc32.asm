@@ -0,0 +1,72 @@
+# Benchmark: bitwise CRC-32 (reflected polynomial 0xEDB88320) with shifts/XOR.
+# The input buffer (data offset 256) is filled with LCG words and processed
+# as little-endian bytes, one bit per inner iteration, using a branch-free
+# conditional XOR: crc = (crc >> 1) ^ (poly & -(crc & 1)).
+# Self-check: the final CRC must match 'expected' (same as zlib.crc32).
+
+.data
+    status:   .word 0            # 1 = pass, -1 = fail (written by the program).
+    result:   .word 0            # Computed CRC-32.
+    words:    .word 4096         # Buffer size in words.
+    seed:     .word 1            # Initial LCG state.
+    expected: .word -567217310   # Reference CRC-32 of the buffer.
+
+.text
+    main:
+        lw s0, 8(x0)            # s0 = words
+        lw s1, 12(x0)           # s1 = LCG state
+        li t6, 2
+        sll s2, s0, t6          # s2 = buffer size in bytes
+        li s3, 256              # s3 = buffer
+        add t2, s3, s2          # t2 = end of buffer
+        lui s5, 269413
+        addi s5, s5, -403       # s5 = 1103515245
+        lui s6, 3
+        addi s6, s6, 57         # s6 = 12345
+
+        add t0, s3, x0
+
+    gen_loop:
+        mul s1, s1, s5
+        add s1, s1, s6
+        sw s1, 0(t0)
+        addi t0, t0, 4
+        bne t0, t2, gen_loop
+
+        lui s7, -74872
+        addi s7, s7, 800        # s7 = 0xEDB88320
+        li s8, 1
+        li s9, 32
+        li a0, -1               # a0 = crc = 0xFFFFFFFF
+        add t0, s3, x0
+
+    crc_word:
+        lw a1, 0(t0)
+        xor a0, a0, a1
+        li t1, 0
+
+    crc_bit:
+        and a2, a0, s8          # a2 = crc & 1
+        sub a2, x0, a2          # a2 = all ones if the bit was set
+        and a2, a2, s7
+        srl a0, a0, s8
+        xor a0, a0, a2
+        addi t1, t1, 1
+        bne t1, s9, crc_bit
+
+        addi t0, t0, 4
+        bne t0, t2, crc_word
+
+        li a3, -1
+        xor a0, a0, a3          # Final inversion.
+        sw a0, 4(x0)            # Store the CRC in 'result'.
+        lw t5, 16(x0)
+        bne a0, t5, fail
+        li t4, 1
+        jal x0, finish
+
+    fail:
+        li t4, -1
+
+    finish:
+        sw t4, 0(x0)            # Store the self-check status.
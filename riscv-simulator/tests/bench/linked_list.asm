@@ -0,0 +1,66 @@
+# Benchmark: pointer chasing through a linked list.
+# Node i (8 bytes: next, value) lives at data offset 256 + 8 * i. The list
+# visits the nodes in the order 0, s, 2s, ... (mod n) for an odd stride s, so
+# consecutive nodes are far apart in memory. A next pointer of 0 ends the list.
+# Self-check: the sum of all values over all passes must match 'expected'.
+
+.data
+    status:   .word 0          # 1 = pass, -1 = fail (written by the program).
+    result:   .word 0          # Sum of the node values over all passes.
+    nodes:    .word 2048       # Number of nodes (power of two).
+    passes:   .word 100        # Number of list traversals.
+    stride:   .word 1237       # Odd stride between consecutive nodes.
+    expected: .word 209612800  # passes * nodes * (nodes - 1) / 2
+
+.text
+    main:
+        lw s0, 8(x0)            # s0 = n
+        lw s1, 12(x0)           # s1 = passes
+        lw s2, 16(x0)           # s2 = stride
+        addi s3, s0, -1         # s3 = n - 1 (index mask)
+        li s4, 256              # s4 = node array
+        li s5, 3                # s5 = log2(node size)
+        li t0, 0                # t0 = i
+
+    build:
+        add t1, t0, s2
+        and t1, t1, s3          # t1 = (i + stride) mod n
+        li a0, 0                # a0 = next (0 ends the list)
+        beq t1, x0, build_store
+        sll a0, t1, s5
+        add a0, a0, s4          # a0 = &node[t1]
+
+    build_store:
+        sll t2, t0, s5
+        add t2, t2, s4          # t2 = &node[i]
+        sw a0, 0(t2)
+        sw t0, 4(t2)            # value = i
+        addi t0, t0, 1
+        bne t0, s0, build
+
+        li a1, 0                # a1 = sum
+        li t3, 0                # t3 = pass
+
+    pass:
+        add t4, s4, x0          # t4 = &node[0]
+
+    chase:
+        lw a2, 4(t4)
+        add a1, a1, a2
+        lw t4, 0(t4)            # Follow the next pointer.
+        bne t4, x0, chase
+
+        addi t3, t3, 1
+        bne t3, s1, pass
+
+        sw a1, 4(x0)            # Store the sum in 'result'.
+        lw t5, 20(x0)
+        bne a1, t5, fail
+        li t4, 1
+        jal x0, finish
+
+    fail:
+        li t4, -1
+
+    finish:
+        sw t4, 0(x0)            # Store the self-check status.
@@ -0,0 +1,94 @@
+# Benchmark: integer matrix multiplication C = A * B with MUL.
+# A[i][j] = i + j and B[i][j] = i - j, stored row-major starting at data
+# offset 256 (A), followed by B and C.
+# Self-check: the sum of all elements of C must match 'expected'.
+
+.data
+    status:   .word 0          # 1 = pass, -1 = fail (written by the program).
+    result:   .word 0          # Sum of all elements of C.
+    n:        .word 48         # Matrix dimension.
+    expected: .word 21224448   # Reference sum of C for n = 48.
+
+.text
+    main:
+        lw s0, 8(x0)            # s0 = n
+        li t6, 2
+        sll s1, s0, t6          # s1 = row size in bytes
+        mul s2, s1, s0          # s2 = matrix size in bytes
+        li s3, 256              # s3 = A
+        add s4, s3, s2          # s4 = B
+        add s5, s4, s2          # s5 = C
+
+        li t0, 0                # t0 = i
+        add t2, s3, x0          # t2 = &A[i][j]
+        add t3, s4, x0          # t3 = &B[i][j]
+
+    init_row:
+        li t1, 0                # t1 = j
+
+    init_col:
+        add a0, t0, t1
+        sub a1, t0, t1
+        sw a0, 0(t2)            # A[i][j] = i + j
+        sw a1, 0(t3)            # B[i][j] = i - j
+        addi t2, t2, 4
+        addi t3, t3, 4
+        addi t1, t1, 1
+        bne t1, s0, init_col
+        addi t0, t0, 1
+        bne t0, s0, init_row
+
+        add a5, s3, x0          # a5 = &A[i][0]
+        add a6, s5, x0          # a6 = &C[i][j]
+        li t0, 0                # t0 = i
+
+    mm_row:
+        add a7, s4, x0          # a7 = &B[0][j]
+        li t1, 0                # t1 = j
+
+    mm_col:
+        li a0, 0                # a0 = dot product
+        add t2, a5, x0          # t2 = &A[i][k]
+        add t3, a7, x0          # t3 = &B[k][j]
+        li t4, 0                # t4 = k
+
+    mm_k:
+        lw a1, 0(t2)
+        lw a2, 0(t3)
+        mul a3, a1, a2
+        add a0, a0, a3
+        addi t2, t2, 4
+        add t3, t3, s1
+        addi t4, t4, 1
+        bne t4, s0, mm_k
+
+        sw a0, 0(a6)            # C[i][j] = dot product
+        addi a6, a6, 4
+        addi a7, a7, 4
+        addi t1, t1, 1
+        bne t1, s0, mm_col
+        add a5, a5, s1
+        addi t0, t0, 1
+        bne t0, s0, mm_row
+
+        li a0, 0                # a0 = sum of C
+        add t2, s5, x0
+        add t3, s5, s2
+
+    sum_loop:
+        lw a1, 0(t2)
+        add a0, a0, a1
+        addi t2, t2, 4
+        bne t2, t3, sum_loop
+
+        sw a0, 4(x0)            # Store the sum in 'result'.
+        lw t5, 12(x0)
+        bne a0, t5, fail
+        li t4, 1
+        jal x0, finish
+
+    fail:
+        li t4, -1
+
+    finish:
+        sw t4, 0(x0)            # Store the self-check status.
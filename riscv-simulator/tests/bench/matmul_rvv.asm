@@ -0,0 +1,104 @@
+# Benchmark: matmul.asm with the RVV subset. Each row of C is computed in
+# strips of vl columns as sum over k of A[i][k] * B[k][j0..j0+vl) with
+# vmul.vx/vadd.vv (LMUL=8, so a strip is up to VLEN/4 columns), and the
+# final sum of C uses vredsum. Same matrices, layout and self-check.
+
+.data
+    status:   .word 0          # 1 = pass, -1 = fail (written by the program).
+    result:   .word 0          # Sum of all elements of C.
+    n:        .word 48         # Matrix dimension.
+    expected: .word 21224448   # Reference sum of C for n = 48.
+
+.text
+    main:
+        lw s0, 8(x0)            # s0 = n
+        li t6, 2
+        sll s1, s0, t6          # s1 = row size in bytes
+        mul s2, s1, s0          # s2 = matrix size in bytes
+        li s3, 256              # s3 = A
+        add s4, s3, s2          # s4 = B
+        add s5, s4, s2          # s5 = C
+
+        li t0, 0                # t0 = i
+        add t2, s3, x0          # t2 = &A[i][j]
+        add t3, s4, x0          # t3 = &B[i][j]
+
+    init_row:
+        li t1, 0                # t1 = j
+
+    init_col:
+        add a0, t0, t1
+        sub a1, t0, t1
+        sw a0, 0(t2)            # A[i][j] = i + j
+        sw a1, 0(t3)            # B[i][j] = i - j
+        addi t2, t2, 4
+        addi t3, t3, 4
+        addi t1, t1, 1
+        bne t1, s0, init_col
+        addi t0, t0, 1
+        bne t0, s0, init_row
+
+        add a5, s3, x0          # a5 = &A[i][0]
+        add a6, s5, x0          # a6 = &C[i][j0]
+        li t0, 0                # t0 = i
+
+    mm_row:
+        li t1, 0                # t1 = j0, first column of the strip
+
+    mm_strip:
+        sub a0, s0, t1
+        vsetvli a4, a0, e32, m8, ta, ma # a4 = vl = columns in this strip
+        vxor.vv v8, v8, v8      # v8-v15 = C[i][j0..j0+vl)
+        add t2, a5, x0          # t2 = &A[i][k]
+        sll t3, t1, t6
+        add t3, t3, s4          # t3 = &B[k][j0]
+        li t4, 0                # t4 = k
+
+    mm_k:
+        lw a1, 0(t2)            # a1 = A[i][k]
+        vle32.v v16, (t3)
+        vmul.vx v16, v16, a1
+        vadd.vv v8, v8, v16
+        addi t2, t2, 4
+        add t3, t3, s1
+        addi t4, t4, 1
+        bne t4, s0, mm_k
+
+        vse32.v v8, (a6)
+        sll a3, a4, t6
+        add a6, a6, a3
+        add t1, t1, a4
+        bne t1, s0, mm_strip
+        add a5, a5, s1
+        addi t0, t0, 1
+        bne t0, s0, mm_row
+
+        mul a0, s0, s0          # a0 = elements of C left to add
+        add t2, s5, x0
+        vsetvli a4, a0, e32, m8, ta, ma
+        vxor.vv v0, v0, v0      # v0[0] = running sum
+
+    sum_loop:
+        vsetvli a4, a0, e32, m8, ta, ma
+        vle32.v v16, (t2)
+        vredsum.vs v0, v16, v0
+        sub a0, a0, a4
+        sll a3, a4, t6
+        add t2, t2, a3
+        bne a0, x0, sum_loop
+
+        li a2, 1
+        vsetvli a4, a2, e32, m1, ta, ma
+        li a3, 4
+        vse32.v v0, (a3)        # Store the sum in 'result'.
+        lw a0, 4(x0)
+        lw t5, 12(x0)
+        bne a0, t5, fail
+        li t4, 1
+        jal x0, finish
+
+    fail:
+        li t4, -1
+
+    finish:
+        sw t4, 0(x0)            # Store the self-check status.
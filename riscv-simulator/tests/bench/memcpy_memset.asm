@@ -0,0 +1,74 @@
+# Benchmark: repeated memset + memcpy over two 1024-word buffers.
+# Each round fills buffer A with the round number (memset) and copies A into
+# buffer B (memcpy). Both loops are unrolled by 4.
+# The buffers live past the declared data, at data offsets 256 (A) and 4352 (B).
+# Self-check: after the last round, the checksum of B must be words * rounds.
+
+.data
+    status: .word 0          # 1 = pass, -1 = fail (written by the program).
+    result: .word 0          # Checksum of buffer B.
+    rounds: .word 200        # Number of memset + memcpy rounds.
+    words:  .word 1024       # Buffer size in words (multiple of 4).
+
+.text
+    main:
+        lw s0, 8(x0)            # s0 = rounds
+        lw s1, 12(x0)           # s1 = words
+        li t6, 2
+        sll s2, s1, t6          # s2 = buffer size in bytes
+        li s3, 256              # s3 = buffer A
+        add s4, s3, s2          # s4 = buffer B
+        li s5, 1                # s5 = current round (memset value)
+
+    round:
+        add t0, s3, x0          # t0 = A
+        add t1, s3, s2          # t1 = end of A
+
+    memset_loop:
+        sw s5, 0(t0)
+        sw s5, 4(t0)
+        sw s5, 8(t0)
+        sw s5, 12(t0)
+        addi t0, t0, 16
+        bne t0, t1, memset_loop
+
+        add t0, s3, x0          # t0 = source (A)
+        add t2, s4, x0          # t2 = destination (B)
+
+    memcpy_loop:
+        lw a0, 0(t0)
+        lw a1, 4(t0)
+        lw a2, 8(t0)
+        lw a3, 12(t0)
+        sw a0, 0(t2)
+        sw a1, 4(t2)
+        sw a2, 8(t2)
+        sw a3, 12(t2)
+        addi t0, t0, 16
+        addi t2, t2, 16
+        bne t0, t1, memcpy_loop
+
+        addi s5, s5, 1
+        bge s0, s5, round       # Repeat while round <= rounds.
+
+        li a0, 0                # a0 = checksum of B
+        add t0, s4, x0
+        add t1, s4, s2
+
+    sum_loop:
+        lw a1, 0(t0)
+        add a0, a0, a1
+        addi t0, t0, 4
+        bne t0, t1, sum_loop
+
+        sw a0, 4(x0)            # Store the checksum in 'result'.
+        mul t3, s1, s0          # Expected checksum: words * rounds.
+        bne a0, t3, fail
+        li t4, 1
+        jal x0, finish
+
+    fail:
+        li t4, -1
+
+    finish:
+        sw t4, 0(x0)            # Store the self-check status.
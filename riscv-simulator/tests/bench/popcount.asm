@@ -0,0 +1,63 @@
+# Benchmark: population count over an array of LCG words.
+# Each word is counted with a 32-iteration shift/AND/add loop, the same
+# kernel as tests/counting_bits.asm. The array lives at data offset 256.
+# Self-check: the total number of set bits must match 'expected'.
+
+.data
+    status:   .word 0          # 1 = pass, -1 = fail (written by the program).
+    result:   .word 0          # Total number of set bits.
+    words:    .word 4096       # Array size in words.
+    seed:     .word 7          # Initial LCG state.
+    expected: .word 65726      # Reference bit count.
+
+.text
+    main:
+        lw s0, 8(x0)            # s0 = words
+        lw s1, 12(x0)           # s1 = LCG state
+        li t6, 2
+        sll s2, s0, t6          # s2 = array size in bytes
+        li s3, 256              # s3 = array
+        add t2, s3, s2          # t2 = end of array
+        lui s5, 269413
+        addi s5, s5, -403       # s5 = 1103515245
+        lui s6, 3
+        addi s6, s6, 57         # s6 = 12345
+
+        add t0, s3, x0
+
+    gen_loop:
+        mul s1, s1, s5
+        add s1, s1, s6
+        sw s1, 0(t0)
+        addi t0, t0, 4
+        bne t0, t2, gen_loop
+
+        li s8, 1
+        li a0, 0                # a0 = total count
+        add t0, s3, x0
+
+    pc_word:
+        lw a1, 0(t0)
+        li t1, 32               # t1 = bits left
+
+    pc_bit:
+        and a2, a1, s8          # Extract the least significant bit.
+        add a0, a0, a2
+        srl a1, a1, s8
+        addi t1, t1, -1
+        bne t1, x0, pc_bit
+
+        addi t0, t0, 4
+        bne t0, t2, pc_word
+
+        sw a0, 4(x0)            # Store the count in 'result'.
+        lw t5, 16(x0)
+        bne a0, t5, fail
+        li t4, 1
+        jal x0, finish
+
+    fail:
+        li t4, -1
+
+    finish:
+        sw t4, 0(x0)            # Store the self-check status.
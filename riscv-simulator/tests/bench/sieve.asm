@@ -0,0 +1,80 @@
+# Benchmark: sieve of Eratosthenes, repeated several rounds.
+# One word per number (0 = prime candidate, 1 = composite) starting at data
+# offset 256. Each round clears the table, sieves it and counts the primes.
+# Self-check: the prime count summed over all rounds must match 'expected'.
+
+.data
+    status:   .word 0          # 1 = pass, -1 = fail (written by the program).
+    result:   .word 0          # Primes found, summed over all rounds.
+    limit:    .word 8192       # Sieve numbers below this limit.
+    rounds:   .word 10         # Number of rounds.
+    expected: .word 10280      # 1028 primes below 8192, times 10 rounds.
+
+.text
+    main:
+        lw s0, 8(x0)            # s0 = limit
+        lw s1, 12(x0)           # s1 = rounds
+        li t6, 2
+        sll s2, s0, t6          # s2 = table size in bytes
+        li s3, 256              # s3 = table
+        add s4, s3, s2          # s4 = end of table
+        li s5, 0                # s5 = total primes
+        li s6, 0                # s6 = round
+        li s8, 1
+
+    round:
+        add t0, s3, x0
+
+    clear:
+        sw x0, 0(t0)
+        addi t0, t0, 4
+        bne t0, s4, clear
+
+        li t1, 2                # t1 = p
+
+    sieve_outer:
+        mul t2, t1, t1          # t2 = p * p
+        bge t2, s0, sieve_count
+        sll t3, t1, t6
+        add t3, t3, s3
+        lw a0, 0(t3)
+        bne a0, x0, sieve_next  # p is composite.
+        sll t4, t2, t6
+        add t4, t4, s3          # t4 = &table[p * p]
+        sll t5, t1, t6          # t5 = stride in bytes
+
+    mark:
+        sw s8, 0(t4)
+        add t4, t4, t5
+        blt t4, s4, mark
+
+    sieve_next:
+        addi t1, t1, 1
+        jal x0, sieve_outer
+
+    sieve_count:
+        addi t0, s3, 8          # Start counting at 2.
+
+    count:
+        lw a0, 0(t0)
+        bne a0, x0, count_next
+        addi s5, s5, 1
+
+    count_next:
+        addi t0, t0, 4
+        bne t0, s4, count
+
+        addi s6, s6, 1
+        bne s6, s1, round
+
+        sw s5, 4(x0)            # Store the total in 'result'.
+        lw t0, 16(x0)
+        bne s5, t0, fail
+        li t4, 1
+        jal x0, finish
+
+    fail:
+        li t4, -1
+
+    finish:
+        sw t4, 0(x0)            # Store the self-check status.
@@ -0,0 +1,39 @@
+# Multi-hart benchmark: every hart increments one shared counter with
+# amoadd.w 'iterations' times, so all harts contend on a single word.
+# Harts start with their hart id in a0 and the hart count in a1. Each hart
+# then counts itself as done with another amoadd.w; the last one to finish
+# checks the total. Status goes to data offset 256 + h * 4 (1 = pass,
+# -1 = fail).
+
+.data
+    iterations: .word 200000   # Increments per hart.
+    counter:    .word 0        # Shared counter.
+    done:       .word 0        # Harts that have finished their increments.
+
+.text
+    main:
+        lw s0, 0(x0)            # s0 = iterations
+        li s1, 4                # s1 = &counter
+        li s2, 8                # s2 = &done
+        li t6, 2
+        sll s7, a0, t6
+        addi s7, s7, 256        # s7 = status word of this hart
+        li t0, 1
+        add t1, s0, x0          # t1 = increments left
+
+    count_loop:
+        amoadd.w x0, t0, (s1)
+        addi t1, t1, -1
+        bne t1, x0, count_loop
+
+        li t4, 1
+        amoadd.w t2, t0, (s2)   # t2 = harts that finished before this one
+        addi t3, a1, -1
+        bne t2, t3, finish      # Only the last hart checks the total.
+        lw t5, 4(x0)
+        mul t3, s0, a1
+        beq t5, t3, finish
+        li t4, -1
+
+    finish:
+        sw t4, 0(s7)            # Store the self-check status.
@@ -0,0 +1,74 @@
+# Multi-hart benchmark: every hart counts the set bits of its own array of
+# LCG words, 'passes' times over. Harts start with their hart id in a0.
+# Hart h keeps its array at data offset 4096 + h * 4096 and writes its
+# self-check status to data offset 256 + h * 4 (1 = pass, -1 = fail),
+# so up to 64 harts fit in front of the arrays.
+# Memory needed: code + 4096 + harts * 4096 bytes.
+
+.data
+    words:    .word 1024       # Array size in words (per hart).
+    seed:     .word 7          # Initial LCG state.
+    passes:   .word 16         # Times every array is counted.
+    expected: .word 263520     # Reference bit count over all passes.
+
+.text
+    main:
+        lw s0, 0(x0)            # s0 = words
+        lw s1, 4(x0)            # s1 = LCG state
+        lw s4, 8(x0)            # s4 = passes left
+        li t6, 2
+        sll s7, a0, t6
+        addi s7, s7, 256        # s7 = status word of this hart
+        sll s2, s0, t6          # s2 = array size in bytes
+        li t6, 12
+        sll s3, a0, t6
+        lui t6, 1
+        add s3, s3, t6          # s3 = array of this hart
+        add t2, s3, s2          # t2 = end of array
+        lui s5, 269413
+        addi s5, s5, -403       # s5 = 1103515245
+        lui s6, 3
+        addi s6, s6, 57         # s6 = 12345
+
+        add t0, s3, x0
+
+    gen_loop:
+        mul s1, s1, s5
+        add s1, s1, s6
+        sw s1, 0(t0)
+        addi t0, t0, 4
+        bne t0, t2, gen_loop
+
+        li s8, 1
+        li a3, 0                # a3 = total count
+
+    pass_loop:
+        add t0, s3, x0
+
+    pc_word:
+        lw a1, 0(t0)
+        li t1, 32               # t1 = bits left
+
+    pc_bit:
+        and a2, a1, s8          # Extract the least significant bit.
+        add a3, a3, a2
+        srl a1, a1, s8
+        addi t1, t1, -1
+        bne t1, x0, pc_bit
+
+        addi t0, t0, 4
+        bne t0, t2, pc_word
+
+        addi s4, s4, -1
+        bne s4, x0, pass_loop
+
+        lw t5, 12(x0)
+        bne a3, t5, fail
+        li t4, 1
+        jal x0, finish
+
+    fail:
+        li t4, -1
+
+    finish:
+        sw t4, 0(s7)            # Store the self-check status.
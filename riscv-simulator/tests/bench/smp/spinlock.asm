@@ -0,0 +1,49 @@
+# Multi-hart benchmark: every hart increments one shared counter with a
+# plain lw/addi/sw, 'iterations' times, inside a spinlock taken with
+# lr.w/sc.w and released with amoswap.w.rl. Harts start with their hart id
+# in a0 and the hart count in a1; the last hart to finish checks that no
+# increment was lost. Status goes to data offset 256 + h * 4 (1 = pass,
+# -1 = fail).
+
+.data
+    iterations: .word 20000    # Critical sections per hart.
+    lock:       .word 0        # 0 = free, 1 = held.
+    counter:    .word 0        # Shared counter, only touched under the lock.
+    done:       .word 0        # Harts that have finished.
+
+.text
+    main:
+        lw s0, 0(x0)            # s0 = iterations
+        li s1, 4                # s1 = &lock
+        li s2, 12               # s2 = &done
+        li t6, 2
+        sll s7, a0, t6
+        addi s7, s7, 256        # s7 = status word of this hart
+        li t0, 1
+        add t1, s0, x0          # t1 = critical sections left
+
+    acquire:
+        lr.w t2, (s1)
+        bne t2, x0, acquire     # Spin while the lock is held.
+        sc.w t2, t0, (s1)
+        bne t2, x0, acquire     # Lost the race, try again.
+
+        lw t3, 8(x0)            # Critical section: counter += 1
+        addi t3, t3, 1
+        sw t3, 8(x0)
+        amoswap.w.rl x0, x0, (s1)   # Release the lock.
+
+        addi t1, t1, -1
+        bne t1, x0, acquire
+
+        li t4, 1
+        amoadd.w t2, t0, (s2)   # t2 = harts that finished before this one
+        addi t3, a1, -1
+        bne t2, t3, finish      # Only the last hart checks the total.
+        lw t5, 8(x0)
+        mul t3, s0, a1
+        beq t5, t3, finish
+        li t4, -1
+
+    finish:
+        sw t4, 0(s7)            # Store the self-check status.
@@ -0,0 +1,118 @@
+# Benchmark: bubble sort and insertion sort of the same pseudo-random array.
+# The array is generated with the LCG x = x * 1103515245 + 12345, keeping the
+# upper 16 bits of each state. Array A (bubble sort) lives at data offset 256,
+# array B (insertion sort) right after it.
+# Self-check: both arrays must be sorted, equal element by element, and sum to
+# the same value as the generated input.
+
+.data
+    status: .word 0          # 1 = pass, -1 = fail (written by the program).
+    result: .word 0          # Sum of the sorted array.
+    count:  .word 400        # Number of elements.
+    seed:   .word 12345      # Initial LCG state.
+
+.text
+    main:
+        lw s0, 8(x0)            # s0 = n
+        lw s1, 12(x0)           # s1 = LCG state
+        li t6, 2
+        sll s2, s0, t6          # s2 = array size in bytes
+        li s3, 256              # s3 = array A
+        add s4, s3, s2          # s4 = array B
+        lui s5, 269413
+        addi s5, s5, -403       # s5 = 1103515245 (0x41C64E6D)
+        lui s6, 3
+        addi s6, s6, 57         # s6 = 12345
+        li s7, 16
+        li s8, 0                # s8 = sum of the generated values
+
+        add t0, s3, x0
+        add t1, s4, x0
+        add t2, s3, s2          # t2 = end of A
+
+    gen_loop:
+        mul s1, s1, s5
+        add s1, s1, s6
+        srl a0, s1, s7          # Keep the upper 16 bits.
+        sw a0, 0(t0)
+        sw a0, 0(t1)
+        add s8, s8, a0
+        addi t0, t0, 4
+        addi t1, t1, 4
+        bne t0, t2, gen_loop
+
+        addi t2, t2, -4         # t2 = last unsorted position of A
+
+    bubble_outer:
+        add t0, s3, x0
+
+    bubble_inner:
+        lw a0, 0(t0)
+        lw a1, 4(t0)
+        bge a1, a0, bubble_next # Already in order.
+        sw a1, 0(t0)
+        sw a0, 4(t0)
+
+    bubble_next:
+        addi t0, t0, 4
+        blt t0, t2, bubble_inner
+        addi t2, t2, -4
+        blt s3, t2, bubble_outer
+
+        addi t1, s4, 4          # t1 = address of B[i], i = 1
+        add t3, s4, s2          # t3 = end of B
+
+    insertion_outer:
+        lw a0, 0(t1)            # a0 = key
+        addi t0, t1, -4         # t0 = address of B[j], j = i - 1
+
+    insertion_inner:
+        blt t0, s4, insertion_place
+        lw a1, 0(t0)
+        bge a0, a1, insertion_place
+        sw a1, 4(t0)            # Shift B[j] one slot to the right.
+        addi t0, t0, -4
+        jal x0, insertion_inner
+
+    insertion_place:
+        sw a0, 4(t0)
+        addi t1, t1, 4
+        bne t1, t3, insertion_outer
+
+        li a2, 0                # a2 = sum of A
+        li a3, 0                # a3 = number of errors
+        add t0, s3, x0
+        add t1, s4, x0
+        add t2, s3, s2
+        addi t2, t2, -4         # t2 = last element of A
+
+    verify_loop:
+        lw a0, 0(t0)
+        lw a1, 0(t1)
+        add a2, a2, a0
+        beq a0, a1, verify_order
+        addi a3, a3, 1          # A and B differ.
+
+    verify_order:
+        beq t0, t2, verify_done
+        lw a4, 4(t0)
+        bge a4, a0, verify_next
+        addi a3, a3, 1          # A is not sorted.
+
+    verify_next:
+        addi t0, t0, 4
+        addi t1, t1, 4
+        jal x0, verify_loop
+
+    verify_done:
+        sw a2, 4(x0)            # Store the sum in 'result'.
+        bne a3, x0, fail
+        bne a2, s8, fail
+        li t4, 1
+        jal x0, finish
+
+    fail:
+        li t4, -1
+
+    finish:
+        sw t4, 0(x0)            # Store the self-check status.
@@ -0,0 +1,39 @@
+# This program exercises the RV32M instructions, including the cases the
+# spec defines instead of trapping: division by zero returns all ones (the
+# remainder returns the dividend) and INT32_MIN / -1 returns INT32_MIN with
+# remainder 0. It also checks OR, which shares the R-type decode path.
+
+.data
+    dividend: .word 17        # Dividend for the divide-by-zero cases.
+    negative: .word -7        # Dividend for rounding toward zero.
+
+.text
+    main:
+        lw s0, 0(x0)            # s0 = 17
+        lw s1, 4(x0)            # s1 = -7
+        li t0, 2
+        li t1, -1
+        lui s2, -524288         # s2 = INT32_MIN
+
+        div a0, s0, x0          # a0 = -1
+        rem a1, s0, x0          # a1 = 17
+        divu a2, s0, x0         # a2 = 0xFFFFFFFF
+        remu a3, s0, x0         # a3 = 17
+
+        div a4, s2, t1          # a4 = INT32_MIN
+        rem a5, s2, t1          # a5 = 0
+
+        div a6, s1, t0          # a6 = -3
+        rem a7, s1, t0          # a7 = -1
+        divu s3, s1, t0         # s3 = 0x7FFFFFFC
+        remu s4, s1, t0         # s4 = 1
+
+        mul s5, s2, t0          # s5 = 0 (low word wraps)
+        mulh s6, s1, t0         # s6 = -1
+        mulhu s7, t1, t1        # s7 = 0xFFFFFFFE
+        mulhsu s8, t1, t1       # s8 = -1
+        mulhsu s9, t0, t1       # s9 = 1
+
+        li t2, 240
+        li t3, 15
+        or s10, t2, t3          # s10 = 255
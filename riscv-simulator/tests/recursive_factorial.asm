@@ -0,0 +1,36 @@
+# This program computes the factorial of 'n' recursively: fact(n) = n * fact(n - 1), fact(0) = 1.
+# Calls use t0 (x5), the alternate link register, because ra can only be written by JAL/JALR
+# and therefore cannot be restored from the stack. Run with --profile to see the call tree.
+
+.data
+    n:      .word 6          # Input value (6! = 720).
+    result: .word 0          # Output placeholder for the computed factorial.
+
+.text
+    main:
+        lw a0, 0(x0)            # a0 = n
+        li sp, 200              # Stack top, as an offset into the data section.
+        jal t0, fact            # a0 = fact(n)
+        jal x0, done
+
+    fact:
+        addi sp, sp, -8         # Push a frame: saved link register and n.
+        sw t0, 4(sp)
+        sw a0, 0(sp)
+        bne a0, x0, recurse     # Base case: fact(0) = 1.
+        li a0, 1
+        jal x0, fact_ret
+
+    recurse:
+        addi a0, a0, -1
+        jal t0, fact            # a0 = fact(n - 1)
+        lw t1, 0(sp)            # Reload n.
+        mul a0, a0, t1          # a0 = n * fact(n - 1)
+
+    fact_ret:
+        lw t0, 4(sp)            # Pop the frame and return.
+        addi sp, sp, 8
+        jalr x0, 0(t0)
+
+    done:
+        sw a0, 4(x0)            # Store the result in 'result'.
@@ -0,0 +1,40 @@
+# This program exercises the compressed (RVC) instructions: a loop and a
+# function call assembled under .option rvc, where every instruction that
+# has a 16-bit form takes 2 bytes, next to explicit c.* mnemonics and a
+# .option norvc block that stays 32-bit.
+
+.data
+    values:  .word 3, 5, 7, 9      # summed by the loop below.
+    result:  .word 0               # sum + 2 * 16 after the call.
+
+.text
+    main:
+.option rvc
+        li s0, 0                # s0 = address of values (c.li)
+        li s1, 4                # s1 = count (c.li)
+        li a0, 0                # a0 = sum (c.li)
+
+    loop:
+        lw a1, 0(s0)            # c.lw
+        add a0, a0, a1          # c.add
+        addi s0, s0, 4          # c.addi
+        addi s1, s1, -1         # c.addi
+        bne s1, x0, loop        # c.bnez
+
+        li a1, 16
+        jal ra, double          # c.jal
+        add a0, a0, a1          # a0 = 24 + 32 = 56
+        sw a0, 0(s0)            # c.sw into result
+.option norvc
+        addi t0, a0, 0          # stays 32-bit: t0 = 56
+        lui t1, 0x12345         # t1 = 0x12345000, too wide for c.lui
+        c.mv a2, t0             # a2 = 56
+        c.sub a2, s1            # a2 = 56 - 0
+        c.j end
+
+    double:
+        c.add a1, a1            # a1 = 32
+        c.jr ra
+
+    end:
+        c.nop
@@ -0,0 +1,70 @@
+# This program exercises the ECALL system calls: it prints a greeting and
+# a computed number with write, moves the heap break with brk, reads the
+# clock into the heap, checks the errors for an unknown call and a bad fd,
+# and ends with exit before running off the end of the program.
+
+.data
+    message:  .word 169961800      # 0x0A216948: "Hi!\n", little-endian.
+    digit:    .word 0              # one ASCII digit at a time.
+
+.text
+    main:
+        li a0, 1                # write(1, message, 4)
+        li a1, 0
+        li a2, 4
+        li a7, 64
+        ecall                   # a0 = 4
+
+        li t0, 10
+        li s0, 0
+    sum:
+        add s0, s0, t0
+        addi t0, t0, -1
+        bne t0, x0, sum         # s0 = 55
+
+        li s1, 10               # s1 = place value of the leading digit
+        li s2, 10
+    print:
+        divu t1, s0, s1
+        remu s0, s0, s1
+        addi t1, t1, 48         # t1 = ASCII digit
+        sw t1, 4(x0)            # Store it in 'digit'.
+        li a0, 1                # write(1, digit, 1)
+        li a1, 4
+        li a2, 1
+        li a7, 64
+        ecall
+        divu s1, s1, s2
+        bne s1, x0, print
+
+        li a0, 1                # write(1, "\n", 1): the last byte of 'message'
+        li a1, 3
+        li a2, 1
+        ecall
+
+        li a0, 0                # brk(0): the break starts after .data
+        li a7, 214
+        ecall
+        addi s3, a0, 0          # s3 = 8
+        addi a0, s3, 64         # brk(72)
+        ecall
+        addi s4, a0, 0          # s4 = 72
+
+        li a0, 1                # clock_gettime(CLOCK_MONOTONIC, heap + 32)
+        addi a1, s3, 32
+        li a7, 113
+        ecall                   # a0 = 0
+
+        li a7, 500              # no such call
+        ecall
+        addi s5, a0, 0          # s5 = -38 (-ENOSYS)
+
+        li a0, 5                # write(5, ...)
+        li a7, 64
+        ecall
+        addi s6, a0, 0          # s6 = -9 (-EBADF)
+
+        li a0, 0                # exit(0)
+        li a7, 93
+        ecall
+        li s7, 1                # never runs
@@ -0,0 +1,62 @@
+# This program exercises the RVV integer subset at SEW=32 on eight
+# elements: vector-vector, vector-scalar and vector-immediate forms of
+# vadd/vsub/vmul/vand/vor/vxor, a register group of two (LMUL=2) and
+# vredsum. Every result is folded into one checksum that is compared with
+# the value computed by hand; 'status' becomes 1 when it matches.
+
+.data
+    a0v: .word 1
+    a1v: .word 2
+    a2v: .word 3
+    a3v: .word 4
+    a4v: .word 5
+    a5v: .word 6
+    a6v: .word 7
+    a7v: .word -8
+    out0: .word 0           # Receives (a * 3) ^ 5 for the first four
+    out1: .word 0           # elements: 6, 3, 12, 9.
+    out2: .word 0
+    out3: .word 0
+    status: .word 0         # 1 when the checksum matched.
+
+.text
+    main:
+        li a0, 8
+        li a1, 0
+        vsetvli t0, a0, e32, m2, ta, ma # LMUL=2: vl = 8 for VLEN >= 128.
+        vle32.v v2, (a1)                # v2-v3 = {1, 2, 3, 4, 5, 6, 7, -8}
+
+        li t1, 3
+        vmul.vx v4, v2, t1              # {3, 6, 9, 12, 15, 18, 21, -24}
+        vxor.vi v6, v4, 5               # {6, 3, 12, 9, 10, 23, 16, -19}
+        vsub.vv v8, v6, v2              # {5, 1, 9, 5, 5, 17, 9, -11}
+        vand.vi v10, v8, 7              # {5, 1, 1, 5, 5, 1, 1, 5}
+        vor.vx v12, v10, t1             # {7, 3, 3, 7, 7, 3, 3, 7}
+        vadd.vi v14, v12, -2            # {5, 1, 1, 5, 5, 1, 1, 5}
+        vmul.vv v16, v14, v2            # {5, 2, 3, 20, 25, 6, 7, -40}
+        vsub.vx v18, v16, t1            # {2, -1, 0, 17, 22, 3, 4, -43}
+        vand.vv v20, v18, v6            # {2, 3, 0, 1, 2, 3, 0, -43 & -19 = -59}
+        vor.vv v22, v20, v10            # {7, 3, 1, 5, 7, 3, 1, -59 | 5 = -59}
+        vxor.vx v24, v22, t1            # {4, 0, 2, 6, 4, 0, 2, -58}
+        vadd.vx v26, v24, t1            # {7, 3, 5, 9, 7, 3, 5, -55}
+
+        vxor.vv v28, v28, v28           # v28[0] = 0
+        vredsum.vs v30, v26, v28        # v30[0] = 7+3+5+9+7+3+5-55 = -16
+
+        li t2, 4
+        vsetvli t0, t2, e32, m1, ta, ma # vl = 4
+        li a2, 32
+        vse32.v v6, (a2)                # out0-out3 = {6, 3, 12, 9}
+
+        li a3, 1
+        vsetvli t0, a3, e32, m1, ta, ma # vl = 1
+        li a4, 48
+        vse32.v v30, (a4)               # status = checksum for now
+        lw a5, 48(x0)
+        li a6, -16
+        li a7, 0
+        bne a5, a6, done
+        li a7, 1
+
+    done:
+        sw a7, 48(x0)                   # status = 1 if the checksum matched.
@@ -0,0 +1,40 @@
+# Vectorized vector_like_sum: sums the five words at data addresses 0-16
+# with the RVV subset and stores the result to 'result' (address 20).
+# The loop is strip-mined, so it gives the same sum for any VLEN: each
+# pass takes vl = min(elements left, VLMAX) and adds them into the partial
+# sums in v3, whose other elements are left alone (tail undisturbed).
+
+.data
+    val0: .word 3           # First word in memory.
+    val1: .word 5           # Second word in memory.
+    val2: .word 12          # Third word in memory.
+    val3: .word 7           # Fourth word in memory.
+    val4: .word 9           # Fifth word in memory.
+    result: .word 0         # Receives the sum (36).
+
+.text
+    main:
+        li a0, 5                        # Elements left.
+        li a1, 0                        # Address of the next element.
+        vsetvli t0, x0, e32, m1, tu, mu # vl = VLMAX to clear every partial sum.
+        vxor.vv v3, v3, v3
+
+    loop:
+        vsetvli t0, a0, e32, m1, tu, mu # t0 = vl = elements this pass.
+        vle32.v v2, (a1)                # Load vl words.
+        vadd.vv v3, v3, v2              # Add them to the partial sums.
+        sub a0, a0, t0
+        add t1, t0, t0
+        add t1, t1, t1                  # t1 = 4 * vl bytes.
+        add a1, a1, t1
+        bne a0, x0, loop
+
+    end:
+        vsetvli t0, x0, e32, m1, ta, ma # vl = VLMAX
+        vxor.vv v4, v4, v4              # v4[0] = 0 is the starting value.
+        vredsum.vs v5, v3, v4           # v5[0] = sum of the partial sums.
+        li a2, 1
+        vsetvli t0, a2, e32, m1, ta, ma # vl = 1
+        li a3, 20
+        vse32.v v5, (a3)                # Store the sum to 'result'.
+        lw a0, 20(x0)                   # a0 = 36
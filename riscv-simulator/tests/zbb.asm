@@ -0,0 +1,41 @@
+# This program exercises the Zbb bit-manipulation instructions: counting
+# (cpop/clz/ctz), logic with an inverted operand, signed and unsigned
+# min/max, rotates, sign/zero extension and the byte operations.
+
+.data
+    count:   .word 0              # cpop of 0x12345678.
+
+.text
+    main:
+        lui s0, 0x12345
+        addi s0, s0, 0x678      # s0 = 0x12345678
+        li s1, -2               # s1 = 0xFFFFFFFE
+        li s2, 128              # s2 = 0x80
+
+        cpop a0, s0             # a0 = 13
+        clz a1, s0              # a1 = 3
+        ctz a2, s1              # a2 = 1
+        clz a3, x0              # a3 = 32
+        cpop a4, s1             # a4 = 31
+
+        andn a5, s0, s1         # a5 = 0x12345678 & 1 = 0
+        orn a6, x0, s1          # a6 = 1
+        xnor a7, s0, s0         # a7 = -1
+
+        min t0, s1, s2          # t0 = -2
+        minu t1, s1, s2         # t1 = 128
+        max t2, s1, s2          # t2 = 128
+        maxu t3, s1, s2         # t3 = 0xFFFFFFFE
+
+        li t4, 8
+        rol s3, s0, t4          # s3 = 0x34567812
+        ror s4, s0, t4          # s4 = 0x78123456
+        rori s5, s0, 4          # s5 = 0x81234567
+
+        sext.b s6, s2           # s6 = -128
+        sext.h s7, s1           # s7 = -2
+        zext.h s8, s1           # s8 = 0xFFFE
+        rev8 s9, s0             # s9 = 0x78563412
+        orc.b s10, s2           # s10 = 0x000000FF
+        orc.b s11, s0           # s11 = 0xFFFFFFFF
+        sw a0, 0(x0)            # Store the bit count in 'count'.
@@ -0,0 +1,30 @@
+# This program exercises the Zicsr counters: a loop timed with rdinstret
+# and rdcycle, the high halves, mhartid and the explicit CSR instructions
+# with named and numeric CSRs. rdtime is left out as it differs per run.
+
+.data
+    loop_cost:  .word 0            # instructions the loop retired.
+
+.text
+    main:
+        li s1, 5                # s1 = iterations
+        rdinstret s0            # s0 = 1 (one instruction retired so far)
+
+    loop:
+        addi s1, s1, -1
+        bne s1, x0, loop
+
+        rdinstret a0            # a0 = 1 + 1 + 5 * 2 = 12
+        sub a0, a0, s0          # a0 = 11: the loop plus the first rdinstret
+        sw a0, 0(x0)            # Store the cost in 'loop_cost'.
+
+        rdcycle a1              # no timing model: cycle follows instret
+        rdinstret a2
+        sub a3, a2, a1          # a3 = 1
+        rdcycleh a4             # a4 = 0
+        rdinstreth a5           # a5 = 0
+
+        csrr a6, mhartid        # a6 = 0
+        csrrs a7, 0xC02, x0     # a7 = 21
+        csrrsi t0, instret, 0   # t0 = 22
+        csrrci x0, cycle, 0     # x0 discards the value
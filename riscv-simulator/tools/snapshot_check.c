@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "riscvsim.h"
+#include "syscall.h"
+
+/**
+ * Snapshot round-trip check.
+ *
+ * Loads each program, takes a snapshot, runs it, restores the snapshot and
+ * runs it again. A restore has to put back everything the first run
+ * changed (registers, memory, the heap break and exit status of the system
+ * calls), so both runs have to end in the same state, and right after the
+ * restore the guest must not look exited. Memory is compared up to the end
+ * of .data: the heap above it may hold clock_gettime readings, which differ
+ * from run to run. Exits 1 if any program fails.
+ **/
+
+#define SNAPSHOT_CHECK_BUDGET 10000000u
+
+typedef struct
+{
+    int32_t regs[32];
+    uint32_t pc;
+    uint64_t executed;
+    int exited;
+    int32_t exit_code;
+    uint8_t *memory;
+} RunState;
+
+static int snapshot_check_capture(RiscvSim *sim, RunState *state)
+{
+    Memory *m = rvsim_memory(sim);
+    for(int i = 0; i < 32; ++i)
+    {
+        state->regs[i] = rvsim_get_reg(sim, i);
+    }
+    state->pc = rvsim_get_pc(sim);
+    state->executed = rvsim_instructions_executed(sim);
+    state->exited = rvsim_exited(sim);
+    state->exit_code = rvsim_exit_code(sim);
+    state->memory = (uint8_t *)malloc(m->size ? m->size : 1);
+    if(!state->memory)
+        return -1;
+    memcpy(state->memory, m->data, m->size);
+    return 0;
+}
+
+// prints the first difference; returns 0 if the runs match
+static int snapshot_check_compare(const char *path, const RunState *a, const RunState *b, size_t memory_size)
+{
+    for(int i = 0; i < 32; ++i)
+    {
+        if(a->regs[i] != b->regs[i])
+        {
+            printf("[FAIL] %s: x%d is %d after the first run, %d after the rerun\n", path, i, a->regs[i], b->regs[i]);
+            return -1;
+        }
+    }
+    if(a->pc != b->pc || a->executed != b->executed)
+    {
+        printf("[FAIL] %s: stopped at PC 0x%08X after %llu instructions, then at 0x%08X after %llu\n", path,
+               a->pc, (unsigned long long)a->executed, b->pc, (unsigned long long)b->executed);
+        return -1;
+    }
+    if(a->exited != b->exited || a->exit_code != b->exit_code)
+    {
+        printf("[FAIL] %s: exit status %d/%d, then %d/%d\n", path, a->exited, a->exit_code, b->exited, b->exit_code);
+        return -1;
+    }
+    for(size_t i = 0; i < memory_size; ++i)
+    {
+        if(a->memory[i] != b->memory[i])
+        {
+            printf("[FAIL] %s: memory differs at 0x%08zX\n", path, i);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int snapshot_check_program(const char *path, int rvc)
+{
+    RiscvSim *sim = rvsim_create();
+    if(!sim)
+        return -1;
+    rvsim_set_rvc(sim, rvc);
+    rvsim_set_trace(sim, 0);
+
+    int rc = -1;
+    CpuSnapshot *snap = NULL;
+    RunState first = { 0 };
+    RunState second = { 0 };
+
+    if(rvsim_load_source(sim, path) < 0 || !(snap = rvsim_snapshot(sim)))
+    {
+        printf("[FAIL] %s: cannot load the program\n", path);
+        goto out;
+    }
+
+    rvsim_run(sim, SNAPSHOT_CHECK_BUDGET);
+    if(snapshot_check_capture(sim, &first) < 0 || rvsim_restore(sim, snap) < 0)
+        goto out;
+
+    if(rvsim_exited(sim) || rvsim_instructions_executed(sim) != 0)
+    {
+        printf("[FAIL] %s: the restored guest still looks exited\n", path);
+        goto out;
+    }
+
+    rvsim_run(sim, SNAPSHOT_CHECK_BUDGET);
+    if(snapshot_check_capture(sim, &second) < 0)
+        goto out;
+
+    size_t compared = (size_t)rvsim_data_offset(sim) + rvsim_syscalls(sim)->brk_start;
+    if(compared > rvsim_memory(sim)->size)
+        compared = rvsim_memory(sim)->size;
+    rc = snapshot_check_compare(path, &first, &second, compared);
+    if(rc == 0)
+        printf("[OK] %s\n", path);
+
+out:
+    free(first.memory);
+    free(second.memory);
+    if(snap)
+        rvsim_snapshot_free(snap);
+    rvsim_destroy(sim);
+    return rc;
+}
+
+int main(int argc, char **argv)
+{
+    int rvc = 0;
+    int failed = 0;
+    int checked = 0;
+
+    for(int c = 0; c < LOG_CAT_COUNT; ++c)
+    {
+        log_set_level((LogCategory)c, LOG_LEVEL_ERROR);
+    }
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--rvc") == 0)
+        {
+            rvc = 1;
+            continue;
+        }
+        if(snapshot_check_program(argv[i], rvc) < 0)
+            failed++;
+        checked++;
+    }
+
+    if(checked == 0)
+    {
+        fprintf(stderr, "Usage: %s [--rvc] <program.asm>...\n", argv[0]);
+        return 2;
+    }
+    return failed ? 1 : 0;
+}
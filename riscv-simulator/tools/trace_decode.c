@@ -0,0 +1,354 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "instruction.h"
+#include "loop_trace.h"
+#include "rvc.h"
+#include "trace.h"
+
+/**
+ * Offline decoder for binary execution traces (--trace-bin).
+ *
+ * Replays the trace against a shadow register file and renders every record
+ * in the simulator's [STEP]/[EXEC] text format, so a run can be traced at
+ * full speed and inspected afterwards.
+ *
+ * With --expand, a log written with --trace-loops is expanded instead: every
+ * [LOOP] block is replaced by the [STEP]/[EXEC] lines of its iterations.
+ **/
+
+typedef struct
+{
+    int32_t regs[TRACE_REGS];
+    uint32_t step;
+} DecodeState;
+
+// ================================================================= //
+//                        LOOP LOG EXPANSION                         //
+// ================================================================= //
+
+typedef struct
+{
+    // most recent [STEP] lines, the loop block is taken from their tail
+    uint32_t pc[LOOP_TRACE_MAX_BODY];
+    uint32_t word[LOOP_TRACE_MAX_BODY];
+    int head;
+    int count;
+    uint32_t next_step;
+
+    // block being expanded
+    int block_size;
+    uint32_t block_pc[LOOP_TRACE_MAX_BODY];
+    uint32_t block_word[LOOP_TRACE_MAX_BODY];
+    uint32_t data_offset;
+    int32_t regs[TRACE_REGS];
+
+    // register writes of the last expanded iteration, strided runs repeat them
+    LoopTraceEntry last[LOOP_TRACE_MAX_BODY];
+    int last_count;
+} ExpandState;
+
+static void expand_remember_step(ExpandState *ex, uint32_t step, uint32_t pc, uint32_t word)
+{
+    ex->pc[ex->head] = pc;
+    ex->word[ex->head] = word;
+    ex->head = (ex->head + 1) % LOOP_TRACE_MAX_BODY;
+    if(ex->count < LOOP_TRACE_MAX_BODY)
+        ex->count++;
+    ex->next_step = step + 1;
+}
+
+static int expand_begin_block(ExpandState *ex, int size, uint32_t first_pc, uint32_t data_offset)
+{
+    if(size <= 0 || size > ex->count)
+        return -1;
+
+    for(int i = 0; i < size; ++i)
+    {
+        int slot = (ex->head - size + i + LOOP_TRACE_MAX_BODY) % LOOP_TRACE_MAX_BODY;
+        ex->block_pc[i] = ex->pc[slot];
+        ex->block_word[i] = ex->word[slot];
+    }
+
+    ex->block_size = size;
+    ex->data_offset = data_offset;
+    return (ex->block_pc[0] == first_pc) ? 0 : -1;
+}
+
+static void expand_parse_regs(ExpandState *ex, const char *line)
+{
+    memset(ex->regs, 0, sizeof(ex->regs));
+
+    const char *p = line;
+    int reg;
+    uint32_t value;
+    int used;
+    while((p = strchr(p, 'x')) != NULL)
+    {
+        if(sscanf(p, "x%d=0x%X%n", &reg, &value, &used) == 2 && reg > 0 && reg < TRACE_REGS)
+        {
+            ex->regs[reg] = (int32_t)value;
+            p += used;
+        }
+        else
+        {
+            p++;
+        }
+    }
+}
+
+// renders one iteration of the block with the given register writes
+static void expand_render_iteration(ExpandState *ex, const LoopTraceEntry *entries, int count)
+{
+    const LoopTraceEntry *at[LOOP_TRACE_MAX_BODY] = {0};
+    for(int i = 0; i < count; ++i)
+    {
+        at[entries[i].pos] = &entries[i];
+    }
+
+    for(int i = 0; i < ex->block_size; ++i)
+    {
+        TraceRecord rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.pc = ex->block_pc[i];
+        rec.word = ex->block_word[i];
+
+        // a compressed instruction is logged as its halfword; its fields are
+        // those of the 32-bit instruction it expands to
+        uint32_t w = (rvc_length(rec.word) == 2) ? rvc_expand((uint16_t)rec.word) : rec.word;
+        uint8_t opcode = w & 0x7F;
+        if(opcode != 0x23 && opcode != 0x63)
+            rec.rd = rtype_get_rd(w);
+
+        if(at[i] && at[i]->reg != 0)
+        {
+            rec.flags |= TRACE_F_RD;
+            rec.rd_value = at[i]->value;
+        }
+        else if(rec.rd != 0 && (!vtype_is_vector(w) || vtype_is_vsetvli(w)))
+        {
+            // the log leaves out writes that did not change rd
+            rec.flags |= TRACE_F_RD;
+            rec.rd_value = ex->regs[rec.rd];
+        }
+
+        if(opcode == 0x03)
+        {
+            rec.flags |= TRACE_F_LOAD;
+            rec.mem_addr = ex->data_offset + ex->regs[itype_get_rs1(w)] + itype_get_immediate(w);
+            rec.mem_value = at[i] ? at[i]->value : ex->regs[rec.rd];
+        }
+        else if(opcode == 0x23)
+        {
+            rec.flags |= TRACE_F_STORE;
+            rec.mem_addr = ex->data_offset + ex->regs[stype_get_rs1(w)] + stype_get_immediate(w);
+            rec.mem_value = ex->regs[stype_get_rs2(w)];
+        }
+        else if(opcode == 0x07 || opcode == 0x27)
+        {
+            // only the address is rendered for vector loads and stores
+            rec.flags |= (opcode == 0x07) ? TRACE_F_LOAD : TRACE_F_STORE;
+            rec.mem_addr = ex->data_offset + ex->regs[rtype_get_rs1(w)];
+        }
+        else if(opcode == 0x2F)
+        {
+            // LR.W and the AMOs record the word they read, SC.W only reports rd
+            rec.mem_addr = ex->data_offset + ex->regs[rtype_get_rs1(w)];
+            rec.mem_value = at[i] ? at[i]->value : ex->regs[rec.rd];
+        }
+
+        trace_render_record(stdout, ex->next_step++, ex->regs, &rec);
+
+        if((rec.flags & TRACE_F_RD) && rec.rd != 0)
+            ex->regs[rec.rd] = rec.rd_value;
+    }
+
+    memcpy(ex->last, entries, sizeof(LoopTraceEntry) * count);
+    ex->last_count = count;
+}
+
+static int expand_iteration(ExpandState *ex, const char *line)
+{
+    LoopTraceEntry entries[LOOP_TRACE_MAX_BODY];
+    int count = 0;
+    uint32_t first, last;
+
+    const char *p = strchr(line, ']');
+    if(!p)
+        return -1;
+    p++;
+
+    int pos, reg, used;
+    if(sscanf(line, "[ITER %u..%u]", &first, &last) == 2)
+    {
+        // a run: every iteration repeats the previous writes plus a stride
+        int32_t stride[LOOP_TRACE_MAX_BODY];
+        int32_t value;
+        while(count < ex->last_count && sscanf(p, " %d:x%d+=%d%n", &pos, &reg, &value, &used) == 3)
+        {
+            if(pos != ex->last[count].pos || reg != ex->last[count].reg)
+                return -1;
+            stride[count++] = value;
+            p += used;
+        }
+        if(count != ex->last_count || last < first)
+            return -1;
+
+        for(uint32_t it = first; it <= last; ++it)
+        {
+            memcpy(entries, ex->last, sizeof(LoopTraceEntry) * count);
+            for(int i = 0; i < count; ++i)
+            {
+                entries[i].value = (int32_t)((uint32_t)entries[i].value + (uint32_t)stride[i]);
+            }
+            expand_render_iteration(ex, entries, count);
+        }
+        return 0;
+    }
+
+    uint32_t value;
+    while(count < LOOP_TRACE_MAX_BODY && sscanf(p, " %d:x%d=0x%X%n", &pos, &reg, &value, &used) == 3)
+    {
+        if(pos < 0 || pos >= ex->block_size || reg < 0 || reg >= TRACE_REGS)
+            return -1;
+
+        entries[count].pos = pos;
+        entries[count].reg = reg;
+        entries[count].value = (int32_t)value;
+        count++;
+        p += used;
+    }
+
+    expand_render_iteration(ex, entries, count);
+    return 0;
+}
+
+static int expand_log(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if(!f)
+    {
+        printf("[ERROR] trace_decode: cannot open '%s'\n", path);
+        return 1;
+    }
+
+    static ExpandState ex;
+    memset(&ex, 0, sizeof(ex));
+
+    char line[4096];
+    int blank_pending = 0;
+    int line_number = 0;
+    int rc = 0;
+    while(fgets(line, sizeof(line), f))
+    {
+        line_number++;
+
+        // the blank line in front of [LOOP] only separates the block
+        if(line[0] == '\n')
+        {
+            if(blank_pending)
+                printf("\n");
+            blank_pending = 1;
+            continue;
+        }
+
+        uint32_t step, pc, word, last_pc, data_offset;
+        int size;
+        if(strncmp(line, "[LOOP] ", 7) == 0 &&
+           sscanf(line, "[LOOP] block PC=0x%X..0x%X, %d instructions, data=0x%X",
+                  &pc, &last_pc, &size, &data_offset) == 4)
+        {
+            blank_pending = 0;
+            if(expand_begin_block(&ex, size, pc, data_offset) < 0)
+            {
+                printf("[ERROR] trace_decode: %s:%d: loop block does not follow its first iteration\n",
+                       path, line_number);
+                rc = 1;
+                break;
+            }
+            continue;
+        }
+
+        if(blank_pending)
+            printf("\n");
+        blank_pending = 0;
+
+        if(strncmp(line, "[REGS]", 6) == 0)
+        {
+            expand_parse_regs(&ex, line);
+        }
+        else if(strncmp(line, "[ITER ", 6) == 0)
+        {
+            if(expand_iteration(&ex, line) < 0)
+            {
+                printf("[ERROR] trace_decode: %s:%d: malformed iteration\n", path, line_number);
+                rc = 1;
+                break;
+            }
+        }
+        else if(strncmp(line, "[LOOP END]", 10) == 0)
+        {
+            continue;
+        }
+        else
+        {
+            if(sscanf(line, "[STEP %u] PC=0x%X, Instruction=0x%X", &step, &pc, &word) == 3)
+                expand_remember_step(&ex, step, pc, word);
+            fputs(line, stdout);
+        }
+    }
+
+    if(blank_pending)
+        printf("\n");
+
+    fclose(f);
+    return rc;
+}
+
+int main(int argc, char **argv)
+{
+    if(argc == 3 && strcmp(argv[1], "--expand") == 0)
+        return expand_log(argv[2]);
+
+    if(argc != 2)
+    {
+        printf("Usage: %s <trace.bin>\n"
+               "       %s --expand <loop-trace.log>\n", argv[0], argv[0]);
+        return 1;
+    }
+
+    TraceReader reader;
+    if(trace_reader_open(&reader, argv[1]) < 0)
+        return 1;
+
+    DecodeState st;
+    memcpy(st.regs, reader.start_regs, sizeof(st.regs));
+    st.step = 0;
+
+    printf("\n=== Starting CPU Execution ===\n");
+
+    TraceRecord rec;
+    int rc;
+    while((rc = trace_reader_next(&reader, &rec)) > 0)
+    {
+        trace_render_record(stdout, st.step, st.regs, &rec);
+
+        if(rec.flags & TRACE_F_RD)
+            st.regs[rec.rd] = rec.rd_value;
+        st.step++;
+    }
+
+    trace_reader_close(&reader);
+
+    if(rc < 0)
+    {
+        printf("[ERROR] trace_decode: malformed record after step %u\n", st.step);
+        return 1;
+    }
+
+    printf("\n=== CPU Execution Finished ===\n");
+    printf("Total instructions executed: %u\n", st.step);
+    return 0;
+}